@@ -3,17 +3,38 @@ HEADERS += \
     $$PWD/quickenapplicationmonitor_p.h \
     $$PWD/quickenbitmaptext_p.h \
     $$PWD/quickenbitmaptextfont_p.h \
+    $$PWD/quickencounter.h \
+    $$PWD/quickencounter_p.h \
+    $$PWD/quickenenginestatistics_p.h \
     $$PWD/quickengputimer_p.h \
+    $$PWD/quickenhistogram_p.h \
     $$PWD/quickenlogger.h \
     $$PWD/quickenlogger_p.h \
+    $$PWD/quickenlogreader.h \
+    $$PWD/quickenlogreader_p.h \
     $$PWD/quickenmetrics.h \
     $$PWD/quickenmetrics_p.h \
-    $$PWD/quickenoverlay_p.h
+    $$PWD/quickenmetricscodec_p.h \
+    $$PWD/quickenoverlay_p.h \
+    $$PWD/quickenperfcounters_p.h \
+    $$PWD/quickenprocfile_p.h \
+    $$PWD/quickenscenegraphstatistics_p.h \
+    $$PWD/quickentrace.h \
+    $$PWD/quickentrace_p.h
 
 SOURCES += \
     $$PWD/quickenapplicationmonitor.cpp \
     $$PWD/quickenbitmaptext.cpp \
+    $$PWD/quickencounter.cpp \
+    $$PWD/quickenenginestatistics.cpp \
     $$PWD/quickengputimer.cpp \
+    $$PWD/quickenhistogram.cpp \
     $$PWD/quickenlogger.cpp \
+    $$PWD/quickenlogreader.cpp \
     $$PWD/quickenmetrics.cpp \
-    $$PWD/quickenoverlay.cpp
+    $$PWD/quickenmetricscodec.cpp \
+    $$PWD/quickenoverlay.cpp \
+    $$PWD/quickenperfcounters.cpp \
+    $$PWD/quickenprocfile.cpp \
+    $$PWD/quickenscenegraphstatistics.cpp \
+    $$PWD/quickentrace.cpp
@@ -6,31 +6,66 @@
 
 #include "quickenapplicationmonitor_p.h"
 
+#include <limits.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <new>
+
+#include <QtCore/QAnimationDriver>
 #include <QtCore/QTimer>
 #include <QtGui/QGuiApplication>
+#include <QtGui/QMouseEvent>
+#include <QtGui/QScreen>
 #include <QtQuick/QQuickWindow>
 #include <QtQuick/QSGRendererInterface>
+#include <QtQuick/private/qquickwindow_p.h>
+#include <QtQuick/private/qsgrenderer_p.h>
+#include <QtQuick/private/qsgrenderloop_p.h>
+
+#include "quickencounter_p.h"
+#include "quickenscenegraphstatistics_p.h"
+#include "quickentrace_p.h"
 
 // FIXME(loicm) When a monitored window is destroyed and if there's a window
 //     that's not monitored because the max count was reached, enable monitoring
 //     on it if possible.
 
-const int logQueueSize = 16;
 const int logQueueAlignment = 64;
 
-LoggingThread::LoggingThread()
+// Maximum time in milliseconds between two reports of dropped metrics while
+// the logging thread is busy.
+const qint64 droppedReportInterval = 1000;
+
+LoggingThread::LoggingThread(int queueSize, QuickenApplicationMonitor::OverflowPolicy policy)
     : m_loggerCount(0)
     , m_refCount(1)
-    , m_queueIndex(0)
-    , m_queueSize(0)
+    , m_waiting(0)
+    , m_hasDropped(0)
+    , m_overflowPolicy(policy)
+    , m_queueMask(queueSize - 1)
     , m_flags(0)
+    , m_queueHead(0)
+    , m_queueTail(0)
 {
-    m_queue = static_cast<QuickenMetrics*>(
-        alignedAlloc(logQueueAlignment, logQueueSize * sizeof(QuickenMetrics)));
-
-#if !defined(QT_NO_DEBUG)
-    setObjectName(QStringLiteral("Quicken logging"));  // Thread name.
-#endif
+    DASSERT(queueSize >= QuickenApplicationMonitorPrivate::minLoggingQueueSize);
+    DASSERT(queueSize <= QuickenApplicationMonitorPrivate::maxLoggingQueueSize);
+    DASSERT(IS_POWER_OF_TWO(queueSize));
+
+    m_queue = static_cast<QueueSlot*>(
+        alignedAlloc(logQueueAlignment, queueSize * sizeof(QueueSlot)));
+    for (int i = 0; i < queueSize; ++i) {
+        new (&m_queue[i].sequence) QAtomicInteger<quint32>(i);
+    }
+    m_batch = static_cast<QuickenMetrics*>(
+        alignedAlloc(logQueueAlignment, queueSize * sizeof(QuickenMetrics)));
+    m_dropped[maxDroppedCounts - 1].window.store(QuickenDroppedMetrics::otherWindows);
+    m_droppedTimer.start();
+
+    // Thread name, always set since the thread metrics identify the logging
+    // role with it.
+    setObjectName(QStringLiteral("Quicken logging"));
     start();
 }
 
@@ -38,77 +73,293 @@ LoggingThread::~LoggingThread()
 {
     m_mutex.lock();
     m_flags |= JoinRequested;
-    if (m_flags & Waiting) {
+    if (m_waiting.load()) {
         m_condition.wakeOne();
     }
     m_mutex.unlock();
     wait();
 
+    free(m_batch);
     free(m_queue);
 }
 
-#define BREAK_ON_JOIN_REQUEST()                \
-    if (Q_UNLIKELY(m_flags & JoinRequested)) { \
-        m_mutex.unlock();                      \
-        break;                                 \
-    }
-
 // Logging thread entry point.
 void LoggingThread::run()
 {
     DLOG("Entering logging thread.");
+    const int batchSize = m_queueMask + 1;
     while (true) {
-        // Wait for new metrics in the log queue.
-        m_mutex.lock();
-        DASSERT(m_queueSize >= 0);
-        if (m_queueSize == 0) {
-            BREAK_ON_JOIN_REQUEST();
-            m_flags |= Waiting;
-            m_condition.wait(&m_mutex);
-            if (m_queueSize == 0) {
-                BREAK_ON_JOIN_REQUEST();
-            }
-            m_flags &= ~Waiting;
+        // Unqueue all the metrics available in the log queue, oldest first.
+        int count = 0;
+        while (count < batchSize && pop(&m_batch[count])) {
+            count++;
         }
 
-        // Unqueue oldest metrics from the log queue.
-        DASSERT(m_queueSize > 0);
-        QuickenMetrics metrics;
-        memcpy(&metrics, &m_queue[m_queueIndex], sizeof(QuickenMetrics));
-        m_queueIndex = (m_queueIndex + 1) % logQueueSize;
-        m_queueSize--;
-
-        // Log.
+        // Get the loggers.
+        m_mutex.lock();
         const int loggerCount = m_loggerCount;
         QuickenLogger* loggers[QuickenApplicationMonitorPrivate::maxLoggers];
         memcpy(loggers, m_loggers, loggerCount * sizeof(QuickenLogger*));
         m_mutex.unlock();
-        for (int i = 0; i < loggerCount; ++i) {
-            loggers[i]->log(metrics);
+
+        // Log.
+        if (count > 0) {
+            for (int i = 0; i < loggerCount; ++i) {
+                loggers[i]->logBatch(m_batch, count);
+            }
+        }
+
+        // Report dropped metrics once the queue is drained or, under sustained
+        // overflow, at regular intervals.
+        if (Q_UNLIKELY(m_hasDropped.loadAcquire())
+            && (count < batchSize || m_droppedTimer.elapsed() > droppedReportInterval)) {
+            logDropped(loggers, loggerCount);
+        }
+
+        if (count < batchSize) {
+            // Let the loggers write buffered metrics, the thread is woken up
+            // after the shortest delay they return if nothing is logged.
+            int idleTimeout = -1;
+            for (int i = 0; i < loggerCount; ++i) {
+                const int timeout = loggers[i]->idle();
+                if (timeout >= 0 && (idleTimeout < 0 || timeout < idleTimeout)) {
+                    idleTimeout = timeout;
+                }
+            }
+
+            // The log queue is empty, park the thread. The waiting flag must be
+            // visible to producers before the queue is checked again, the
+            // fence pairs with the one in wakeUp() so that either the producer
+            // sees the flag or we see its metrics.
+            m_mutex.lock();
+            m_waiting.store(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (isQueueEmpty()) {
+                if (Q_UNLIKELY(m_flags & JoinRequested)) {
+                    m_waiting.store(0);
+                    m_mutex.unlock();
+                    break;
+                }
+                m_condition.wait(&m_mutex, idleTimeout >= 0 ? idleTimeout : ULONG_MAX);
+            }
+            m_waiting.store(0);
+            m_mutex.unlock();
         }
     }
     DLOG("Leaving logging thread.");
 }
 
+// Bounded queue based on Dmitry Vyukov's bounded MPMC queue. A producer
+// reserves a slot by incrementing the head index, a slot can be reserved at a
+// given position if its sequence number equals the position. Once written,
+// the sequence number is set to position + 1 which tells consumers it's ready
+// to be read. A consumer reserves it by incrementing the tail index and then
+// sets the sequence number to position + size to release it for the next
+// round. The logging thread is the only consumer except with the DropOldest
+// policy where producers consume the oldest metrics when the queue is full.
 void LoggingThread::push(const QuickenMetrics* metrics)
 {
-    // Ensure the log queue is not full.
-    m_mutex.lock();
-    DASSERT(m_queueSize <= logQueueSize);
-    while (m_queueSize == logQueueSize) {
-        m_mutex.unlock();
-        QThread::yieldCurrentThread();
-        m_mutex.lock();
+    push(metrics, m_overflowPolicy.load());
+}
+
+void LoggingThread::tryPush(const QuickenMetrics* metrics)
+{
+    const quint32 policy = m_overflowPolicy.load();
+    push(metrics, policy == QuickenApplicationMonitor::Block
+         ? static_cast<quint32>(QuickenApplicationMonitor::DropNewest) : policy);
+}
+
+void LoggingThread::push(const QuickenMetrics* metrics, quint32 policy)
+{
+    DASSERT(metrics);
+
+    QueueSlot* slot;
+    quint32 position = m_queueHead.load();
+    while (true) {
+        slot = &m_queue[position & m_queueMask];
+        const qint32 difference =
+            static_cast<qint32>(slot->sequence.loadAcquire() - position);
+        if (difference == 0) {
+            // Slot is free, try to reserve it.
+            if (m_queueHead.testAndSetRelaxed(position, position + 1, position)) {
+                break;
+            }
+        } else if (difference < 0) {
+            // The log queue is full, the consumer hasn't released that slot.
+            switch (policy) {
+            case QuickenApplicationMonitor::DropNewest:
+                countDropped(*metrics);
+                return;
+            case QuickenApplicationMonitor::DropOldest: {
+                QuickenMetrics oldest;
+                if (pop(&oldest)) {
+                    countDropped(oldest);
+                } else {
+                    // The oldest slot is reserved by a producer that hasn't
+                    // written it yet, let it finish.
+                    QThread::yieldCurrentThread();
+                }
+                break;
+            }
+            default:
+                QThread::yieldCurrentThread();
+                break;
+            }
+            position = m_queueHead.load();
+        } else {
+            // Another producer reserved that slot in the meantime.
+            position = m_queueHead.load();
+        }
+    }
+
+    memcpy(&slot->metrics, metrics, sizeof(QuickenMetrics));
+    slot->sequence.storeRelease(position + 1);
+
+    wakeUp();
+}
+
+bool LoggingThread::pop(QuickenMetrics* metrics)
+{
+    DASSERT(metrics);
+
+    QueueSlot* slot;
+    quint32 position = m_queueTail.load();
+    while (true) {
+        slot = &m_queue[position & m_queueMask];
+        const qint32 difference =
+            static_cast<qint32>(slot->sequence.loadAcquire() - (position + 1));
+        if (difference == 0) {
+            // Slot is ready, try to reserve it.
+            if (m_queueTail.testAndSetRelaxed(position, position + 1, position)) {
+                break;
+            }
+        } else if (difference < 0) {
+            // Empty or the slot reserved by a producer isn't written yet.
+            return false;
+        } else {
+            // Another consumer reserved that slot in the meantime.
+            position = m_queueTail.load();
+        }
     }
 
-    // Push metrics to the log queue.
-    DASSERT(m_queueSize < logQueueSize);
-    memcpy(&m_queue[(m_queueIndex + m_queueSize++) % logQueueSize], metrics,
-           sizeof(QuickenMetrics));
-    if (m_flags & Waiting) {
+    memcpy(metrics, &slot->metrics, sizeof(QuickenMetrics));
+    slot->sequence.storeRelease(position + m_queueMask + 1);
+    return true;
+}
+
+bool LoggingThread::isQueueEmpty() const
+{
+    const quint32 position = m_queueTail.load();
+    const QueueSlot* slot = &m_queue[position & m_queueMask];
+    return static_cast<qint32>(slot->sequence.loadAcquire() - (position + 1)) < 0;
+}
+
+void LoggingThread::wakeUp()
+{
+    // Cheap check in the common case where the consumer is busy, the lock is
+    // only taken when it's parked (or about to).
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_waiting.load()) {
+        m_mutex.lock();
         m_condition.wakeOne();
+        m_mutex.unlock();
     }
-    m_mutex.unlock();
+}
+
+// Called by producers whenever metrics are dropped, possibly from the render
+// threads, so the counts are updated without locking.
+void LoggingThread::countDropped(const QuickenMetrics& metrics)
+{
+    DASSERT(metrics.type < QuickenMetrics::TypeCount);
+
+    quint32 window;
+    switch (metrics.type) {
+    case QuickenMetrics::Window:
+        window = metrics.window.id;
+        break;
+    case QuickenMetrics::Frame:
+        window = metrics.frame.window;
+        break;
+    case QuickenMetrics::PerfCounters:
+        window = metrics.perfCounters.window;
+        break;
+    case QuickenMetrics::Engine:
+        window = metrics.engine.window;
+        break;
+    case QuickenMetrics::Pacing:
+        window = metrics.pacing.window;
+        break;
+    case QuickenMetrics::Timeline:
+        window = metrics.timeline.window;
+        break;
+    default:
+        window = 0;
+        break;
+    }
+
+    // The first slot is for metrics not bound to a window, the last one for
+    // windows dropping metrics once all the others are taken. The others are
+    // claimed by the first metrics dropped for a window and kept for the
+    // lifetime of the logging thread, window ids aren't reused.
+    DroppedCount* dropped = &m_dropped[0];
+    if (window != 0) {
+        int index = 1;
+        for (; index < maxDroppedCounts - 1; ++index) {
+            quint32 slotWindow = m_dropped[index].window.loadAcquire();
+            if (slotWindow == 0) {
+                m_dropped[index].window.testAndSetOrdered(0, window, slotWindow);
+                if (slotWindow == 0) {
+                    break;
+                }
+            }
+            if (slotWindow == window) {
+                break;
+            }
+        }
+        dropped = &m_dropped[index];
+    }
+    dropped->count[metrics.type].fetchAndAddRelaxed(1);
+    m_hasDropped.storeRelease(1);
+}
+
+void LoggingThread::logDropped(QuickenLogger** loggers, int loggerCount)
+{
+    // Cleared before the counts are taken so that metrics dropped in the
+    // meantime are reported next time.
+    m_hasDropped.fetchAndStoreOrdered(0);
+    m_droppedTimer.start();
+
+    QuickenMetrics metrics[maxDroppedCounts];
+    int droppedSize = 0;
+    const quint64 timeStamp = QuickenMetricsUtils::timeStamp();
+    for (int i = 0; i < maxDroppedCounts; ++i) {
+        quint32 count[QuickenMetrics::TypeCount];
+        quint32 total = 0;
+        for (int j = 0; j < QuickenMetrics::TypeCount; ++j) {
+            count[j] = m_dropped[i].count[j].fetchAndStoreRelaxed(0);
+            total += count[j];
+        }
+        if (total == 0) {
+            continue;
+        }
+        memset(&metrics[droppedSize], 0, sizeof(QuickenMetrics));
+        metrics[droppedSize].type = QuickenMetrics::Dropped;
+        metrics[droppedSize].timeStamp = timeStamp;
+        metrics[droppedSize].dropped.window = m_dropped[i].window.loadAcquire();
+        memcpy(metrics[droppedSize].dropped.count, count, sizeof(count));
+        droppedSize++;
+    }
+    if (droppedSize == 0) {
+        return;
+    }
+    for (int i = 0; i < loggerCount; ++i) {
+        loggers[i]->logBatch(metrics, droppedSize);
+    }
+}
+
+void LoggingThread::setOverflowPolicy(QuickenApplicationMonitor::OverflowPolicy policy)
+{
+    m_overflowPolicy.store(policy);
 }
 
 void LoggingThread::setLoggers(QuickenLogger** loggers, int count)
@@ -157,8 +408,10 @@ QuickenApplicationMonitorPrivate::QuickenApplicationMonitorPrivate(
     , m_loggingThread(nullptr)
     , m_monitorCount(0)
     , m_loggerCount(0)
-    , m_updateInterval{1000, -1, -1}
+    , m_loggingQueueSize(16)
+    , m_overflowPolicy(QuickenApplicationMonitor::Block)
     , m_flags(QuickenApplicationMonitor::AllMetrics)
+    , m_inputCheckQueued(false)
 {
     Q_Q(QuickenApplicationMonitor);
 
@@ -168,13 +421,25 @@ QuickenApplicationMonitorPrivate::QuickenApplicationMonitorPrivate(
     m_application = application;
 #endif
 
+    // Only process, memory and pacing metrics are updated periodically.
+    Q_STATIC_ASSERT(sizeof(m_updateInterval) == QuickenMetrics::TypeCount * sizeof(int));
+    for (int i = 0; i < QuickenMetrics::TypeCount; ++i) {
+        m_updateInterval[i] = -1;
+    }
+    m_updateInterval[QuickenMetrics::Process] = 1000;
+    m_updateInterval[QuickenMetrics::Memory] = 10000;
+    m_updateInterval[QuickenMetrics::Pacing] = 1000;
+
     q->setParent(application);
 
     QObject::connect(application, SIGNAL(lastWindowClosed()), q, SLOT(closeDown()));
     QObject::connect(application, SIGNAL(aboutToQuit()), q, SLOT(closeDown()));
     QObject::connect(&m_processTimer, SIGNAL(timeout()), q, SLOT(processTimeout()));
+    QObject::connect(&m_memoryTimer, SIGNAL(timeout()), q, SLOT(memoryTimeout()));
 
     m_processTimer.setInterval(m_updateInterval[QuickenMetrics::Process]);
+    m_memoryTimer.setInterval(m_updateInterval[QuickenMetrics::Memory]);
+    memset(&m_memoryMetrics, 0, sizeof(QuickenMetrics));
 }
 
 QuickenApplicationMonitor::~QuickenApplicationMonitor()
@@ -234,6 +499,9 @@ void QuickenApplicationMonitor::setLogging(bool logging)
                 d->start();
             } else {
                 d->setMonitoringFlags(d->m_flags);
+                if (d->m_flags & QuickenApplicationMonitorPrivate::Started) {
+                    d->logNumericDeclarations();
+                }
             }
         } else {
             d->m_flags &= ~QuickenApplicationMonitorPrivate::Logging;
@@ -267,6 +535,12 @@ void QuickenApplicationMonitorPrivate::startMonitoring(QQuickWindow* window)
             new WindowMonitor(q_func(), window, m_loggingThread->ref(), m_flags, ++id);
         m_metricsUtils.updateProcessMetrics(&m_processMetrics);
         m_monitors[m_monitorCount]->setProcessMetrics(m_processMetrics);
+        m_monitors[m_monitorCount]->setPacingInterval(m_updateInterval[QuickenMetrics::Pacing]);
+        // Memory metrics are too expensive to be updated here, the last ones
+        // are set if any.
+        if (m_memoryMetrics.type == QuickenMetrics::Memory) {
+            m_monitors[m_monitorCount]->setMemoryMetrics(m_memoryMetrics);
+        }
         m_monitorCount++;
     } else {
         WARN("ApplicationMonitor: Can't monitor more than %d QQuickWindows.", maxMonitors);
@@ -278,7 +552,7 @@ void QuickenApplicationMonitorPrivate::start()
     DASSERT(!(m_flags & Started));
     DASSERT(!m_loggingThread);
 
-    m_loggingThread = new LoggingThread;
+    m_loggingThread = new LoggingThread(m_loggingQueueSize, m_overflowPolicy);
     m_loggingThread->setLoggers(m_loggers, m_loggerCount);
 
     QWindowList windows = QGuiApplication::allWindows();
@@ -297,12 +571,21 @@ void QuickenApplicationMonitorPrivate::start()
 
     // Doing it here so that processTimeout can assert the monitoring started.
     m_flags |= Started;
+    updateTracing();
+
+    if (m_flags & Logging) {
+        logNumericDeclarations();
+    }
 
     memset(&m_processMetrics, 0, sizeof(QuickenMetrics));
     processTimeout();
     if (m_updateInterval[QuickenMetrics::Process] >= 0) {
         m_processTimer.start();
     }
+    memoryTimeout();
+    if (m_updateInterval[QuickenMetrics::Memory] >= 0) {
+        m_memoryTimer.start();
+    }
 }
 
 bool QuickenApplicationMonitorPrivate::removeMonitor(WindowMonitor* monitor)
@@ -373,6 +656,9 @@ void QuickenApplicationMonitorPrivate::stop()
     if (m_updateInterval[QuickenMetrics::Process] >= 0) {
         m_processTimer.stop();
     }
+    if (m_updateInterval[QuickenMetrics::Memory] >= 0) {
+        m_memoryTimer.stop();
+    }
 
     QGuiApplication::instance()->removeEventFilter(q_func());
 
@@ -387,6 +673,10 @@ void QuickenApplicationMonitorPrivate::stop()
         stopMonitoring(monitorsCopy[i]);
     }
 
+    // Scopes buffered by all the threads are flushed before deactivation.
+    QuickenTracePrivate::flushBuffers();
+    QuickenTracePrivate::setLoggingThread(nullptr);
+
     DASSERT(m_loggingThread);
     m_loggingThread->deref();
     m_loggingThread = nullptr;
@@ -450,6 +740,15 @@ void QuickenApplicationMonitorPrivate::setMonitoringFlags(quint32 flags)
         monitorsCopy[i]->window()->scheduleRenderJob(
             new WindowMonitorFlagSetter(monitorsCopy[i], flags), QQuickWindow::NoStage);
     }
+    updateTracing();
+}
+
+// Scoped tracing is active while logging scope metrics.
+void QuickenApplicationMonitorPrivate::updateTracing()
+{
+    const bool tracing = (m_flags & Started) && (m_flags & Logging)
+        && (m_flags & QuickenApplicationMonitor::ScopeMetrics);
+    QuickenTracePrivate::setLoggingThread(tracing ? m_loggingThread : nullptr);
 }
 
 void QuickenApplicationMonitor::setLoggingFilter(QuickenApplicationMonitor::LoggingFilters filter)
@@ -472,6 +771,46 @@ QuickenApplicationMonitor::LoggingFilters QuickenApplicationMonitor::loggingFilt
         d_func()->m_flags & QuickenApplicationMonitorPrivate::FilterMask);
 }
 
+void QuickenApplicationMonitor::setLoggingQueueSize(int size)
+{
+    Q_D(QuickenApplicationMonitor);
+
+    int powerOfTwoSize = QuickenApplicationMonitorPrivate::minLoggingQueueSize;
+    while (powerOfTwoSize < size
+           && powerOfTwoSize < QuickenApplicationMonitorPrivate::maxLoggingQueueSize) {
+        powerOfTwoSize <<= 1;
+    }
+    if (powerOfTwoSize != d->m_loggingQueueSize) {
+        d->m_loggingQueueSize = powerOfTwoSize;
+        Q_EMIT loggingQueueSizeChanged();
+    }
+}
+
+int QuickenApplicationMonitor::loggingQueueSize()
+{
+    return d_func()->m_loggingQueueSize;
+}
+
+void QuickenApplicationMonitor::setLoggingOverflowPolicy(
+    QuickenApplicationMonitor::OverflowPolicy policy)
+{
+    Q_D(QuickenApplicationMonitor);
+
+    if (policy != d->m_overflowPolicy) {
+        d->m_overflowPolicy = policy;
+        if (d->m_flags & QuickenApplicationMonitorPrivate::Started) {
+            DASSERT(d->m_loggingThread);
+            d->m_loggingThread->setOverflowPolicy(policy);
+        }
+        Q_EMIT loggingOverflowPolicyChanged();
+    }
+}
+
+QuickenApplicationMonitor::OverflowPolicy QuickenApplicationMonitor::loggingOverflowPolicy()
+{
+    return d_func()->m_overflowPolicy;
+}
+
 QList<QuickenLogger*> QuickenApplicationMonitor::loggers()
 {
     Q_D(QuickenApplicationMonitor);
@@ -494,6 +833,10 @@ bool QuickenApplicationMonitor::installLogger(QuickenLogger* logger)
         if (d->m_flags & QuickenApplicationMonitorPrivate::Started) {
             DASSERT(d->m_loggingThread);
             d->m_loggingThread->setLoggers(d->m_loggers, d->m_loggerCount);
+            // The new logger needs the declarations to resolve names.
+            if (d->m_flags & QuickenApplicationMonitorPrivate::Logging) {
+                d->logNumericDeclarations();
+            }
         }
         Q_EMIT loggersChanged();
         return true;
@@ -561,6 +904,7 @@ bool QuickenApplicationMonitor::logGenericMetrics(quint32 id, const char* string
     if ((d->m_flags & QuickenApplicationMonitorPrivate::Logging) && (d->m_flags & GenericMetrics)) {
         DASSERT(d->m_loggingThread);
         QuickenMetrics metrics;
+        memset(&metrics, 0, sizeof(QuickenMetrics));
         metrics.type = QuickenMetrics::Generic;
         metrics.timeStamp = QuickenMetricsUtils::timeStamp();
         metrics.generic.id = id;
@@ -576,26 +920,189 @@ bool QuickenApplicationMonitor::logGenericMetrics(quint32 id, const char* string
     }
 }
 
+// Copies a null-terminated string to a fixed size buffer, replacing whitespaces
+// by '_' so that names and units can be parsed from space separated logs.
+static void copyNumericName(const char* source, char* destination, quint32 size)
+{
+    quint32 i = 0;
+    if (source) {
+        for (; i < size - 1 && source[i] != '\0'; ++i) {
+            const char c = source[i];
+            destination[i] = (c == ' ' || c == '\t' || c == '\n' || c == '\r') ? '_' : c;
+        }
+    }
+    memset(&destination[i], 0, size - i);
+}
+
+quint32 QuickenApplicationMonitor::registerNumericMetrics(const char* name, const char* unit)
+{
+    Q_D(QuickenApplicationMonitor);
+
+    QuickenMetrics metrics;
+    memset(&metrics, 0, sizeof(QuickenMetrics));
+    metrics.type = QuickenMetrics::Numeric;
+    metrics.numeric.kind = QuickenNumericMetrics::Declaration;
+    metrics.numeric.valueCount = 0;
+    copyNumericName(name, metrics.numeric.declaration.name,
+                    QuickenNumericDeclaration::maxNameSize);
+    copyNumericName(unit, metrics.numeric.declaration.unit,
+                    QuickenNumericDeclaration::maxUnitSize);
+
+    d->m_numericMutex.lock();
+    d->m_numericDeclarations.append(metrics.numeric.declaration);
+    // 0 is reserved for QuickenApplicationMonitor metrics.
+    const quint32 id = d->m_numericDeclarations.size();
+    d->m_numericMutex.unlock();
+
+    if ((d->m_flags & QuickenApplicationMonitorPrivate::Logging)
+        && (d->m_flags & QuickenApplicationMonitorPrivate::Started)) {
+        DASSERT(d->m_loggingThread);
+        metrics.timeStamp = QuickenMetricsUtils::timeStamp();
+        metrics.numeric.id = id;
+        d->m_loggingThread->push(&metrics);
+    }
+    return id;
+}
+
+bool QuickenApplicationMonitor::logNumericMetrics(quint32 id, const qint64* values, int count)
+{
+    Q_D(QuickenApplicationMonitor);
+    DASSERT(values);
+    DASSERT(count > 0);
+
+    if ((d->m_flags & QuickenApplicationMonitorPrivate::Logging) && (d->m_flags & NumericMetrics)) {
+        DASSERT(d->m_loggingThread);
+        QuickenMetrics metrics;
+        memset(&metrics, 0, sizeof(QuickenMetrics));
+        metrics.type = QuickenMetrics::Numeric;
+        metrics.timeStamp = QuickenMetricsUtils::timeStamp();
+        metrics.numeric.id = id;
+        metrics.numeric.kind = QuickenNumericMetrics::Integer;
+        metrics.numeric.valueCount = qBound(
+            0, count, static_cast<int>(QuickenNumericMetrics::maxValueCount));
+        memcpy(metrics.numeric.integers, values, metrics.numeric.valueCount * sizeof(qint64));
+        d->m_loggingThread->push(&metrics);
+        return true;
+    } else {
+        return false;
+    }
+}
+
+bool QuickenApplicationMonitor::logNumericMetrics(quint32 id, const double* values, int count)
+{
+    Q_D(QuickenApplicationMonitor);
+    DASSERT(values);
+    DASSERT(count > 0);
+
+    if ((d->m_flags & QuickenApplicationMonitorPrivate::Logging) && (d->m_flags & NumericMetrics)) {
+        DASSERT(d->m_loggingThread);
+        QuickenMetrics metrics;
+        memset(&metrics, 0, sizeof(QuickenMetrics));
+        metrics.type = QuickenMetrics::Numeric;
+        metrics.timeStamp = QuickenMetricsUtils::timeStamp();
+        metrics.numeric.id = id;
+        metrics.numeric.kind = QuickenNumericMetrics::Real;
+        metrics.numeric.valueCount = qBound(
+            0, count, static_cast<int>(QuickenNumericMetrics::maxValueCount));
+        memcpy(metrics.numeric.reals, values, metrics.numeric.valueCount * sizeof(double));
+        d->m_loggingThread->push(&metrics);
+        return true;
+    } else {
+        return false;
+    }
+}
+
+QuickenCounter* QuickenApplicationMonitor::registerCounter(
+    const char* name, QuickenCounter::Type type, QuickenCounter::Sampling sampling)
+{
+    Q_D(QuickenApplicationMonitor);
+
+    char sanitizedName[QuickenNumericDeclaration::maxNameSize];
+    copyNumericName(name, sanitizedName, QuickenNumericDeclaration::maxNameSize);
+    const int size = strlen(sanitizedName);
+
+    QMutexLocker locker(&d->m_countersMutex);
+    if (QuickenCounter* counter = QuickenCounterRegistry::find(sanitizedName, size)) {
+        return counter;
+    } else if (QuickenCounterRegistry::size() < QuickenCounterRegistry::maxCounters) {
+        const quint32 id = registerNumericMetrics(sanitizedName);
+        return QuickenCounterRegistry::append(sanitizedName, type, sampling, id);
+    } else {
+        WARN("ApplicationMonitor: Can't register more than %d counters.",
+             QuickenCounterRegistry::maxCounters);
+        return nullptr;
+    }
+}
+
+// Pushes the declarations of all the registered numeric metrics, loggers
+// installed or started after the registration need them to resolve names.
+// Counters are pushed again at next sampling for the same reason.
+void QuickenApplicationMonitorPrivate::logNumericDeclarations()
+{
+    DASSERT(m_flags & Started);
+    DASSERT(m_loggingThread);
+
+    QuickenMetrics metrics;
+    memset(&metrics, 0, sizeof(QuickenMetrics));
+    metrics.type = QuickenMetrics::Numeric;
+    metrics.timeStamp = QuickenMetricsUtils::timeStamp();
+    metrics.numeric.kind = QuickenNumericMetrics::Declaration;
+    metrics.numeric.valueCount = 0;
+
+    // The lock isn't held while pushing since the push can block.
+    m_numericMutex.lock();
+    const QVector<QuickenNumericDeclaration> declarations = m_numericDeclarations;
+    m_numericMutex.unlock();
+
+    const int size = declarations.size();
+    for (int i = 0; i < size; ++i) {
+        metrics.numeric.id = i + 1;
+        metrics.numeric.declaration = declarations[i];
+        m_loggingThread->push(&metrics);
+    }
+
+    QuickenCounterRegistry::invalidateSamples();
+}
+
 void QuickenApplicationMonitor::setUpdateInterval(QuickenMetrics::Type type, int interval)
 {
     Q_D(QuickenApplicationMonitor);
 
+    // Other types (like QuickenMetrics::Frame) are ignored for now.
+    QTimer* timer;
     if (type == QuickenMetrics::Process) {
-        // Other types (like QuickenMetrics::Frame) are ignored for now.
-        if (interval != d->m_updateInterval[QuickenMetrics::Process]) {
-            if (interval >= 0) {
-                d->m_processTimer.setInterval(interval);
-                if ((d->m_flags & QuickenApplicationMonitorPrivate::Started)
-                    && (d->m_updateInterval[QuickenMetrics::Process] < 0)) {
-                    d->m_processTimer.start();
-                }
-            } else if ((d->m_flags & QuickenApplicationMonitorPrivate::Started)
-                       && (d->m_updateInterval[QuickenMetrics::Process] >= 0)) {
-                d->m_processTimer.stop();
+        timer = &d->m_processTimer;
+    } else if (type == QuickenMetrics::Memory) {
+        timer = &d->m_memoryTimer;
+    } else if (type == QuickenMetrics::Pacing) {
+        // Pacing metrics are updated by the window monitors at frame swaps.
+        if (interval != d->m_updateInterval[type]) {
+            d->m_updateInterval[type] = interval;
+            d->m_monitorsMutex.lock();
+            for (int i = 0; i < d->m_monitorCount; ++i) {
+                d->m_monitors[i]->setPacingInterval(interval);
+            }
+            d->m_monitorsMutex.unlock();
+            Q_EMIT updateIntervalChanged(type);
+        }
+        return;
+    } else {
+        return;
+    }
+
+    if (interval != d->m_updateInterval[type]) {
+        if (interval >= 0) {
+            timer->setInterval(interval);
+            if ((d->m_flags & QuickenApplicationMonitorPrivate::Started)
+                && (d->m_updateInterval[type] < 0)) {
+                timer->start();
             }
-            d->m_updateInterval[QuickenMetrics::Process] = interval;
-            Q_EMIT updateIntervalChanged(QuickenMetrics::Process);
+        } else if ((d->m_flags & QuickenApplicationMonitorPrivate::Started)
+                   && (d->m_updateInterval[type] >= 0)) {
+            timer->stop();
         }
+        d->m_updateInterval[type] = interval;
+        Q_EMIT updateIntervalChanged(type);
     }
 }
 
@@ -619,6 +1126,21 @@ void QuickenApplicationMonitor::processTimeout()
     d_func()->processTimeout();
 }
 
+void QuickenApplicationMonitor::memoryTimeout()
+{
+    d_func()->memoryTimeout();
+}
+
+void QuickenApplicationMonitor::checkInputEvents()
+{
+    d_func()->checkInputEvents();
+}
+
+void QuickenApplicationMonitor::endGuiFrame(quint32 window)
+{
+    d_func()->endGuiFrame(window);
+}
+
 void QuickenApplicationMonitorPrivate::processTimeout()
 {
     DASSERT(m_flags & Started);
@@ -626,8 +1148,29 @@ void QuickenApplicationMonitorPrivate::processTimeout()
 
     const bool processLogging =
         (m_flags & Logging) && (m_flags & QuickenApplicationMonitor::ProcessMetrics);
+    const bool threadLogging =
+        (m_flags & Logging) && (m_flags & QuickenApplicationMonitor::ThreadMetrics);
     const bool overlay = m_flags & Overlay;
 
+    if ((m_flags & Logging) && (m_flags & QuickenApplicationMonitor::NumericMetrics)) {
+        QuickenCounterRegistry::sample(QuickenCounter::ProcessSampling, m_loggingThread);
+    }
+
+    // Threads only flush their scopes at their next outermost scope end after
+    // a delay, sporadically traced ones would keep them buffered.
+    if ((m_flags & Logging) && (m_flags & QuickenApplicationMonitor::ScopeMetrics)) {
+        QuickenTracePrivate::flushBuffers();
+    }
+
+    // Engine profilers are otherwise only read at the sync pass, windows not
+    // rendering frames would let them buffer JavaScript allocations forever.
+    m_monitorsMutex.lock();
+    for (int i = 0; i < m_monitorCount; ++i) {
+        DASSERT(m_monitors[i]);
+        m_monitors[i]->drainEngineStatistics();
+    }
+    m_monitorsMutex.unlock();
+
     if (processLogging || overlay) {
         m_metricsUtils.updateProcessMetrics(&m_processMetrics);
         if (processLogging) {
@@ -649,17 +1192,170 @@ void QuickenApplicationMonitorPrivate::processTimeout()
             m_monitorsMutex.unlock();
         }
     }
+
+    if (threadLogging || overlay) {
+        const int count = m_metricsUtils.updateThreadMetrics(m_threadMetrics, maxThreadMetrics);
+        if (threadLogging) {
+            for (int i = 0; i < count; ++i) {
+                m_loggingThread->push(&m_threadMetrics[i]);
+            }
+        }
+        if (overlay) {
+            m_monitorsMutex.lock();
+            for (int i = 0; i < m_monitorCount; ++i) {
+                DASSERT(m_monitors[i]);
+                m_monitors[i]->setThreadMetrics(m_threadMetrics, count);
+            }
+            m_monitorsMutex.unlock();
+        }
+    }
+}
+
+void QuickenApplicationMonitorPrivate::memoryTimeout()
+{
+    DASSERT(m_flags & Started);
+    DASSERT(m_loggingThread);
+
+    const bool memoryLogging =
+        (m_flags & Logging) && (m_flags & QuickenApplicationMonitor::MemoryMetrics);
+    const bool overlay = m_flags & Overlay;
+
+    if (memoryLogging || overlay) {
+        m_metricsUtils.updateMemoryMetrics(&m_memoryMetrics);
+        if (memoryLogging) {
+            m_loggingThread->push(&m_memoryMetrics);
+        }
+        if (overlay) {
+            m_monitorsMutex.lock();
+            for (int i = 0; i < m_monitorCount; ++i) {
+                DASSERT(m_monitors[i]);
+                m_monitors[i]->setMemoryMetrics(m_memoryMetrics);
+            }
+            m_monitorsMutex.unlock();
+        }
+    }
+}
+
+// Time stamps the input events delivered to a monitored window, called on the
+// GUI thread before delivery.
+void QuickenApplicationMonitorPrivate::addInputEvent(QQuickWindow* window)
+{
+    DASSERT(window);
+
+    const quint64 timeStamp = QuickenMetricsUtils::timeStamp();
+    bool added = false;
+    m_monitorsMutex.lock();
+    for (int i = 0; i < m_monitorCount; ++i) {
+        if (m_monitors[i]->window() == window) {
+            m_monitors[i]->addInputEvent(timeStamp);
+            added = true;
+            break;
+        }
+    }
+    m_monitorsMutex.unlock();
+
+    // The check is queued after the events being delivered.
+    if (added && !m_inputCheckQueued) {
+        m_inputCheckQueued = true;
+        QMetaObject::invokeMethod(q_func(), "checkInputEvents", Qt::QueuedConnection);
+    }
+}
+
+void QuickenApplicationMonitorPrivate::checkInputEvents()
+{
+    m_inputCheckQueued = false;
+    m_monitorsMutex.lock();
+    for (int i = 0; i < m_monitorCount; ++i) {
+        m_monitors[i]->checkInputEvents();
+    }
+    m_monitorsMutex.unlock();
+}
+
+// Starts the GUI timeline of a monitored window, called on the GUI thread
+// before the delivery of its update request.
+void QuickenApplicationMonitorPrivate::addUpdateRequest(QQuickWindow* window)
+{
+    DASSERT(window);
+
+    const quint64 timeStamp = QuickenMetricsUtils::timeStamp();
+    m_monitorsMutex.lock();
+    for (int i = 0; i < m_monitorCount; ++i) {
+        if (m_monitors[i]->window() == window) {
+            m_monitors[i]->startGuiFrame(timeStamp);
+            break;
+        }
+    }
+    m_monitorsMutex.unlock();
+}
+
+// Ends the GUI timeline of a window, queued on the GUI thread once unblocked
+// by the scene graph so that the animations are advanced when called.
+void QuickenApplicationMonitorPrivate::endGuiFrame(quint32 window)
+{
+    m_monitorsMutex.lock();
+    for (int i = 0; i < m_monitorCount; ++i) {
+        if (m_monitors[i]->id() == window) {
+            m_monitors[i]->endGuiFrame();
+            break;
+        }
+    }
+    m_monitorsMutex.unlock();
 }
 
 bool QuickenApplicationMonitor::eventFilter(QObject* object, QEvent* event)
 {
-    if (event->type() == QEvent::Show) {
+    switch (event->type()) {
+    case QEvent::Show:
         if (QQuickWindow* window = qobject_cast<QQuickWindow*>(object)) {
             Q_D(QuickenApplicationMonitor);
             d->m_monitorsMutex.lock();
             d->startMonitoring(window);
             d->m_monitorsMutex.unlock();
         }
+        break;
+
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonRelease:
+    case QEvent::MouseButtonDblClick:
+    case QEvent::MouseMove:
+        // Mouse events synthesized from touch events duplicate them.
+        if (static_cast<QMouseEvent*>(event)->source() != Qt::MouseEventNotSynthesized) {
+            break;
+        }
+        Q_FALLTHROUGH();
+    case QEvent::TouchBegin:
+    case QEvent::TouchUpdate:
+    case QEvent::TouchEnd:
+    case QEvent::Wheel:
+    case QEvent::KeyPress:
+    case QEvent::KeyRelease: {
+        // Application event filters see the events sent to any object, input
+        // events are delivered to the windows before their items.
+        Q_D(QuickenApplicationMonitor);
+        if ((d->m_flags & QuickenApplicationMonitorPrivate::Logging)
+            && (d->m_flags & FrameMetrics)) {
+            if (QQuickWindow* window = qobject_cast<QQuickWindow*>(object)) {
+                d->addInputEvent(window);
+            }
+        }
+        break;
+    }
+
+    case QEvent::UpdateRequest: {
+        // Starts the frame of a window, the items are polished and the scene
+        // synchronized during the delivery.
+        Q_D(QuickenApplicationMonitor);
+        if ((d->m_flags & QuickenApplicationMonitorPrivate::Logging)
+            && (d->m_flags & TimelineMetrics)) {
+            if (QQuickWindow* window = qobject_cast<QQuickWindow*>(object)) {
+                d->addUpdateRequest(window);
+            }
+        }
+        break;
+    }
+
+    default:
+        break;
     }
     return QObject::eventFilter(object, event);
 }
@@ -676,11 +1372,27 @@ static const char* const defaultOverlayText =
     "  SG sync. : %9syncTime ms\n"
     " SG render : %9renderTime ms\n"
     "       GPU : %9gpuTime ms\n"
-    "     Total : %9totalTime ms\r"
+    "     Total : %9totalTime ms\n"
+    "  CPU time : %9cpuTime ms\n"
+    "Smoothness : %9smoothness %% \n"
+    "  SG nodes : %9nodeCount   \n"
+    "Draw calls : %9drawCalls   \r"
     "  VSZ mem. : %9vszMemory kB\n"
     "  RSS mem. : %9rssMemory kB\n"
+    "  PSS mem. : %9pssMemory kB\n"
+    " Heap mem. : %9heapMemory kB\n"
     "   Threads : %9threadCount   \n"
-    " CPU usage : %9cpuUsage %% ";
+    " CPU usage : %9cpuUsage %% \n"
+    "   GUI CPU : %9guiCpuUsage %% \n"
+    "Render CPU : %9renderCpuUsage %% ";
+
+static const char* overlayText()
+{
+    // FIXME(loicm) We should actually provide an API call to let the user set
+    //     the overlay text programmatically.
+    static const QByteArray text = qgetenv("QUICKEN_OVERLAY_TEXT");
+    return !text.isEmpty() ? text.constData() : defaultOverlayText;
+}
 
 WindowMonitor::WindowMonitor(
     QuickenApplicationMonitor* applicationMonitor, QQuickWindow* window,
@@ -688,10 +1400,18 @@ WindowMonitor::WindowMonitor(
     : m_applicationMonitor(applicationMonitor)
     , m_loggingThread(loggingThread)
     , m_window(window)
-    , m_overlay(defaultOverlayText, id)
+    , m_overlay(overlayText(), id)
+    , m_sceneGraphStatistics(nullptr)
+    , m_syncCpuTime(0)
     , m_id(id)
     , m_flags(flags)
     , m_frameSize(window->width(), window->height())
+    , m_inputTimeStamp(0)
+    , m_inputEventCount(0)
+    , m_frameInputTimeStamp(0)
+    , m_screenVsyncInterval(0)
+    , m_pacingInterval(-1)
+    , m_previousVsyncCount(0)
 {
     DASSERT(applicationMonitor == QuickenApplicationMonitor::instance());
     DASSERT(m_applicationMonitor);
@@ -704,6 +1424,8 @@ WindowMonitor::WindowMonitor(
                      SLOT(windowSceneGraphInitialized()), Qt::DirectConnection);
     QObject::connect(window, SIGNAL(sceneGraphInvalidated()), this,
                      SLOT(windowSceneGraphInvalidated()), Qt::DirectConnection);
+    QObject::connect(window, SIGNAL(afterAnimating()), this, SLOT(windowAfterAnimating()),
+                     Qt::DirectConnection);
     QObject::connect(window, SIGNAL(beforeSynchronizing()), this,
                      SLOT(windowBeforeSynchronizing()), Qt::DirectConnection);
     QObject::connect(window, SIGNAL(afterSynchronizing()), this,
@@ -716,14 +1438,41 @@ WindowMonitor::WindowMonitor(
                      Qt::DirectConnection);
     QObject::connect(window, SIGNAL(sceneGraphAboutToStop()), this,
                      SLOT(windowSceneGraphAboutToStop()), Qt::DirectConnection);
+    QObject::connect(window, SIGNAL(screenChanged(QScreen*)), this,
+                     SLOT(windowScreenChanged(QScreen*)), Qt::DirectConnection);
+    windowScreenChanged(window->screen());
 
+    memset(&m_syncResourceUsage, 0, sizeof(m_syncResourceUsage));
     memset(&m_frameMetrics, 0, sizeof(m_frameMetrics));
     m_frameMetrics.type = QuickenMetrics::Frame;
     m_frameMetrics.frame.window = id;
+    memset(m_perfCounterValues, 0, sizeof(m_perfCounterValues));
+    for (int i = 0; i < PerfCountersCount; ++i) {
+        memset(&m_perfCounterMetrics[i], 0, sizeof(m_perfCounterMetrics[i]));
+        m_perfCounterMetrics[i].type = QuickenMetrics::PerfCounters;
+        m_perfCounterMetrics[i].perfCounters.window = id;
+        m_perfCounterMetrics[i].perfCounters.role =
+            i < GuiPerfCounters ? QuickenThreadMetrics::Render : QuickenThreadMetrics::Gui;
+        m_perfCounterMetrics[i].perfCounters.source = i % QuickenPerfCounterMetrics::SourceCount;
+    }
+    memset(&m_engineMetrics, 0, sizeof(m_engineMetrics));
+    m_engineMetrics.type = QuickenMetrics::Engine;
+    m_engineMetrics.engine.window = id;
+    memset(&m_pacingMetrics, 0, sizeof(m_pacingMetrics));
+    m_pacingMetrics.type = QuickenMetrics::Pacing;
+    m_pacingMetrics.pacing.window = id;
+    for (int i = 0; i < TimelineCount; ++i) {
+        memset(&m_timelineMetrics[i], 0, sizeof(m_timelineMetrics[i]));
+        m_timelineMetrics[i].type = QuickenMetrics::Timeline;
+        m_timelineMetrics[i].timeline.window = id;
+        m_timelineMetrics[i].timeline.role =
+            i == RenderTimeline ? QuickenThreadMetrics::Render : QuickenThreadMetrics::Gui;
+    }
 
     if ((flags & QuickenApplicationMonitorPrivate::Logging)
         && (flags & QuickenApplicationMonitor::WindowMetrics)) {
         QuickenMetrics metrics;
+        memset(&metrics, 0, sizeof(QuickenMetrics));
         metrics.type = QuickenMetrics::Window;
         metrics.timeStamp = QuickenMetricsUtils::timeStamp();
         metrics.window.id = id;
@@ -741,6 +1490,7 @@ WindowMonitor::~WindowMonitor()
     if ((m_flags & QuickenApplicationMonitorPrivate::Logging)
         && (m_flags & QuickenApplicationMonitor::WindowMetrics)) {
         QuickenMetrics metrics;
+        memset(&metrics, 0, sizeof(QuickenMetrics));
         metrics.type = QuickenMetrics::Window;
         metrics.timeStamp = QuickenMetricsUtils::timeStamp();
         metrics.window.id = m_id;
@@ -763,6 +1513,7 @@ void WindowMonitor::initializeGpuResources()
 
     m_overlay.initialize();
     m_gpuTimer.initialize();
+    m_sceneGraphStatistics = new QuickenSceneGraphStatistics;
     m_frameMetrics.frame.number = 0;
     m_flags |= GpuResourcesInitialized | (!noGpuTimer ? GpuTimerAvailable : 0);
 }
@@ -782,11 +1533,66 @@ void WindowMonitor::finalizeGpuResources()
         m_gpuTimer.finalize();
     }
     m_overlay.finalize();
+    delete m_sceneGraphStatistics;
+    m_sceneGraphStatistics = nullptr;
+    if (m_flags & PerfCountersInitialized) {
+        finalizePerfCounters();
+    }
 
     m_frameMetrics.frame.number = 0;
     m_flags &= ~(GpuResourcesInitialized | GpuTimerAvailable);
 }
 
+void WindowMonitor::initializePerfCounters()
+{
+    DASSERT(!(m_flags & PerfCountersInitialized));
+
+    // Called on the render thread. With the threaded render loop, the GUI
+    // thread (the main thread, its id is the process id) is counted too.
+    const quint32 renderThread = syscall(SYS_gettid);
+    const quint32 guiThread = getpid();
+    for (int i = 0; i < QuickenPerfCounterMetrics::SourceCount; ++i) {
+        m_perfCounters[RenderPerfCounters + i].open(0, i);
+        if (renderThread != guiThread) {
+            m_perfCounters[GuiPerfCounters + i].open(guiThread, i);
+        }
+    }
+    // Set even if opening failed so that it's not retried at each frame.
+    m_flags |= PerfCountersInitialized;
+}
+
+void WindowMonitor::finalizePerfCounters()
+{
+    DASSERT(m_flags & PerfCountersInitialized);
+
+    for (int i = 0; i < PerfCountersCount; ++i) {
+        m_perfCounters[i].close();
+    }
+    m_flags &= ~PerfCountersInitialized;
+}
+
+// Reads the perf counters and stores the deltas since the previous read in the
+// given phase, a negative phase only sets the base values.
+void WindowMonitor::readPerfCounters(int phase)
+{
+    DASSERT(phase < QuickenPerfCounterMetrics::PhaseCount);
+
+    for (int i = 0; i < PerfCountersCount; ++i) {
+        if (m_perfCounters[i].isOpen()) {
+            quint64 values[QuickenPerfCounters::counterCount];
+            if (m_perfCounters[i].read(values)) {
+                for (int j = 0; j < QuickenPerfCounters::counterCount; ++j) {
+                    if (phase >= 0) {
+                        m_perfCounterMetrics[i].perfCounters.values[phase][j] =
+                            values[j] - qMin(values[j], m_perfCounterValues[i][j]);
+                    }
+                    m_perfCounterValues[i][j] = values[j];
+                }
+            }
+        }
+    }
+}
+
 void WindowMonitor::windowSceneGraphInvalidated()
 {
     if (m_flags & GpuResourcesInitialized) {
@@ -794,10 +1600,63 @@ void WindowMonitor::windowSceneGraphInvalidated()
     }
 }
 
+void WindowMonitor::windowAfterAnimating()
+{
+    // Emitted on the GUI thread once the items are polished, right before the
+    // scene is synchronized.
+    const quint32 flags = QuickenApplicationMonitorPrivate::get(m_applicationMonitor)->m_flags;
+    if ((flags & QuickenApplicationMonitorPrivate::Logging)
+        && (flags & QuickenApplicationMonitor::TimelineMetrics)) {
+        m_timelineMetrics[GuiTimeline].timeline.timeStamps[QuickenTimelineMetrics::PolishEnd] =
+            QuickenMetricsUtils::timeStamp();
+    }
+}
+
 void WindowMonitor::windowBeforeSynchronizing()
 {
+    if ((m_flags & GpuResourcesInitialized) && timelineLogged()) {
+        // The GUI thread is blocked, its timeline is the one of the frame
+        // being synchronized.
+        m_timelineMetrics[RenderTimeline].timeline.timeStamps[QuickenTimelineMetrics::SyncStart] =
+            QuickenMetricsUtils::timeStamp();
+        m_timelineMetrics[GuiTimeline].timeline.number = m_frameMetrics.frame.number + 1;
+    }
+
+    // The GUI thread is blocked, the scene state changed by the input events
+    // delivered so far is synchronized for this frame.
+    m_frameInputTimeStamp = m_inputTimeStamp;
+    m_frameMetrics.frame.inputEventCount = m_inputEventCount;
+    m_inputTimeStamp = 0;
+    m_inputEventCount = 0;
+
+    // Running animations request a new frame right after this one, which is
+    // then expected at the next vsync.
+    QAnimationDriver* animationDriver = QSGRenderLoop::instance()->animationDriver();
+    if (animationDriver && animationDriver->isRunning()) {
+        m_flags |= AnimationsRunning;
+    }
+
     if (m_flags & GpuResourcesInitialized) {
         m_sceneGraphTimer.start();
+        m_syncCpuTime = QuickenMetricsUtils::threadCpuTime();
+        getrusage(RUSAGE_THREAD, &m_syncResourceUsage);
+        if ((m_flags & QuickenApplicationMonitorPrivate::Logging)
+            && (m_flags & QuickenApplicationMonitor::PerfCounterMetrics)) {
+            if (!(m_flags & PerfCountersInitialized)) {
+                initializePerfCounters();
+            }
+            readPerfCounters(-1);
+        } else if (m_flags & PerfCountersInitialized) {
+            finalizePerfCounters();
+        }
+        if ((m_flags & QuickenApplicationMonitorPrivate::Logging)
+            && (m_flags & QuickenApplicationMonitor::EngineMetrics)) {
+            if (m_engineStatistics.update(m_window, &m_engineMetrics.engine)) {
+                m_flags |= EngineMetricsUpdated;
+            }
+        } else {
+            m_engineStatistics.stopProfiling();
+        }
     }
 }
 
@@ -805,6 +1664,24 @@ void WindowMonitor::windowAfterSynchronizing()
 {
     if (m_flags & GpuResourcesInitialized) {
         m_frameMetrics.frame.syncTime = m_sceneGraphTimer.nsecsElapsed();
+        if (m_flags & PerfCountersInitialized) {
+            readPerfCounters(QuickenPerfCounterMetrics::Sync);
+        }
+        if (timelineLogged()) {
+            const quint64 timeStamp = QuickenMetricsUtils::timeStamp();
+            m_timelineMetrics[RenderTimeline].timeline.timeStamps[QuickenTimelineMetrics::SyncEnd] =
+                timeStamp;
+            // The threaded render loop unblocks the GUI thread right after the
+            // sync pass, non-threaded ones once the frame is swapped.
+            if (QThread::currentThread() != m_window->thread()) {
+                m_timelineMetrics[GuiTimeline].timeline.timeStamps[
+                    QuickenTimelineMetrics::Unblocked] = timeStamp;
+                QMetaObject::invokeMethod(m_applicationMonitor, "endGuiFrame",
+                                          Qt::QueuedConnection, Q_ARG(quint32, m_id));
+            } else {
+                m_flags |= GuiThreadRendering;
+            }
+        }
     }
 }
 
@@ -816,6 +1693,7 @@ void WindowMonitor::windowBeforeRendering()
         if ((m_flags & QuickenApplicationMonitorPrivate::Logging) &&
             (m_flags & QuickenApplicationMonitor::WindowMetrics)) {
             QuickenMetrics metrics;
+            memset(&metrics, 0, sizeof(QuickenMetrics));
             metrics.type = QuickenMetrics::Window;
             metrics.timeStamp = QuickenMetricsUtils::timeStamp();
             metrics.window.id = m_id;
@@ -827,6 +1705,10 @@ void WindowMonitor::windowBeforeRendering()
     }
 
     if (m_flags & GpuResourcesInitialized) {
+        if (timelineLogged()) {
+            m_timelineMetrics[RenderTimeline].timeline.timeStamps[
+                QuickenTimelineMetrics::RenderStart] = QuickenMetricsUtils::timeStamp();
+        }
         m_sceneGraphTimer.start();
         if (m_flags & GpuTimerAvailable) {
             m_gpuTimer.start();
@@ -837,14 +1719,36 @@ void WindowMonitor::windowBeforeRendering()
 void WindowMonitor::windowAfterRendering()
 {
     if (m_flags & GpuResourcesInitialized) {
+        QuickenTimelineMetrics* timeline = &m_timelineMetrics[RenderTimeline].timeline;
+        if (timelineLogged()) {
+            timeline->timeStamps[QuickenTimelineMetrics::RenderEnd] =
+                QuickenMetricsUtils::timeStamp();
+        }
+        if (m_flags & PerfCountersInitialized) {
+            readPerfCounters(QuickenPerfCounterMetrics::Render);
+        }
         m_frameMetrics.frame.renderTime = m_sceneGraphTimer.nsecsElapsed();
         m_frameMetrics.frame.gpuTime = (m_flags & GpuTimerAvailable) ? m_gpuTimer.stop() : 0;
         m_frameMetrics.frame.number++;
+        // The tree just rendered is walked before the overlay so that it shows
+        // the statistics of the frame it's rendered on, only if it shows them.
+        if (((m_flags & QuickenApplicationMonitorPrivate::Overlay)
+             && m_overlay.hasSceneGraphStatistics())
+            || ((m_flags & QuickenApplicationMonitorPrivate::Logging)
+                && (m_flags & QuickenApplicationMonitor::SceneGraphMetrics))) {
+            QSGRenderer* renderer = QQuickWindowPrivate::get(m_window)->renderer;
+            m_sceneGraphStatistics->update(
+                renderer ? renderer->rootNode() : nullptr, &m_frameMetrics.frame);
+        }
         if (m_flags & QuickenApplicationMonitorPrivate::Overlay) {
             m_mutex.lock();
             m_overlay.render(m_frameMetrics, m_frameSize);
             m_mutex.unlock();
         }
+        if (timelineLogged()) {
+            timeline->timeStamps[QuickenTimelineMetrics::SwapStart] =
+                QuickenMetricsUtils::timeStamp();
+        }
         m_sceneGraphTimer.start();
     }
 }
@@ -852,14 +1756,80 @@ void WindowMonitor::windowAfterRendering()
 void WindowMonitor::windowFrameSwapped()
 {
     if (m_flags & GpuResourcesInitialized) {
+        if (m_flags & PerfCountersInitialized) {
+            readPerfCounters(QuickenPerfCounterMetrics::Swap);
+        }
         m_frameMetrics.frame.deltaTime = m_deltaTimer.isValid() ? m_deltaTimer.nsecsElapsed() : 0;
         m_deltaTimer.start();
+        updateFramePacing();
+        // Also shown by the overlay at next frame.
+        const quint64 cpuTime = QuickenMetricsUtils::threadCpuTime();
+        m_frameMetrics.frame.cpuTime = cpuTime - qMin(cpuTime, m_syncCpuTime);
+        // Major faults and involuntary switches explain frame drops that the
+        // sync and render times don't account for.
+        struct rusage usage;
+        if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+            QuickenFrameMetrics* frame = &m_frameMetrics.frame;
+            frame->minorPageFaults = usage.ru_minflt - m_syncResourceUsage.ru_minflt;
+            frame->majorPageFaults = usage.ru_majflt - m_syncResourceUsage.ru_majflt;
+            frame->voluntaryContextSwitches = usage.ru_nvcsw - m_syncResourceUsage.ru_nvcsw;
+            frame->involuntaryContextSwitches = usage.ru_nivcsw - m_syncResourceUsage.ru_nivcsw;
+        }
         if ((m_flags & QuickenApplicationMonitorPrivate::Logging) &&
             (m_flags & QuickenApplicationMonitor::FrameMetrics)) {
             m_frameMetrics.frame.swapTime = m_sceneGraphTimer.nsecsElapsed();
             m_frameMetrics.timeStamp = QuickenMetricsUtils::timeStamp();
+            m_frameMetrics.frame.inputLatency = m_frameInputTimeStamp > 0
+                ? m_frameMetrics.timeStamp - qMin(m_frameMetrics.timeStamp, m_frameInputTimeStamp)
+                : 0;
             m_loggingThread->push(&m_frameMetrics);
         }
+        // Frames repainted without sync pass reflect no input events.
+        m_frameInputTimeStamp = 0;
+        m_frameMetrics.frame.inputEventCount = 0;
+        if ((m_flags & QuickenApplicationMonitorPrivate::Logging) &&
+            (m_flags & QuickenApplicationMonitor::NumericMetrics)) {
+            QuickenCounterRegistry::sample(QuickenCounter::FrameSampling, m_loggingThread);
+        }
+        if ((m_flags & PerfCountersInitialized)
+            && (m_flags & QuickenApplicationMonitorPrivate::Logging)
+            && (m_flags & QuickenApplicationMonitor::PerfCounterMetrics)) {
+            const quint64 timeStamp = QuickenMetricsUtils::timeStamp();
+            for (int i = 0; i < PerfCountersCount; ++i) {
+                if (m_perfCounters[i].isOpen()) {
+                    m_perfCounterMetrics[i].timeStamp = timeStamp;
+                    m_perfCounterMetrics[i].perfCounters.number = m_frameMetrics.frame.number;
+                    m_loggingThread->push(&m_perfCounterMetrics[i]);
+                }
+            }
+        }
+        if (m_flags & EngineMetricsUpdated) {
+            m_flags &= ~EngineMetricsUpdated;
+            if ((m_flags & QuickenApplicationMonitorPrivate::Logging)
+                && (m_flags & QuickenApplicationMonitor::EngineMetrics)) {
+                m_engineMetrics.timeStamp = QuickenMetricsUtils::timeStamp();
+                m_engineMetrics.engine.number = m_frameMetrics.frame.number;
+                m_loggingThread->push(&m_engineMetrics);
+            }
+        }
+        QuickenTimelineMetrics* timeline = &m_timelineMetrics[RenderTimeline].timeline;
+        if (timelineLogged()) {
+            const quint64 timeStamp = QuickenMetricsUtils::timeStamp();
+            timeline->timeStamps[QuickenTimelineMetrics::SwapEnd] = timeStamp;
+            timeline->number = m_frameMetrics.frame.number;
+            timeline->thread = syscall(SYS_gettid);
+            m_timelineMetrics[RenderTimeline].timeStamp = timeStamp;
+            m_loggingThread->push(&m_timelineMetrics[RenderTimeline]);
+            if (m_flags & GuiThreadRendering) {
+                m_timelineMetrics[GuiTimeline].timeline.timeStamps[
+                    QuickenTimelineMetrics::Unblocked] = timeStamp;
+                QMetaObject::invokeMethod(m_applicationMonitor, "endGuiFrame",
+                                          Qt::QueuedConnection, Q_ARG(quint32, m_id));
+            }
+        }
+        // Frames repainted without sync pass have no sync boundaries.
+        memset(timeline->timeStamps, 0, sizeof(timeline->timeStamps));
+        m_flags &= ~GuiThreadRendering;
     } else {
         initializeGpuResources();  // Get everything ready for the next frame.
         if (m_flags & QuickenApplicationMonitorPrivate::Overlay) {
@@ -868,6 +1838,89 @@ void WindowMonitor::windowFrameSwapped()
     }
 }
 
+void WindowMonitor::updateFramePacing()
+{
+    QuickenPacingMetrics* pacing = &m_pacingMetrics.pacing;
+    const quint32 screenVsyncInterval = m_screenVsyncInterval.load();
+    if (screenVsyncInterval != pacing->screenVsyncInterval) {
+        pacing->screenVsyncInterval = screenVsyncInterval;
+        pacing->vsyncInterval = screenVsyncInterval;
+    }
+
+    // Gaps between frames are only unexpected while animations are running,
+    // idle windows aren't rendered.
+    const quint64 deltaTime = m_frameMetrics.frame.deltaTime;
+    m_frameMetrics.frame.droppedVsyncCount = 0;
+    if ((m_flags & PacedFrame) && deltaTime > 0) {
+        const quint64 interval = pacing->vsyncInterval;
+        const quint32 vsyncCount =
+            qMax(static_cast<quint32>((deltaTime + interval / 2) / interval), 1u);
+        // The refresh rate reported by the screen is a nominal value, frames
+        // swapped about one interval apart refine it.
+        if (deltaTime > interval / 2 && deltaTime < interval + interval / 2) {
+            pacing->vsyncInterval = static_cast<quint32>(
+                static_cast<qint64>(interval)
+                + (static_cast<qint64>(deltaTime) - static_cast<qint64>(interval)) / 16);
+        }
+        m_frameMetrics.frame.droppedVsyncCount = qMin(vsyncCount - 1, 0xffffu);
+        pacing->frameCount++;
+        pacing->vsyncCount += vsyncCount;
+        pacing->droppedVsyncCount += vsyncCount - 1;
+        if (m_previousVsyncCount > 0 && vsyncCount != m_previousVsyncCount) {
+            pacing->pacingChangeCount++;
+        }
+        m_previousVsyncCount = vsyncCount;
+    } else {
+        m_previousVsyncCount = 0;
+    }
+    m_flags = (m_flags & ~(AnimationsRunning | PacedFrame))
+        | ((m_flags & AnimationsRunning) ? PacedFrame : 0);
+
+    const int updateInterval = m_pacingInterval.load();
+    if (updateInterval < 0) {
+        pacing->frameCount = 0;
+        pacing->vsyncCount = 0;
+        pacing->droppedVsyncCount = 0;
+        pacing->pacingChangeCount = 0;
+        m_pacingTimer.invalidate();
+        return;
+    }
+    if (!m_pacingTimer.isValid()) {
+        m_pacingTimer.start();
+        return;
+    }
+    if (m_pacingTimer.elapsed() < updateInterval) {
+        return;
+    }
+    m_pacingTimer.start();
+
+    // Idle periods aren't reported.
+    if (pacing->frameCount == 0) {
+        return;
+    }
+    pacing->number = m_frameMetrics.frame.number;
+    pacing->smoothness = static_cast<quint16>(qMin(
+        static_cast<quint64>(pacing->frameCount) * 10000
+        / (static_cast<quint64>(pacing->vsyncCount) + pacing->pacingChangeCount),
+        Q_UINT64_C(10000)));
+    if ((m_flags & QuickenApplicationMonitorPrivate::Logging)
+        && (m_flags & QuickenApplicationMonitor::PacingMetrics)) {
+        m_pacingMetrics.timeStamp = QuickenMetricsUtils::timeStamp();
+        m_loggingThread->push(&m_pacingMetrics);
+    }
+    if (m_flags & QuickenApplicationMonitorPrivate::Overlay) {
+        m_mutex.lock();
+        m_overlay.setPacingMetrics(m_pacingMetrics);
+        m_mutex.unlock();
+    }
+    Q_EMIT m_applicationMonitor->framePacingUpdated(
+        m_id, pacing->smoothness / 100.0f, pacing->droppedVsyncCount, pacing->pacingChangeCount);
+    pacing->frameCount = 0;
+    pacing->vsyncCount = 0;
+    pacing->droppedVsyncCount = 0;
+    pacing->pacingChangeCount = 0;
+}
+
 void WindowMonitor::windowSceneGraphAboutToStop()
 {
 #if !defined(QT_NO_DEBUG)
@@ -883,6 +1936,14 @@ void WindowMonitor::windowSceneGraphAboutToStop()
     delete this;
 }
 
+void WindowMonitor::windowScreenChanged(QScreen* screen)
+{
+    // Screens not reporting their refresh rate are assumed to be 60 Hz.
+    const qreal refreshRate =
+        screen && screen->refreshRate() >= 1.0 ? screen->refreshRate() : 60.0;
+    m_screenVsyncInterval.store(static_cast<quint32>(1000000000.0 / refreshRate));
+}
+
 void WindowMonitor::setProcessMetrics(const QuickenMetrics& metrics)
 {
     DASSERT(metrics.type == QuickenMetrics::Process);
@@ -894,3 +1955,88 @@ void WindowMonitor::setProcessMetrics(const QuickenMetrics& metrics)
         m_window->update();
     }
 }
+
+void WindowMonitor::setThreadMetrics(const QuickenMetrics* metrics, int count)
+{
+    DASSERT(metrics);
+
+    if (m_flags & QuickenApplicationMonitorPrivate::Overlay) {
+        m_mutex.lock();
+        m_overlay.setThreadMetrics(metrics, count);
+        m_mutex.unlock();
+    }
+}
+
+void WindowMonitor::addInputEvent(quint64 timeStamp)
+{
+    if (m_inputEventCount == 0) {
+        m_inputTimeStamp = timeStamp;
+    }
+    m_inputEventCount++;
+}
+
+void WindowMonitor::checkInputEvents()
+{
+    // Input events delivered without changing the scene don't trigger a frame,
+    // they would be attributed to the next one whatever its cause. Items
+    // changed or to be polished are synchronized by the next frame.
+    if (m_inputEventCount > 0) {
+        QQuickWindowPrivate* windowPrivate = QQuickWindowPrivate::get(m_window);
+        if (!windowPrivate->dirtyItemList && windowPrivate->polishItems.isEmpty()) {
+            m_inputTimeStamp = 0;
+            m_inputEventCount = 0;
+        }
+    }
+}
+
+void WindowMonitor::startGuiFrame(quint64 timeStamp)
+{
+    // An update request delivered before the queued end of the previous
+    // frame ends it first. The time stamps of an update request not leading to a
+    // sync pass (windows with nothing to render) are dropped.
+    QuickenTimelineMetrics* timeline = &m_timelineMetrics[GuiTimeline].timeline;
+    if (timeline->timeStamps[QuickenTimelineMetrics::Unblocked] > 0) {
+        endGuiFrame();
+    }
+    memset(timeline->timeStamps, 0, sizeof(timeline->timeStamps));
+    timeline->timeStamps[QuickenTimelineMetrics::UpdateRequest] = timeStamp;
+}
+
+void WindowMonitor::endGuiFrame()
+{
+    // The end of the frame is time stamped when the GUI thread handles the
+    // queued call, after advancing the animations and handling the events
+    // posted before. Already ended if an update request was delivered first.
+    QuickenTimelineMetrics* timeline = &m_timelineMetrics[GuiTimeline].timeline;
+    if (timeline->timeStamps[QuickenTimelineMetrics::Unblocked] > 0) {
+        const quint64 timeStamp = QuickenMetricsUtils::timeStamp();
+        timeline->timeStamps[QuickenTimelineMetrics::GuiFrameEnd] = timeStamp;
+        timeline->thread = syscall(SYS_gettid);
+        m_timelineMetrics[GuiTimeline].timeStamp = timeStamp;
+        m_loggingThread->push(&m_timelineMetrics[GuiTimeline]);
+        memset(timeline->timeStamps, 0, sizeof(timeline->timeStamps));
+    }
+}
+
+void WindowMonitor::setMemoryMetrics(const QuickenMetrics& metrics)
+{
+    DASSERT(metrics.type == QuickenMetrics::Memory);
+
+    if (m_flags & QuickenApplicationMonitorPrivate::Overlay) {
+        m_mutex.lock();
+        m_overlay.setMemoryMetrics(metrics);
+        m_mutex.unlock();
+        m_window->update();
+    }
+}
+
+void WindowMonitor::drainEngineStatistics()
+{
+    // Called on the GUI thread, which runs the engine.
+    if ((m_flags & QuickenApplicationMonitorPrivate::Logging)
+        && (m_flags & QuickenApplicationMonitor::EngineMetrics)) {
+        m_engineStatistics.drain();
+    } else {
+        m_engineStatistics.stopProfiling();
+    }
+}
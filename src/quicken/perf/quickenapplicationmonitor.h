@@ -9,6 +9,7 @@
 
 #include <QtCore/QList>
 
+#include <Quicken/quickencounter.h>
 #include <Quicken/quickenlogger.h>
 #include <Quicken/quickenmetrics.h>
 #include <Quicken/quickenglobal.h>
@@ -32,11 +33,54 @@ public:
         FrameMetrics   = (1 << 2),
         // Allow generic metrics logging.
         GenericMetrics = (1 << 3),
+        // Allow numeric metrics logging.
+        NumericMetrics = (1 << 4),
+        // Allow scope metrics logging (see QuickenTrace).
+        ScopeMetrics   = (1 << 5),
+        // Allow thread metrics logging, updated along with process metrics.
+        ThreadMetrics  = (1 << 6),
+        // Allow memory metrics logging.
+        MemoryMetrics  = (1 << 7),
+        // Allow perf counter metrics logging. Not part of AllMetrics since the
+        // counters are opened with perf_event_open() for each monitored window,
+        // which might be restricted (see /proc/sys/kernel/perf_event_paranoid).
+        PerfCounterMetrics = (1 << 8),
+        // Allow QML engine metrics logging. Not part of AllMetrics since the
+        // engine's V4 memory allocation profiler and QML binding profiler are
+        // enabled to count garbage collections and bindings: every JavaScript
+        // allocation and binding evaluation is then recorded, which slows down
+        // JavaScript and adds to the heap the collector has to scan. Requires
+        // Qt built with QML debugging support (qml_debug feature), relies on
+        // private profiler APIs. Without it, or for engines already profiled by
+        // the QML debugger, only heap sizes are reported.
+        EngineMetrics  = (1 << 9),
+        // Allow frame pacing metrics logging.
+        PacingMetrics  = (1 << 10),
+        // Allow frame timeline metrics logging. Not part of AllMetrics since
+        // it logs two metrics per frame and time stamps each update request
+        // delivered to the monitored windows.
+        TimelineMetrics = (1 << 11),
+        // Allow scene graph statistics in the frame metrics. Not part of
+        // AllMetrics since the whole node tree is walked on the render thread
+        // before the swap, which adds to the times of the measured frames. The
+        // batch and draw call counts are estimates (see QuickenFrameMetrics).
+        SceneGraphMetrics = (1 << 12),
         // Allow all metrics logging.
-        AllMetrics     = (ProcessMetrics | WindowMetrics | FrameMetrics | GenericMetrics)
+        AllMetrics     = (ProcessMetrics | WindowMetrics | FrameMetrics | GenericMetrics
+                          | NumericMetrics | ScopeMetrics | ThreadMetrics | MemoryMetrics
+                          | PacingMetrics)
     };
     Q_DECLARE_FLAGS(LoggingFilters, LoggingFilter)
 
+    enum OverflowPolicy {
+        // Block the thread pushing metrics until the logging queue has room.
+        Block      = 0,
+        // Drop the metrics being pushed.
+        DropNewest = 1,
+        // Drop the oldest queued metrics to make room for the new ones.
+        DropOldest = 2
+    };
+
     // Get the unique QuickenApplicationMonitor instance. A QGuiApplication instance
     // must be running.
     static QuickenApplicationMonitor* instance() {
@@ -55,6 +99,20 @@ public:
     void setLoggingFilter(LoggingFilters filter);
     LoggingFilters loggingFilter();
 
+    // Set the capacity of the logging queue in number of metrics. Rounded up to
+    // the next power-of-two in the range [2, 65536], default value is 16. Takes
+    // effect the next time monitoring is started.
+    void setLoggingQueueSize(int size);
+    int loggingQueueSize();
+
+    // Set the policy applied when the logging queue is full. Block by default,
+    // which stalls the threads pushing metrics (like the QtQuick render
+    // threads) until the loggers catch up. With the drop policies, the number
+    // of metrics lost is counted per window and per type and logged as
+    // QuickenMetrics::Dropped metrics.
+    void setLoggingOverflowPolicy(OverflowPolicy policy);
+    OverflowPolicy loggingOverflowPolicy();
+
     // Set the loggers. Empty by default, max number of loggers is 8.
     QList<QuickenLogger*> loggers();
     bool installLogger(QuickenLogger* logger);
@@ -73,10 +131,36 @@ public:
     quint32 registerGenericMetrics();
     bool logGenericMetrics(quint32 id, const char* string, quint32 size);
 
+    // Typed numeric metrics. registerNumericMetrics() binds a name and a unit
+    // (both null-terminated, whitespaces are replaced by '_', truncated to
+    // QuickenNumericDeclaration::maxNameSize and maxUnitSize) to a unique
+    // integer id once, loggers resolve the name and the unit of the logged
+    // values from that id. logNumericMetrics() logs up to
+    // QuickenNumericMetrics::maxValueCount integer or real values with no
+    // formatting, it's cheap enough to be called every frame. Does not log and
+    // returns false if logging is disabled or if the logging filter does not
+    // contain NumericMetrics.
+    quint32 registerNumericMetrics(const char* name, const char* unit = "");
+    bool logNumericMetrics(quint32 id, const qint64* values, int count = 1);
+    bool logNumericMetrics(quint32 id, const double* values, int count = 1);
+
+    // Get the counter with the given name, registered as a numeric metrics
+    // with the given type and sampling on first call (the type and sampling
+    // of an already registered counter are kept). The name is sanitized like
+    // numeric metrics names. Returns null if the maximum number of counters
+    // (64) is reached. Counters live until the process exits. Values are
+    // logged if the logging filter contains NumericMetrics.
+    QuickenCounter* registerCounter(
+        const char* name, QuickenCounter::Type type = QuickenCounter::Counter,
+        QuickenCounter::Sampling sampling = QuickenCounter::FrameSampling);
+
     // Set the time in milliseconds between two updates of metrics of a given
-    // type. -1 to disable updates. Only QuickenMetrics::Process is accepted so
-    // far as metrics type, default value is 1000. Note that when the overlay is
-    // enabled, a process update triggers a frame update.
+    // type. -1 to disable updates. Only QuickenMetrics::Process (default value
+    // is 1000), QuickenMetrics::Memory (default value is 10000, memory
+    // updates are expensive) and QuickenMetrics::Pacing (default value is
+    // 1000, updated by each window at the first frame swapped after the
+    // interval) are accepted so far as metrics type. Note that when the
+    // overlay is enabled, a process update triggers a frame update.
     void setUpdateInterval(QuickenMetrics::Type type, int interval);
     int updateInterval(QuickenMetrics::Type type);
 
@@ -84,12 +168,24 @@ Q_SIGNALS:
     void overlayChanged();
     void loggingChanged();
     void loggingFilterChanged();
+    void loggingQueueSizeChanged();
+    void loggingOverflowPolicyChanged();
     void loggersChanged();
     void updateIntervalChanged(QuickenMetrics::Type type);
 
+    // Emitted at each frame pacing update of a window (see
+    // QuickenPacingMetrics) with its smoothness score in percent, from the
+    // scene graph thread of the window. Connections to objects living on other
+    // threads are queued.
+    void framePacingUpdated(quint32 window, float smoothness, quint32 droppedVsyncCount,
+                            quint32 pacingChangeCount);
+
 private Q_SLOTS:
     void closeDown();
     void processTimeout();
+    void memoryTimeout();
+    void checkInputEvents();
+    void endGuiFrame(quint32 window);
 
 private:
     static QuickenApplicationMonitor* self;
@@ -9,6 +9,8 @@
 
 #include <Quicken/quickenapplicationmonitor.h>
 
+#include <sys/resource.h>
+
 #include <QtCore/QTimer>
 #include <QtCore/QThread>
 #include <QtCore/QMutex>
@@ -16,20 +18,28 @@
 #include <QtCore/QElapsedTimer>
 #include <QtCore/QRunnable>
 #include <QtCore/QAtomicInteger>
+#include <QtCore/QVector>
 
 #include <Quicken/private/quickenoverlay_p.h>
+#include <Quicken/private/quickenenginestatistics_p.h>
 #include <Quicken/private/quickengputimer_p.h>
+#include <Quicken/private/quickenperfcounters_p.h>
 #include <Quicken/private/quickenglobal_p.h>
 
 class LoggingThread;
 class WindowMonitor;
 class QQuickWindow;
+class QScreen;
+class QuickenSceneGraphStatistics;
 
 class QUICKEN_PRIVATE_EXPORT QuickenApplicationMonitorPrivate
 {
 public:
     static const int maxMonitors = 16;
     static const int maxLoggers = 8;
+    static const int maxThreadMetrics = 64;
+    static const int minLoggingQueueSize = 2;
+    static const int maxLoggingQueueSize = 65536;
 
     static inline QuickenApplicationMonitorPrivate* get(
         QuickenApplicationMonitor* applicationMonitor) {
@@ -37,15 +47,15 @@ public:
     }
 
     enum {
-        // Lower bit allowed is (1 << 8).
-        Overlay     = (1 << 8),
-        Logging     = (1 << 9),
-        Started     = (1 << 10),
-        ClosingDown = (1 << 11),
-        // Higher bit allowed is (1 << 15).
-        FilterMask             = 0x000000ff,
-        ApplicationMonitorMask = 0x0000ff00,
-        WindowMonitorMask      = 0xffff0000
+        // Lower bit allowed is (1 << 13).
+        Overlay     = (1 << 13),
+        Logging     = (1 << 14),
+        Started     = (1 << 15),
+        ClosingDown = (1 << 16),
+        // Higher bit allowed is (1 << 16).
+        FilterMask             = 0x00001fff,
+        ApplicationMonitorMask = 0x0001e000,
+        WindowMonitorMask      = 0xfffe0000
     };
 
     QuickenApplicationMonitorPrivate(QuickenApplicationMonitor* applicationMonitor);
@@ -59,6 +69,13 @@ public:
     bool hasMonitor(WindowMonitor* monitor);
     void setMonitoringFlags(quint32 flags);
     void processTimeout();
+    void memoryTimeout();
+    void addInputEvent(QQuickWindow* window);
+    void checkInputEvents();
+    void addUpdateRequest(QQuickWindow* window);
+    void endGuiFrame(quint32 window);
+    void logNumericDeclarations();
+    void updateTracing();
 
     QuickenApplicationMonitor* const q_ptr;
     Q_DECLARE_PUBLIC(QuickenApplicationMonitor)
@@ -71,42 +88,96 @@ public:
 #endif
     QuickenMetricsUtils m_metricsUtils;
     QTimer m_processTimer;
+    QTimer m_memoryTimer;
     QMutex m_monitorsMutex;
+    // Numeric metrics declarations, indexed by id - 1.
+    QVector<QuickenNumericDeclaration> m_numericDeclarations;
+    QMutex m_numericMutex;
+    QMutex m_countersMutex;
     int m_monitorCount;
     int m_loggerCount;
     int m_updateInterval[QuickenMetrics::TypeCount];
+    int m_loggingQueueSize;
+    QuickenApplicationMonitor::OverflowPolicy m_overflowPolicy;
     quint32 m_flags;
+    // Set while a check of the input events delivered is queued.
+    bool m_inputCheckQueued;
     alignas(64) QuickenMetrics m_processMetrics;
+    alignas(64) QuickenMetrics m_threadMetrics[maxThreadMetrics];
+    alignas(64) QuickenMetrics m_memoryMetrics;
 };
 
+// The logging thread consumes the metrics pushed by the window monitors, the
+// application monitor and the generic metrics API and hands them to the
+// installed loggers in batches. Metrics are exchanged through a bounded lock-free ring
+// buffer so that producers never contend on a lock, the consumer is only woken
+// up when it is actually parked. The ring buffer supports multiple consumers so
+// that producers can evict the oldest metrics with the DropOldest policy.
 class QUICKEN_PRIVATE_EXPORT LoggingThread : public QThread
 {
 public:
-    LoggingThread();
+    LoggingThread(int queueSize, QuickenApplicationMonitor::OverflowPolicy policy);
 
     void run() override;
     void push(const QuickenMetrics* metrics);
+    // Same as push() except that it never blocks, the metrics are dropped if
+    // the queue is full with the Block policy.
+    void tryPush(const QuickenMetrics* metrics);
     void setLoggers(QuickenLogger** loggers, int count);
+    void setOverflowPolicy(QuickenApplicationMonitor::OverflowPolicy policy);
     LoggingThread* ref();
     void deref();
 
 private:
     enum {
-        Waiting       = (1 << 0),
-        JoinRequested = (1 << 1)
+        JoinRequested = (1 << 0)
+    };
+
+    // One count per monitored window, plus one for the metrics not bound to a
+    // window and one for the windows without a count left.
+    static const int maxDroppedCounts = QuickenApplicationMonitorPrivate::maxMonitors + 2;
+
+    // A slot of the log queue. The sequence number tells producers and
+    // consumers whether the slot is free to be written or ready to be read for
+    // a given position.
+    struct alignas(64) QueueSlot {
+        QuickenMetrics metrics;
+        QAtomicInteger<quint32> sequence;
+    };
+
+    // Count of dropped metrics per type for a given window, 0 if the slot is
+    // free.
+    struct DroppedCount {
+        QAtomicInteger<quint32> window;
+        QAtomicInteger<quint32> count[QuickenMetrics::TypeCount];
     };
 
     ~LoggingThread();
 
-    QuickenMetrics* m_queue;
+    void push(const QuickenMetrics* metrics, quint32 policy);
+    bool pop(QuickenMetrics* metrics);
+    bool isQueueEmpty() const;
+    void wakeUp();
+    void countDropped(const QuickenMetrics& metrics);
+    void logDropped(QuickenLogger** loggers, int loggerCount);
+
+    QueueSlot* m_queue;
+    QuickenMetrics* m_batch;
     QuickenLogger* m_loggers[QuickenApplicationMonitorPrivate::maxLoggers];
     int m_loggerCount;
     QMutex m_mutex;
     QWaitCondition m_condition;
+    DroppedCount m_dropped[maxDroppedCounts];
+    QElapsedTimer m_droppedTimer;
     QAtomicInteger<quint32> m_refCount;
-    qint8 m_queueIndex;
-    qint8 m_queueSize;
+    QAtomicInteger<quint32> m_waiting;
+    QAtomicInteger<quint32> m_hasDropped;
+    QAtomicInteger<quint32> m_overflowPolicy;
+    quint32 m_queueMask;
     quint8 m_flags;
+    // Producers and consumers indices are kept on their own cache lines.
+    alignas(64) QAtomicInteger<quint32> m_queueHead;
+    alignas(64) QAtomicInteger<quint32> m_queueTail;
 };
 
 class QUICKEN_PRIVATE_EXPORT WindowMonitorDeleter : public QRunnable
@@ -159,46 +230,119 @@ public:
     ~WindowMonitor();
 
     QQuickWindow* window() const { return m_window; }
+    quint32 id() const { return m_id; }
     void setProcessMetrics(const QuickenMetrics& metrics);
+    void setThreadMetrics(const QuickenMetrics* metrics, int count);
+    void setMemoryMetrics(const QuickenMetrics& metrics);
+    void drainEngineStatistics();
+    void addInputEvent(quint64 timeStamp);
+    void checkInputEvents();
+    void setPacingInterval(int interval) { m_pacingInterval.store(interval); }
+    void startGuiFrame(quint64 timeStamp);
+    void endGuiFrame();
 
 private Q_SLOTS:
     void windowSceneGraphInitialized();
     void windowSceneGraphInvalidated();
+    void windowAfterAnimating();
     void windowBeforeSynchronizing();
     void windowAfterSynchronizing();
     void windowBeforeRendering();
     void windowAfterRendering();
     void windowFrameSwapped();
     void windowSceneGraphAboutToStop();
+    void windowScreenChanged(QScreen* screen);
 
 private:
     enum {
-        // Lower bit allowed is (1 << 16).
-        GpuResourcesInitialized = (1 << 16),
-        GpuTimerAvailable       = (1 << 17),
-        SizeChanged             = (1 << 18)
+        // Lower bit allowed is (1 << 17).
+        GpuResourcesInitialized = (1 << 17),
+        GpuTimerAvailable       = (1 << 18),
+        SizeChanged             = (1 << 19),
+        PerfCountersInitialized = (1 << 20),
+        EngineMetricsUpdated    = (1 << 21),
+        // Set when animations were running at the beginning of the sync pass,
+        // the next frame is then expected at the next vsync.
+        AnimationsRunning       = (1 << 22),
+        PacedFrame              = (1 << 23),
+        // Set when the GUI thread is blocked until the frame is swapped
+        // (non-threaded render loops).
+        GuiThreadRendering      = (1 << 24)
         // Higher bit allowed is (1 << 31).
     };
 
+    // Perf counter groups per thread and source (indexed by source), software
+    // ones are always opened and hardware ones in addition when available. The
+    // GUI ones are only opened with the threaded render loop.
+    enum {
+        RenderPerfCounters = 0,
+        GuiPerfCounters = QuickenPerfCounterMetrics::SourceCount,
+        PerfCountersCount = 2 * QuickenPerfCounterMetrics::SourceCount
+    };
+
+    // Timelines of the thread rendering the frame and of the GUI thread.
+    enum { RenderTimeline = 0, GuiTimeline = 1, TimelineCount = 2 };
+
     bool gpuResourcesInitialized() const { return m_flags & GpuResourcesInitialized; }
+    bool timelineLogged() const {
+        return (m_flags & QuickenApplicationMonitorPrivate::Logging)
+            && (m_flags & QuickenApplicationMonitor::TimelineMetrics);
+    }
     void setFlags(quint32 flags) {
         m_flags = (m_flags & QuickenApplicationMonitorPrivate::WindowMonitorMask) | flags;
     }
     void initializeGpuResources();
     void finalizeGpuResources();
+    void initializePerfCounters();
+    void finalizePerfCounters();
+    void readPerfCounters(int phase);
+    void updateFramePacing();
 
     QuickenApplicationMonitor* m_applicationMonitor;
     LoggingThread* m_loggingThread;
     QQuickWindow* m_window;
     QuickenGPUTimer m_gpuTimer;
     QuickenOverlay m_overlay;  // Accessed from different threads (needs locking).
+    // Created with the GPU resources, used on the scene graph thread only.
+    QuickenSceneGraphStatistics* m_sceneGraphStatistics;
     QMutex m_mutex;
     QElapsedTimer m_sceneGraphTimer;
     QElapsedTimer m_deltaTimer;
+    // CPU time and resource usage of the render thread at the beginning of
+    // the sync pass.
+    quint64 m_syncCpuTime;
+    struct rusage m_syncResourceUsage;
     quint32 m_id;
     quint32 m_flags;
     QSize m_frameSize;
     QuickenMetrics m_frameMetrics;
+    // Delivery time stamp of the oldest input event not synchronized yet and
+    // number of input events, written on the GUI thread and read during the
+    // sync pass. Delivery time stamp of the oldest input event reflected by
+    // the frame being rendered.
+    quint64 m_inputTimeStamp;
+    quint32 m_inputEventCount;
+    quint64 m_frameInputTimeStamp;
+    QuickenPerfCounters m_perfCounters[PerfCountersCount];
+    // Counter values at the previous read point, to compute phase deltas.
+    quint64 m_perfCounterValues[PerfCountersCount][QuickenPerfCounters::counterCount];
+    QuickenMetrics m_perfCounterMetrics[PerfCountersCount];
+    // Updated during the sync pass, while the GUI thread is blocked.
+    QuickenEngineStatistics m_engineStatistics;
+    QuickenMetrics m_engineMetrics;
+    // Refresh interval in nanoseconds of the window's screen, written on the
+    // GUI thread. Update interval of the pacing metrics.
+    QAtomicInteger<quint32> m_screenVsyncInterval;
+    QAtomicInteger<qint32> m_pacingInterval;
+    QElapsedTimer m_pacingTimer;
+    // Number of vsyncs spanned by the previous paced frame, 0 if the previous
+    // frame wasn't paced.
+    quint32 m_previousVsyncCount;
+    QuickenMetrics m_pacingMetrics;
+    // The GUI timeline is written on the GUI thread and during the sync pass,
+    // the render one on the scene graph thread. Time stamps are cleared once
+    // logged.
+    QuickenMetrics m_timelineMetrics[TimelineCount];
 
     friend class WindowMonitorDeleter;
     friend class WindowMonitorFlagSetter;
@@ -0,0 +1,91 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#include "quickencounter_p.h"
+
+#include <string.h>
+
+#include "quickenapplicationmonitor_p.h"
+#include "quickenmetrics.h"
+
+// Sampled value forcing the next sampling to push the counter. A counter
+// actually holding that value is pushed at each sampling.
+const qint64 invalidSample = Q_INT64_C(-0x7fffffffffffffff) - 1;
+
+QuickenCounter QuickenCounterRegistry::counters[maxCounters];
+QAtomicInteger<int> QuickenCounterRegistry::count(0);
+
+QuickenCounter* QuickenCounterRegistry::find(const char* name, int size)
+{
+    DASSERT(name);
+
+    const int counterCount = count.loadAcquire();
+    for (int i = 0; i < counterCount; ++i) {
+        if (size < QuickenCounter::maxNameSize && !strncmp(counters[i].m_name, name, size)
+            && counters[i].m_name[size] == '\0') {
+            return &counters[i];
+        }
+    }
+    return nullptr;
+}
+
+QuickenCounter* QuickenCounterRegistry::append(
+    const char* name, QuickenCounter::Type type, QuickenCounter::Sampling sampling, quint32 id)
+{
+    DASSERT(name);
+
+    const int index = count.load();
+    if (index < maxCounters) {
+        QuickenCounter* counter = &counters[index];
+        counter->m_value.store(0);
+        counter->m_sampledValue.store(invalidSample);
+        counter->m_id = id;
+        counter->m_type = type;
+        counter->m_sampling = sampling;
+        strncpy(counter->m_name, name, QuickenCounter::maxNameSize - 1);
+        counter->m_name[QuickenCounter::maxNameSize - 1] = '\0';
+        count.storeRelease(index + 1);
+        return counter;
+    } else {
+        return nullptr;
+    }
+}
+
+void QuickenCounterRegistry::sample(
+    QuickenCounter::Sampling sampling, LoggingThread* loggingThread)
+{
+    DASSERT(loggingThread);
+
+    QuickenMetrics metrics;
+    memset(&metrics, 0, sizeof(QuickenMetrics));
+    metrics.type = QuickenMetrics::Numeric;
+    metrics.numeric.kind = QuickenNumericMetrics::Integer;
+    metrics.numeric.valueCount = 1;
+
+    const int counterCount = count.loadAcquire();
+    for (int i = 0; i < counterCount; ++i) {
+        QuickenCounter* counter = &counters[i];
+        if (counter->m_sampling == sampling) {
+            const qint64 value = counter->m_value.load();
+            // Window monitors might sample concurrently on different render
+            // threads, exchanging makes sure a change is pushed only once.
+            if (counter->m_sampledValue.fetchAndStoreRelaxed(value) != value
+                || value == invalidSample) {
+                metrics.timeStamp = QuickenMetricsUtils::timeStamp();
+                metrics.numeric.id = counter->m_id;
+                metrics.numeric.integers[0] = value;
+                loggingThread->push(&metrics);
+            }
+        }
+    }
+}
+
+void QuickenCounterRegistry::invalidateSamples()
+{
+    const int counterCount = count.loadAcquire();
+    for (int i = 0; i < counterCount; ++i) {
+        counters[i].m_sampledValue.store(invalidSample);
+    }
+}
@@ -0,0 +1,65 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#ifndef COUNTER_H
+#define COUNTER_H
+
+#include <QtCore/QAtomicInteger>
+
+#include <Quicken/quickenglobal.h>
+
+class QuickenCounterRegistry;
+
+// Named counter or gauge that any thread can update, retrieved from
+// QuickenApplicationMonitor::registerCounter(). Updates are single relaxed
+// atomic operations on a value stored on its own cache line, so that counters
+// can be updated from hot code paths. The application monitor samples the
+// values, either at each frame swap or at each process metrics update, and
+// logs the ones that changed as numeric metrics (QuickenMetrics::Numeric)
+// declared with the counter name. The overlay shows the current value with the
+// %counter:name keyword.
+class QUICKEN_EXPORT QuickenCounter
+{
+public:
+    enum Type {
+        // Accumulates the values added.
+        Counter = 0,
+        // Holds the last value set.
+        Gauge   = 1
+    };
+
+    enum Sampling {
+        // Sampled at each frame swap of the monitored windows.
+        FrameSampling   = 0,
+        // Sampled at each process metrics update (see
+        // QuickenApplicationMonitor::setUpdateInterval()).
+        ProcessSampling = 1
+    };
+
+    void add(qint64 value = 1) { m_value.fetchAndAddRelaxed(value); }
+    void set(qint64 value) { m_value.store(value); }
+    qint64 value() const { return m_value.load(); }
+
+    Type type() const { return m_type; }
+    Sampling sampling() const { return m_sampling; }
+    const char* name() const { return m_name; }
+
+private:
+    static const int maxNameSize = 64;
+
+    QuickenCounter() {}
+    Q_DISABLE_COPY(QuickenCounter)
+
+    alignas(64) QAtomicInteger<qint64> m_value;
+    alignas(64) QAtomicInteger<qint64> m_sampledValue;
+    quint32 m_id;
+    Type m_type;
+    Sampling m_sampling;
+    char m_name[maxNameSize];
+
+    friend class QuickenCounterRegistry;
+};
+
+#endif  // COUNTER_H
@@ -0,0 +1,49 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#ifndef COUNTER_P_H
+#define COUNTER_P_H
+
+#include <Quicken/quickencounter.h>
+
+#include <Quicken/private/quickenglobal_p.h>
+
+class LoggingThread;
+
+// Fixed storage of the registered counters. Counters are never removed, the
+// registered ones are published with a release store of the count so that
+// lookups and sampling don't need locking. Registrations must be serialized by
+// the caller.
+class QUICKEN_PRIVATE_EXPORT QuickenCounterRegistry
+{
+public:
+    static const int maxCounters = 64;
+
+    // Get the number of registered counters.
+    static int size() { return count.loadAcquire(); }
+
+    // Get the counter with the given name (sanitized like numeric metrics
+    // names), null if not registered.
+    static QuickenCounter* find(const char* name, int size);
+
+    // Append a counter. Returns null if there's no room left.
+    static QuickenCounter* append(
+        const char* name, QuickenCounter::Type type, QuickenCounter::Sampling sampling,
+        quint32 id);
+
+    // Push the counters of the given sampling whose value changed since their
+    // last sampling as numeric metrics.
+    static void sample(QuickenCounter::Sampling sampling, LoggingThread* loggingThread);
+
+    // Mark all the counters to be pushed at next sampling, so that newly
+    // installed loggers get the current values.
+    static void invalidateSamples();
+
+private:
+    static QuickenCounter counters[maxCounters];
+    static QAtomicInteger<int> count;
+};
+
+#endif  // COUNTER_P_H
@@ -0,0 +1,301 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#include "quickenenginestatistics_p.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtQml/private/qqmlengine_p.h>
+#include <QtQml/private/qv4engine_p.h>
+#include <QtQml/private/qv4mm_p.h>
+#include <QtQuick/QQuickItem>
+#include <QtQuick/QQuickWindow>
+
+#if QT_CONFIG(qml_debug)
+
+// Name of the profilers created by the statistics, the ones set by the QML
+// debugger must be left alone.
+static const char profilerName[] = "QuickenProfiler";
+
+static const quint64 v4Features = 1 << QV4::Profiling::FeatureMemoryAllocation;
+static const quint64 qmlFeatures = 1 << QQmlProfilerDefinitions::ProfileBinding;
+
+// Number of statistics using the profilers of an engine, keyed by V4 profiler.
+// Statistics are released on the scene graph thread of their window.
+static QMutex profilerUsersMutex;
+static QHash<QObject*, int> profilerUsers;
+
+static void removeProfilerUsers(QObject* v4Profiler)
+{
+    profilerUsersMutex.lock();
+    profilerUsers.remove(v4Profiler);
+    profilerUsersMutex.unlock();
+}
+
+// Timer shared by the profilers, time stamps are compared to its current time.
+static const QElapsedTimer& profilerTimer()
+{
+    static const QElapsedTimer timer = []() {
+        QElapsedTimer timer;
+        timer.start();
+        return timer;
+    }();
+    return timer;
+}
+
+#endif  // QT_CONFIG(qml_debug)
+
+// Root items of a QQuickView are not QML objects of the window, but of its
+// content item.
+static QQmlEngine* windowEngine(QQuickWindow* window)
+{
+    if (QQmlEngine* engine = qmlEngine(window)) {
+        return engine;
+    }
+    const QList<QQuickItem*> items = window->contentItem()->childItems();
+    for (int i = 0; i < items.size(); ++i) {
+        if (QQmlEngine* engine = qmlEngine(items[i])) {
+            return engine;
+        }
+    }
+    return nullptr;
+}
+
+QuickenEngineStatistics::QuickenEngineStatistics()
+    : m_allocationTime(0)
+    , m_gcTimeEstimate(0)
+    , m_gcCount(0)
+    , m_bindingCount(0)
+    , m_flags(0)
+{
+    // Used from the scene graph threads, the slots are called directly.
+    moveToThread(nullptr);
+}
+
+QuickenEngineStatistics::~QuickenEngineStatistics()
+{
+    stopProfiling();
+}
+
+bool QuickenEngineStatistics::update(QQuickWindow* window, QuickenEngineMetrics* metrics)
+{
+    DASSERT(window);
+    DASSERT(metrics);
+
+    m_mutex.lock();
+
+    if (!m_engine) {
+        // The profilers were owned by a deleted engine.
+        m_flags &= ~Profiling;
+        m_engine = windowEngine(window);
+        if (!m_engine) {
+            m_mutex.unlock();
+            return false;
+        }
+    }
+
+    QV4::MemoryManager* memoryManager = QQmlEnginePrivate::getV4Engine(m_engine)->memoryManager;
+    const quint64 largeItemsSize = memoryManager->getLargeItemsMem();
+    metrics->heapUsed = memoryManager->getUsedMem() + largeItemsSize;
+    metrics->heapAllocated = memoryManager->getAllocatedMem() + largeItemsSize;
+
+#if QT_CONFIG(qml_debug)
+    if (!(m_flags & Profiling)) {
+        startProfiling();
+    }
+    readProfilers();
+#endif
+
+    metrics->gcTimeEstimate = m_gcTimeEstimate;
+    metrics->gcCount = m_gcCount;
+    metrics->bindingCount = m_bindingCount;
+    m_gcTimeEstimate = 0;
+    m_gcCount = 0;
+    m_bindingCount = 0;
+    m_mutex.unlock();
+
+    return true;
+}
+
+void QuickenEngineStatistics::drain()
+{
+#if QT_CONFIG(qml_debug)
+    m_mutex.lock();
+    // The profilers were possibly owned by a deleted engine.
+    if ((m_flags & Profiling) && m_engine) {
+        readProfilers();
+    }
+    m_mutex.unlock();
+#endif
+}
+
+#if QT_CONFIG(qml_debug)
+
+void QuickenEngineStatistics::readProfilers()
+{
+    if (m_v4Profiler && m_qmlProfiler) {
+        // Profilers are stopped when released by the last statistics using
+        // them, which might happen after this one started to use them.
+        if (!m_v4Profiler->featuresEnabled) {
+            m_v4Profiler->startProfiling(v4Features);
+        }
+        if (!m_qmlProfiler->featuresEnabled) {
+            m_qmlProfiler->startProfiling(qmlFeatures);
+        }
+        m_flags |= Reading;
+        m_v4Profiler->reportData(true);
+        m_qmlProfiler->reportData(true);
+        m_flags &= ~Reading;
+        // Collections after the read can't start before now.
+        m_allocationTime = qMax(m_allocationTime, profilerTimer().nsecsElapsed());
+    }
+}
+
+void QuickenEngineStatistics::startProfiling()
+{
+    DASSERT(m_engine);
+    DASSERT(!(m_flags & Profiling));
+
+    // Not retried at each frame if the engine is already profiled.
+    m_flags |= Profiling;
+
+    QV4::ExecutionEngine* v4Engine = QQmlEnginePrivate::getV4Engine(m_engine);
+    QQmlEnginePrivate* enginePrivate = QQmlEnginePrivate::get(m_engine);
+    QV4::Profiling::Profiler* v4Profiler = v4Engine->profiler();
+    QQmlProfiler* qmlProfiler = enginePrivate->profiler;
+    if (!v4Profiler && !qmlProfiler) {
+        // The GUI thread is blocked, the profilers are created here and moved
+        // to the engine thread. They are owned by the engine.
+        v4Profiler = new QV4::Profiling::Profiler(v4Engine);
+        v4Profiler->setObjectName(QLatin1String(profilerName));
+        v4Profiler->setTimer(profilerTimer());
+        v4Profiler->moveToThread(m_engine->thread());
+        v4Engine->setProfiler(v4Profiler);
+        qmlProfiler = new QQmlProfiler;
+        qmlProfiler->setObjectName(QLatin1String(profilerName));
+        qmlProfiler->setTimer(profilerTimer());
+        qmlProfiler->moveToThread(m_engine->thread());
+        enginePrivate->profiler = qmlProfiler;
+        QObject::connect(v4Profiler, &QObject::destroyed, &removeProfilerUsers);
+    } else if (!v4Profiler || !qmlProfiler
+               || v4Profiler->objectName() != QLatin1String(profilerName)
+               || qmlProfiler->objectName() != QLatin1String(profilerName)) {
+        DWARN("EngineStatistics: QML engine already profiled, garbage collections and bindings "
+              "aren't counted.");
+        return;
+    }
+
+    profilerUsersMutex.lock();
+    profilerUsers[v4Profiler]++;
+    profilerUsersMutex.unlock();
+
+    QObject::connect(v4Profiler, &QV4::Profiling::Profiler::dataReady, this,
+                     &QuickenEngineStatistics::v4DataReady, Qt::DirectConnection);
+    QObject::connect(qmlProfiler, &QQmlProfiler::dataReady, this,
+                     &QuickenEngineStatistics::qmlDataReady, Qt::DirectConnection);
+    if (!v4Profiler->featuresEnabled) {
+        v4Profiler->startProfiling(v4Features);
+    }
+    if (!qmlProfiler->featuresEnabled) {
+        qmlProfiler->startProfiling(qmlFeatures);
+    }
+    m_v4Profiler = v4Profiler;
+    m_qmlProfiler = qmlProfiler;
+    m_allocationTime = profilerTimer().nsecsElapsed();
+}
+
+#endif  // QT_CONFIG(qml_debug)
+
+void QuickenEngineStatistics::stopProfiling()
+{
+#if QT_CONFIG(qml_debug)
+    m_mutex.lock();
+    if (!(m_flags & Profiling)) {
+        m_mutex.unlock();
+        return;
+    }
+
+    if (m_v4Profiler && m_qmlProfiler) {
+        QObject::disconnect(m_v4Profiler, nullptr, this, nullptr);
+        QObject::disconnect(m_qmlProfiler, nullptr, this, nullptr);
+        profilerUsersMutex.lock();
+        QHash<QObject*, int>::iterator users = profilerUsers.find(m_v4Profiler);
+        if (users != profilerUsers.end() && --users.value() == 0) {
+            profilerUsers.erase(users);
+            // Possibly called while the engine is running, the profilers are
+            // stopped on the engine thread.
+            QMetaObject::invokeMethod(m_v4Profiler, "stopProfiling", Qt::QueuedConnection);
+            QMetaObject::invokeMethod(m_qmlProfiler, "stopProfiling", Qt::QueuedConnection);
+        }
+        profilerUsersMutex.unlock();
+    }
+    m_v4Profiler = nullptr;
+    m_qmlProfiler = nullptr;
+    m_flags &= ~Profiling;
+    m_mutex.unlock();
+#endif
+}
+
+#if QT_CONFIG(qml_debug)
+
+void QuickenEngineStatistics::v4DataReady(
+    const QV4::Profiling::FunctionLocationHash& locations,
+    const QVector<QV4::Profiling::FunctionCallProperties>& calls,
+    const QVector<QV4::Profiling::MemoryAllocationProperties>& memory)
+{
+    Q_UNUSED(locations);
+    Q_UNUSED(calls);
+
+    // Data read by other statistics sharing the profiler.
+    if (!(m_flags & Reading)) {
+        return;
+    }
+
+    // Heap items are only deallocated by the sweep phase of a collection, the
+    // mark phase started after the last allocation. A collection can't span
+    // two updates since the engine is blocked during updates.
+    qint64 gcStartTime = -1;
+    qint64 gcEndTime = 0;
+    for (int i = 0; i < memory.size(); ++i) {
+        const QV4::Profiling::MemoryAllocationProperties& allocation = memory[i];
+        if (allocation.size < 0) {
+            if (gcStartTime < 0) {
+                gcStartTime = qMin(m_allocationTime, allocation.timestamp);
+                m_gcCount++;
+            }
+            gcEndTime = allocation.timestamp;
+        } else {
+            if (gcStartTime >= 0) {
+                m_gcTimeEstimate += gcEndTime - gcStartTime;
+                gcStartTime = -1;
+            }
+            m_allocationTime = allocation.timestamp;
+        }
+    }
+    if (gcStartTime >= 0) {
+        m_gcTimeEstimate += gcEndTime - gcStartTime;
+        m_allocationTime = gcEndTime;
+    }
+}
+
+void QuickenEngineStatistics::qmlDataReady(
+    const QVector<QQmlProfilerData>& data, const QQmlProfiler::LocationHash& locations)
+{
+    Q_UNUSED(locations);
+
+    if (!(m_flags & Reading)) {
+        return;
+    }
+
+    for (int i = 0; i < data.size(); ++i) {
+        if (data[i].detailType == QQmlProfilerDefinitions::Binding
+            && (data[i].messageType & (1 << QQmlProfilerDefinitions::RangeStart))) {
+            m_bindingCount++;
+        }
+    }
+}
+
+#endif  // QT_CONFIG(qml_debug)
@@ -0,0 +1,101 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#ifndef ENGINESTATISTICS_P_H
+#define ENGINESTATISTICS_P_H
+
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+#include <QtCore/QVector>
+#include <QtQml/QQmlEngine>
+#include <QtQml/private/qqmlprofiler_p.h>
+#include <QtQml/private/qv4profiling_p.h>
+
+#include <Quicken/quickenmetrics.h>
+
+#include <Quicken/private/quickenglobal_p.h>
+
+class QQuickWindow;
+
+// QML engine statistics of a window. The engine runs on the GUI thread, so
+// update() must be called while the GUI thread is blocked by the scene graph
+// synchronization (or on the GUI thread with non-threaded render loops).
+//
+// Heap sizes are read from the V4 memory manager. Garbage collections and
+// bindings are counted by enabling the engine's V4 and QML profilers, as the
+// QML debugger does, and by reading their data at each update. The engine
+// doesn't record collections, but the V4 profiler records the allocations and
+// the sweep deallocations of the heap: a collection is detected as a sequence
+// of deallocations and its pause is estimated from the allocation preceding
+// it to the last deallocation, which slightly overestimates it. Collections
+// freeing nothing aren't detected.
+//
+// The profilers are owned by the engine and shared by the windows using the
+// same engine, each one only counts the data read by its own updates and
+// drains.
+class QUICKEN_PRIVATE_EXPORT QuickenEngineStatistics : public QObject
+{
+    Q_OBJECT
+
+public:
+    QuickenEngineStatistics();
+    ~QuickenEngineStatistics();
+
+    // Finds the engine of the given window if needed, starts profiling it and
+    // sets the engine metrics. Returns false if the window has no engine.
+    bool update(QQuickWindow* window, QuickenEngineMetrics* metrics);
+
+    // Reads the profiler data recorded since the previous update or drain, the
+    // counts are reported by the next update. The profilers record every
+    // JavaScript allocation until read, so this must be called regularly on the
+    // engine thread for windows not rendering frames (JavaScript can run
+    // without changing the scene).
+    void drain();
+
+    // Stops profiling the engine, restarted by the next update. The profilers
+    // record every JavaScript allocation until stopped.
+    void stopProfiling();
+
+private Q_SLOTS:
+#if QT_CONFIG(qml_debug)
+    void v4DataReady(const QV4::Profiling::FunctionLocationHash& locations,
+                     const QVector<QV4::Profiling::FunctionCallProperties>& calls,
+                     const QVector<QV4::Profiling::MemoryAllocationProperties>& memory);
+    void qmlDataReady(const QVector<QQmlProfilerData>& data,
+                      const QQmlProfiler::LocationHash& locations);
+#endif
+
+private:
+    Q_DISABLE_COPY(QuickenEngineStatistics)
+
+#if QT_CONFIG(qml_debug)
+    void startProfiling();
+    void readProfilers();
+#endif
+
+    enum {
+        Profiling = (1 << 0),
+        // Set while reading profiler data, the profilers are shared.
+        Reading   = (1 << 1)
+    };
+
+    // Updates are done on the scene graph thread, drains on the engine thread.
+    QMutex m_mutex;
+    QPointer<QQmlEngine> m_engine;
+#if QT_CONFIG(qml_debug)
+    QPointer<QV4::Profiling::Profiler> m_v4Profiler;
+    QPointer<QQmlProfiler> m_qmlProfiler;
+#endif
+    // Time stamp of the last allocation recorded by the V4 profiler, or of the
+    // last update if later.
+    qint64 m_allocationTime;
+    quint64 m_gcTimeEstimate;
+    quint32 m_gcCount;
+    quint32 m_bindingCount;
+    quint32 m_flags;
+};
+
+#endif  // ENGINESTATISTICS_P_H
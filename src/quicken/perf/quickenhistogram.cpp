@@ -0,0 +1,101 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#include "quickenhistogram_p.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <QtCore/QtAlgorithms>
+
+QuickenHistogram::QuickenHistogram()
+{
+    reset();
+}
+
+// A value with its most significant bit at position msb >= subBucketBits is
+// stored in sub-bucket (value >> shift), with shift = msb - (subBucketBits - 1),
+// which is in the range [subBucketCount / 2, subBucketCount). The index is then
+// (shift * subBucketCount / 2 + subBucket), which makes the indices of values
+// below subBucketCount (shift 0) the values themselves.
+int QuickenHistogram::index(quint64 value)
+{
+    DASSERT(value <= maxValue);
+
+    const int msb = 63 - static_cast<int>(qCountLeadingZeroBits(value | 1));
+    const int shift = qMax(0, msb - (subBucketBits - 1));
+    return (shift << (subBucketBits - 1)) + static_cast<int>(value >> shift);
+}
+
+quint64 QuickenHistogram::highestEquivalentValue(int index)
+{
+    DASSERT(index >= 0 && index < bucketCount);
+
+    if (index < subBucketCount) {
+        return index;
+    } else {
+        const int shift = (index >> (subBucketBits - 1)) - 1;
+        const quint64 subBucket = index - (shift << (subBucketBits - 1));
+        return ((subBucket + 1) << shift) - 1;
+    }
+}
+
+void QuickenHistogram::record(quint64 value)
+{
+    const quint64 clampedValue = value < maxValue ? value : maxValue;
+    const int bucket = index(clampedValue);
+    DASSERT(bucket < bucketCount);
+    m_counts[bucket]++;
+    m_count++;
+    m_sum += clampedValue;
+    m_min = qMin(m_min, clampedValue);
+    m_max = qMax(m_max, clampedValue);
+}
+
+void QuickenHistogram::add(const QuickenHistogram& histogram)
+{
+    for (int i = 0; i < bucketCount; ++i) {
+        m_counts[i] += histogram.m_counts[i];
+    }
+    m_count += histogram.m_count;
+    m_sum += histogram.m_sum;
+    m_min = qMin(m_min, histogram.m_min);
+    m_max = qMax(m_max, histogram.m_max);
+}
+
+void QuickenHistogram::reset()
+{
+    memset(m_counts, 0, sizeof(m_counts));
+    m_count = 0;
+    m_sum = 0;
+    m_min = maxValue;
+    m_max = 0;
+}
+
+void QuickenHistogram::percentiles(const double* percentiles, quint64* values, int count) const
+{
+    DASSERT(percentiles);
+    DASSERT(values);
+    DASSERT(count >= 0);
+
+    if (m_count == 0) {
+        memset(values, 0, count * sizeof(quint64));
+        return;
+    }
+
+    quint64 cumulativeCount = 0;
+    int bucket = 0;
+    for (int i = 0; i < count; ++i) {
+        DASSERT(percentiles[i] >= 0.0 && percentiles[i] <= 100.0);
+        DASSERT(i == 0 || percentiles[i] >= percentiles[i - 1]);
+        const quint64 targetCount = qMax(
+            static_cast<quint64>(1), static_cast<quint64>(ceil(percentiles[i] / 100.0 * m_count)));
+        while (cumulativeCount + m_counts[bucket] < targetCount && bucket < bucketCount - 1) {
+            cumulativeCount += m_counts[bucket];
+            bucket++;
+        }
+        values[i] = qMin(highestEquivalentValue(bucket), m_max);
+    }
+}
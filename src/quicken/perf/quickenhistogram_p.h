@@ -0,0 +1,70 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#ifndef HISTOGRAM_P_H
+#define HISTOGRAM_P_H
+
+#include <Quicken/private/quickenglobal_p.h>
+
+// High dynamic range histogram of unsigned integer values. Values are stored in
+// log-linear buckets, exactly up to 255 and then with a relative precision of
+// 1/128 (within 0.8%) up to maxValue, bigger values are clamped. The memory
+// footprint is fixed (15 kB) and recording a value is constant time, which
+// allows to keep distributions of frame timings in nanoseconds (up to 68 s)
+// without storing the samples. Min, max and mean are exact.
+class QUICKEN_PRIVATE_EXPORT QuickenHistogram
+{
+public:
+    static const int maxValueBits = 36;
+    static const quint64 maxValue = (Q_UINT64_C(1) << maxValueBits) - 1;
+
+    // Values below subBucketCount are stored exactly, the others in buckets of
+    // subBucketCount / 2 sub-buckets for each power of two. Buckets are
+    // indexed in ascending order of values.
+    static const int subBucketBits = 8;
+    static const int subBucketCount = 1 << subBucketBits;
+    static const int bucketCount =
+        ((maxValueBits - subBucketBits + 1) << (subBucketBits - 1)) + (subBucketCount / 2);
+
+    QuickenHistogram();
+
+    // Record a value.
+    void record(quint64 value);
+
+    // Add the values recorded by the given histogram.
+    void add(const QuickenHistogram& histogram);
+
+    // Remove all the values.
+    void reset();
+
+    quint64 count() const { return m_count; }
+    quint64 min() const { return m_count > 0 ? m_min : 0; }
+    quint64 max() const { return m_max; }
+    quint64 mean() const { return m_count > 0 ? m_sum / m_count : 0; }
+
+    // Get the values at count percentiles (in the range [0, 100]) sorted in
+    // ascending order, in a single pass over the buckets. The value returned
+    // for a percentile is the highest value equivalent to the bucket it falls
+    // in (clamped to the max value), 0 if the histogram is empty.
+    void percentiles(const double* percentiles, quint64* values, int count) const;
+
+    // Get the number of values recorded in a bucket, allows to compute
+    // statistics requiring ranks (values of a bucket being considered equal).
+    quint32 count(int bucket) const { return m_counts[bucket]; }
+
+    // Get the bucket index of a value (up to maxValue) and the highest value
+    // equivalent to a bucket.
+    static int index(quint64 value);
+    static quint64 highestEquivalentValue(int index);
+
+private:
+    quint32 m_counts[bucketCount];
+    quint64 m_count;
+    quint64 m_sum;
+    quint64 m_min;
+    quint64 m_max;
+};
+
+#endif  // HISTOGRAM_P_H
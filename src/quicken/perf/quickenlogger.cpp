@@ -6,18 +6,52 @@
 
 #include "quickenlogger_p.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <atomic>
+
 #include <QtCore/QDir>
-#include <QtCore/QTime>
 
 #include "quickenmetrics.h"
 #include "quickenglobal_p.h"
 
+void QuickenLogger::logBatch(const QuickenMetrics* metrics, int count)
+{
+    DASSERT(metrics);
+    DASSERT(count >= 0);
+
+    for (int i = 0; i < count; ++i) {
+        log(metrics[i]);
+    }
+}
+
+int QuickenLogger::idle()
+{
+    return -1;
+}
+
+// Size of the text buffer, a line takes at most maxLineSize bytes.
+const int textBufferCapacity = 65536;
+const int maxLineSize = 640;
+
 QuickenFileLogger::QuickenFileLogger(const QString& fileName, bool parsable)
     : d_ptr(new QuickenFileLoggerPrivate(fileName, parsable))
 {
 }
 
 QuickenFileLoggerPrivate::QuickenFileLoggerPrivate(const QString& fileName, bool parsable)
+    : m_buffer(new char [textBufferCapacity])
+    , m_bufferSize(0)
+    , m_flushInterval(1000)
+    , m_flushPolicy(QuickenFileLogger::FlushEveryRecord)
 {
     if (QDir::isRelativePath(fileName)) {
         m_file.setFileName(QString(QDir::currentPath() + QDir::separator() + fileName));
@@ -26,14 +60,11 @@ QuickenFileLoggerPrivate::QuickenFileLoggerPrivate(const QString& fileName, bool
     }
 
     if (m_file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Unbuffered)) {
-        m_textStream.setDevice(&m_file);
-        m_textStream.setCodec("ISO 8859-1");
-        m_textStream.setRealNumberPrecision(2);
-        m_textStream.setRealNumberNotation(QTextStream::FixedNotation);
         m_flags = Open | Parsable;
         if (parsable) {
             m_flags |= Parsable;
         }
+        m_flushTimer.start();
     } else {
         m_flags = 0;
         WARN("FileLogger: Can't open file %s '%s'.", fileName.toLatin1().constData(),
@@ -47,12 +78,12 @@ QuickenFileLogger::QuickenFileLogger(FILE* fileHandle, bool parsable)
 }
 
 QuickenFileLoggerPrivate::QuickenFileLoggerPrivate(FILE* fileHandle, bool parsable)
+    : m_buffer(new char [textBufferCapacity])
+    , m_bufferSize(0)
+    , m_flushInterval(1000)
+    , m_flushPolicy(QuickenFileLogger::FlushEveryRecord)
 {
     if (m_file.open(fileHandle, QIODevice::WriteOnly | QIODevice::Text | QIODevice::Unbuffered)) {
-        m_textStream.setDevice(&m_file);
-        m_textStream.setCodec("ISO 8859-1");
-        m_textStream.setRealNumberPrecision(2);
-        m_textStream.setRealNumberNotation(QTextStream::FixedNotation);
         if ((fileHandle == stdout || fileHandle == stderr) &&
             !qEnvironmentVariableIsSet("QUICKEN_NO_LOGGER_COLOR")) {
             m_flags = Open | Colored;
@@ -62,6 +93,7 @@ QuickenFileLoggerPrivate::QuickenFileLoggerPrivate(FILE* fileHandle, bool parsab
         if (parsable) {
             m_flags |= Parsable;
         }
+        m_flushTimer.start();
     } else {
         m_flags = 0;
         WARN("FileLogger: Can't open file handle '%s'.",
@@ -74,127 +106,970 @@ QuickenFileLogger::~QuickenFileLogger()
     delete d_ptr;
 }
 
+QuickenFileLoggerPrivate::~QuickenFileLoggerPrivate()
+{
+    if (m_flags & Open) {
+        flush();
+    }
+    delete [] m_buffer;
+}
+
 bool QuickenFileLogger::isOpen()
 {
     return !!(d_func()->m_flags & QuickenFileLoggerPrivate::Open);
 }
 
-// FIXME(loicm) We should maybe get rid of QTextStream and directly write to the
-//     device for efficiency reasons.
-
 void QuickenFileLogger::log(const QuickenMetrics& metrics)
 {
-    d_func()->log(metrics);
+    d_func()->logBatch(&metrics, 1);
+}
+
+void QuickenFileLogger::logBatch(const QuickenMetrics* metrics, int count)
+{
+    d_func()->logBatch(metrics, count);
 }
 
-void QuickenFileLoggerPrivate::log(const QuickenMetrics& metrics)
+int QuickenFileLogger::idle()
 {
+    return d_func()->idle();
+}
+
+void QuickenFileLoggerPrivate::logBatch(const QuickenMetrics* metrics, int count)
+{
+    DASSERT(metrics);
+    DASSERT(count >= 0);
+
     if (m_flags & Open) {
-        // ANSI/VT100 terminal codes.
-        const char* const dim = m_flags & Colored ? "\033[02m" : "";
-        const char* const reset = m_flags & Colored ? "\033[00m" : "";
-        const char* const dimColon = m_flags & Colored ? "\033[02m:\033[00m" : "=";
+        for (int i = 0; i < count; ++i) {
+            if (m_bufferSize > textBufferCapacity - maxLineSize) {
+                flush();
+            }
+            m_bufferSize += format(metrics[i], &m_buffer[m_bufferSize]);
+        }
+        if (m_flushPolicy == QuickenFileLogger::FlushEveryRecord
+            || (m_flushPolicy == QuickenFileLogger::FlushInterval
+                && m_flushTimer.elapsed() >= m_flushInterval)) {
+            flush();
+        }
+    }
+}
+
+int QuickenFileLoggerPrivate::idle()
+{
+    // With the FlushInterval policy, the metrics logged since the last flush
+    // are written once the interval elapsed even if no other metrics come.
+    if ((m_flags & Open) && m_flushPolicy == QuickenFileLogger::FlushInterval
+        && m_bufferSize > 0) {
+        const qint64 remaining = m_flushInterval - m_flushTimer.elapsed();
+        if (remaining > 0) {
+            return static_cast<int>(remaining);
+        }
+        flush();
+    }
+    return -1;
+}
+
+void QuickenFileLoggerPrivate::flush()
+{
+    if (m_bufferSize > 0) {
+        if (m_file.write(m_buffer, m_bufferSize) != m_bufferSize) {
+            DWARN("FileLogger: Can't write to file '%s'.",
+                  m_file.errorString().toLatin1().constData());
+        }
+        // Only required for file handles (buffered by stdio).
+        m_file.flush();
+        m_bufferSize = 0;
+    }
+    m_flushTimer.start();
+}
+
+// The text helpers below write to a buffer and return the number of bytes
+// written. Their output must be identical to the former QTextStream based
+// implementation (Latin-1 codec, fixed notation with 2 digits of precision) so
+// that existing log parsers keep working. For the same reason, parsable frame
+// and process lines keep their original fields, values added since are written
+// on an extension line ('f' and 'p') right after them.
+
+static inline int appendString(const char* string, char* buffer)
+{
+    int size = 0;
+    while (string[size] != '\0') {
+        buffer[size] = string[size];
+        size++;
+    }
+    return size;
+}
+
+static inline int appendInteger(quint64 value, char* buffer)
+{
+    char digits[20];
+    int digitCount = 0;
+    do {
+        digits[digitCount++] = (value % 10) + '0';
+        value /= 10;
+    } while (value != 0);
+    for (int i = 0; i < digitCount; ++i) {
+        buffer[i] = digits[digitCount - 1 - i];
+    }
+    return digitCount;
+}
+
+static inline int appendSignedInteger(qint64 value, char* buffer)
+{
+    if (value < 0) {
+        buffer[0] = '-';
+        return 1 + appendInteger(-static_cast<quint64>(value), &buffer[1]);
+    } else {
+        return appendInteger(value, buffer);
+    }
+}
+
+// Appends a real that reads back to the same value (at most 24 bytes). 15
+// significant digits are tried first to avoid printing binary rounding noise.
+static inline int appendReal(double value, char* buffer)
+{
+    int size = snprintf(buffer, 25, "%.15g", value);
+    if (strtod(buffer, nullptr) != value) {
+        size = snprintf(buffer, 25, "%.17g", value);
+    }
+    return size;
+}
+
+// Appends the values of numeric metrics separated by the given character.
+static inline int appendNumericValues(
+    const QuickenNumericMetrics& metrics, char separator, char* buffer)
+{
+    int size = 0;
+    const int count = qMin(static_cast<int>(metrics.valueCount),
+                           static_cast<int>(QuickenNumericMetrics::maxValueCount));
+    for (int i = 0; i < count; ++i) {
+        if (i > 0) {
+            buffer[size++] = separator;
+        }
+        if (metrics.kind == QuickenNumericMetrics::Integer) {
+            size += appendSignedInteger(metrics.integers[i], &buffer[size]);
+        } else {
+            size += appendReal(metrics.reals[i], &buffer[size]);
+        }
+    }
+    return size;
+}
 
-        QTime timeStamp = QTime(0, 0).addMSecs(metrics.timeStamp / 1000000);
-        QString timeString = !timeStamp.hour()
-            ? timeStamp.toString(QStringLiteral("mm:ss:zzz"))
-            : timeStamp.toString(QStringLiteral("hh:mm:ss:zzz"));
+// Appends a possibly non null-terminated string of at most maxSize bytes.
+static inline int appendBoundedString(const char* string, int maxSize, char* buffer)
+{
+    const int size = strnlen(string, maxSize);
+    memcpy(buffer, string, size);
+    return size;
+}
+
+static inline int appendPaddedInteger(quint32 value, int width, char* buffer)
+{
+    for (int i = width - 1; i >= 0; --i) {
+        buffer[i] = (value % 10) + '0';
+        value /= 10;
+    }
+    return width;
+}
+
+// Appends a value in hundredths with 2 decimal digits.
+static inline int appendHundredths(quint64 value, char* buffer)
+{
+    int size = appendInteger(value / 100, buffer);
+    buffer[size++] = '.';
+    size += appendPaddedInteger(value % 100, 2, &buffer[size]);
+    return size;
+}
+
+// Appends a time in nanoseconds as milliseconds with 2 decimal digits. The
+// value is converted to a float and rounded half up like QTextStream does. The
+// conversion to double of the float multiplied by 100 is exact (24 bits
+// mantissa times 7 bits), so is the rounding.
+static inline int appendTime(quint64 time, char* buffer)
+{
+    const float milliseconds = time / 1000000.0f;
+    const quint64 hundredths = static_cast<quint64>(
+        floor(static_cast<double>(milliseconds) * 100.0 + 0.5));
+    int size = appendInteger(hundredths / 100, buffer);
+    buffer[size++] = '.';
+    size += appendPaddedInteger(hundredths % 100, 2, &buffer[size]);
+    return size;
+}
+
+// Appends the time stamp in nanoseconds as "mm:ss:zzz" or "hh:mm:ss:zzz" if
+// longer than an hour, wrapping after 24 hours like QTime::addMSecs() with the
+// milliseconds truncated to an int.
+static inline int appendTimeStamp(quint64 timeStamp, char* buffer)
+{
+    const qint64 millisecondsPerDay = 86400000;
+    qint64 milliseconds = static_cast<int>(timeStamp / 1000000);
+    milliseconds %= millisecondsPerDay;
+    if (milliseconds < 0) {
+        milliseconds += millisecondsPerDay;
+    }
+    const quint32 hours = milliseconds / 3600000;
+    const quint32 minutes = (milliseconds / 60000) % 60;
+    const quint32 seconds = (milliseconds / 1000) % 60;
+    int size = 0;
+    if (hours > 0) {
+        size += appendPaddedInteger(hours, 2, &buffer[size]);
+        buffer[size++] = ':';
+    }
+    size += appendPaddedInteger(minutes, 2, &buffer[size]);
+    buffer[size++] = ':';
+    size += appendPaddedInteger(seconds, 2, &buffer[size]);
+    buffer[size++] = ':';
+    size += appendPaddedInteger(milliseconds % 1000, 3, &buffer[size]);
+    return size;
+}
+
+// Formats metrics to buffer which must have at least maxLineSize bytes
+// available. Returns the number of bytes written.
+int QuickenFileLoggerPrivate::format(const QuickenMetrics& metrics, char* buffer)
+{
+    // ANSI/VT100 terminal codes.
+    const char* const dim = m_flags & Colored ? "\033[02m" : "";
+    const char* const reset = m_flags & Colored ? "\033[00m" : "";
+    const char* const dimColon = m_flags & Colored ? "\033[02m:\033[00m" : "=";
 
+    int size = 0;
+    const bool parsable = m_flags & Parsable;
+    if (!parsable) {
         switch (metrics.type) {
-        case QuickenMetrics::Process: {
-            if (m_flags & Parsable) {
-                m_textStream
-                    << "P "
-                    << metrics.timeStamp << ' '
-                    << metrics.process.cpuUsage << ' '
-                    << metrics.process.vszMemory << ' '
-                    << metrics.process.rssMemory << ' '
-                    << metrics.process.threadCount << '\n' << flush;
-            } else {
-                m_textStream
-                    << (m_flags & Colored ? "\033[33mP\033[00m " : "P ")
-                    << dim << timeString << reset << ' '
-                    << "CPU" << dimColon << metrics.process.cpuUsage << "% "
-                    << "VSZ" << dimColon << metrics.process.vszMemory << "kB "
-                    << "RSS" << dimColon << metrics.process.rssMemory << "kB "
-                    << "Threads" << dimColon << metrics.process.threadCount
-                    << '\n' << flush;
-            }
+        case QuickenMetrics::Process:
+            size += appendString(m_flags & Colored ? "\033[33mP\033[00m " : "P ", buffer);
+            break;
+        case QuickenMetrics::Frame:
+            size += appendString(m_flags & Colored ? "\033[36mF\033[00m " : "F ", buffer);
+            break;
+        case QuickenMetrics::Window:
+            size += appendString(m_flags & Colored ? "\033[35mW\033[00m " : "W ", buffer);
+            break;
+        case QuickenMetrics::Generic:
+            size += appendString(m_flags & Colored ? "\033[32mG\033[00m " : "G ", buffer);
+            break;
+        case QuickenMetrics::Dropped:
+            size += appendString(m_flags & Colored ? "\033[31mD\033[00m " : "D ", buffer);
+            break;
+        case QuickenMetrics::Numeric:
+            size += appendString(m_flags & Colored ? "\033[34mN\033[00m " : "N ", buffer);
+            break;
+        case QuickenMetrics::Scope:
+            size += appendString(m_flags & Colored ? "\033[37mT\033[00m " : "T ", buffer);
+            break;
+        case QuickenMetrics::Thread:
+            size += appendString(m_flags & Colored ? "\033[93mH\033[00m " : "H ", buffer);
+            break;
+        case QuickenMetrics::Memory:
+            size += appendString(m_flags & Colored ? "\033[92mM\033[00m " : "M ", buffer);
+            break;
+        case QuickenMetrics::PerfCounters:
+            size += appendString(m_flags & Colored ? "\033[96mC\033[00m " : "C ", buffer);
+            break;
+        case QuickenMetrics::Engine:
+            size += appendString(m_flags & Colored ? "\033[95mE\033[00m " : "E ", buffer);
+            break;
+        case QuickenMetrics::Pacing:
+            size += appendString(m_flags & Colored ? "\033[94mV\033[00m " : "V ", buffer);
+            break;
+        case QuickenMetrics::Timeline:
+            size += appendString(m_flags & Colored ? "\033[91mL\033[00m " : "L ", buffer);
+            break;
+        default:
             break;
         }
+        size += appendString(dim, &buffer[size]);
+        size += appendTimeStamp(metrics.timeStamp, &buffer[size]);
+        size += appendString(reset, &buffer[size]);
+        buffer[size++] = ' ';
+    }
 
-        case QuickenMetrics::Frame:
-            if (m_flags & Parsable) {
-                m_textStream
-                    << "F "
-                    << metrics.timeStamp << ' '
-                    << metrics.frame.window << ' '
-                    << metrics.frame.number << ' '
-                    << metrics.frame.deltaTime << ' '
-                    << metrics.frame.syncTime << ' '
-                    << metrics.frame.renderTime << ' '
-                    << metrics.frame.gpuTime << ' '
-                    << metrics.frame.swapTime << '\n' << flush;
-            } else {
-                m_textStream
-                    << (m_flags & Colored ? "\033[36mF\033[00m " : "F ")
-                    << dim << timeString << reset << ' '
-                    << "Win" << dimColon << metrics.frame.window << ' '
-                    << "N" << dimColon << metrics.frame.number << ' '
-                    << "Delta" << dimColon << metrics.frame.deltaTime / 1000000.0f << "ms "
-                    << "Sync" << dimColon << metrics.frame.syncTime / 1000000.0f << "ms "
-                    << "Render" << dimColon << metrics.frame.renderTime / 1000000.0f << "ms "
-                    << "GPU" << dimColon << metrics.frame.gpuTime / 1000000.0f << "ms "
-                    << "Swap" << dimColon << metrics.frame.swapTime / 1000000.0f << "ms\n" << flush;
-            }
-            break;
-
-        case QuickenMetrics::Window: {
-            if (m_flags & Parsable) {
-                m_textStream
-                    << "W "
-                    << metrics.timeStamp << ' '
-                    << metrics.window.id << ' '
-                    << metrics.window.state << ' '
-                    << metrics.window.width << ' '
-                    << metrics.window.height << '\n' << flush;
+    switch (metrics.type) {
+    case QuickenMetrics::Process: {
+        if (parsable) {
+            size += appendString("P ", &buffer[size]);
+            size += appendInteger(metrics.timeStamp, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.process.cpuUsage, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.process.vszMemory, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.process.rssMemory, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.process.threadCount, &buffer[size]);
+            buffer[size++] = '\n';
+            size += appendString("p ", &buffer[size]);
+            size += appendInteger(metrics.timeStamp, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.process.readBytes, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.process.writtenBytes, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.process.minorPageFaults, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.process.majorPageFaults, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.process.voluntaryContextSwitches, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.process.involuntaryContextSwitches, &buffer[size]);
+        } else {
+            size += appendString("CPU", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.process.cpuUsage, &buffer[size]);
+            size += appendString("% VSZ", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.process.vszMemory, &buffer[size]);
+            size += appendString("kB RSS", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.process.rssMemory, &buffer[size]);
+            size += appendString("kB Threads", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.process.threadCount, &buffer[size]);
+            size += appendString(" Read", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.process.readBytes >> 10, &buffer[size]);
+            size += appendString("kB Written", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.process.writtenBytes >> 10, &buffer[size]);
+            size += appendString("kB Faults", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.process.minorPageFaults, &buffer[size]);
+            buffer[size++] = '/';
+            size += appendInteger(metrics.process.majorPageFaults, &buffer[size]);
+            size += appendString(" Switches", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.process.voluntaryContextSwitches, &buffer[size]);
+            buffer[size++] = '/';
+            size += appendInteger(metrics.process.involuntaryContextSwitches, &buffer[size]);
+        }
+        break;
+    }
+
+    case QuickenMetrics::Frame:
+        if (parsable) {
+            size += appendString("F ", &buffer[size]);
+            size += appendInteger(metrics.timeStamp, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.frame.window, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.frame.number, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.frame.deltaTime, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.frame.syncTime, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.frame.renderTime, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.frame.gpuTime, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.frame.swapTime, &buffer[size]);
+            buffer[size++] = '\n';
+            size += appendString("f ", &buffer[size]);
+            size += appendInteger(metrics.timeStamp, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.frame.window, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.frame.number, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.frame.cpuTime, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.frame.minorPageFaults, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.frame.majorPageFaults, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.frame.voluntaryContextSwitches, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.frame.involuntaryContextSwitches, &buffer[size]);
+            const quint32 sceneGraphValues[] = {
+                metrics.frame.nodeCount, metrics.frame.opaqueBatchCount,
+                metrics.frame.alphaBatchCount, metrics.frame.drawCallCount,
+                metrics.frame.materialChangeCount, metrics.frame.shaderChangeCount,
+                metrics.frame.vertexUploadSize, metrics.frame.indexUploadSize
+            };
+            for (int i = 0; i < static_cast<int>(ARRAY_SIZE(sceneGraphValues)); ++i) {
+                buffer[size++] = ' ';
+                size += appendInteger(sceneGraphValues[i], &buffer[size]);
+            }
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.frame.inputLatency, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.frame.inputEventCount, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.frame.droppedVsyncCount, &buffer[size]);
+        } else {
+            size += appendString("Win", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.frame.window, &buffer[size]);
+            size += appendString(" N", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.frame.number, &buffer[size]);
+            size += appendString(" Delta", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendTime(metrics.frame.deltaTime, &buffer[size]);
+            size += appendString("ms Sync", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendTime(metrics.frame.syncTime, &buffer[size]);
+            size += appendString("ms Render", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendTime(metrics.frame.renderTime, &buffer[size]);
+            size += appendString("ms GPU", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendTime(metrics.frame.gpuTime, &buffer[size]);
+            size += appendString("ms Swap", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendTime(metrics.frame.swapTime, &buffer[size]);
+            size += appendString("ms CPU", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendTime(metrics.frame.cpuTime, &buffer[size]);
+            size += appendString("ms Faults", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.frame.minorPageFaults, &buffer[size]);
+            buffer[size++] = '/';
+            size += appendInteger(metrics.frame.majorPageFaults, &buffer[size]);
+            size += appendString(" Switches", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.frame.voluntaryContextSwitches, &buffer[size]);
+            buffer[size++] = '/';
+            size += appendInteger(metrics.frame.involuntaryContextSwitches, &buffer[size]);
+            size += appendString(" Nodes", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.frame.nodeCount, &buffer[size]);
+            size += appendString(" Batches", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.frame.opaqueBatchCount, &buffer[size]);
+            buffer[size++] = '/';
+            size += appendInteger(metrics.frame.alphaBatchCount, &buffer[size]);
+            size += appendString(" Draws", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.frame.drawCallCount, &buffer[size]);
+            size += appendString(" Changes", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.frame.materialChangeCount, &buffer[size]);
+            buffer[size++] = '/';
+            size += appendInteger(metrics.frame.shaderChangeCount, &buffer[size]);
+            size += appendString(" Upload", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(
+                (static_cast<quint64>(metrics.frame.vertexUploadSize)
+                 + metrics.frame.indexUploadSize) >> 10, &buffer[size]);
+            size += appendString("kB", &buffer[size]);
+            if (metrics.frame.inputEventCount > 0) {
+                size += appendString(" Input", &buffer[size]);
+                size += appendString(dimColon, &buffer[size]);
+                size += appendTime(metrics.frame.inputLatency, &buffer[size]);
+                size += appendString("ms/", &buffer[size]);
+                size += appendInteger(metrics.frame.inputEventCount, &buffer[size]);
+            }
+            if (metrics.frame.droppedVsyncCount > 0) {
+                size += appendString(" Dropped", &buffer[size]);
+                size += appendString(dimColon, &buffer[size]);
+                size += appendInteger(metrics.frame.droppedVsyncCount, &buffer[size]);
+            }
+        }
+        break;
+
+    case QuickenMetrics::Window: {
+        if (parsable) {
+            size += appendString("W ", &buffer[size]);
+            size += appendInteger(metrics.timeStamp, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.window.id, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.window.state, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.window.width, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.window.height, &buffer[size]);
+        } else {
+            const char* const stateString[] = { "Hidden", "Shown", "Resized" };
+            Q_STATIC_ASSERT(ARRAY_SIZE(stateString) == QuickenWindowMetrics::StateCount);
+            size += appendString("Id", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.window.id, &buffer[size]);
+            size += appendString(" State", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendString(stateString[metrics.window.state], &buffer[size]);
+            size += appendString(" Size", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.window.width, &buffer[size]);
+            buffer[size++] = 'x';
+            size += appendInteger(metrics.window.height, &buffer[size]);
+        }
+        break;
+    }
+
+    case QuickenMetrics::Generic: {
+        // Strings might not be null-terminated.
+        const int stringSize =
+            strnlen(metrics.generic.string, QuickenGenericMetrics::maxStringSize);
+        if (parsable) {
+            size += appendString("G ", &buffer[size]);
+            size += appendInteger(metrics.timeStamp, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.generic.id, &buffer[size]);
+            buffer[size++] = ' ';
+            memcpy(&buffer[size], metrics.generic.string, stringSize);
+            size += stringSize;
+        } else {
+            size += appendString("Id", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.generic.id, &buffer[size]);
+            size += appendString(" String", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            buffer[size++] = '"';
+            memcpy(&buffer[size], metrics.generic.string, stringSize);
+            size += stringSize;
+            buffer[size++] = '"';
+        }
+        break;
+    }
+
+    case QuickenMetrics::Dropped: {
+        if (parsable) {
+            size += appendString("D ", &buffer[size]);
+            size += appendInteger(metrics.timeStamp, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.dropped.window, &buffer[size]);
+            for (int i = 0; i < QuickenMetrics::TypeCount; ++i) {
+                buffer[size++] = ' ';
+                size += appendInteger(metrics.dropped.count[i], &buffer[size]);
+            }
+        } else {
+            const char* const typeString[] = {
+                "Process", "Window", "Frame", "Generic", "Dropped", "Numeric", "Scope", "Thread",
+                "Memory", "PerfCounters", "Engine", "Pacing", "Timeline"
+            };
+            Q_STATIC_ASSERT(ARRAY_SIZE(typeString) == QuickenMetrics::TypeCount);
+            size += appendString("Win", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.dropped.window, &buffer[size]);
+            for (int i = 0; i < QuickenMetrics::TypeCount; ++i) {
+                if (metrics.dropped.count[i] > 0) {
+                    buffer[size++] = ' ';
+                    size += appendString(typeString[i], &buffer[size]);
+                    size += appendString(dimColon, &buffer[size]);
+                    size += appendInteger(metrics.dropped.count[i], &buffer[size]);
+                }
+            }
+        }
+        break;
+    }
+
+    case QuickenMetrics::Numeric: {
+        const QuickenNumericMetrics& numeric = metrics.numeric;
+        if (numeric.kind == QuickenNumericMetrics::Declaration) {
+            m_numericDeclarations.insert(numeric.id, numeric.declaration);
+        } else if (numeric.kind >= QuickenNumericMetrics::KindCount) {
+            return 0;
+        }
+        if (parsable) {
+            // Declarations are written as "N time id 2 name [unit]", values as
+            // "N time id kind value...".
+            size += appendString("N ", &buffer[size]);
+            size += appendInteger(metrics.timeStamp, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(numeric.id, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(numeric.kind, &buffer[size]);
+            buffer[size++] = ' ';
+            if (numeric.kind == QuickenNumericMetrics::Declaration) {
+                size += appendBoundedString(numeric.declaration.name,
+                                            QuickenNumericDeclaration::maxNameSize, &buffer[size]);
+                if (numeric.declaration.unit[0] != '\0') {
+                    buffer[size++] = ' ';
+                    size += appendBoundedString(numeric.declaration.unit,
+                                                QuickenNumericDeclaration::maxUnitSize,
+                                                &buffer[size]);
+                }
             } else {
-                const char* const stateString[] = { "Hidden", "Shown", "Resized" };
-                Q_STATIC_ASSERT(ARRAY_SIZE(stateString) == QuickenWindowMetrics::StateCount);
-                m_textStream
-                    << (m_flags & Colored ? "\033[35mW\033[00m " : "W ")
-                    << dim << timeString << reset << ' '
-                    << "Id" << dimColon << metrics.window.id << ' '
-                    << "State" << dimColon << stateString[metrics.window.state] << ' '
-                    << "Size" << dimColon << metrics.window.width << 'x' << metrics.window.height
-                    << '\n' << flush;
-            }
-            break;
-        }
-
-        case QuickenMetrics::Generic: {
-            if (m_flags & Parsable) {
-                m_textStream
-                    << "G "
-                    << metrics.timeStamp << ' '
-                    << metrics.generic.id << ' '
-                    << metrics.generic.string << '\n' << flush;
+                size += appendNumericValues(numeric, ' ', &buffer[size]);
+            }
+        } else {
+            const QuickenNumericDeclaration* declaration = nullptr;
+            QHash<quint32, QuickenNumericDeclaration>::const_iterator it =
+                m_numericDeclarations.constFind(numeric.id);
+            if (it != m_numericDeclarations.constEnd()) {
+                declaration = &it.value();
+            }
+            if (numeric.kind == QuickenNumericMetrics::Declaration || !declaration) {
+                size += appendString("Id", &buffer[size]);
+                size += appendString(dimColon, &buffer[size]);
+                size += appendInteger(numeric.id, &buffer[size]);
+                buffer[size++] = ' ';
+            }
+            if (numeric.kind == QuickenNumericMetrics::Declaration) {
+                size += appendString("Name", &buffer[size]);
+                size += appendString(dimColon, &buffer[size]);
+                size += appendBoundedString(numeric.declaration.name,
+                                            QuickenNumericDeclaration::maxNameSize, &buffer[size]);
+                size += appendString(" Unit", &buffer[size]);
+                size += appendString(dimColon, &buffer[size]);
+                size += appendBoundedString(numeric.declaration.unit,
+                                            QuickenNumericDeclaration::maxUnitSize, &buffer[size]);
             } else {
-                m_textStream
-                    << (m_flags & Colored ? "\033[32mG\033[00m " : "G ")
-                    << dim << timeString << reset << ' '
-                    << "Id" << dimColon << metrics.generic.id << ' '
-                    << "String" << dimColon << '"' << metrics.generic.string << '"'
-                    << '\n' << flush;
+                if (declaration) {
+                    size += appendBoundedString(declaration->name,
+                                                QuickenNumericDeclaration::maxNameSize,
+                                                &buffer[size]);
+                } else {
+                    size += appendString("Values", &buffer[size]);
+                }
+                size += appendString(dimColon, &buffer[size]);
+                size += appendNumericValues(numeric, ',', &buffer[size]);
+                if (declaration) {
+                    size += appendBoundedString(declaration->unit,
+                                                QuickenNumericDeclaration::maxUnitSize,
+                                                &buffer[size]);
+                }
             }
-            break;
         }
+        break;
+    }
 
-        default:
-            DNOT_REACHED();
-            break;
+    case QuickenMetrics::Scope: {
+        const quint64 duration =
+            metrics.timeStamp - qMin(metrics.timeStamp, metrics.scope.startTime);
+        if (parsable) {
+            size += appendString("T ", &buffer[size]);
+            size += appendInteger(metrics.timeStamp, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.scope.thread, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.scope.depth, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(duration, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendBoundedString(
+                metrics.scope.name, QuickenScopeMetrics::maxNameSize, &buffer[size]);
+        } else {
+            size += appendString("Thread", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.scope.thread, &buffer[size]);
+            size += appendString(" Depth", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.scope.depth, &buffer[size]);
+            size += appendString(" Name", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            buffer[size++] = '"';
+            size += appendBoundedString(
+                metrics.scope.name, QuickenScopeMetrics::maxNameSize, &buffer[size]);
+            buffer[size++] = '"';
+            size += appendString(" Time", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendTime(duration, &buffer[size]);
+            size += appendString("ms", &buffer[size]);
+        }
+        break;
+    }
+
+    case QuickenMetrics::Thread: {
+        const char state = metrics.thread.state > ' ' ? metrics.thread.state : '?';
+        if (parsable) {
+            // The name is the rest of the line, it might contain spaces.
+            size += appendString("H ", &buffer[size]);
+            size += appendInteger(metrics.timeStamp, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.thread.thread, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.thread.role, &buffer[size]);
+            buffer[size++] = ' ';
+            buffer[size++] = state;
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.thread.cpuUsage, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.thread.userTime, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(metrics.thread.systemTime, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendBoundedString(
+                metrics.thread.name, QuickenThreadMetrics::maxNameSize, &buffer[size]);
+        } else {
+            const char* const roleString[] = {
+                "Other", "GUI", "Render", "PixmapReader", "QML", "Logging"
+            };
+            Q_STATIC_ASSERT(ARRAY_SIZE(roleString) == QuickenThreadMetrics::RoleCount);
+            size += appendString("Thread", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.thread.thread, &buffer[size]);
+            size += appendString(" Name", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            buffer[size++] = '"';
+            size += appendBoundedString(
+                metrics.thread.name, QuickenThreadMetrics::maxNameSize, &buffer[size]);
+            buffer[size++] = '"';
+            if (metrics.thread.role < QuickenThreadMetrics::RoleCount) {
+                size += appendString(" Role", &buffer[size]);
+                size += appendString(dimColon, &buffer[size]);
+                size += appendString(roleString[metrics.thread.role], &buffer[size]);
+            }
+            size += appendString(" State", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            buffer[size++] = state;
+            size += appendString(" CPU", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(metrics.thread.cpuUsage, &buffer[size]);
+            size += appendString("% User", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendTime(metrics.thread.userTime, &buffer[size]);
+            size += appendString("ms System", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendTime(metrics.thread.systemTime, &buffer[size]);
+            size += appendString("ms", &buffer[size]);
+        }
+        break;
+    }
+
+    case QuickenMetrics::Memory: {
+        const QuickenMemoryMetrics& memory = metrics.memory;
+        if (parsable) {
+            size += appendString("M ", &buffer[size]);
+            size += appendInteger(metrics.timeStamp, &buffer[size]);
+            const quint32 values[] = {
+                memory.pssMemory, memory.privateCleanMemory, memory.privateDirtyMemory,
+                memory.anonymousMemory, memory.swapMemory, memory.heapArenaMemory,
+                memory.heapUsedMemory, memory.heapFreeMemory, memory.heapMappedMemory
+            };
+            for (int i = 0; i < static_cast<int>(ARRAY_SIZE(values)); ++i) {
+                buffer[size++] = ' ';
+                size += appendInteger(values[i], &buffer[size]);
+            }
+        } else {
+            size += appendString("PSS", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(memory.pssMemory, &buffer[size]);
+            size += appendString("kB USS", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(
+                memory.privateCleanMemory + memory.privateDirtyMemory, &buffer[size]);
+            size += appendString("kB Dirty", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(memory.privateDirtyMemory, &buffer[size]);
+            size += appendString("kB Anon", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(memory.anonymousMemory, &buffer[size]);
+            size += appendString("kB Swap", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(memory.swapMemory, &buffer[size]);
+            size += appendString("kB Heap", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(memory.heapUsedMemory, &buffer[size]);
+            size += appendString("kB Free", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(memory.heapFreeMemory, &buffer[size]);
+            size += appendString("kB", &buffer[size]);
+        }
+        break;
+    }
+
+    case QuickenMetrics::PerfCounters: {
+        const QuickenPerfCounterMetrics& perfCounters = metrics.perfCounters;
+        const int counterCount = QuickenPerfCounterMetrics::counterCount;
+        if (parsable) {
+            size += appendString("C ", &buffer[size]);
+            size += appendInteger(metrics.timeStamp, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(perfCounters.window, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(perfCounters.number, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(perfCounters.role, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(perfCounters.source, &buffer[size]);
+            for (int i = 0; i < QuickenPerfCounterMetrics::PhaseCount; ++i) {
+                for (int j = 0; j < counterCount; ++j) {
+                    buffer[size++] = ' ';
+                    size += appendInteger(perfCounters.values[i][j], &buffer[size]);
+                }
+            }
+        } else {
+            const char* const counterString[][counterCount] = {
+                { " Instr", " Cycles", " Misses" }, { " TaskClock", " Switches", " Faults" }
+            };
+            Q_STATIC_ASSERT(
+                ARRAY_SIZE(counterString) == QuickenPerfCounterMetrics::SourceCount);
+            size += appendString("Win", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(perfCounters.window, &buffer[size]);
+            size += appendString(" Frame", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(perfCounters.number, &buffer[size]);
+            size += appendString(" Role", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendString(
+                perfCounters.role == QuickenThreadMetrics::Gui ? "GUI" : "Render", &buffer[size]);
+            // Values per phase, sync/render/swap.
+            const int source = qMin<int>(perfCounters.source, QuickenPerfCounterMetrics::Software);
+            for (int i = 0; i < counterCount; ++i) {
+                size += appendString(counterString[source][i], &buffer[size]);
+                size += appendString(dimColon, &buffer[size]);
+                for (int j = 0; j < QuickenPerfCounterMetrics::PhaseCount; ++j) {
+                    if (j > 0) {
+                        buffer[size++] = '/';
+                    }
+                    size += appendInteger(perfCounters.values[j][i], &buffer[size]);
+                }
+            }
+        }
+        break;
+    }
+
+    case QuickenMetrics::Engine: {
+        const QuickenEngineMetrics& engine = metrics.engine;
+        if (parsable) {
+            size += appendString("E ", &buffer[size]);
+            size += appendInteger(metrics.timeStamp, &buffer[size]);
+            const quint64 values[] = {
+                engine.window, engine.number, engine.heapUsed, engine.heapAllocated,
+                engine.gcCount, engine.gcTimeEstimate, engine.bindingCount
+            };
+            for (int i = 0; i < static_cast<int>(ARRAY_SIZE(values)); ++i) {
+                buffer[size++] = ' ';
+                size += appendInteger(values[i], &buffer[size]);
+            }
+        } else {
+            size += appendString("Win", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(engine.window, &buffer[size]);
+            size += appendString(" N", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(engine.number, &buffer[size]);
+            size += appendString(" JSHeap", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(engine.heapUsed >> 10, &buffer[size]);
+            buffer[size++] = '/';
+            size += appendInteger(engine.heapAllocated >> 10, &buffer[size]);
+            size += appendString("kB GC", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(engine.gcCount, &buffer[size]);
+            size += appendString(" GCTimeEst", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendTime(engine.gcTimeEstimate, &buffer[size]);
+            size += appendString("ms Bindings", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(engine.bindingCount, &buffer[size]);
+        }
+        break;
+    }
+
+    case QuickenMetrics::Pacing: {
+        const QuickenPacingMetrics& pacing = metrics.pacing;
+        if (parsable) {
+            size += appendString("V ", &buffer[size]);
+            size += appendInteger(metrics.timeStamp, &buffer[size]);
+            const quint32 values[] = {
+                pacing.window, pacing.number, pacing.vsyncInterval, pacing.screenVsyncInterval,
+                pacing.frameCount, pacing.vsyncCount, pacing.droppedVsyncCount,
+                pacing.pacingChangeCount, pacing.smoothness
+            };
+            for (int i = 0; i < static_cast<int>(ARRAY_SIZE(values)); ++i) {
+                buffer[size++] = ' ';
+                size += appendInteger(values[i], &buffer[size]);
+            }
+        } else {
+            size += appendString("Win", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(pacing.window, &buffer[size]);
+            size += appendString(" N", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(pacing.number, &buffer[size]);
+            size += appendString(" Vsync", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendTime(pacing.vsyncInterval, &buffer[size]);
+            buffer[size++] = '/';
+            size += appendTime(pacing.screenVsyncInterval, &buffer[size]);
+            size += appendString("ms Frames", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(pacing.frameCount, &buffer[size]);
+            buffer[size++] = '/';
+            size += appendInteger(pacing.vsyncCount, &buffer[size]);
+            size += appendString(" Dropped", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(pacing.droppedVsyncCount, &buffer[size]);
+            size += appendString(" PacingChanges", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(pacing.pacingChangeCount, &buffer[size]);
+            size += appendString(" Smoothness", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendHundredths(pacing.smoothness, &buffer[size]);
+            buffer[size++] = '%';
+        }
+        break;
+    }
+
+    case QuickenMetrics::Timeline: {
+        const QuickenTimelineMetrics& timeline = metrics.timeline;
+        if (parsable) {
+            size += appendString("L ", &buffer[size]);
+            size += appendInteger(metrics.timeStamp, &buffer[size]);
+            const quint32 values[] = {
+                timeline.window, timeline.number, timeline.thread, timeline.role
+            };
+            for (int i = 0; i < static_cast<int>(ARRAY_SIZE(values)); ++i) {
+                buffer[size++] = ' ';
+                size += appendInteger(values[i], &buffer[size]);
+            }
+            for (int i = 0; i < QuickenTimelineMetrics::maxBoundaryCount; ++i) {
+                buffer[size++] = ' ';
+                size += appendInteger(timeline.timeStamps[i], &buffer[size]);
+            }
+        } else {
+            const char* const guiBoundaryString[] = {
+                " Update", " Polished", " Unblocked", " End"
+            };
+            const char* const renderBoundaryString[] = {
+                " Sync", " Synced", " Render", " Rendered", " Swap", " Swapped"
+            };
+            Q_STATIC_ASSERT(
+                ARRAY_SIZE(guiBoundaryString) == QuickenTimelineMetrics::GuiBoundaryCount);
+            Q_STATIC_ASSERT(
+                ARRAY_SIZE(renderBoundaryString) == QuickenTimelineMetrics::RenderBoundaryCount);
+            const bool gui = timeline.role == QuickenThreadMetrics::Gui;
+            const char* const* boundaryString = gui ? guiBoundaryString : renderBoundaryString;
+            const int boundaryCount = gui
+                ? static_cast<int>(QuickenTimelineMetrics::GuiBoundaryCount)
+                : static_cast<int>(QuickenTimelineMetrics::RenderBoundaryCount);
+            size += appendString("Win", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(timeline.window, &buffer[size]);
+            size += appendString(" N", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(timeline.number, &buffer[size]);
+            size += appendString(" Role", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendString(gui ? "GUI" : "Render", &buffer[size]);
+            size += appendString(" Tid", &buffer[size]);
+            size += appendString(dimColon, &buffer[size]);
+            size += appendInteger(timeline.thread, &buffer[size]);
+            // Boundaries are written relative to the first one reached, "-"
+            // for the ones not reached.
+            quint64 origin = 0;
+            for (int i = 0; i < boundaryCount && origin == 0; ++i) {
+                origin = timeline.timeStamps[i];
+            }
+            for (int i = 0; i < boundaryCount; ++i) {
+                size += appendString(boundaryString[i], &buffer[size]);
+                size += appendString(dimColon, &buffer[size]);
+                if (timeline.timeStamps[i] > 0) {
+                    size += appendTime(
+                        timeline.timeStamps[i] - qMin(timeline.timeStamps[i], origin),
+                        &buffer[size]);
+                } else {
+                    buffer[size++] = '-';
+                }
+            }
+            size += appendString("ms", &buffer[size]);
         }
+        break;
     }
+
+    default:
+        DNOT_REACHED();
+        return 0;
+    }
+
+    buffer[size++] = '\n';
+    DASSERT(size <= maxLineSize);
+    return size;
 }
 
 void QuickenFileLogger::setParsable(bool parsable)
@@ -212,3 +1087,1342 @@ bool QuickenFileLogger::parsable()
 {
     return !!(d_func()->m_flags & QuickenFileLoggerPrivate::Parsable);
 }
+
+void QuickenFileLogger::setFlushPolicy(FlushPolicy policy)
+{
+    d_func()->m_flushPolicy = policy;
+}
+
+QuickenFileLogger::FlushPolicy QuickenFileLogger::flushPolicy()
+{
+    return d_func()->m_flushPolicy;
+}
+
+void QuickenFileLogger::setFlushInterval(int interval)
+{
+    d_func()->m_flushInterval = qMax(0, interval);
+}
+
+int QuickenFileLogger::flushInterval()
+{
+    return d_func()->m_flushInterval;
+}
+
+// Size of the buffer in bytes (512 metrics).
+const int binaryBufferCapacity = 65536;
+const int binaryBufferAlignment = 64;
+
+// Maximum time in milliseconds metrics stay in the buffer when the logging
+// thread is idle.
+const int binaryFlushInterval = 1000;
+
+QuickenBinaryLogger::QuickenBinaryLogger(const QString& fileName)
+    : d_ptr(new QuickenBinaryLoggerPrivate(fileName))
+{
+}
+
+QuickenBinaryLoggerPrivate::QuickenBinaryLoggerPrivate(const QString& fileName)
+    : m_buffer(nullptr)
+    , m_bufferSize(0)
+    , m_flags(0)
+{
+    const QString filePath = QDir::isRelativePath(fileName)
+        ? QString(QDir::currentPath() + QDir::separator() + fileName) : fileName;
+    m_fd = open(QFile::encodeName(filePath).constData(),
+                O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_fd == -1) {
+        WARN("BinaryLogger: Can't open file '%s' (%s).", fileName.toLatin1().constData(),
+             strerror(errno));
+        return;
+    }
+
+    QuickenBinaryLogHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "QUICKENB", sizeof(header.magic));
+    header.version = QuickenBinaryLogHeader::currentVersion;
+    header.metricsSize = sizeof(QuickenMetrics);
+    header.byteOrder = 0x01020304;
+    m_flags = Open;
+    if (!write(&header, sizeof(header))) {
+        return;
+    }
+
+    m_buffer = static_cast<char*>(alignedAlloc(binaryBufferAlignment, binaryBufferCapacity));
+    m_flushTimer.start();
+}
+
+QuickenBinaryLogger::~QuickenBinaryLogger()
+{
+    delete d_ptr;
+}
+
+QuickenBinaryLoggerPrivate::~QuickenBinaryLoggerPrivate()
+{
+    if (m_flags & Open) {
+        if (m_bufferSize > 0) {
+            write(m_buffer, m_bufferSize);
+        }
+        if (m_flags & Open) {
+            close(m_fd);
+        }
+    }
+    free(m_buffer);
+}
+
+bool QuickenBinaryLogger::isOpen()
+{
+    return !!(d_func()->m_flags & QuickenBinaryLoggerPrivate::Open);
+}
+
+void QuickenBinaryLogger::log(const QuickenMetrics& metrics)
+{
+    d_func()->logBatch(&metrics, 1);
+}
+
+void QuickenBinaryLogger::logBatch(const QuickenMetrics* metrics, int count)
+{
+    d_func()->logBatch(metrics, count);
+}
+
+int QuickenBinaryLogger::idle()
+{
+    return d_func()->idle();
+}
+
+void QuickenBinaryLoggerPrivate::logBatch(const QuickenMetrics* metrics, int count)
+{
+    DASSERT(metrics);
+    DASSERT(count >= 0);
+
+    if (m_flags & Open) {
+        const int size = count * sizeof(QuickenMetrics);
+        if (m_bufferSize + size <= binaryBufferCapacity) {
+            memcpy(&m_buffer[m_bufferSize], metrics, size);
+            m_bufferSize += size;
+        } else {
+            // Write the buffered metrics and the new ones with a single system
+            // call, without copying.
+            write(m_buffer, m_bufferSize, metrics, size);
+            m_bufferSize = 0;
+            m_flushTimer.restart();
+        }
+    }
+}
+
+int QuickenBinaryLoggerPrivate::idle()
+{
+    if ((m_flags & Open) && m_bufferSize > 0) {
+        const qint64 remaining = binaryFlushInterval - m_flushTimer.elapsed();
+        if (remaining > 0) {
+            return static_cast<int>(remaining);
+        }
+        write(m_buffer, m_bufferSize);
+        m_bufferSize = 0;
+        m_flushTimer.restart();
+    }
+    return -1;
+}
+
+// Writes the given vector of buffers, looping over partial writes. Returns
+// false in case of error with errno set.
+static bool writeVector(int fd, struct iovec* iov, int iovCount)
+{
+    while (iovCount > 0) {
+        const ssize_t written = writev(fd, iov, iovCount);
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        size_t remaining = written;
+        while (iovCount > 0 && remaining >= iov->iov_len) {
+            remaining -= iov->iov_len;
+            iov++;
+            iovCount--;
+        }
+        if (iovCount > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + remaining;
+            iov->iov_len -= remaining;
+        }
+    }
+    return true;
+}
+
+// Writes the given data followed by the optional extra data. Closes the file
+// and returns false in case of error.
+bool QuickenBinaryLoggerPrivate::write(
+    const void* data, int size, const void* extraData, int extraSize)
+{
+    DASSERT(m_flags & Open);
+
+    struct iovec vector[2] = {
+        { const_cast<void*>(data), static_cast<size_t>(size) },
+        { const_cast<void*>(extraData), static_cast<size_t>(extraSize) }
+    };
+    if (!writeVector(m_fd, vector, extraSize > 0 ? 2 : 1)) {
+        WARN("BinaryLogger: Can't write to file (%s).", strerror(errno));
+        close(m_fd);
+        m_fd = -1;
+        m_flags &= ~Open;
+        return false;
+    }
+    return true;
+}
+
+QuickenFlightRecorderLogger::QuickenFlightRecorderLogger(const QString& fileName, int capacity)
+    : d_ptr(new QuickenFlightRecorderLoggerPrivate(fileName, capacity))
+{
+}
+
+QuickenFlightRecorderLoggerPrivate::QuickenFlightRecorderLoggerPrivate(
+    const QString& fileName, int capacity)
+    : m_header(nullptr)
+    , m_ring(nullptr)
+    , m_mappingSize(0)
+    , m_index(0)
+    , m_mask(0)
+{
+    DASSERT(capacity > 0);
+
+    quint32 powerOfTwoCapacity = 1;
+    while (powerOfTwoCapacity < static_cast<quint32>(capacity)) {
+        powerOfTwoCapacity <<= 1;
+    }
+    const size_t mappingSize =
+        sizeof(QuickenFlightRecorderHeader) + powerOfTwoCapacity * sizeof(QuickenMetrics);
+
+    const QString filePath = QDir::isRelativePath(fileName)
+        ? QString(QDir::currentPath() + QDir::separator() + fileName) : fileName;
+    const int fd = open(QFile::encodeName(filePath).constData(),
+                        O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        WARN("FlightRecorderLogger: Can't open file '%s' (%s).",
+             fileName.toLatin1().constData(), strerror(errno));
+        return;
+    }
+    if (ftruncate(fd, mappingSize) == -1) {
+        WARN("FlightRecorderLogger: Can't resize file '%s' (%s).",
+             fileName.toLatin1().constData(), strerror(errno));
+        close(fd);
+        return;
+    }
+    void* mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    // The mapping keeps a reference on the file.
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        WARN("FlightRecorderLogger: Can't map file '%s' (%s).",
+             fileName.toLatin1().constData(), strerror(errno));
+        return;
+    }
+
+    // The header is written last so that readers never see a valid header
+    // with uninitialized indices.
+    m_header = static_cast<QuickenFlightRecorderHeader*>(mapping);
+    m_ring = reinterpret_cast<QuickenMetrics*>(&m_header[1]);
+    m_mappingSize = mappingSize;
+    m_mask = powerOfTwoCapacity - 1;
+    m_header->reserveIndex.store(0);
+    m_header->writeIndex.store(0);
+    m_header->version = QuickenFlightRecorderHeader::currentVersion;
+    m_header->metricsSize = sizeof(QuickenMetrics);
+    m_header->byteOrder = 0x01020304;
+    m_header->capacity = powerOfTwoCapacity;
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(m_header->magic, "QUICKENR", sizeof(m_header->magic));
+}
+
+QuickenFlightRecorderLogger::~QuickenFlightRecorderLogger()
+{
+    delete d_ptr;
+}
+
+QuickenFlightRecorderLoggerPrivate::~QuickenFlightRecorderLoggerPrivate()
+{
+    if (m_header) {
+        munmap(m_header, m_mappingSize);
+    }
+}
+
+bool QuickenFlightRecorderLogger::isOpen()
+{
+    return d_func()->m_header != nullptr;
+}
+
+void QuickenFlightRecorderLogger::log(const QuickenMetrics& metrics)
+{
+    d_func()->logBatch(&metrics, 1);
+}
+
+void QuickenFlightRecorderLogger::logBatch(const QuickenMetrics* metrics, int count)
+{
+    d_func()->logBatch(metrics, count);
+}
+
+void QuickenFlightRecorderLoggerPrivate::logBatch(const QuickenMetrics* metrics, int count)
+{
+    DASSERT(metrics);
+    DASSERT(count >= 0);
+
+    if (!m_header || count == 0) {
+        return;
+    }
+
+    // Only the last capacity metrics of the batch would survive.
+    const quint32 capacity = m_mask + 1;
+    if (static_cast<quint32>(count) > capacity) {
+        metrics += count - capacity;
+        count = capacity;
+    }
+
+    // The fence prevents the metrics from being written before the reserve
+    // index is updated.
+    m_header->reserveIndex.storeRelease(m_index + count);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const quint32 slot = m_index & m_mask;
+    const quint32 contiguousCount = qMin(static_cast<quint32>(count), capacity - slot);
+    memcpy(&m_ring[slot], metrics, contiguousCount * sizeof(QuickenMetrics));
+    if (contiguousCount < static_cast<quint32>(count)) {
+        memcpy(m_ring, &metrics[contiguousCount],
+               (count - contiguousCount) * sizeof(QuickenMetrics));
+    }
+    m_index += count;
+    m_header->writeIndex.storeRelease(m_index);
+}
+
+// Size in bytes from which the current block is written.
+const int compressedBlockSize = 32768;
+Q_STATIC_ASSERT(compressedBlockSize + QuickenMetricsCodec::maxEncodedSize
+                <= QuickenCompressedBlockHeader::maxPayloadSize);
+
+const char quickenCompressedBlockMarker[8] = { '\xff', 'Q', 'K', 'B', 'L', 'O', 'C', 'K' };
+
+quint32 quickenCompressedBlockChecksum(const char* data, int size)
+{
+    quint32 hash = 2166136261u;
+    for (int i = 0; i < size; ++i) {
+        hash = (hash ^ static_cast<quint8>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+QuickenCompressedLogger::QuickenCompressedLogger(const QString& fileName, quint32 timeResolution)
+    : d_ptr(new QuickenCompressedLoggerPrivate(fileName, timeResolution))
+{
+}
+
+QuickenCompressedLoggerPrivate::QuickenCompressedLoggerPrivate(
+    const QString& fileName, quint32 timeResolution)
+    : m_codec(timeResolution)
+    , m_buffer(nullptr)
+    , m_bufferSize(0)
+    , m_count(0)
+{
+    const QString filePath = QDir::isRelativePath(fileName)
+        ? QString(QDir::currentPath() + QDir::separator() + fileName) : fileName;
+    m_fd = open(QFile::encodeName(filePath).constData(),
+                O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_fd == -1) {
+        WARN("CompressedLogger: Can't open file '%s' (%s).", fileName.toLatin1().constData(),
+             strerror(errno));
+        return;
+    }
+
+    QuickenCompressedLogHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "QUICKENC", sizeof(header.magic));
+    header.version = QuickenCompressedLogHeader::currentVersion;
+    header.metricsSize = sizeof(QuickenMetrics);
+    header.byteOrder = 0x01020304;
+    header.timeResolution = qMax(timeResolution, 1u);
+    struct iovec vector = { &header, sizeof(header) };
+    if (!writeVector(m_fd, &vector, 1)) {
+        WARN("CompressedLogger: Can't write to file (%s).", strerror(errno));
+        close(m_fd);
+        m_fd = -1;
+        return;
+    }
+
+    m_buffer = new char [compressedBlockSize + QuickenMetricsCodec::maxEncodedSize];
+}
+
+QuickenCompressedLogger::~QuickenCompressedLogger()
+{
+    delete d_ptr;
+}
+
+QuickenCompressedLoggerPrivate::~QuickenCompressedLoggerPrivate()
+{
+    if (m_fd != -1) {
+        if (m_count > 0) {
+            writeBlock();
+        }
+        if (m_fd != -1) {
+            close(m_fd);
+        }
+    }
+    delete [] m_buffer;
+}
+
+bool QuickenCompressedLogger::isOpen()
+{
+    return d_func()->m_fd != -1;
+}
+
+void QuickenCompressedLogger::log(const QuickenMetrics& metrics)
+{
+    d_func()->logBatch(&metrics, 1);
+}
+
+void QuickenCompressedLogger::logBatch(const QuickenMetrics* metrics, int count)
+{
+    d_func()->logBatch(metrics, count);
+}
+
+void QuickenCompressedLoggerPrivate::logBatch(const QuickenMetrics* metrics, int count)
+{
+    DASSERT(metrics);
+    DASSERT(count >= 0);
+
+    for (int i = 0; i < count && m_fd != -1; ++i) {
+        m_bufferSize += m_codec.encode(metrics[i], &m_buffer[m_bufferSize]);
+        m_count++;
+        if (m_bufferSize >= compressedBlockSize) {
+            writeBlock();
+        }
+    }
+}
+
+void QuickenCompressedLoggerPrivate::writeBlock()
+{
+    DASSERT(m_fd != -1);
+    DASSERT(m_count > 0);
+
+    QuickenCompressedBlockHeader header;
+    memcpy(header.marker, quickenCompressedBlockMarker, sizeof(header.marker));
+    header.payloadSize = m_bufferSize;
+    header.count = m_count;
+    header.checksum = quickenCompressedBlockChecksum(m_buffer, m_bufferSize);
+    struct iovec vector[2] = {
+        { &header, sizeof(header) },
+        { m_buffer, static_cast<size_t>(m_bufferSize) }
+    };
+    if (!writeVector(m_fd, vector, 2)) {
+        WARN("CompressedLogger: Can't write to file (%s).", strerror(errno));
+        close(m_fd);
+        m_fd = -1;
+    }
+
+    // Blocks are decoded independently.
+    m_codec.reset();
+    m_bufferSize = 0;
+    m_count = 0;
+}
+
+// Size of the trace buffer, an event (or a set of events for frame metrics)
+// takes at most maxTraceEventSize bytes.
+const int traceBufferCapacity = 65536;
+const int maxTraceEventSize = 2048;
+
+// First track id of the thread tracks, above window track ids and above Linux
+// thread ids (limited to 2^22).
+const quint32 threadTrackBase = 1 << 24;
+
+QuickenTraceLogger::QuickenTraceLogger(const QString& fileName)
+    : d_ptr(new QuickenTraceLoggerPrivate(fileName))
+{
+}
+
+QuickenTraceLoggerPrivate::QuickenTraceLoggerPrivate(const QString& fileName)
+    : m_buffer(nullptr)
+    , m_bufferSize(0)
+    , m_pid(getpid())
+{
+    const QString filePath = QDir::isRelativePath(fileName)
+        ? QString(QDir::currentPath() + QDir::separator() + fileName) : fileName;
+    m_fd = open(QFile::encodeName(filePath).constData(),
+                O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_fd == -1) {
+        WARN("TraceLogger: Can't open file '%s' (%s).", fileName.toLatin1().constData(),
+             strerror(errno));
+        return;
+    }
+
+    m_buffer = new char [traceBufferCapacity];
+    m_bufferSize = appendString("[\n", m_buffer);
+    m_bufferSize += formatTrackNames(0, &m_buffer[m_bufferSize]);
+}
+
+QuickenTraceLogger::~QuickenTraceLogger()
+{
+    delete d_ptr;
+}
+
+QuickenTraceLoggerPrivate::~QuickenTraceLoggerPrivate()
+{
+    if (m_fd != -1) {
+        // Replace the trailing comma of the last event.
+        DASSERT(m_bufferSize >= 2);
+        m_bufferSize -= 2;
+        m_bufferSize += appendString("\n]\n", &m_buffer[m_bufferSize]);
+        write();
+        if (m_fd != -1) {
+            close(m_fd);
+        }
+    }
+    delete [] m_buffer;
+}
+
+bool QuickenTraceLogger::isOpen()
+{
+    return d_func()->m_fd != -1;
+}
+
+void QuickenTraceLogger::log(const QuickenMetrics& metrics)
+{
+    d_func()->logBatch(&metrics, 1);
+}
+
+void QuickenTraceLogger::logBatch(const QuickenMetrics* metrics, int count)
+{
+    d_func()->logBatch(metrics, count);
+}
+
+void QuickenTraceLoggerPrivate::logBatch(const QuickenMetrics* metrics, int count)
+{
+    DASSERT(metrics);
+    DASSERT(count >= 0);
+
+    for (int i = 0; i < count && m_fd != -1; ++i) {
+        // Always keep room for the closing bracket written at destruction.
+        if (m_bufferSize > traceBufferCapacity - maxTraceEventSize) {
+            write();
+            if (m_fd == -1) {
+                break;
+            }
+        }
+        m_bufferSize += format(metrics[i], &m_buffer[m_bufferSize]);
+    }
+}
+
+void QuickenTraceLoggerPrivate::write()
+{
+    DASSERT(m_fd != -1);
+
+    // The trailing comma and new line of the last event are kept in the buffer
+    // so that they can be removed at destruction.
+    const int size = m_bufferSize - 2;
+    if (size > 0) {
+        struct iovec vector = { m_buffer, static_cast<size_t>(size) };
+        if (!writeVector(m_fd, &vector, 1)) {
+            WARN("TraceLogger: Can't write to file (%s).", strerror(errno));
+            close(m_fd);
+            m_fd = -1;
+            return;
+        }
+        memmove(m_buffer, &m_buffer[size], 2);
+        m_bufferSize = 2;
+    }
+}
+
+// Appends a time in nanoseconds as microseconds with 3 decimal digits, the unit
+// of the trace event format.
+static inline int appendTraceTime(quint64 time, char* buffer)
+{
+    int size = appendInteger(time / 1000, buffer);
+    buffer[size++] = '.';
+    size += appendPaddedInteger(time % 1000, 3, &buffer[size]);
+    return size;
+}
+
+// Appends a string as the content of a JSON string. Control characters are
+// escaped and the other bytes are considered Latin-1 encoded and converted to
+// UTF-8. buffer must have 6 times the string size available.
+static inline int appendJsonString(const char* string, int stringSize, char* buffer)
+{
+    const char hexDigits[] = "0123456789abcdef";
+    int size = 0;
+    for (int i = 0; i < stringSize; ++i) {
+        const quint8 c = string[i];
+        if (c == '"' || c == '\\') {
+            buffer[size++] = '\\';
+            buffer[size++] = c;
+        } else if (c < 0x20) {
+            size += appendString("\\u00", &buffer[size]);
+            buffer[size++] = hexDigits[c >> 4];
+            buffer[size++] = hexDigits[c & 0xf];
+        } else if (c >= 0x80) {
+            buffer[size++] = 0xc0 | (c >> 6);
+            buffer[size++] = 0x80 | (c & 0x3f);
+        } else {
+            buffer[size++] = c;
+        }
+    }
+    return size;
+}
+
+// Appends the beginning of an event up to the time stamp included. Events are
+// identified by the process id and a thread id, each window gets 2 tracks, the
+// CPU track uses tid (2 * window) and the GPU track uses tid (2 * window + 1).
+// Process wide events use tid 0.
+static inline int appendTraceEvent(
+    const char* name, const char* phase, int pid, quint32 tid, quint64 timeStamp, char* buffer)
+{
+    int size = appendString("{\"name\":\"", buffer);
+    size += appendString(name, &buffer[size]);
+    size += appendString("\",\"ph\":\"", &buffer[size]);
+    size += appendString(phase, &buffer[size]);
+    size += appendString("\",\"pid\":", &buffer[size]);
+    size += appendInteger(pid, &buffer[size]);
+    size += appendString(",\"tid\":", &buffer[size]);
+    size += appendInteger(tid, &buffer[size]);
+    size += appendString(",\"ts\":", &buffer[size]);
+    size += appendTraceTime(timeStamp, &buffer[size]);
+    return size;
+}
+
+// Appends a complete event (a slice) with the frame number as argument.
+static inline int appendTraceSlice(
+    const char* name, int pid, quint32 tid, quint64 start, quint64 duration, quint32 frame,
+    char* buffer)
+{
+    int size = appendTraceEvent(name, "X", pid, tid, start, buffer);
+    size += appendString(",\"dur\":", &buffer[size]);
+    size += appendTraceTime(duration, &buffer[size]);
+    size += appendString(",\"args\":{\"frame\":", &buffer[size]);
+    size += appendInteger(frame, &buffer[size]);
+    size += appendString("}},\n", &buffer[size]);
+    return size;
+}
+
+// Formats the metadata events naming the tracks of the given window (the
+// process track for window 0).
+int QuickenTraceLoggerPrivate::formatTrackNames(quint32 window, char* buffer)
+{
+    int size = 0;
+    if (window == 0) {
+        size += appendTraceEvent("thread_name", "M", m_pid, 0, 0, &buffer[size]);
+        size += appendString(",\"args\":{\"name\":\"Process\"}},\n", &buffer[size]);
+    } else {
+        size += appendTraceEvent("thread_name", "M", m_pid, 2 * window, 0, &buffer[size]);
+        size += appendString(",\"args\":{\"name\":\"Window ", &buffer[size]);
+        size += appendInteger(window, &buffer[size]);
+        size += appendString("\"}},\n", &buffer[size]);
+        size += appendTraceEvent("thread_name", "M", m_pid, 2 * window + 1, 0, &buffer[size]);
+        size += appendString(",\"args\":{\"name\":\"Window ", &buffer[size]);
+        size += appendInteger(window, &buffer[size]);
+        size += appendString(" GPU\"}},\n", &buffer[size]);
+        m_windows.append(window);
+    }
+    return size;
+}
+
+// Formats metrics as trace events to buffer which must have at least
+// maxTraceEventSize bytes available. Returns the number of bytes written.
+int QuickenTraceLoggerPrivate::format(const QuickenMetrics& metrics, char* buffer)
+{
+    int size = 0;
+
+    switch (metrics.type) {
+    case QuickenMetrics::Process: {
+        size += appendTraceEvent("CPU", "C", m_pid, 0, metrics.timeStamp, &buffer[size]);
+        size += appendString(",\"args\":{\"usage\":", &buffer[size]);
+        size += appendInteger(metrics.process.cpuUsage, &buffer[size]);
+        size += appendString("}},\n", &buffer[size]);
+        size += appendTraceEvent("Memory (kB)", "C", m_pid, 0, metrics.timeStamp, &buffer[size]);
+        size += appendString(",\"args\":{\"VSZ\":", &buffer[size]);
+        size += appendInteger(metrics.process.vszMemory, &buffer[size]);
+        size += appendString(",\"RSS\":", &buffer[size]);
+        size += appendInteger(metrics.process.rssMemory, &buffer[size]);
+        size += appendString("}},\n", &buffer[size]);
+        size += appendTraceEvent("Threads", "C", m_pid, 0, metrics.timeStamp, &buffer[size]);
+        size += appendString(",\"args\":{\"count\":", &buffer[size]);
+        size += appendInteger(metrics.process.threadCount, &buffer[size]);
+        size += appendString("}},\n", &buffer[size]);
+        size += appendTraceEvent("I/O (kB)", "C", m_pid, 0, metrics.timeStamp, &buffer[size]);
+        size += appendString(",\"args\":{\"read\":", &buffer[size]);
+        size += appendInteger(metrics.process.readBytes >> 10, &buffer[size]);
+        size += appendString(",\"written\":", &buffer[size]);
+        size += appendInteger(metrics.process.writtenBytes >> 10, &buffer[size]);
+        size += appendString("}},\n", &buffer[size]);
+        size += appendTraceEvent("Page faults", "C", m_pid, 0, metrics.timeStamp, &buffer[size]);
+        size += appendString(",\"args\":{\"minor\":", &buffer[size]);
+        size += appendInteger(metrics.process.minorPageFaults, &buffer[size]);
+        size += appendString(",\"major\":", &buffer[size]);
+        size += appendInteger(metrics.process.majorPageFaults, &buffer[size]);
+        size += appendString("}},\n", &buffer[size]);
+        size += appendTraceEvent("Context switches", "C", m_pid, 0, metrics.timeStamp,
+                                 &buffer[size]);
+        size += appendString(",\"args\":{\"voluntary\":", &buffer[size]);
+        size += appendInteger(metrics.process.voluntaryContextSwitches, &buffer[size]);
+        size += appendString(",\"involuntary\":", &buffer[size]);
+        size += appendInteger(metrics.process.involuntaryContextSwitches, &buffer[size]);
+        size += appendString("}},\n", &buffer[size]);
+        break;
+    }
+
+    case QuickenMetrics::Frame: {
+        const quint32 window = metrics.frame.window;
+        if (!m_windows.contains(window)) {
+            size += formatTrackNames(window, &buffer[size]);
+        }
+        // The time stamp is taken once the frame is swapped, the sync, render
+        // and swap phases are considered contiguous to reconstruct the timeline
+        // (they are on the threaded and basic render loops). The GPU timer
+        // starts with the render phase.
+        const quint64 swapStart =
+            metrics.timeStamp - qMin(metrics.timeStamp, metrics.frame.swapTime);
+        const quint64 renderStart = swapStart - qMin(swapStart, metrics.frame.renderTime);
+        const quint64 syncStart = renderStart - qMin(renderStart, metrics.frame.syncTime);
+        const quint32 number = metrics.frame.number;
+        // The frame slice also has the CPU time, the page faults and the
+        // context switches of the render thread, and the scene graph
+        // statistics.
+        size += appendTraceEvent("Frame", "X", m_pid, 2 * window, syncStart, &buffer[size]);
+        size += appendString(",\"dur\":", &buffer[size]);
+        size += appendTraceTime(metrics.timeStamp - syncStart, &buffer[size]);
+        size += appendString(",\"args\":{\"frame\":", &buffer[size]);
+        size += appendInteger(number, &buffer[size]);
+        size += appendString(",\"cpuTime (us)\":", &buffer[size]);
+        size += appendTraceTime(metrics.frame.cpuTime, &buffer[size]);
+        size += appendString(",\"minorFaults\":", &buffer[size]);
+        size += appendInteger(metrics.frame.minorPageFaults, &buffer[size]);
+        size += appendString(",\"majorFaults\":", &buffer[size]);
+        size += appendInteger(metrics.frame.majorPageFaults, &buffer[size]);
+        size += appendString(",\"voluntarySwitches\":", &buffer[size]);
+        size += appendInteger(metrics.frame.voluntaryContextSwitches, &buffer[size]);
+        size += appendString(",\"involuntarySwitches\":", &buffer[size]);
+        size += appendInteger(metrics.frame.involuntaryContextSwitches, &buffer[size]);
+        size += appendString(",\"nodes\":", &buffer[size]);
+        size += appendInteger(metrics.frame.nodeCount, &buffer[size]);
+        size += appendString(",\"opaqueBatches\":", &buffer[size]);
+        size += appendInteger(metrics.frame.opaqueBatchCount, &buffer[size]);
+        size += appendString(",\"alphaBatches\":", &buffer[size]);
+        size += appendInteger(metrics.frame.alphaBatchCount, &buffer[size]);
+        size += appendString(",\"drawCalls\":", &buffer[size]);
+        size += appendInteger(metrics.frame.drawCallCount, &buffer[size]);
+        size += appendString(",\"materialChanges\":", &buffer[size]);
+        size += appendInteger(metrics.frame.materialChangeCount, &buffer[size]);
+        size += appendString(",\"shaderChanges\":", &buffer[size]);
+        size += appendInteger(metrics.frame.shaderChangeCount, &buffer[size]);
+        size += appendString(",\"vertexUpload\":", &buffer[size]);
+        size += appendInteger(metrics.frame.vertexUploadSize, &buffer[size]);
+        size += appendString(",\"indexUpload\":", &buffer[size]);
+        size += appendInteger(metrics.frame.indexUploadSize, &buffer[size]);
+        if (metrics.frame.inputEventCount > 0) {
+            size += appendString(",\"inputLatency (us)\":", &buffer[size]);
+            size += appendTraceTime(metrics.frame.inputLatency, &buffer[size]);
+            size += appendString(",\"inputEvents\":", &buffer[size]);
+            size += appendInteger(metrics.frame.inputEventCount, &buffer[size]);
+        }
+        if (metrics.frame.droppedVsyncCount > 0) {
+            size += appendString(",\"droppedVsyncs\":", &buffer[size]);
+            size += appendInteger(metrics.frame.droppedVsyncCount, &buffer[size]);
+        }
+        size += appendString("}},\n", &buffer[size]);
+        size += appendTraceSlice("Sync", m_pid, 2 * window, syncStart, renderStart - syncStart,
+                                 number, &buffer[size]);
+        size += appendTraceSlice("Render", m_pid, 2 * window, renderStart,
+                                 swapStart - renderStart, number, &buffer[size]);
+        size += appendTraceSlice("Swap", m_pid, 2 * window, swapStart,
+                                 metrics.timeStamp - swapStart, number, &buffer[size]);
+        if (metrics.frame.gpuTime > 0) {
+            size += appendTraceSlice("GPU", m_pid, 2 * window + 1, renderStart,
+                                     metrics.frame.gpuTime, number, &buffer[size]);
+        }
+        break;
+    }
+
+    case QuickenMetrics::Window: {
+        const quint32 window = metrics.window.id;
+        if (!m_windows.contains(window)) {
+            size += formatTrackNames(window, &buffer[size]);
+        }
+        const char* const stateString[] = { "Hidden", "Shown", "Resized" };
+        Q_STATIC_ASSERT(ARRAY_SIZE(stateString) == QuickenWindowMetrics::StateCount);
+        size += appendTraceEvent(stateString[metrics.window.state], "i", m_pid, 2 * window,
+                                 metrics.timeStamp, &buffer[size]);
+        size += appendString(",\"s\":\"t\",\"args\":{\"width\":", &buffer[size]);
+        size += appendInteger(metrics.window.width, &buffer[size]);
+        size += appendString(",\"height\":", &buffer[size]);
+        size += appendInteger(metrics.window.height, &buffer[size]);
+        size += appendString("}},\n", &buffer[size]);
+        break;
+    }
+
+    case QuickenMetrics::Generic: {
+        // Strings might not be null-terminated.
+        const int stringSize = strnlen(
+            metrics.generic.string, qMin(metrics.generic.stringSize,
+                                         static_cast<quint32>(QuickenGenericMetrics::maxStringSize)));
+        size += appendString("{\"name\":\"", &buffer[size]);
+        size += appendJsonString(metrics.generic.string, stringSize, &buffer[size]);
+        size += appendString("\",\"cat\":\"generic\",\"ph\":\"i\",\"s\":\"p\",\"pid\":",
+                             &buffer[size]);
+        size += appendInteger(m_pid, &buffer[size]);
+        size += appendString(",\"tid\":0,\"ts\":", &buffer[size]);
+        size += appendTraceTime(metrics.timeStamp, &buffer[size]);
+        size += appendString(",\"args\":{\"id\":", &buffer[size]);
+        size += appendInteger(metrics.generic.id, &buffer[size]);
+        size += appendString("}},\n", &buffer[size]);
+        break;
+    }
+
+    case QuickenMetrics::Dropped: {
+        const quint32 window = metrics.dropped.window;
+        if (!m_windows.contains(window) && window != 0) {
+            size += formatTrackNames(window, &buffer[size]);
+        }
+        const char* const typeString[] = {
+            "Process", "Window", "Frame", "Generic", "Dropped", "Numeric", "Scope", "Thread",
+            "Memory", "PerfCounters", "Engine", "Pacing", "Timeline"
+        };
+        Q_STATIC_ASSERT(ARRAY_SIZE(typeString) == QuickenMetrics::TypeCount);
+        size += appendTraceEvent("Dropped", "i", m_pid, 2 * window, metrics.timeStamp,
+                                 &buffer[size]);
+        size += appendString(",\"s\":\"t\",\"args\":{", &buffer[size]);
+        for (int i = 0; i < QuickenMetrics::TypeCount; ++i) {
+            if (i > 0) {
+                buffer[size++] = ',';
+            }
+            buffer[size++] = '"';
+            size += appendString(typeString[i], &buffer[size]);
+            size += appendString("\":", &buffer[size]);
+            size += appendInteger(metrics.dropped.count[i], &buffer[size]);
+        }
+        size += appendString("}},\n", &buffer[size]);
+        break;
+    }
+
+    case QuickenMetrics::Numeric: {
+        // Values are counters named after the declared name and unit, the
+        // declarations themselves aren't emitted.
+        const QuickenNumericMetrics& numeric = metrics.numeric;
+        if (numeric.kind == QuickenNumericMetrics::Declaration) {
+            m_numericDeclarations.insert(numeric.id, numeric.declaration);
+            break;
+        } else if (numeric.kind >= QuickenNumericMetrics::KindCount) {
+            break;
+        }
+        size += appendString("{\"name\":\"", &buffer[size]);
+        QHash<quint32, QuickenNumericDeclaration>::const_iterator it =
+            m_numericDeclarations.constFind(numeric.id);
+        if (it != m_numericDeclarations.constEnd()) {
+            const QuickenNumericDeclaration& declaration = it.value();
+            size += appendJsonString(
+                declaration.name,
+                strnlen(declaration.name, QuickenNumericDeclaration::maxNameSize), &buffer[size]);
+            const int unitSize = strnlen(declaration.unit, QuickenNumericDeclaration::maxUnitSize);
+            if (unitSize > 0) {
+                size += appendString(" (", &buffer[size]);
+                size += appendJsonString(declaration.unit, unitSize, &buffer[size]);
+                buffer[size++] = ')';
+            }
+        } else {
+            size += appendString("Numeric ", &buffer[size]);
+            size += appendInteger(numeric.id, &buffer[size]);
+        }
+        size += appendString("\",\"cat\":\"numeric\",\"ph\":\"C\",\"pid\":", &buffer[size]);
+        size += appendInteger(m_pid, &buffer[size]);
+        size += appendString(",\"tid\":0,\"ts\":", &buffer[size]);
+        size += appendTraceTime(metrics.timeStamp, &buffer[size]);
+        size += appendString(",\"args\":{", &buffer[size]);
+        const int count = qMin(static_cast<int>(numeric.valueCount),
+                               static_cast<int>(QuickenNumericMetrics::maxValueCount));
+        for (int i = 0; i < count; ++i) {
+            if (i > 0) {
+                buffer[size++] = ',';
+            }
+            if (count == 1) {
+                size += appendString("\"value\":", &buffer[size]);
+            } else {
+                buffer[size++] = '"';
+                size += appendInteger(i, &buffer[size]);
+                size += appendString("\":", &buffer[size]);
+            }
+            if (numeric.kind == QuickenNumericMetrics::Integer) {
+                size += appendSignedInteger(numeric.integers[i], &buffer[size]);
+            } else if (isfinite(numeric.reals[i])) {
+                size += appendReal(numeric.reals[i], &buffer[size]);
+            } else {
+                // JSON has no representation for infinities and NaNs.
+                size += appendString("null", &buffer[size]);
+            }
+        }
+        size += appendString("}},\n", &buffer[size]);
+        break;
+    }
+
+    case QuickenMetrics::Scope: {
+        // Scopes are slices on per-thread tracks, the track ids are offset so
+        // that they can't collide with window tracks.
+        const quint32 thread = metrics.scope.thread;
+        if (!m_threads.contains(thread)) {
+            size += appendTraceEvent("thread_name", "M", m_pid, threadTrackBase + thread, 0,
+                                     &buffer[size]);
+            size += appendString(",\"args\":{\"name\":\"Thread ", &buffer[size]);
+            size += appendInteger(thread, &buffer[size]);
+            size += appendString("\"}},\n", &buffer[size]);
+            m_threads.append(thread);
+        }
+        const quint64 startTime = qMin(metrics.timeStamp, metrics.scope.startTime);
+        size += appendString("{\"name\":\"", &buffer[size]);
+        size += appendJsonString(
+            metrics.scope.name, strnlen(metrics.scope.name, QuickenScopeMetrics::maxNameSize),
+            &buffer[size]);
+        size += appendString("\",\"cat\":\"scope\",\"ph\":\"X\",\"pid\":", &buffer[size]);
+        size += appendInteger(m_pid, &buffer[size]);
+        size += appendString(",\"tid\":", &buffer[size]);
+        size += appendInteger(threadTrackBase + thread, &buffer[size]);
+        size += appendString(",\"ts\":", &buffer[size]);
+        size += appendTraceTime(startTime, &buffer[size]);
+        size += appendString(",\"dur\":", &buffer[size]);
+        size += appendTraceTime(metrics.timeStamp - startTime, &buffer[size]);
+        size += appendString(",\"args\":{\"depth\":", &buffer[size]);
+        size += appendInteger(metrics.scope.depth, &buffer[size]);
+        size += appendString("}},\n", &buffer[size]);
+        break;
+    }
+
+    case QuickenMetrics::Thread: {
+        // CPU usages are counters per thread. Thread names are also set on the
+        // scope tracks of the threads.
+        const quint32 thread = metrics.thread.thread;
+        const int nameSize = strnlen(metrics.thread.name, QuickenThreadMetrics::maxNameSize);
+        if (!m_threads.contains(thread)) {
+            size += appendTraceEvent("thread_name", "M", m_pid, threadTrackBase + thread, 0,
+                                     &buffer[size]);
+            size += appendString(",\"args\":{\"name\":\"", &buffer[size]);
+            size += appendJsonString(metrics.thread.name, nameSize, &buffer[size]);
+            size += appendString(" (", &buffer[size]);
+            size += appendInteger(thread, &buffer[size]);
+            size += appendString(")\"}},\n", &buffer[size]);
+            m_threads.append(thread);
+        }
+        size += appendString("{\"name\":\"CPU usage (%) ", &buffer[size]);
+        size += appendJsonString(metrics.thread.name, nameSize, &buffer[size]);
+        size += appendString(" (", &buffer[size]);
+        size += appendInteger(thread, &buffer[size]);
+        size += appendString(")\",\"cat\":\"thread\",\"ph\":\"C\",\"pid\":", &buffer[size]);
+        size += appendInteger(m_pid, &buffer[size]);
+        size += appendString(",\"tid\":0,\"ts\":", &buffer[size]);
+        size += appendTraceTime(metrics.timeStamp, &buffer[size]);
+        size += appendString(",\"args\":{\"value\":", &buffer[size]);
+        size += appendInteger(metrics.thread.cpuUsage, &buffer[size]);
+        size += appendString("}},\n", &buffer[size]);
+        break;
+    }
+
+    case QuickenMetrics::Memory: {
+        const QuickenMemoryMetrics& memory = metrics.memory;
+        size += appendTraceEvent("Memory breakdown (kB)", "C", m_pid, 0, metrics.timeStamp,
+                                 &buffer[size]);
+        size += appendString(",\"args\":{\"PSS\":", &buffer[size]);
+        size += appendInteger(memory.pssMemory, &buffer[size]);
+        size += appendString(",\"USS\":", &buffer[size]);
+        size += appendInteger(memory.privateCleanMemory + memory.privateDirtyMemory, &buffer[size]);
+        size += appendString(",\"anonymous\":", &buffer[size]);
+        size += appendInteger(memory.anonymousMemory, &buffer[size]);
+        size += appendString(",\"swap\":", &buffer[size]);
+        size += appendInteger(memory.swapMemory, &buffer[size]);
+        size += appendString("}},\n", &buffer[size]);
+        size += appendTraceEvent("Heap (kB)", "C", m_pid, 0, metrics.timeStamp, &buffer[size]);
+        size += appendString(",\"args\":{\"used\":", &buffer[size]);
+        size += appendInteger(memory.heapUsedMemory, &buffer[size]);
+        size += appendString(",\"free\":", &buffer[size]);
+        size += appendInteger(memory.heapFreeMemory, &buffer[size]);
+        size += appendString(",\"mapped\":", &buffer[size]);
+        size += appendInteger(memory.heapMappedMemory, &buffer[size]);
+        size += appendString("}},\n", &buffer[size]);
+        break;
+    }
+
+    case QuickenMetrics::PerfCounters: {
+        const QuickenPerfCounterMetrics& perfCounters = metrics.perfCounters;
+        const char* const counterString[][QuickenPerfCounterMetrics::counterCount] = {
+            { "Instructions", "CPU cycles", "Cache misses" },
+            { "Task clock (ns)", "Context switches", "Page faults" }
+        };
+        Q_STATIC_ASSERT(ARRAY_SIZE(counterString) == QuickenPerfCounterMetrics::SourceCount);
+        const int source = qMin<int>(perfCounters.source, QuickenPerfCounterMetrics::Software);
+        const char* const roleString =
+            perfCounters.role == QuickenThreadMetrics::Gui ? "GUI" : "Render";
+        // One counter track per counter, thread and window, the phases are
+        // stacked so that the track shows the frame total.
+        for (int i = 0; i < QuickenPerfCounterMetrics::counterCount; ++i) {
+            size += appendString("{\"name\":\"", &buffer[size]);
+            size += appendString(counterString[source][i], &buffer[size]);
+            size += appendString(" (", &buffer[size]);
+            size += appendString(roleString, &buffer[size]);
+            size += appendString(" ", &buffer[size]);
+            size += appendInteger(perfCounters.window, &buffer[size]);
+            size += appendString(")\",\"cat\":\"perf\",\"ph\":\"C\",\"pid\":", &buffer[size]);
+            size += appendInteger(m_pid, &buffer[size]);
+            size += appendString(",\"tid\":0,\"ts\":", &buffer[size]);
+            size += appendTraceTime(metrics.timeStamp, &buffer[size]);
+            size += appendString(",\"args\":{\"sync\":", &buffer[size]);
+            size += appendInteger(perfCounters.values[QuickenPerfCounterMetrics::Sync][i],
+                                  &buffer[size]);
+            size += appendString(",\"render\":", &buffer[size]);
+            size += appendInteger(perfCounters.values[QuickenPerfCounterMetrics::Render][i],
+                                  &buffer[size]);
+            size += appendString(",\"swap\":", &buffer[size]);
+            size += appendInteger(perfCounters.values[QuickenPerfCounterMetrics::Swap][i],
+                                  &buffer[size]);
+            size += appendString("}},\n", &buffer[size]);
+        }
+        break;
+    }
+
+    case QuickenMetrics::Engine: {
+        const QuickenEngineMetrics& engine = metrics.engine;
+        size += appendTraceEvent("JS heap (kB)", "C", m_pid, 0, metrics.timeStamp, &buffer[size]);
+        size += appendString(",\"args\":{\"used\":", &buffer[size]);
+        size += appendInteger(engine.heapUsed >> 10, &buffer[size]);
+        size += appendString(",\"allocated\":", &buffer[size]);
+        size += appendInteger(engine.heapAllocated >> 10, &buffer[size]);
+        size += appendString("}},\n", &buffer[size]);
+        // Per frame engine activity, on a counter track per window.
+        size += appendString("{\"name\":\"QML engine (", &buffer[size]);
+        size += appendInteger(engine.window, &buffer[size]);
+        size += appendString(")\",\"ph\":\"C\",\"pid\":", &buffer[size]);
+        size += appendInteger(m_pid, &buffer[size]);
+        size += appendString(",\"tid\":0,\"ts\":", &buffer[size]);
+        size += appendTraceTime(metrics.timeStamp, &buffer[size]);
+        size += appendString(",\"args\":{\"bindings\":", &buffer[size]);
+        size += appendInteger(engine.bindingCount, &buffer[size]);
+        size += appendString(",\"gcRuns\":", &buffer[size]);
+        size += appendInteger(engine.gcCount, &buffer[size]);
+        size += appendString(",\"gcTimeEstimate (us)\":", &buffer[size]);
+        size += appendTraceTime(engine.gcTimeEstimate, &buffer[size]);
+        size += appendString("}},\n", &buffer[size]);
+        break;
+    }
+
+    case QuickenMetrics::Pacing: {
+        const QuickenPacingMetrics& pacing = metrics.pacing;
+        size += appendString("{\"name\":\"Frame pacing (", &buffer[size]);
+        size += appendInteger(pacing.window, &buffer[size]);
+        size += appendString(")\",\"ph\":\"C\",\"pid\":", &buffer[size]);
+        size += appendInteger(m_pid, &buffer[size]);
+        size += appendString(",\"tid\":0,\"ts\":", &buffer[size]);
+        size += appendTraceTime(metrics.timeStamp, &buffer[size]);
+        size += appendString(",\"args\":{\"smoothness (%)\":", &buffer[size]);
+        size += appendHundredths(pacing.smoothness, &buffer[size]);
+        size += appendString(",\"droppedVsyncs\":", &buffer[size]);
+        size += appendInteger(pacing.droppedVsyncCount, &buffer[size]);
+        size += appendString(",\"pacingChanges\":", &buffer[size]);
+        size += appendInteger(pacing.pacingChangeCount, &buffer[size]);
+        size += appendString("}},\n", &buffer[size]);
+        break;
+    }
+
+    case QuickenMetrics::Timeline: {
+        // Phases are slices on the track of the thread, so that the GUI thread
+        // activity lines up with the frame slices of the window tracks.
+        const QuickenTimelineMetrics& timeline = metrics.timeline;
+        struct Phase { const char* name; int start; int end; };
+        const Phase guiPhases[] = {
+            { "Polish", QuickenTimelineMetrics::UpdateRequest, QuickenTimelineMetrics::PolishEnd },
+            { "Blocked", QuickenTimelineMetrics::PolishEnd, QuickenTimelineMetrics::Unblocked },
+            { "Animations", QuickenTimelineMetrics::Unblocked, QuickenTimelineMetrics::GuiFrameEnd }
+        };
+        const Phase renderPhases[] = {
+            { "Sync", QuickenTimelineMetrics::SyncStart, QuickenTimelineMetrics::SyncEnd },
+            { "Render", QuickenTimelineMetrics::RenderStart, QuickenTimelineMetrics::RenderEnd },
+            { "Swap", QuickenTimelineMetrics::SwapStart, QuickenTimelineMetrics::SwapEnd }
+        };
+        const bool gui = timeline.role == QuickenThreadMetrics::Gui;
+        const Phase* phases = gui ? guiPhases : renderPhases;
+        const int phaseCount = gui ? ARRAY_SIZE(guiPhases) : ARRAY_SIZE(renderPhases);
+        const quint32 thread = timeline.thread;
+        if (!m_threads.contains(thread)) {
+            size += appendTraceEvent("thread_name", "M", m_pid, threadTrackBase + thread, 0,
+                                     &buffer[size]);
+            size += appendString(",\"args\":{\"name\":\"", &buffer[size]);
+            size += appendString(gui ? "GUI" : "Render", &buffer[size]);
+            size += appendString(" (", &buffer[size]);
+            size += appendInteger(thread, &buffer[size]);
+            size += appendString(")\"}},\n", &buffer[size]);
+            m_threads.append(thread);
+        }
+        for (int i = 0; i < phaseCount; ++i) {
+            const quint64 start = timeline.timeStamps[phases[i].start];
+            const quint64 end = timeline.timeStamps[phases[i].end];
+            if (start > 0 && end >= start) {
+                size += appendTraceSlice(phases[i].name, m_pid, threadTrackBase + thread, start,
+                                         end - start, timeline.number, &buffer[size]);
+            }
+        }
+        break;
+    }
+
+    default:
+        DNOT_REACHED();
+        return 0;
+    }
+
+    DASSERT(size <= maxTraceEventSize);
+    return size;
+}
+
+// Percentiles of QuickenFrameStatistics.
+const double statisticsPercentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+
+QuickenStatisticsLogger::QuickenStatisticsLogger()
+    : d_ptr(new QuickenStatisticsLoggerPrivate)
+{
+}
+
+QuickenStatisticsLoggerPrivate::QuickenStatisticsLoggerPrivate()
+    : m_frameBudget(16666667)
+    , m_summaryInterval(10000)
+    , m_flags(Open)
+{
+}
+
+QuickenStatisticsLogger::QuickenStatisticsLogger(const QString& fileName)
+    : d_ptr(new QuickenStatisticsLoggerPrivate(fileName))
+{
+}
+
+QuickenStatisticsLoggerPrivate::QuickenStatisticsLoggerPrivate(const QString& fileName)
+    : m_frameBudget(16666667)
+    , m_summaryInterval(10000)
+{
+    if (QDir::isRelativePath(fileName)) {
+        m_file.setFileName(QString(QDir::currentPath() + QDir::separator() + fileName));
+    } else {
+        m_file.setFileName(fileName);
+    }
+
+    if (m_file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Unbuffered)) {
+        m_flags = Open | Output;
+    } else {
+        m_flags = 0;
+        WARN("StatisticsLogger: Can't open file %s '%s'.", fileName.toLatin1().constData(),
+             m_file.errorString().toLatin1().constData());
+    }
+}
+
+QuickenStatisticsLogger::QuickenStatisticsLogger(FILE* fileHandle)
+    : d_ptr(new QuickenStatisticsLoggerPrivate(fileHandle))
+{
+}
+
+QuickenStatisticsLoggerPrivate::QuickenStatisticsLoggerPrivate(FILE* fileHandle)
+    : m_frameBudget(16666667)
+    , m_summaryInterval(10000)
+{
+    if (m_file.open(fileHandle, QIODevice::WriteOnly | QIODevice::Text | QIODevice::Unbuffered)) {
+        m_flags = Open | Output;
+    } else {
+        m_flags = 0;
+        WARN("StatisticsLogger: Can't open file handle '%s'.",
+             m_file.errorString().toLatin1().constData());
+    }
+}
+
+QuickenStatisticsLogger::~QuickenStatisticsLogger()
+{
+    delete d_ptr;
+}
+
+QuickenStatisticsLoggerPrivate::~QuickenStatisticsLoggerPrivate()
+{
+    for (QHash<quint32, WindowStatistics*>::iterator it = m_windows.begin();
+         it != m_windows.end(); ++it) {
+        if (it.value()->interval[QuickenStatisticsLogger::SyncTime].histogram.count() > 0) {
+            writeSummaries(it.key(), it.value(), QuickenMetricsUtils::timeStamp());
+        }
+        delete it.value();
+    }
+}
+
+bool QuickenStatisticsLogger::isOpen()
+{
+    return !!(d_func()->m_flags & QuickenStatisticsLoggerPrivate::Open);
+}
+
+void QuickenStatisticsLogger::log(const QuickenMetrics& metrics)
+{
+    d_func()->logBatch(&metrics, 1);
+}
+
+void QuickenStatisticsLogger::logBatch(const QuickenMetrics* metrics, int count)
+{
+    d_func()->logBatch(metrics, count);
+}
+
+void QuickenStatisticsLoggerPrivate::logBatch(const QuickenMetrics* metrics, int count)
+{
+    DASSERT(metrics);
+    DASSERT(count >= 0);
+
+    if (m_flags & Open) {
+        QMutexLocker locker(&m_mutex);
+        for (int i = 0; i < count; ++i) {
+            if (metrics[i].type == QuickenMetrics::Frame) {
+                record(metrics[i].frame, metrics[i].timeStamp);
+            }
+        }
+    }
+}
+
+void QuickenStatisticsLoggerPrivate::record(const QuickenFrameMetrics& metrics, quint64 timeStamp)
+{
+    WindowStatistics* statistics = m_windows.value(metrics.window, nullptr);
+    if (!statistics) {
+        statistics = new WindowStatistics;
+        statistics->intervalStart = timeStamp;
+        for (int i = 0; i < QuickenStatisticsLogger::FieldCount; ++i) {
+            statistics->interval[i].overBudgetCount = 0;
+            statistics->total[i].overBudgetCount = 0;
+        }
+        m_windows.insert(metrics.window, statistics);
+    } else if (m_summaryInterval > 0 && timeStamp - statistics->intervalStart
+               >= static_cast<quint64>(m_summaryInterval) * 1000000) {
+        writeSummaries(metrics.window, statistics, timeStamp);
+    }
+
+    const quint64 values[QuickenStatisticsLogger::FieldCount] = {
+        metrics.deltaTime, metrics.syncTime, metrics.renderTime, metrics.gpuTime,
+        metrics.swapTime, metrics.syncTime + metrics.renderTime + metrics.swapTime,
+        metrics.cpuTime, metrics.inputLatency
+    };
+    for (int i = 0; i < QuickenStatisticsLogger::FieldCount; ++i) {
+        // Delta time of the first frame, unavailable GPU times, CPU times of
+        // logs written by older versions and input latencies of frames
+        // reflecting no input are 0.
+        if (values[i] == 0 && (i == QuickenStatisticsLogger::DeltaTime
+                               || i == QuickenStatisticsLogger::GpuTime
+                               || i == QuickenStatisticsLogger::CpuTime
+                               || i == QuickenStatisticsLogger::InputLatency)) {
+            continue;
+        }
+        const quint64 overBudget = values[i] > m_frameBudget ? 1 : 0;
+        statistics->interval[i].histogram.record(values[i]);
+        statistics->interval[i].overBudgetCount += overBudget;
+        statistics->total[i].histogram.record(values[i]);
+        statistics->total[i].overBudgetCount += overBudget;
+    }
+}
+
+static void getStatistics(
+    const QuickenStatisticsLoggerPrivate::FieldStatistics& fieldStatistics,
+    QuickenFrameStatistics* statistics)
+{
+    const QuickenHistogram& histogram = fieldStatistics.histogram;
+    quint64 percentiles[ARRAY_SIZE(statisticsPercentiles)];
+    histogram.percentiles(statisticsPercentiles, percentiles, ARRAY_SIZE(statisticsPercentiles));
+    statistics->count = histogram.count();
+    statistics->overBudgetCount = fieldStatistics.overBudgetCount;
+    statistics->min = histogram.min();
+    statistics->mean = histogram.mean();
+    statistics->p50 = percentiles[0];
+    statistics->p90 = percentiles[1];
+    statistics->p99 = percentiles[2];
+    statistics->p999 = percentiles[3];
+    statistics->max = histogram.max();
+}
+
+// Writes the summaries of the current interval and starts a new one.
+void QuickenStatisticsLoggerPrivate::writeSummaries(
+    quint32 window, WindowStatistics* statistics, quint64 timeStamp)
+{
+    const char* const fieldString[] = {
+        "delta", "sync", "render", "gpu", "swap", "total", "cpu", "input"
+    };
+    Q_STATIC_ASSERT(ARRAY_SIZE(fieldString) == QuickenStatisticsLogger::FieldCount);
+
+    if (m_flags & Output) {
+        char buffer[QuickenStatisticsLogger::FieldCount * 256];
+        int size = 0;
+        for (int i = 0; i < QuickenStatisticsLogger::FieldCount; ++i) {
+            QuickenFrameStatistics fieldStatistics;
+            getStatistics(statistics->interval[i], &fieldStatistics);
+            const quint64 values[] = {
+                fieldStatistics.count, fieldStatistics.overBudgetCount, fieldStatistics.min,
+                fieldStatistics.mean, fieldStatistics.p50, fieldStatistics.p90,
+                fieldStatistics.p99, fieldStatistics.p999, fieldStatistics.max
+            };
+            size += appendString("S ", &buffer[size]);
+            size += appendInteger(timeStamp, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendInteger(window, &buffer[size]);
+            buffer[size++] = ' ';
+            size += appendString(fieldString[i], &buffer[size]);
+            for (int j = 0; j < static_cast<int>(ARRAY_SIZE(values)); ++j) {
+                buffer[size++] = ' ';
+                size += appendInteger(values[j], &buffer[size]);
+            }
+            buffer[size++] = '\n';
+        }
+        DASSERT(size <= static_cast<int>(sizeof(buffer)));
+        if (m_file.write(buffer, size) != size) {
+            DWARN("StatisticsLogger: Can't write to file '%s'.",
+                  m_file.errorString().toLatin1().constData());
+        }
+        m_file.flush();
+    }
+
+    for (int i = 0; i < QuickenStatisticsLogger::FieldCount; ++i) {
+        statistics->interval[i].histogram.reset();
+        statistics->interval[i].overBudgetCount = 0;
+    }
+    statistics->intervalStart = timeStamp;
+}
+
+void QuickenStatisticsLogger::setSummaryInterval(int interval)
+{
+    Q_D(QuickenStatisticsLogger);
+    QMutexLocker locker(&d->m_mutex);
+    d->m_summaryInterval = qMax(0, interval);
+}
+
+int QuickenStatisticsLogger::summaryInterval()
+{
+    return d_func()->m_summaryInterval;
+}
+
+void QuickenStatisticsLogger::setFrameBudget(quint64 budget)
+{
+    Q_D(QuickenStatisticsLogger);
+    QMutexLocker locker(&d->m_mutex);
+    d->m_frameBudget = budget;
+}
+
+quint64 QuickenStatisticsLogger::frameBudget()
+{
+    return d_func()->m_frameBudget;
+}
+
+bool QuickenStatisticsLogger::statistics(
+    quint32 window, Field field, QuickenFrameStatistics* statistics)
+{
+    Q_D(QuickenStatisticsLogger);
+    DASSERT(field >= 0 && field < FieldCount);
+    DASSERT(statistics);
+
+    QMutexLocker locker(&d->m_mutex);
+    QuickenStatisticsLoggerPrivate::WindowStatistics* windowStatistics =
+        d->m_windows.value(window, nullptr);
+    if (windowStatistics) {
+        getStatistics(windowStatistics->total[field], statistics);
+        return true;
+    } else {
+        return false;
+    }
+}
+
+void QuickenStatisticsLogger::reset()
+{
+    Q_D(QuickenStatisticsLogger);
+
+    QMutexLocker locker(&d->m_mutex);
+    for (QHash<quint32, QuickenStatisticsLoggerPrivate::WindowStatistics*>::iterator it =
+             d->m_windows.begin(); it != d->m_windows.end(); ++it) {
+        delete it.value();
+    }
+    d->m_windows.clear();
+}
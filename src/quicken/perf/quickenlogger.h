@@ -12,6 +12,11 @@
 #include <Quicken/quickenglobal.h>
 
 class QuickenFileLoggerPrivate;
+class QuickenBinaryLoggerPrivate;
+class QuickenFlightRecorderLoggerPrivate;
+class QuickenCompressedLoggerPrivate;
+class QuickenTraceLoggerPrivate;
+class QuickenStatisticsLoggerPrivate;
 struct QuickenMetrics;
 
 // Log metrics to a specific device.
@@ -23,27 +28,230 @@ public:
     // Log metrics.
     virtual void log(const QuickenMetrics& metrics) = 0;
 
+    // Log count contiguous metrics. Called by the logging thread with all the
+    // metrics available at once, loggers can reimplement it to amortize costs
+    // (like system calls) over several metrics. The default implementation
+    // calls log() for each metrics.
+    virtual void logBatch(const QuickenMetrics* metrics, int count);
+
+    // Called by the logging thread once the metrics available are logged,
+    // before it waits for new ones. Loggers buffering metrics can write them
+    // there. Returns the maximum time in milliseconds the logging thread can
+    // wait before calling it again, -1 (default implementation) to only wait
+    // for new metrics.
+    virtual int idle();
+
     // Get whether the target device has been opened successfully or not.
     virtual bool isOpen() = 0;
 };
 
-// Log metrics to a file.
+// Log metrics to a file as text lines. Metrics are formatted to a buffer
+// written to the file depending on the flush policy. Parsable frame and process
+// lines keep the fields of the first versions so that existing parsers keep
+// working, the values added since are written on an extension line starting
+// with 'f' or 'p' right after them.
 class QUICKEN_EXPORT QuickenFileLogger : public QuickenLogger
 {
 public:
+    enum FlushPolicy {
+        // Write the metrics to the file as soon as they're logged, default.
+        FlushEveryRecord = 0,
+        // Write the metrics at most every flushInterval() milliseconds, metrics
+        // are kept buffered for flushInterval() milliseconds at most.
+        FlushInterval = 1,
+        // Write the metrics when the buffer (64 kB) is full and at destruction.
+        FlushOnShutdown = 2
+    };
+
     QuickenFileLogger(const QString& filename, bool parsable = true);
     QuickenFileLogger(FILE* fileHandle, bool parsable = false);
     ~QuickenFileLogger();
 
     void log(const QuickenMetrics& metrics) Q_DECL_OVERRIDE;
+    void logBatch(const QuickenMetrics* metrics, int count) Q_DECL_OVERRIDE;
+    int idle() Q_DECL_OVERRIDE;
     bool isOpen() Q_DECL_OVERRIDE;
 
     void setParsable(bool parsable);
     bool parsable();
 
+    // Set the flush policy and the flush interval in milliseconds used by the
+    // FlushInterval policy (default value is 1000).
+    void setFlushPolicy(FlushPolicy policy);
+    FlushPolicy flushPolicy();
+    void setFlushInterval(int interval);
+    int flushInterval();
+
 private:
     QuickenFileLoggerPrivate* const d_ptr;
     Q_DECLARE_PRIVATE(QuickenFileLogger)
 };
 
+// Log metrics to a file in a binary format. The file starts with a 128 bytes
+// header (see QuickenLogReader) followed by the raw 128 bytes QuickenMetrics
+// structs in the native byte order. Metrics are buffered and written in large
+// chunks, the buffer is written when full, when the logging thread is idle at
+// most every second and at destruction. Metrics logged during the last second
+// before a crash can be lost.
+class QUICKEN_EXPORT QuickenBinaryLogger : public QuickenLogger
+{
+public:
+    QuickenBinaryLogger(const QString& fileName);
+    ~QuickenBinaryLogger();
+
+    void log(const QuickenMetrics& metrics) Q_DECL_OVERRIDE;
+    void logBatch(const QuickenMetrics* metrics, int count) Q_DECL_OVERRIDE;
+    int idle() Q_DECL_OVERRIDE;
+    bool isOpen() Q_DECL_OVERRIDE;
+
+private:
+    QuickenBinaryLoggerPrivate* const d_ptr;
+    Q_DECLARE_PRIVATE(QuickenBinaryLogger)
+};
+
+// Log metrics to a ring buffer of capacity metrics stored in a memory-mapped
+// file. Logging is a plain memory copy, the metrics are written to the file by
+// the kernel even if the process crashes or gets killed, which allows to
+// recover the last metrics logged (with QuickenLogReader) for post-mortem
+// analysis. capacity is rounded up to the next power-of-two, the default value
+// keeps around 4 minutes of frame metrics for a single window at 60 Hz.
+class QUICKEN_EXPORT QuickenFlightRecorderLogger : public QuickenLogger
+{
+public:
+    QuickenFlightRecorderLogger(const QString& fileName, int capacity = 16384);
+    ~QuickenFlightRecorderLogger();
+
+    void log(const QuickenMetrics& metrics) Q_DECL_OVERRIDE;
+    void logBatch(const QuickenMetrics* metrics, int count) Q_DECL_OVERRIDE;
+    bool isOpen() Q_DECL_OVERRIDE;
+
+private:
+    QuickenFlightRecorderLoggerPrivate* const d_ptr;
+    Q_DECLARE_PRIVATE(QuickenFlightRecorderLogger)
+};
+
+// Log metrics to a file in a compressed binary format, readable with
+// QuickenLogReader. Metrics are delta encoded per type (and per window for
+// frame metrics) and varint packed in self-synchronizing blocks, the blocks are
+// written once full (32 kB) and at destruction. timeResolution, in
+// nanoseconds, allows to quantize time stamps and frame timings to improve the
+// compression ratio, the default value of 1 is lossless.
+class QUICKEN_EXPORT QuickenCompressedLogger : public QuickenLogger
+{
+public:
+    QuickenCompressedLogger(const QString& fileName, quint32 timeResolution = 1);
+    ~QuickenCompressedLogger();
+
+    void log(const QuickenMetrics& metrics) Q_DECL_OVERRIDE;
+    void logBatch(const QuickenMetrics* metrics, int count) Q_DECL_OVERRIDE;
+    bool isOpen() Q_DECL_OVERRIDE;
+
+private:
+    QuickenCompressedLoggerPrivate* const d_ptr;
+    Q_DECLARE_PRIVATE(QuickenCompressedLogger)
+};
+
+// Log metrics to a file in the Chrome trace event format (JSON array format),
+// which can be loaded in chrome://tracing or in the Perfetto UI. Frames are
+// shown as slices on per-window tracks (sync, render and swap nested in a frame
+// slice, GPU on a dedicated track), process metrics as counter tracks and
+// window, generic and dropped metrics as instant events. Events are buffered
+// and written once the buffer is full (64 kB) and at destruction. The closing
+// bracket being optional in that format, a trace cut by a crash is still valid.
+class QUICKEN_EXPORT QuickenTraceLogger : public QuickenLogger
+{
+public:
+    QuickenTraceLogger(const QString& fileName);
+    ~QuickenTraceLogger();
+
+    void log(const QuickenMetrics& metrics) Q_DECL_OVERRIDE;
+    void logBatch(const QuickenMetrics* metrics, int count) Q_DECL_OVERRIDE;
+    bool isOpen() Q_DECL_OVERRIDE;
+
+private:
+    QuickenTraceLoggerPrivate* const d_ptr;
+    Q_DECLARE_PRIVATE(QuickenTraceLogger)
+};
+
+// Statistics of a frame timing over a set of frames. Times are in nanoseconds,
+// percentiles are within 0.8% of the exact values.
+struct QuickenFrameStatistics
+{
+    quint64 count;
+    quint64 overBudgetCount;
+    quint64 min;
+    quint64 mean;
+    quint64 p50;
+    quint64 p90;
+    quint64 p99;
+    quint64 p999;
+    quint64 max;
+};
+
+// Keep per-window distributions of the frame timings in high dynamic range
+// histograms instead of logging every frame. Summaries (min, mean, percentiles,
+// max and count of frames over budget) of the frames of each window are
+// written to the optional file every summaryInterval() milliseconds as
+// parsable lines:
+//
+//   S <timeStamp> <window> <field> <count> <overBudgetCount> <min> <mean> <p50>
+//     <p90> <p99> <p99.9> <max>
+//
+// with field being either 'delta', 'sync', 'render', 'gpu', 'swap', 'total'
+// (sync, render and swap times), 'cpu' (render thread CPU time) or 'input'
+// (input latency) and times in nanoseconds. The statistics since the logger
+// creation (or the last reset) can be queried at any time from any thread.
+// Delta, GPU and CPU times of 0 (first frame, GPU timer not available and
+// frames logged by older versions) and input latencies of frames reflecting
+// no input events are not recorded.
+class QUICKEN_EXPORT QuickenStatisticsLogger : public QuickenLogger
+{
+public:
+    enum Field {
+        DeltaTime    = 0,
+        SyncTime     = 1,
+        RenderTime   = 2,
+        GpuTime      = 3,
+        SwapTime     = 4,
+        TotalTime    = 5,
+        CpuTime      = 6,
+        // Frames reflecting input events only.
+        InputLatency = 7,
+        FieldCount   = 8
+    };
+
+    // Create a logger with no output, for queries only.
+    QuickenStatisticsLogger();
+    QuickenStatisticsLogger(const QString& fileName);
+    QuickenStatisticsLogger(FILE* fileHandle);
+    ~QuickenStatisticsLogger();
+
+    void log(const QuickenMetrics& metrics) Q_DECL_OVERRIDE;
+    void logBatch(const QuickenMetrics* metrics, int count) Q_DECL_OVERRIDE;
+    bool isOpen() Q_DECL_OVERRIDE;
+
+    // Set the interval in milliseconds at which summaries are written, based
+    // on the frame time stamps. 0 writes summaries only at destruction. Default
+    // value is 10000.
+    void setSummaryInterval(int interval);
+    int summaryInterval();
+
+    // Set the frame budget in nanoseconds used to count frames over budget.
+    // Default value is 16666667 (60 Hz).
+    void setFrameBudget(quint64 budget);
+    quint64 frameBudget();
+
+    // Get the statistics of a field for the given window since the logger
+    // creation or the last reset. Returns false if no frames have been logged
+    // for that window.
+    bool statistics(quint32 window, Field field, QuickenFrameStatistics* statistics);
+
+    // Remove all the recorded frames.
+    void reset();
+
+private:
+    QuickenStatisticsLoggerPrivate* const d_ptr;
+    Q_DECLARE_PRIVATE(QuickenStatisticsLogger)
+};
+
 #endif  // LOGGER_H
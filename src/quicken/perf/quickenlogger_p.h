@@ -9,10 +9,16 @@
 
 #include <Quicken/quickenlogger.h>
 
+#include <QtCore/QAtomicInteger>
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QFile>
-#include <QtCore/QTextStream>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
 
 #include <Quicken/quickenmetrics.h>
+#include <Quicken/private/quickenhistogram_p.h>
+#include <Quicken/private/quickenmetricscodec_p.h>
 #include <Quicken/private/quickenglobal_p.h>
 
 class QUICKEN_PRIVATE_EXPORT QuickenFileLoggerPrivate
@@ -26,11 +32,235 @@ public:
 
     QuickenFileLoggerPrivate(const QString& fileName, bool parsable);
     QuickenFileLoggerPrivate(FILE* fileHandle, bool parsable);
+    ~QuickenFileLoggerPrivate();
 
-    void log(const QuickenMetrics& metrics);
+    void logBatch(const QuickenMetrics* metrics, int count);
+    int idle();
+    int format(const QuickenMetrics& metrics, char* buffer);
+    void flush();
 
     QFile m_file;
-    QTextStream m_textStream;
+    char* m_buffer;
+    int m_bufferSize;
+    int m_flushInterval;
+    QElapsedTimer m_flushTimer;
+    QuickenFileLogger::FlushPolicy m_flushPolicy;
+    // Numeric metrics declarations seen so far, indexed by id.
+    QHash<quint32, QuickenNumericDeclaration> m_numericDeclarations;
+    quint8 m_flags;
+};
+
+// Header of the files written by QuickenBinaryLogger.
+struct QuickenBinaryLogHeader
+{
+    static const quint32 currentVersion = 1;
+
+    // "QUICKENB", not null-terminated.
+    char magic[8];
+
+    // Version of the format.
+    quint32 version;
+
+    // Size of the metrics structs following the header.
+    quint32 metricsSize;
+
+    // 0x01020304 in the byte order of the metrics.
+    quint32 byteOrder;
+
+    quint8 __reserved[/*20 bytes taken,*/ 108 /*bytes free*/];
+};
+Q_STATIC_ASSERT(sizeof(QuickenBinaryLogHeader) == 128);
+
+class QUICKEN_PRIVATE_EXPORT QuickenBinaryLoggerPrivate
+{
+public:
+    enum {
+        Open = (1 << 0)
+    };
+
+    QuickenBinaryLoggerPrivate(const QString& fileName);
+    ~QuickenBinaryLoggerPrivate();
+
+    void logBatch(const QuickenMetrics* metrics, int count);
+    int idle();
+    bool write(const void* data, int size, const void* extraData = nullptr, int extraSize = 0);
+
+    char* m_buffer;
+    int m_bufferSize;
+    QElapsedTimer m_flushTimer;
+    int m_fd;
+    quint8 m_flags;
+};
+
+// Header of the files written by QuickenFlightRecorderLogger, followed by the
+// ring buffer of capacity metrics. The metrics at index i is stored in slot
+// (i % capacity). Before writing metrics, the logger sets reserveIndex to the
+// index following the last metrics it's about to write and then, once written,
+// sets writeIndex to the same value. The valid metrics are the ones in the
+// range [max(0, reserveIndex - capacity), writeIndex).
+struct QuickenFlightRecorderHeader
+{
+    static const quint32 currentVersion = 1;
+
+    // "QUICKENR", not null-terminated.
+    char magic[8];
+
+    // Version of the format.
+    quint32 version;
+
+    // Size of the metrics structs in the ring buffer.
+    quint32 metricsSize;
+
+    // 0x01020304 in the byte order of the metrics.
+    quint32 byteOrder;
+
+    // Number of metrics in the ring buffer, a power-of-two.
+    quint32 capacity;
+
+    // Indices updated with release semantics. Basic atomics are used to keep
+    // the header a POD.
+    QBasicAtomicInteger<quint64> reserveIndex;
+    QBasicAtomicInteger<quint64> writeIndex;
+
+    quint8 __reserved[/*40 bytes taken,*/ 88 /*bytes free*/];
+};
+Q_STATIC_ASSERT(sizeof(QuickenFlightRecorderHeader) == 128);
+
+class QUICKEN_PRIVATE_EXPORT QuickenFlightRecorderLoggerPrivate
+{
+public:
+    QuickenFlightRecorderLoggerPrivate(const QString& fileName, int capacity);
+    ~QuickenFlightRecorderLoggerPrivate();
+
+    void logBatch(const QuickenMetrics* metrics, int count);
+
+    QuickenFlightRecorderHeader* m_header;
+    QuickenMetrics* m_ring;
+    size_t m_mappingSize;
+    quint64 m_index;
+    quint32 m_mask;
+};
+
+// Header of the files written by QuickenCompressedLogger, followed by blocks
+// of encoded metrics (see QuickenMetricsCodec).
+struct QuickenCompressedLogHeader
+{
+    static const quint32 currentVersion = 1;
+
+    // "QUICKENC", not null-terminated.
+    char magic[8];
+
+    // Version of the format.
+    quint32 version;
+
+    // Size of the decoded metrics structs.
+    quint32 metricsSize;
+
+    // 0x01020304 in the byte order of the block headers.
+    quint32 byteOrder;
+
+    // Resolution of the time stamps and frame timings in nanoseconds.
+    quint32 timeResolution;
+
+    quint8 __reserved[/*24 bytes taken,*/ 104 /*bytes free*/];
+};
+Q_STATIC_ASSERT(sizeof(QuickenCompressedLogHeader) == 128);
+
+// Header of a block of encoded metrics. The marker allows readers to
+// resynchronize on the next block in case of corruption or truncation.
+struct QuickenCompressedBlockHeader
+{
+    static const int maxPayloadSize = 65536;
+
+    // 0xff followed by "QKBLOCK", not null-terminated.
+    char marker[8];
+
+    // Size in bytes of the encoded metrics following the header.
+    quint32 payloadSize;
+
+    // Number of encoded metrics.
+    quint32 count;
+
+    // FNV-1a hash of the encoded metrics.
+    quint32 checksum;
+};
+Q_STATIC_ASSERT(sizeof(QuickenCompressedBlockHeader) == 20);
+
+extern QUICKEN_PRIVATE_EXPORT const char quickenCompressedBlockMarker[8];
+QUICKEN_PRIVATE_EXPORT quint32 quickenCompressedBlockChecksum(const char* data, int size);
+
+class QUICKEN_PRIVATE_EXPORT QuickenCompressedLoggerPrivate
+{
+public:
+    QuickenCompressedLoggerPrivate(const QString& fileName, quint32 timeResolution);
+    ~QuickenCompressedLoggerPrivate();
+
+    void logBatch(const QuickenMetrics* metrics, int count);
+    void writeBlock();
+
+    QuickenMetricsCodec m_codec;
+    char* m_buffer;
+    int m_bufferSize;
+    int m_count;
+    int m_fd;
+};
+
+class QUICKEN_PRIVATE_EXPORT QuickenTraceLoggerPrivate
+{
+public:
+    QuickenTraceLoggerPrivate(const QString& fileName);
+    ~QuickenTraceLoggerPrivate();
+
+    void logBatch(const QuickenMetrics* metrics, int count);
+    int format(const QuickenMetrics& metrics, char* buffer);
+    int formatTrackNames(quint32 window, char* buffer);
+    void write();
+
+    char* m_buffer;
+    int m_bufferSize;
+    int m_fd;
+    int m_pid;
+    // Windows and threads for which track names have been emitted.
+    QVector<quint32> m_windows;
+    QVector<quint32> m_threads;
+    // Numeric metrics declarations seen so far, indexed by id.
+    QHash<quint32, QuickenNumericDeclaration> m_numericDeclarations;
+};
+
+class QUICKEN_PRIVATE_EXPORT QuickenStatisticsLoggerPrivate
+{
+public:
+    enum {
+        Open   = (1 << 0),
+        Output = (1 << 1)
+    };
+
+    struct FieldStatistics {
+        QuickenHistogram histogram;
+        quint64 overBudgetCount;
+    };
+
+    struct WindowStatistics {
+        quint64 intervalStart;
+        // Statistics of the current summary interval and since the creation.
+        FieldStatistics interval[QuickenStatisticsLogger::FieldCount];
+        FieldStatistics total[QuickenStatisticsLogger::FieldCount];
+    };
+
+    QuickenStatisticsLoggerPrivate();
+    QuickenStatisticsLoggerPrivate(const QString& fileName);
+    QuickenStatisticsLoggerPrivate(FILE* fileHandle);
+    ~QuickenStatisticsLoggerPrivate();
+
+    void logBatch(const QuickenMetrics* metrics, int count);
+    void record(const QuickenFrameMetrics& metrics, quint64 timeStamp);
+    void writeSummaries(quint32 window, WindowStatistics* statistics, quint64 timeStamp);
+
+    QFile m_file;
+    QMutex m_mutex;
+    QHash<quint32, WindowStatistics*> m_windows;
+    quint64 m_frameBudget;
+    int m_summaryInterval;
     quint8 m_flags;
 };
 
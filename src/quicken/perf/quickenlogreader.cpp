@@ -0,0 +1,253 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#include "quickenlogreader_p.h"
+
+#include "quickenlogger_p.h"
+#include "quickenmetrics.h"
+
+QuickenLogReader::QuickenLogReader(const QString& fileName)
+    : d_ptr(new QuickenLogReaderPrivate(fileName))
+{
+}
+
+QuickenLogReaderPrivate::QuickenLogReaderPrivate(const QString& fileName)
+    : m_file(fileName)
+    , m_format(QuickenLogReader::Unknown)
+    , m_version(0)
+    , m_index(0)
+    , m_endIndex(0)
+    , m_capacity(0)
+    , m_blockOffset(0)
+    , m_blockCount(0)
+{
+    if (m_file.open(QIODevice::ReadOnly)) {
+        if (!readHeader()) {
+            m_file.close();
+        }
+    } else {
+        WARN("LogReader: Can't open file %s '%s'.", fileName.toLatin1().constData(),
+             m_file.errorString().toLatin1().constData());
+    }
+}
+
+QuickenLogReader::~QuickenLogReader()
+{
+    delete d_ptr;
+}
+
+bool QuickenLogReaderPrivate::readHeader()
+{
+    // Both formats share the same header layout for the first fields.
+    union {
+        QuickenBinaryLogHeader binary;
+        QuickenFlightRecorderHeader flightRecorder;
+        QuickenCompressedLogHeader compressed;
+    } header;
+    Q_STATIC_ASSERT(sizeof(QuickenBinaryLogHeader) == sizeof(QuickenFlightRecorderHeader));
+    Q_STATIC_ASSERT(sizeof(QuickenBinaryLogHeader) == sizeof(QuickenCompressedLogHeader));
+    if (m_file.read(reinterpret_cast<char*>(&header), sizeof(header)) != sizeof(header)) {
+        WARN("LogReader: Can't read log header.");
+        return false;
+    }
+
+    if (!memcmp(header.binary.magic, "QUICKENB", sizeof(header.binary.magic))) {
+        if (header.binary.byteOrder != 0x01020304) {
+            WARN("LogReader: Unsupported byte order.");
+            return false;
+        }
+        if (header.binary.version > QuickenBinaryLogHeader::currentVersion
+            || header.binary.metricsSize != sizeof(QuickenMetrics)) {
+            WARN("LogReader: Unsupported binary log version %u.", header.binary.version);
+            return false;
+        }
+        m_format = QuickenLogReader::Binary;
+        m_version = header.binary.version;
+        return true;
+    }
+
+    if (!memcmp(header.flightRecorder.magic, "QUICKENR", sizeof(header.flightRecorder.magic))) {
+        if (header.flightRecorder.byteOrder != 0x01020304) {
+            WARN("LogReader: Unsupported byte order.");
+            return false;
+        }
+        const quint32 capacity = header.flightRecorder.capacity;
+        if (header.flightRecorder.version > QuickenFlightRecorderHeader::currentVersion
+            || header.flightRecorder.metricsSize != sizeof(QuickenMetrics)
+            || capacity == 0 || !IS_POWER_OF_TWO(capacity)) {
+            WARN("LogReader: Unsupported flight recorder log version %u.",
+                 header.flightRecorder.version);
+            return false;
+        }
+        // Metrics in slots reserved by a write that didn't complete (crash
+        // while logging) are skipped.
+        const quint64 reserveIndex = header.flightRecorder.reserveIndex.load();
+        const quint64 writeIndex = header.flightRecorder.writeIndex.load();
+        m_format = QuickenLogReader::FlightRecorder;
+        m_version = header.flightRecorder.version;
+        m_capacity = capacity;
+        m_index = reserveIndex > capacity ? reserveIndex - capacity : 0;
+        m_endIndex = qMax(writeIndex, m_index);
+        return true;
+    }
+
+    if (!memcmp(header.compressed.magic, "QUICKENC", sizeof(header.compressed.magic))) {
+        if (header.compressed.byteOrder != 0x01020304) {
+            WARN("LogReader: Unsupported byte order.");
+            return false;
+        }
+        if (header.compressed.version > QuickenCompressedLogHeader::currentVersion
+            || header.compressed.metricsSize != sizeof(QuickenMetrics)) {
+            WARN("LogReader: Unsupported compressed log version %u.", header.compressed.version);
+            return false;
+        }
+        m_format = QuickenLogReader::Compressed;
+        m_version = header.compressed.version;
+        m_codec = QuickenMetricsCodec(header.compressed.timeResolution);
+        return true;
+    }
+
+    WARN("LogReader: Unknown log format.");
+    return false;
+}
+
+bool QuickenLogReader::isOpen()
+{
+    return d_func()->m_format != QuickenLogReader::Unknown;
+}
+
+QuickenLogReader::Format QuickenLogReader::format()
+{
+    return d_func()->m_format;
+}
+
+quint32 QuickenLogReader::version()
+{
+    return d_func()->m_version;
+}
+
+int QuickenLogReader::read(QuickenMetrics* metrics, int count)
+{
+    return d_func()->read(metrics, count);
+}
+
+int QuickenLogReaderPrivate::read(QuickenMetrics* metrics, int count)
+{
+    DASSERT(metrics);
+    DASSERT(count >= 0);
+
+    if (m_format == QuickenLogReader::Binary) {
+        const qint64 size = m_file.read(
+            reinterpret_cast<char*>(metrics), count * sizeof(QuickenMetrics));
+        if (size < 0) {
+            return -1;
+        }
+        // A metrics truncated at the end of the log (partial write or log still
+        // being written) isn't consumed, it's read again by the next call.
+        const qint64 partialSize = size % sizeof(QuickenMetrics);
+        if (partialSize > 0 && !m_file.seek(m_file.pos() - partialSize)) {
+            return -1;
+        }
+        return size / sizeof(QuickenMetrics);
+
+    } else if (m_format == QuickenLogReader::FlightRecorder) {
+        // Read the ring buffer in at most two contiguous parts.
+        int readCount = 0;
+        while (readCount < count && m_index < m_endIndex) {
+            const quint32 slot = m_index & (m_capacity - 1);
+            const int contiguousCount = static_cast<int>(qMin(
+                static_cast<quint64>(count - readCount),
+                qMin(static_cast<quint64>(m_capacity - slot), m_endIndex - m_index)));
+            const qint64 size = contiguousCount * sizeof(QuickenMetrics);
+            if (!m_file.seek(sizeof(QuickenFlightRecorderHeader) + slot * sizeof(QuickenMetrics))
+                || m_file.read(reinterpret_cast<char*>(&metrics[readCount]), size) != size) {
+                return -1;
+            }
+            readCount += contiguousCount;
+            m_index += contiguousCount;
+        }
+        return readCount;
+
+    } else if (m_format == QuickenLogReader::Compressed) {
+        int readCount = 0;
+        while (readCount < count) {
+            if (m_blockCount == 0 && !readBlock()) {
+                break;
+            }
+            const int size = m_codec.decode(
+                &m_block.constData()[m_blockOffset], m_block.size() - m_blockOffset,
+                &metrics[readCount]);
+            if (size > 0) {
+                m_blockOffset += size;
+                m_blockCount--;
+                readCount++;
+            } else {
+                // Invalid data despite a valid checksum, skip the block.
+                WARN("LogReader: Invalid compressed block.");
+                m_blockCount = 0;
+            }
+        }
+        return readCount;
+
+    } else {
+        return -1;
+    }
+}
+
+// Reads the next valid block of a compressed log. Returns false at the end of
+// the log.
+bool QuickenLogReaderPrivate::readBlock()
+{
+    while (true) {
+        const qint64 position = m_file.pos();
+        QuickenCompressedBlockHeader header;
+        if (m_file.read(reinterpret_cast<char*>(&header), sizeof(header)) != sizeof(header)) {
+            return false;
+        }
+        if (!memcmp(header.marker, quickenCompressedBlockMarker, sizeof(header.marker))
+            && header.payloadSize <= QuickenCompressedBlockHeader::maxPayloadSize
+            && header.count > 0) {
+            m_block.resize(header.payloadSize);
+            if (m_file.read(m_block.data(), header.payloadSize) == header.payloadSize
+                && quickenCompressedBlockChecksum(m_block.constData(), header.payloadSize)
+                   == header.checksum) {
+                m_codec.reset();
+                m_blockOffset = 0;
+                m_blockCount = header.count;
+                return true;
+            }
+        }
+        // Corrupted or truncated block, resynchronize on the next marker.
+        WARN("LogReader: Skipping corrupted data at offset %lld.",
+             static_cast<long long>(position));
+        if (!seekBlockMarker(position + 1)) {
+            return false;
+        }
+    }
+}
+
+// Seeks to the next block marker from position. Returns false if there's none.
+bool QuickenLogReaderPrivate::seekBlockMarker(qint64 position)
+{
+    const int markerSize = sizeof(quickenCompressedBlockMarker);
+    const int chunkSize = 4096;
+    char chunk[chunkSize];
+
+    while (m_file.seek(position)) {
+        const qint64 size = m_file.read(chunk, chunkSize);
+        if (size < markerSize) {
+            return false;
+        }
+        for (int i = 0; i <= size - markerSize; ++i) {
+            if (chunk[i] == quickenCompressedBlockMarker[0]
+                && !memcmp(&chunk[i], quickenCompressedBlockMarker, markerSize)) {
+                return m_file.seek(position + i);
+            }
+        }
+        // The marker could straddle two chunks.
+        position += size - markerSize + 1;
+    }
+    return false;
+}
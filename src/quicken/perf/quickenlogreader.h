@@ -0,0 +1,52 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#ifndef LOGREADER_H
+#define LOGREADER_H
+
+#include <QtCore/QString>
+
+#include <Quicken/quickenglobal.h>
+
+class QuickenLogReaderPrivate;
+struct QuickenMetrics;
+
+// Read back metrics logged in a binary format. Binary files start with a 128
+// bytes header made of a magic (8 bytes), the format version (32-bit), the size
+// of the metrics structs (32-bit) and 0x01020304 written in the byte order of
+// the metrics (32-bit). Logs written with a different byte order or metrics
+// size are rejected. Supported formats are the ones written by
+// QuickenBinaryLogger ("QUICKENB" magic), QuickenFlightRecorderLogger
+// ("QUICKENR" magic) and QuickenCompressedLogger ("QUICKENC" magic). Flight
+// recorder logs are read from the oldest metrics still available in the ring
+// buffer, even if the process crashed. Corrupted or truncated blocks of
+// compressed logs are skipped.
+class QUICKEN_EXPORT QuickenLogReader
+{
+public:
+    enum Format { Unknown = 0, Binary = 1, FlightRecorder = 2, Compressed = 3 };
+
+    QuickenLogReader(const QString& fileName);
+    ~QuickenLogReader();
+
+    // Get whether the log has been opened and its header recognized.
+    bool isOpen();
+
+    // Get the format and the format version of the log.
+    Format format();
+    quint32 version();
+
+    // Read at most count metrics from the current position, in logging
+    // order. Returns the number of metrics read, 0 at the end of the log and
+    // -1 in case of error. A binary log can be read while being written, a
+    // metrics partially written at the end is read once complete.
+    int read(QuickenMetrics* metrics, int count);
+
+private:
+    QuickenLogReaderPrivate* const d_ptr;
+    Q_DECLARE_PRIVATE(QuickenLogReader)
+};
+
+#endif  // LOGREADER_H
@@ -0,0 +1,41 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#ifndef LOGREADER_P_H
+#define LOGREADER_P_H
+
+#include <Quicken/quickenlogreader.h>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+
+#include <Quicken/private/quickenmetricscodec_p.h>
+#include <Quicken/private/quickenglobal_p.h>
+
+class QUICKEN_PRIVATE_EXPORT QuickenLogReaderPrivate
+{
+public:
+    QuickenLogReaderPrivate(const QString& fileName);
+
+    bool readHeader();
+    int read(QuickenMetrics* metrics, int count);
+    bool readBlock();
+    bool seekBlockMarker(qint64 position);
+
+    QFile m_file;
+    QuickenLogReader::Format m_format;
+    quint32 m_version;
+    // Flight recorder ring buffer state.
+    quint64 m_index;
+    quint64 m_endIndex;
+    quint32 m_capacity;
+    // Compressed block state.
+    QuickenMetricsCodec m_codec;
+    QByteArray m_block;
+    int m_blockOffset;
+    int m_blockCount;
+};
+
+#endif  // LOGREADER_P_H
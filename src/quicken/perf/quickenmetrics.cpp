@@ -8,13 +8,20 @@
 
 #include <string.h>
 #include <unistd.h>
-#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
 #include <cstdio>
+#include <cstdlib>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
 
 #include <QtCore/QElapsedTimer>
 
-const int bufferSize = 128;
-const int bufferAlignment = 64;
+// The entries we need are at the beginning of /proc/self/stat, /proc/self/io is
+// small.
+const int procFileBufferSize = 256;
+const int smapsRollupBufferSize = 1024;
 
 QuickenMetricsUtils::QuickenMetricsUtils()
     : d_ptr(new QuickenMetricsUtilsPrivate)
@@ -22,16 +29,21 @@ QuickenMetricsUtils::QuickenMetricsUtils()
 }
 
 QuickenMetricsUtilsPrivate::QuickenMetricsUtilsPrivate()
+    : m_statFile("/proc/self/stat", procFileBufferSize)
+    , m_ioFile("/proc/self/io", procFileBufferSize)
+    , m_smapsRollupFile("/proc/self/smaps_rollup", smapsRollupBufferSize)
 {
-#if !defined(QT_NO_DEBUG)
-    ASSERT(m_buffer = static_cast<char*>(alignedAlloc(bufferAlignment, bufferSize)));
-#else
-    m_buffer = static_cast<char*>(alignedAlloc(bufferAlignment, bufferSize));
-#endif
-    m_cpuTimer.start();
-    m_cpuTicks = times(&m_cpuTimes);
+    m_cpuTime = QuickenMetricsUtils::processCpuTime();
+    m_cpuTimeStamp = QuickenMetricsUtils::timeStamp();
     m_cpuOnlineCores = sysconf(_SC_NPROCESSORS_ONLN);
     m_pageSize = sysconf(_SC_PAGESIZE);
+    m_pid = getpid();
+    m_clockTickDuration = 1000000000 / sysconf(_SC_CLK_TCK);
+    m_threadTimeStamp = 0;
+    m_threadCount = 0;
+    if (getrusage(RUSAGE_SELF, &m_resourceUsage) != 0) {
+        memset(&m_resourceUsage, 0, sizeof(m_resourceUsage));
+    }
 }
 
 QuickenMetricsUtils::~QuickenMetricsUtils()
@@ -41,7 +53,9 @@ QuickenMetricsUtils::~QuickenMetricsUtils()
 
 QuickenMetricsUtilsPrivate::~QuickenMetricsUtilsPrivate()
 {
-    free(m_buffer);
+    for (int i = 0; i < m_threadCount; ++i) {
+        delete m_threadStatFiles[i];
+    }
 }
 
 void QuickenMetricsUtils::updateProcessMetrics(QuickenMetrics* metrics)
@@ -53,83 +67,331 @@ void QuickenMetricsUtils::updateProcessMetrics(QuickenMetrics* metrics)
     metrics->timeStamp = QuickenMetricsUtils::timeStamp();
     d->updateCpuUsage(metrics);
     d->updateProcStatMetrics(metrics);
+    d->updateProcIoMetrics(metrics);
+    d->updateResourceUsage(metrics);
 }
 
 void QuickenMetricsUtilsPrivate::updateCpuUsage(QuickenMetrics* metrics)
 {
-    // times() is a Linux syscall giving CPU times used by the process. The
-    // granularity of the unit returned by the (some?) kernel (clock ticks)
-    // prevents us from getting precise timings at a high frequency, so we have
-    // to throttle to 200 ms (5 Hz).
-    const qint64 throttlingFrequency = 200;
-    if (m_cpuTimer.elapsed() > throttlingFrequency) {
-        struct tms newCpuTimes;
-        const clock_t newTicks = times(&newCpuTimes);
-        const clock_t ticks = newTicks - m_cpuTicks;
-        const clock_t userTime = newCpuTimes.tms_utime - m_cpuTimes.tms_utime;
-        const clock_t systemTime = newCpuTimes.tms_stime - m_cpuTimes.tms_stime;
-        metrics->process.cpuUsage = ((userTime + systemTime) * 100) / (ticks * m_cpuOnlineCores);
-        m_cpuTimer.start();
-        memcpy(&m_cpuTimes, &newCpuTimes, sizeof(struct tms));
-        m_cpuTicks = newTicks;
+    // The process CPU clock has a nanosecond resolution (unlike times() and its
+    // clock ticks), so the usage is precise whatever the update frequency.
+    const quint64 cpuTime = QuickenMetricsUtils::processCpuTime();
+    const quint64 timeStamp = metrics->timeStamp;
+    if (timeStamp > m_cpuTimeStamp) {
+        metrics->process.cpuUsage = ((cpuTime - qMin(cpuTime, m_cpuTime)) * 100)
+            / ((timeStamp - m_cpuTimeStamp) * m_cpuOnlineCores);
+        m_cpuTime = cpuTime;
+        m_cpuTimeStamp = timeStamp;
     }
 }
 
 void QuickenMetricsUtilsPrivate::updateProcStatMetrics(QuickenMetrics* metrics)
 {
-    int fd = open("/proc/self/stat", O_RDONLY);
-    if (fd == -1) {
-        DWARN("MetricsUtils: can't open '/proc/self/stat'");
-        return;
-    }
-    int readSize;
-    if ((readSize = read(fd, m_buffer, bufferSize)) == 0) {
-        DWARN("MetricsUtils: can't read '/proc/self/stat'");
-        close(fd);
+    const int size = m_statFile.read();
+    if (size <= 0) {
         return;
     }
 
-    // Entries starting from 1 (as listed by 'man proc').
+    // Entries starting from 1 (as listed by 'man proc'). The name (entry 2) can
+    // contain spaces and parentheses, so fields are counted from its closing
+    // parenthesis, followed by the state (entry 3).
     const int numThreadsEntry = 20;
     const int vsizeEntry = 23;
-    const int rssEntry = 24;
-    const int lastEntry = rssEntry;
-
-    // Get the indices of num_threads, vsize and rss entries and check if
-    // the buffer is big enough.
-    int sourceIndex = 0, spaceCount = 0;
-    quint16 entryIndices[lastEntry + 1];
-    entryIndices[sourceIndex] = 0;
-    while (spaceCount < lastEntry) {
-        if (sourceIndex < readSize) {
-            if (m_buffer[sourceIndex++] == ' ') {
-                entryIndices[++spaceCount] = sourceIndex;
-            }
+    QuickenProcScanner scanner(m_statFile.data(), size);
+    quint64 threadCount, vsize, rss;
+    if (!scanner.skipPastLast(')') || !scanner.skipFields(numThreadsEntry - 3)
+        || !scanner.readInteger(&threadCount)
+        || !scanner.skipFields(vsizeEntry - numThreadsEntry - 1)
+        || !scanner.readInteger(&vsize) || !scanner.readInteger(&rss)) {
+        DNOT_REACHED();  // Consider increasing procFileBufferSize.
+        return;
+    }
+
+    metrics->process.vszMemory = vsize >> 10;
+    metrics->process.rssMemory = (rss * m_pageSize) >> 10;
+    metrics->process.threadCount = threadCount;
+}
+
+void QuickenMetricsUtilsPrivate::updateProcIoMetrics(QuickenMetrics* metrics)
+{
+    // Not readable when the kernel is built without task I/O accounting.
+    const int size = m_ioFile.read();
+    if (size <= 0) {
+        metrics->process.readBytes = 0;
+        metrics->process.writtenBytes = 0;
+        return;
+    }
+
+    QuickenProcScanner scanner(m_ioFile.data(), size);
+    quint64 readBytes = 0, writtenBytes = 0;
+    if (!scanner.readKeyValue("rchar:", sizeof("rchar:") - 1, &readBytes)
+        || !scanner.readKeyValue("wchar:", sizeof("wchar:") - 1, &writtenBytes)) {
+        DNOT_REACHED();
+    }
+    metrics->process.readBytes = readBytes;
+    metrics->process.writtenBytes = writtenBytes;
+}
+
+void QuickenMetricsUtilsPrivate::updateResourceUsage(QuickenMetrics* metrics)
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        DNOT_REACHED();
+        return;
+    }
+
+    metrics->process.minorPageFaults = usage.ru_minflt - m_resourceUsage.ru_minflt;
+    metrics->process.majorPageFaults = usage.ru_majflt - m_resourceUsage.ru_majflt;
+    metrics->process.voluntaryContextSwitches = usage.ru_nvcsw - m_resourceUsage.ru_nvcsw;
+    metrics->process.involuntaryContextSwitches = usage.ru_nivcsw - m_resourceUsage.ru_nivcsw;
+    m_resourceUsage = usage;
+}
+
+int QuickenMetricsUtils::updateThreadMetrics(QuickenMetrics* metrics, int maxCount)
+{
+    DASSERT(metrics);
+    DASSERT(maxCount >= 0);
+    Q_D(QuickenMetricsUtils);
+
+    return d->updateThreadMetrics(metrics, maxCount);
+}
+
+// Keep in sync with QuickenThreadMetrics::Role. Names are matched on their 15
+// first characters since Linux truncates them, QThread names threads with their
+// object name or with their class name if not set.
+static const struct {
+    const char* const name;
+    quint8 role;
+} threadRoleInfo[] = {
+    { "QSGRenderThread", QuickenThreadMetrics::Render       },
+    { "QQuickPixmapRea", QuickenThreadMetrics::PixmapReader },
+    { "QQmlThread",      QuickenThreadMetrics::Qml          },
+    { "QQuickWorkerScr", QuickenThreadMetrics::Qml          },
+    { "Quicken logging", QuickenThreadMetrics::Logging      }
+};
+
+int QuickenMetricsUtilsPrivate::updateThreadMetrics(QuickenMetrics* metrics, int maxCount)
+{
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) {
+        DWARN("MetricsUtils: can't open '/proc/self/task'");
+        return 0;
+    }
+
+    const quint64 timeStamp = QuickenMetricsUtils::timeStamp();
+    const quint64 elapsedTime = m_threadTimeStamp > 0 ? timeStamp - m_threadTimeStamp : 0;
+    const int count = qMin(maxCount, static_cast<int>(maxThreadCount));
+    quint32 threadIds[maxThreadCount];
+    quint64 threadCpuTimes[maxThreadCount];
+    QuickenProcFile* threadStatFiles[maxThreadCount];
+    int threadCount = 0;
+
+    struct dirent* entry;
+    while (threadCount < count && (entry = readdir(dir))) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;  // "." and "..".
+        }
+        const quint32 threadId = strtoul(entry->d_name, nullptr, 10);
+
+        // Take over the stat file of a thread already seen at the previous
+        // update, open it otherwise.
+        int previous = 0;
+        while (previous < m_threadCount && m_threadIds[previous] != threadId) {
+            previous++;
+        }
+        QuickenProcFile* statFile;
+        if (previous < m_threadCount) {
+            statFile = m_threadStatFiles[previous];
+            m_threadStatFiles[previous] = nullptr;
         } else {
-            DASSERT(readSize == bufferSize); // Missing entries in /proc/self/stat.
-            DNOT_REACHED();  // Consider increasing bufferSize.
-            close(fd);
+            char fileName[64];
+            snprintf(fileName, sizeof(fileName), "/proc/self/task/%s/stat", entry->d_name);
+            statFile = new QuickenProcFile(fileName, procFileBufferSize);
+        }
+
+        QuickenMetrics* threadMetrics = &metrics[threadCount];
+        memset(threadMetrics, 0, sizeof(QuickenMetrics));
+        if (!updateThreadStatMetrics(statFile, &threadMetrics->thread)) {
+            delete statFile;
+            continue;  // Exited in the meantime.
+        }
+        threadMetrics->type = QuickenMetrics::Thread;
+        threadMetrics->timeStamp = timeStamp;
+
+        QuickenThreadMetrics* thread = &threadMetrics->thread;
+        if (thread->thread == m_pid) {
+            thread->role = QuickenThreadMetrics::Gui;
+        } else {
+            thread->role = QuickenThreadMetrics::Other;
+            for (int i = 0; i < static_cast<int>(ARRAY_SIZE(threadRoleInfo)); ++i) {
+                if (!strcmp(thread->name, threadRoleInfo[i].name)) {
+                    thread->role = threadRoleInfo[i].role;
+                    break;
+                }
+            }
+        }
+
+        // CPU usage since the previous update, threads created in the meantime
+        // get a 0% usage.
+        const quint64 cpuTime = thread->userTime + thread->systemTime;
+        thread->cpuUsage = 0;
+        if (elapsedTime > 0 && previous < m_threadCount && cpuTime > m_threadCpuTimes[previous]) {
+            thread->cpuUsage = ((cpuTime - m_threadCpuTimes[previous]) * 100) / elapsedTime;
+        }
+        threadIds[threadCount] = thread->thread;
+        threadCpuTimes[threadCount] = cpuTime;
+        threadStatFiles[threadCount] = statFile;
+        threadCount++;
+    }
+    closedir(dir);
+
+    // Close the stat files of the threads that exited since the previous update.
+    for (int i = 0; i < m_threadCount; ++i) {
+        delete m_threadStatFiles[i];
+    }
+
+    memcpy(m_threadIds, threadIds, threadCount * sizeof(quint32));
+    memcpy(m_threadCpuTimes, threadCpuTimes, threadCount * sizeof(quint64));
+    memcpy(m_threadStatFiles, threadStatFiles, threadCount * sizeof(QuickenProcFile*));
+    m_threadCount = threadCount;
+    m_threadTimeStamp = timeStamp;
+
+    return threadCount;
+}
+
+bool QuickenMetricsUtilsPrivate::updateThreadStatMetrics(
+    QuickenProcFile* statFile, QuickenThreadMetrics* metrics)
+{
+    const int size = statFile->read();
+    if (size <= 0) {
+        return false;
+    }
+
+    // Entries starting from 1 (as listed by 'man proc'), the state is entry 3
+    // and utime (entry 14) is followed by stime.
+    const int utimeEntry = 14;
+    QuickenProcScanner scanner(statFile->data(), size);
+    quint64 threadId, utime, stime;
+    const char* name;
+    int nameSize;
+    char state;
+    if (!scanner.readInteger(&threadId) || !scanner.readParenthesized(&name, &nameSize)
+        || !scanner.readCharacter(&state) || !scanner.skipFields(utimeEntry - 4)
+        || !scanner.readInteger(&utime) || !scanner.readInteger(&stime)) {
+        DNOT_REACHED();  // Consider increasing procFileBufferSize.
+        return false;
+    }
+
+    nameSize = qMin(nameSize, static_cast<int>(QuickenThreadMetrics::maxNameSize) - 1);
+    memcpy(metrics->name, name, nameSize);
+    memset(&metrics->name[nameSize], 0, QuickenThreadMetrics::maxNameSize - nameSize);
+    metrics->thread = threadId;
+    metrics->state = state;
+    metrics->userTime = utime * m_clockTickDuration;
+    metrics->systemTime = stime * m_clockTickDuration;
+    return true;
+}
+
+void QuickenMetricsUtils::updateMemoryMetrics(QuickenMetrics* metrics)
+{
+    DASSERT(metrics);
+    Q_D(QuickenMetricsUtils);
+
+    metrics->type = QuickenMetrics::Memory;
+    metrics->timeStamp = QuickenMetricsUtils::timeStamp();
+    d->updateSmapsRollupMetrics(metrics);
+    d->updateHeapMetrics(metrics);
+}
+
+void QuickenMetricsUtilsPrivate::updateSmapsRollupMetrics(QuickenMetrics* metrics)
+{
+    QuickenMemoryMetrics* memory = &metrics->memory;
+    memory->pssMemory = 0;
+    memory->privateCleanMemory = 0;
+    memory->privateDirtyMemory = 0;
+    memory->anonymousMemory = 0;
+    memory->swapMemory = 0;
+
+    // Available since Linux 4.14.
+    const int size = m_smapsRollupFile.read();
+    if (size <= 0) {
+        return;
+    }
+
+    // Sizes are in kilobytes, keys are listed in file order.
+    static const struct {
+        const char* const key;
+        const int keySize;
+    } keyInfo[] = {
+        { "Pss:",           sizeof("Pss:") - 1           },
+        { "Private_Clean:", sizeof("Private_Clean:") - 1 },
+        { "Private_Dirty:", sizeof("Private_Dirty:") - 1 },
+        { "Anonymous:",     sizeof("Anonymous:") - 1     },
+        { "Swap:",          sizeof("Swap:") - 1          }
+    };
+    quint32* const values[] = {
+        &memory->pssMemory, &memory->privateCleanMemory, &memory->privateDirtyMemory,
+        &memory->anonymousMemory, &memory->swapMemory
+    };
+    Q_STATIC_ASSERT(ARRAY_SIZE(keyInfo) == ARRAY_SIZE(values));
+
+    QuickenProcScanner scanner(m_smapsRollupFile.data(), size);
+    for (int i = 0; i < static_cast<int>(ARRAY_SIZE(keyInfo)); ++i) {
+        quint64 value;
+        if (!scanner.readKeyValue(keyInfo[i].key, keyInfo[i].keySize, &value)) {
+            DNOT_REACHED();  // Consider increasing smapsRollupBufferSize.
             return;
         }
+        *values[i] = value;
     }
+}
 
-    unsigned long vsize;
-    long threadCount, rss;
-#if !defined(QT_NO_DEBUG)
-    int value =  sscanf(&m_buffer[entryIndices[numThreadsEntry-1]], "%ld", &threadCount);
-    ASSERT(value == 1);
-    value =  sscanf(&m_buffer[entryIndices[vsizeEntry-1]], "%lu %ld", &vsize, &rss);
-    ASSERT(value == 2);
+void QuickenMetricsUtilsPrivate::updateHeapMetrics(QuickenMetrics* metrics)
+{
+    QuickenMemoryMetrics* memory = &metrics->memory;
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    const struct mallinfo2 info = mallinfo2();
+#elif defined(__GLIBC__)
+    // Fields are ints with older glibc versions, wrapping around above 2 GB.
+    const struct mallinfo info = mallinfo();
+#endif
+
+#if defined(__GLIBC__)
+    memory->heapArenaMemory = static_cast<size_t>(info.arena) >> 10;
+    memory->heapUsedMemory =
+        (static_cast<size_t>(info.uordblks) + static_cast<size_t>(info.hblkhd)) >> 10;
+    memory->heapFreeMemory = static_cast<size_t>(info.fordblks) >> 10;
+    memory->heapMappedMemory = static_cast<size_t>(info.hblkhd) >> 10;
 #else
-    sscanf(&m_buffer[entryIndices[numThreadsEntry-1]], "%ld", &threadCount);
-    sscanf(&m_buffer[entryIndices[vsizeEntry-1]], "%lu %ld", &vsize, &rss);
+    memory->heapArenaMemory = 0;
+    memory->heapUsedMemory = 0;
+    memory->heapFreeMemory = 0;
+    memory->heapMappedMemory = 0;
 #endif
+}
 
-    metrics->process.vszMemory = vsize >> 10;
-    metrics->process.rssMemory = (rss * m_pageSize) >> 10;
-    metrics->process.threadCount = threadCount;
+static quint64 cpuTime(clockid_t clock)
+{
+    struct timespec time;
+    if (Q_LIKELY(clock_gettime(clock, &time) == 0)) {
+        return static_cast<quint64>(time.tv_sec) * Q_UINT64_C(1000000000) + time.tv_nsec;
+    } else {
+        DNOT_REACHED();
+        return 0;
+    }
+}
 
-    close(fd);
+// static.
+quint64 QuickenMetricsUtils::processCpuTime()
+{
+    return cpuTime(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+// static.
+quint64 QuickenMetricsUtils::threadCpuTime()
+{
+    return cpuTime(CLOCK_THREAD_CPUTIME_ID);
 }
 
 // static.
@@ -21,16 +21,36 @@ struct QUICKEN_EXPORT QuickenProcessMetrics
     // Resident set size (RSS) of the process in kilobytes.
     quint32 rssMemory;
 
-    // CPU usage of the process as a percentage. 100%, for instance, if all the
-    // cores are at 100% usage, 50% if half of the cores are at 100%.
+    // CPU usage of the process since the previous update as a percentage. 100%,
+    // for instance, if all the cores are at 100% usage, 50% if half of the
+    // cores are at 100%.
     quint16 cpuUsage;
 
     // Number of threads at buffer swap.
     quint16 threadCount;
 
+    quint8 __padding[4];
+
+    // Number of bytes the process read and wrote since its start (including
+    // from and to the page cache, pipes and sockets). 0 if /proc/self/io can't
+    // be read.
+    quint64 readBytes;
+    quint64 writtenBytes;
+
+    // Number of minor (no I/O needed) and major (I/O needed) page faults of
+    // the process since the previous update.
+    quint32 minorPageFaults;
+    quint32 majorPageFaults;
+
+    // Number of voluntary (blocking on a resource) and involuntary (preempted
+    // by the scheduler) context switches of the process since the previous
+    // update.
+    quint32 voluntaryContextSwitches;
+    quint32 involuntaryContextSwitches;
+
     // The whole struct must take 112 bytes to allow future additions and best
     // memory alignment, don't forget to update when adding new metrics.
-    quint8 __reserved[/*12 bytes taken,*/ 100 /*bytes free*/];
+    quint8 __reserved[/*48 bytes taken,*/ 64 /*bytes free*/];
 };
 Q_STATIC_ASSERT(sizeof(QuickenProcessMetrics) == 112);
 
@@ -82,9 +102,58 @@ struct QUICKEN_EXPORT QuickenFrameMetrics
     // Time in nanoseconds taken by the graphics subsystem's buffer swap call.
     quint64 swapTime;
 
+    // CPU time in nanoseconds spent by the thread rendering the frame (the
+    // scene graph render thread, or the GUI thread with the basic render loop)
+    // from the beginning of the sync pass to the end of the buffer swap.
+    quint64 cpuTime;
+
+    // Number of minor and major page faults of the thread rendering the frame,
+    // over the same period than cpuTime.
+    quint32 minorPageFaults;
+    quint32 majorPageFaults;
+
+    // Number of voluntary and involuntary context switches of the thread
+    // rendering the frame, over the same period than cpuTime.
+    quint32 voluntaryContextSwitches;
+    quint32 involuntaryContextSwitches;
+
+    // Scene graph statistics of the frame (see QuickenSceneGraphStatistics).
+    // Number of nodes rendered, number of opaque and alpha batches and of draw
+    // calls. The batch and draw call counts are estimates computed from the
+    // node tree with the main merging rules of the batch renderer, not the
+    // numbers of the renderer which doesn't expose them, they can differ.
+    quint32 nodeCount;
+    quint16 opaqueBatchCount;
+    quint16 alphaBatchCount;
+    quint32 drawCallCount;
+
+    // Number of nodes whose material changed since the previous frame and
+    // number of shader program changes between the estimated batches.
+    quint16 materialChangeCount;
+    quint16 shaderChangeCount;
+
+    // Size in bytes of the vertex and index data of the geometries added or
+    // changed since the previous frame.
+    quint32 vertexUploadSize;
+    quint32 indexUploadSize;
+
+    // Time in nanoseconds from the delivery of the oldest input event (touch,
+    // mouse or key) reflected by the frame to the end of the buffer swap, and
+    // number of input events reflected. Input events are reflected by the
+    // first frame synchronized after their delivery, the ones that don't
+    // change the scene aren't counted. 0 if the frame reflects no input.
+    quint64 inputLatency;
+    quint32 inputEventCount;
+
+    // Number of vsyncs missed since the previous frame, based on the refresh
+    // interval learned by the window monitor (see QuickenPacingMetrics). Only
+    // frames rendered while animations are running are expected at each
+    // vsync, it's 0 for the other ones.
+    quint16 droppedVsyncCount;
+
     // The whole struct must take 112 bytes to allow future additions and best
     // memory alignment, don't forget to update when adding new metrics.
-    quint8 __reserved[/*48 bytes taken,*/ 64 /*bytes free*/];
+    quint8 __reserved[/*110 bytes taken,*/ 2 /*bytes free*/];
 };
 Q_STATIC_ASSERT(sizeof(QuickenFrameMetrics) == 112);
 
@@ -107,9 +176,342 @@ struct QUICKEN_EXPORT QuickenGenericMetrics
 };
 Q_STATIC_ASSERT(sizeof(QuickenGenericMetrics) == 112);
 
+struct QUICKEN_EXPORT QuickenNumericDeclaration
+{
+    static const quint32 maxNameSize = 64;
+    static const quint32 maxUnitSize = 24;
+
+    // Null-terminated name of the numeric metrics, without whitespaces.
+    char name[maxNameSize];
+
+    // Null-terminated unit of the values, without whitespaces. Empty if the
+    // values have no unit.
+    char unit[maxUnitSize];
+};
+
+struct QUICKEN_EXPORT QuickenNumericMetrics
+{
+    enum Kind { Integer = 0, Real = 1, Declaration = 2, KindCount = 3 };
+    static const int maxValueCount = 12;
+
+    // Id retrieved from QuickenApplicationMonitor::registerNumericMetrics().
+    quint32 id;
+
+    // Kind of the metrics (Kind). Integer and real metrics store values, a
+    // declaration binds a name and a unit to the id. Declarations are logged
+    // when an id is registered and when logging starts so that loggers can
+    // resolve names.
+    quint8 kind;
+
+    // Number of values stored (0 for declarations).
+    quint8 valueCount;
+
+    quint8 __padding[2];
+
+    union {
+        qint64 integers[maxValueCount];
+        double reals[maxValueCount];
+        QuickenNumericDeclaration declaration;
+    };
+
+    // The whole struct must take 112 bytes to allow future additions and best
+    // memory alignment, don't forget to update when adding new metrics.
+    quint8 __reserved[/*104 bytes taken,*/ 8 /*bytes free*/];
+};
+Q_STATIC_ASSERT(sizeof(QuickenNumericMetrics) == 112);
+
+struct QUICKEN_EXPORT QuickenScopeMetrics
+{
+    static const quint32 maxNameSize = 64;
+
+    // Id of the thread (as returned by gettid()) on which the scope has been
+    // traced.
+    quint32 thread;
+
+    // Nesting depth of the scope on its thread, 0 for outermost scopes.
+    quint32 depth;
+
+    // Time stamp in nanoseconds of the scope start. The metrics time stamp is
+    // the scope end.
+    quint64 startTime;
+
+    // Null-terminated name of the scope.
+    char name[maxNameSize];
+
+    // The whole struct must take 112 bytes to allow future additions and best
+    // memory alignment, don't forget to update when adding new metrics.
+    quint8 __reserved[/*80 bytes taken,*/ 32 /*bytes free*/];
+};
+Q_STATIC_ASSERT(sizeof(QuickenScopeMetrics) == 112);
+
+struct QUICKEN_EXPORT QuickenThreadMetrics
+{
+    enum Role {
+        Other = 0, Gui = 1, Render = 2, PixmapReader = 3, Qml = 4, Logging = 5, RoleCount = 6
+    };
+    static const quint32 maxNameSize = 16;
+
+    // Id of the thread (as returned by gettid()).
+    quint32 thread;
+
+    // Role of the thread (Role) deduced from its id and its name. Render is
+    // the QtQuick scene graph render thread, Qml the QML type loader and
+    // WorkerScript threads and Logging the Quicken logging thread.
+    quint8 role;
+
+    // State of the thread as listed by 'man proc' ('R' for running, 'S' for
+    // sleeping, 'D' for uninterruptible disk sleep, etc).
+    char state;
+
+    // CPU usage of the thread since the previous update as a percentage of
+    // one core. 100% if the thread kept a core busy.
+    quint16 cpuUsage;
+
+    // CPU time in nanoseconds spent by the thread in user mode.
+    quint64 userTime;
+
+    // CPU time in nanoseconds spent by the thread in kernel mode.
+    quint64 systemTime;
+
+    // Null-terminated name of the thread, truncated to 15 characters.
+    char name[maxNameSize];
+
+    // The whole struct must take 112 bytes to allow future additions and best
+    // memory alignment, don't forget to update when adding new metrics.
+    quint8 __reserved[/*40 bytes taken,*/ 72 /*bytes free*/];
+};
+Q_STATIC_ASSERT(sizeof(QuickenThreadMetrics) == 112);
+
+// Read from /proc/self/smaps_rollup and glibc's mallinfo2(), updated every 10
+// seconds by default (see QuickenApplicationMonitor::setUpdateInterval()).
+struct QUICKEN_EXPORT QuickenMemoryMetrics
+{
+    // Proportional set size (PSS) of the process in kilobytes, the resident
+    // pages shared with other processes are divided by the number of processes
+    // sharing them.
+    quint32 pssMemory;
+
+    // Resident pages mapped only by the process in kilobytes, either clean
+    // (unmodified file backed pages) or dirty. Their sum is the unique set size
+    // (USS), the memory freed if the process exits.
+    quint32 privateCleanMemory;
+    quint32 privateDirtyMemory;
+
+    // Resident anonymous pages (heap, stacks, anonymous mappings) in
+    // kilobytes.
+    quint32 anonymousMemory;
+
+    // Pages swapped out in kilobytes.
+    quint32 swapMemory;
+
+    // Memory of the C heap in kilobytes, as reported by the allocator. The size
+    // of its arenas (excluding mmapped chunks), the memory allocated (including
+    // mmapped chunks), the free memory in arenas and the memory allocated with
+    // mmap. 0 if not available.
+    quint32 heapArenaMemory;
+    quint32 heapUsedMemory;
+    quint32 heapFreeMemory;
+    quint32 heapMappedMemory;
+
+    // The whole struct must take 112 bytes to allow future additions and best
+    // memory alignment, don't forget to update when adding new metrics.
+    quint8 __reserved[/*36 bytes taken,*/ 76 /*bytes free*/];
+};
+Q_STATIC_ASSERT(sizeof(QuickenMemoryMetrics) == 112);
+
+struct QUICKEN_EXPORT QuickenPerfCounterMetrics
+{
+    enum Source { Hardware = 0, Software = 1, SourceCount = 2 };
+    enum Phase { Sync = 0, Render = 1, Swap = 2, PhaseCount = 3 };
+    static const int counterCount = 3;
+
+    // The id of the window on which the frame has been rendered.
+    quint32 window;
+
+    // The frame number, as in QuickenFrameMetrics.
+    quint32 number;
+
+    // Role of the thread counted (QuickenThreadMetrics::Role), either Render
+    // or Gui. The GUI thread is counted along with the render thread with the
+    // threaded render loop.
+    quint8 role;
+
+    // Counters source (Source). Software counters are the task clock in
+    // nanoseconds, context switches and page faults. Hardware counters are
+    // instructions, CPU cycles and cache misses. Software counters are always
+    // logged, hardware ones are logged in a separate metrics when available
+    // (they aren't in most virtual machines).
+    quint8 source;
+
+    quint8 __padding[6];
+
+    // Counter values per frame phase (Phase). The sync phase goes from
+    // QQuickWindow::beforeSynchronizing() to afterSynchronizing(), the render
+    // phase ends at afterRendering() and the swap phase at frameSwapped().
+    // Values are extrapolated from the time the counters were actually running
+    // when the PMU multiplexes them with other events.
+    quint64 values[PhaseCount][counterCount];
+
+    // The whole struct must take 112 bytes to allow future additions and best
+    // memory alignment, don't forget to update when adding new metrics.
+    quint8 __reserved[/*88 bytes taken,*/ 24 /*bytes free*/];
+};
+Q_STATIC_ASSERT(sizeof(QuickenPerfCounterMetrics) == 112);
+
+struct QUICKEN_EXPORT QuickenEngineMetrics
+{
+    // The id of the window on which the frame has been rendered. The engine
+    // activity is reported with the first frame synchronized after it, the GUI
+    // thread being blocked by the engine delays that frame.
+    quint32 window;
+
+    // The frame number, as in QuickenFrameMetrics.
+    quint32 number;
+
+    // Memory of the JavaScript heap in bytes, as reported by the V4 memory
+    // manager. The used size is the size of the live and not yet collected
+    // items, the allocated size is the size of the heap chunks. Both include
+    // the large items allocated separately.
+    quint64 heapUsed;
+    quint64 heapAllocated;
+
+    // Estimated garbage collector time in nanoseconds since the previous frame.
+    // It's not a measured pause, the engine doesn't report collections: it's
+    // the time from the last allocation preceding the sweep deallocations to
+    // the last of them, which includes the mark phase and the profiler's
+    // overhead (see QuickenApplicationMonitor::EngineMetrics).
+    quint64 gcTimeEstimate;
+
+    // Number of garbage collector runs since the previous frame.
+    quint32 gcCount;
+
+    // Number of QML bindings evaluated since the previous frame.
+    quint32 bindingCount;
+
+    // The whole struct must take 112 bytes to allow future additions and best
+    // memory alignment, don't forget to update when adding new metrics.
+    quint8 __reserved[/*40 bytes taken,*/ 72 /*bytes free*/];
+};
+Q_STATIC_ASSERT(sizeof(QuickenEngineMetrics) == 112);
+
+struct QUICKEN_EXPORT QuickenPacingMetrics
+{
+    // The id of the window.
+    quint32 window;
+
+    // The number of the last frame of the period.
+    quint32 number;
+
+    // Refresh interval in nanoseconds learned from the swap cadence, starting
+    // from the screen one and refined by frames swapped about one interval
+    // apart, and refresh interval derived from QScreen::refreshRate().
+    quint32 vsyncInterval;
+    quint32 screenVsyncInterval;
+
+    // Number of frames swapped while animations were running since the last
+    // update and number of vsyncs they spanned. Only these frames are expected
+    // at each vsync, a gap between two frames can't be told from idling
+    // otherwise.
+    quint32 frameCount;
+    quint32 vsyncCount;
+
+    // Number of vsyncs missed by these frames.
+    quint32 droppedVsyncCount;
+
+    // Number of changes of the number of vsyncs spanned between consecutive
+    // frames. Alternating long and short frames (like 1-2-1-2 vsyncs) move at
+    // an irregular pace even if the average frame rate looks fine.
+    quint32 pacingChangeCount;
+
+    // Smoothness score in hundredths of a percent, from 0 to 10000 (frames
+    // presented at each vsync with a regular pace). It's the ratio of the frame
+    // count to the vsync count, each pacing change counting as an additional
+    // vsync.
+    quint16 smoothness;
+
+    // The whole struct must take 112 bytes to allow future additions and best
+    // memory alignment, don't forget to update when adding new metrics.
+    quint8 __reserved[/*34 bytes taken,*/ 78 /*bytes free*/];
+};
+Q_STATIC_ASSERT(sizeof(QuickenPacingMetrics) == 112);
+
+struct QUICKEN_EXPORT QuickenTimelineMetrics
+{
+    // Phase boundaries of the GUI thread. The frame starts with the delivery
+    // of the update request, followed by the frame synchronous events and the
+    // polish of the items, which ends when QQuickWindow::afterAnimating() is
+    // emitted. The GUI thread then waits for the sync pass (or renders the
+    // frame with non-threaded render loops) until unblocked, advances the
+    // animations and returns to its event loop at the end of the frame.
+    enum GuiBoundary {
+        UpdateRequest = 0, PolishEnd = 1, Unblocked = 2, GuiFrameEnd = 3, GuiBoundaryCount = 4
+    };
+
+    // Phase boundaries of the thread rendering the frame. The render phase
+    // ends at QQuickWindow::afterRendering(), the swap starts once the overlay
+    // is rendered.
+    enum RenderBoundary {
+        SyncStart = 0, SyncEnd = 1, RenderStart = 2, RenderEnd = 3, SwapStart = 4, SwapEnd = 5,
+        RenderBoundaryCount = 6
+    };
+
+    static const int maxBoundaryCount = 6;
+
+    // The id of the window.
+    quint32 window;
+
+    // The frame number, as in QuickenFrameMetrics. The GUI timeline has the
+    // number of the frame synchronized.
+    quint32 number;
+
+    // Id of the thread (as in QuickenThreadMetrics).
+    quint32 thread;
+
+    // Role of the thread (QuickenThreadMetrics::Role), either Gui or Render.
+    quint8 role;
+
+    quint8 __padding[3];
+
+    // Time stamps in nanoseconds of the phase boundaries (GuiBoundary or
+    // RenderBoundary depending on the role), 0 for the ones not reached during
+    // the frame (like the update request of frames triggered by an expose
+    // event).
+    quint64 timeStamps[maxBoundaryCount];
+
+    // The whole struct must take 112 bytes to allow future additions and best
+    // memory alignment, don't forget to update when adding new metrics.
+    quint8 __reserved[/*64 bytes taken,*/ 48 /*bytes free*/];
+};
+Q_STATIC_ASSERT(sizeof(QuickenTimelineMetrics) == 112);
+
+struct QUICKEN_EXPORT QuickenDroppedMetrics
+{
+    static const int maxTypeCount = 16;
+    static const quint32 otherWindows = 0xffffffff;
+
+    // The id of the window the dropped metrics were bound to, 0 for metrics
+    // not bound to a window (like process and generic metrics) and
+    // otherWindows for the metrics of windows not counted separately (only
+    // happens when more windows than the max monitor count dropped metrics).
+    quint32 window;
+
+    // Number of metrics dropped since the last report, indexed by metrics
+    // type (QuickenMetrics::Type).
+    quint32 count[maxTypeCount];
+
+    // The whole struct must take 112 bytes to allow future additions and best
+    // memory alignment, don't forget to update when adding new metrics.
+    quint8 __reserved[/*68 bytes taken,*/ 44 /*bytes free*/];
+};
+Q_STATIC_ASSERT(sizeof(QuickenDroppedMetrics) == 112);
+
 struct QUICKEN_EXPORT QuickenMetrics
 {
-    enum Type { Process = 0, Window = 1, Frame = 2, Generic = 3, TypeCount = 4 };
+    enum Type {
+        Process = 0, Window = 1, Frame = 2, Generic = 3, Dropped = 4, Numeric = 5, Scope = 6,
+        Thread = 7, Memory = 8, PerfCounters = 9, Engine = 10, Pacing = 11,
+        Timeline = 12, TypeCount = 13
+    };
 
     // Metrics type.
     Type type;
@@ -122,9 +524,19 @@ struct QUICKEN_EXPORT QuickenMetrics
         QuickenWindowMetrics window;
         QuickenFrameMetrics frame;
         QuickenGenericMetrics generic;
+        QuickenDroppedMetrics dropped;
+        QuickenNumericMetrics numeric;
+        QuickenScopeMetrics scope;
+        QuickenThreadMetrics thread;
+        QuickenMemoryMetrics memory;
+        QuickenPerfCounterMetrics perfCounters;
+        QuickenEngineMetrics engine;
+        QuickenPacingMetrics pacing;
+        QuickenTimelineMetrics timeline;
     };
 };
 Q_STATIC_ASSERT(sizeof(QuickenMetrics) == 128);
+Q_STATIC_ASSERT(QuickenMetrics::TypeCount <= QuickenDroppedMetrics::maxTypeCount);
 
 class QuickenMetricsUtilsPrivate;
 
@@ -138,10 +550,25 @@ public:
     // Fill the given metrics with updated process metrics.
     void updateProcessMetrics(QuickenMetrics* metrics);
 
+    // Fill the given array with updated thread metrics, one per thread of the
+    // process, and return the number of metrics filled (at most maxCount). CPU
+    // usages are computed from the previous call.
+    int updateThreadMetrics(QuickenMetrics* metrics, int maxCount);
+
+    // Fill the given metrics with updated memory metrics. Much more expensive
+    // than process metrics since the kernel walks all the mappings of the
+    // process and the allocator all its arenas.
+    void updateMemoryMetrics(QuickenMetrics* metrics);
+
     // Get a time stamp in nanoseconds. The timer is started at the first call,
     // returning 0.
     static quint64 timeStamp();
 
+    // Get the CPU time in nanoseconds spent by the process (all its threads)
+    // or by the calling thread, with a nanosecond resolution.
+    static quint64 processCpuTime();
+    static quint64 threadCpuTime();
+
 private:
     QuickenMetricsUtilsPrivate* const d_ptr;
     Q_DECLARE_PRIVATE(QuickenMetricsUtils)
@@ -9,11 +9,10 @@
 
 #include <Quicken/quickenmetrics.h>
 
-#include <sys/times.h>
-
-#include <QtCore/QElapsedTimer>
+#include <sys/resource.h>
 
 #include <Quicken/private/quickenglobal_p.h>
+#include <Quicken/private/quickenprocfile_p.h>
 
 class QUICKEN_PRIVATE_EXPORT QuickenMetricsUtilsPrivate
 {
@@ -23,13 +22,35 @@ public:
 
     void updateCpuUsage(QuickenMetrics* metrics);
     void updateProcStatMetrics(QuickenMetrics* metrics);
-
-    char* m_buffer;
-    QElapsedTimer m_cpuTimer;
-    struct tms m_cpuTimes;
-    clock_t m_cpuTicks;
+    void updateProcIoMetrics(QuickenMetrics* metrics);
+    void updateResourceUsage(QuickenMetrics* metrics);
+    int updateThreadMetrics(QuickenMetrics* metrics, int maxCount);
+    bool updateThreadStatMetrics(QuickenProcFile* statFile, QuickenThreadMetrics* metrics);
+    void updateSmapsRollupMetrics(QuickenMetrics* metrics);
+    void updateHeapMetrics(QuickenMetrics* metrics);
+
+    static const int maxThreadCount = 256;
+
+    // Kept open to be read with a single pread() at each process update.
+    QuickenProcFile m_statFile;
+    QuickenProcFile m_ioFile;
+    QuickenProcFile m_smapsRollupFile;
+    quint64 m_cpuTime;
+    quint64 m_cpuTimeStamp;
     quint16 m_cpuOnlineCores;
-    quint16 m_pageSize;
+    quint32 m_pageSize;
+    quint32 m_pid;
+    quint32 m_clockTickDuration;
+    // Resource usage of the process at the previous process metrics update.
+    struct rusage m_resourceUsage;
+    // Time stamp, ids, CPU times (user + system) and stat files of the threads
+    // at the previous thread metrics update. Stat files are kept open while
+    // their thread is alive.
+    quint64 m_threadTimeStamp;
+    int m_threadCount;
+    quint32 m_threadIds[maxThreadCount];
+    quint64 m_threadCpuTimes[maxThreadCount];
+    QuickenProcFile* m_threadStatFiles[maxThreadCount];
 };
 
 #endif  // METRICS_P_H
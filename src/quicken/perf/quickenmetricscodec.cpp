@@ -0,0 +1,242 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#include "quickenmetricscodec_p.h"
+
+#include <stddef.h>
+
+// Index of the first frame timing word (deltaTime) and number of timing words
+// (delta, sync, render, GPU and swap times).
+const int frameTimingWord = 1;
+const int frameTimingWordCount = 5;
+
+Q_STATIC_ASSERT(sizeof(QuickenFrameMetrics) == 14 * sizeof(quint64));
+Q_STATIC_ASSERT(offsetof(QuickenFrameMetrics, deltaTime) == frameTimingWord * sizeof(quint64));
+Q_STATIC_ASSERT(offsetof(QuickenFrameMetrics, swapTime)
+                == (frameTimingWord + frameTimingWordCount - 1) * sizeof(quint64));
+
+static inline int putVarint(quint64 value, char* buffer)
+{
+    int size = 0;
+    while (value >= 0x80) {
+        buffer[size++] = static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    buffer[size++] = static_cast<char>(value);
+    return size;
+}
+
+// Returns the number of bytes read, 0 if the varint is truncated or too long.
+static inline int getVarint(const char* buffer, int size, quint64* value)
+{
+    quint64 result = 0;
+    for (int i = 0; i < size && i < 10; ++i) {
+        const quint8 byte = static_cast<quint8>(buffer[i]);
+        result |= static_cast<quint64>(byte & 0x7f) << (7 * i);
+        if (!(byte & 0x80)) {
+            *value = result;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static inline quint64 zigzag(quint64 difference)
+{
+    const qint64 signedDifference = static_cast<qint64>(difference);
+    return (difference << 1) ^ static_cast<quint64>(signedDifference >> 63);
+}
+
+static inline quint64 unzigzag(quint64 value)
+{
+    return (value >> 1) ^ (~(value & 1) + 1);
+}
+
+static inline quint64* metricsWords(QuickenMetrics* metrics)
+{
+    return reinterpret_cast<quint64*>(&metrics->process);
+}
+
+static inline const quint64* metricsWords(const QuickenMetrics& metrics)
+{
+    return reinterpret_cast<const quint64*>(&metrics.process);
+}
+
+QuickenMetricsCodec::QuickenMetricsCodec(quint32 timeResolution)
+    : m_timeResolution(qMax(timeResolution, 1u))
+{
+    reset();
+}
+
+void QuickenMetricsCodec::reset()
+{
+    m_frameStates.clear();
+    memset(m_words, 0, sizeof(m_words));
+    m_timeStamp = 0;
+}
+
+QuickenMetricsCodec::FrameState* QuickenMetricsCodec::frameState(quint32 window)
+{
+    QHash<quint32, FrameState>::iterator it = m_frameStates.find(window);
+    if (it == m_frameStates.end()) {
+        FrameState state;
+        memset(&state, 0, sizeof(state));
+        state.timeStamp = m_timeStamp;
+        it = m_frameStates.insert(window, state);
+    }
+    return &it.value();
+}
+
+void QuickenMetricsCodec::quantize(QuickenMetrics* metrics)
+{
+    if (m_timeResolution > 1) {
+        const quint64 halfResolution = m_timeResolution / 2;
+        metrics->timeStamp = (metrics->timeStamp + halfResolution) / m_timeResolution;
+        if (metrics->type == QuickenMetrics::Frame) {
+            quint64* words = metricsWords(metrics);
+            for (int i = frameTimingWord; i < frameTimingWord + frameTimingWordCount; ++i) {
+                words[i] = (words[i] + halfResolution) / m_timeResolution;
+            }
+        }
+    }
+}
+
+void QuickenMetricsCodec::dequantize(QuickenMetrics* metrics)
+{
+    if (m_timeResolution > 1) {
+        metrics->timeStamp *= m_timeResolution;
+        if (metrics->type == QuickenMetrics::Frame) {
+            quint64* words = metricsWords(metrics);
+            for (int i = frameTimingWord; i < frameTimingWord + frameTimingWordCount; ++i) {
+                words[i] *= m_timeResolution;
+            }
+        }
+    }
+}
+
+int QuickenMetricsCodec::encode(const QuickenMetrics& sourceMetrics, char* buffer)
+{
+    DASSERT(buffer);
+    DASSERT(sourceMetrics.type < QuickenMetrics::TypeCount);
+
+    QuickenMetrics metrics;
+    memcpy(&metrics, &sourceMetrics, sizeof(QuickenMetrics));
+    quantize(&metrics);
+    const quint64* words = metricsWords(metrics);
+
+    int size = 0;
+    buffer[size++] = static_cast<char>(metrics.type);
+
+    quint64* previousWords;
+    int firstWord;
+    if (metrics.type == QuickenMetrics::Frame) {
+        FrameState* state = frameState(metrics.frame.window);
+        size += putVarint(metrics.frame.window, &buffer[size]);
+        const qint32 numberDifference =
+            static_cast<qint32>(metrics.frame.number - (state->number + 1));
+        size += putVarint(zigzag(static_cast<qint64>(numberDifference)), &buffer[size]);
+        size += putVarint(
+            zigzag(metrics.timeStamp - (state->timeStamp + state->timeStampDelta)),
+            &buffer[size]);
+        state->timeStampDelta = metrics.timeStamp - state->timeStamp;
+        state->timeStamp = metrics.timeStamp;
+        state->number = metrics.frame.number;
+        previousWords = state->words;
+        firstWord = 1;  // Window id and frame number are in the first word.
+    } else {
+        size += putVarint(zigzag(metrics.timeStamp - m_timeStamp), &buffer[size]);
+        previousWords = m_words[metrics.type];
+        firstWord = 0;
+    }
+    m_timeStamp = metrics.timeStamp;
+
+    quint32 mask = 0;
+    for (int i = firstWord; i < wordCount; ++i) {
+        if (words[i] != previousWords[i]) {
+            mask |= 1 << (i - firstWord);
+        }
+    }
+    size += putVarint(mask, &buffer[size]);
+    for (int i = firstWord; i < wordCount; ++i) {
+        if (mask & (1 << (i - firstWord))) {
+            size += putVarint(zigzag(words[i] - previousWords[i]), &buffer[size]);
+            previousWords[i] = words[i];
+        }
+    }
+
+    DASSERT(size <= maxEncodedSize);
+    return size;
+}
+
+// Reads a varint from the decode buffer, returns 0 if invalid.
+#define GET_VARINT(value)                                                         \
+    do {                                                                          \
+        const int varintSize = getVarint(&buffer[size], bufferSize - size, &value); \
+        if (varintSize == 0) {                                                    \
+            return 0;                                                             \
+        }                                                                         \
+        size += varintSize;                                                       \
+    } while (0)
+
+int QuickenMetricsCodec::decode(const char* buffer, int bufferSize, QuickenMetrics* metrics)
+{
+    DASSERT(buffer);
+    DASSERT(metrics);
+
+    if (bufferSize < 1) {
+        return 0;
+    }
+    int size = 0;
+    const quint8 type = static_cast<quint8>(buffer[size++]);
+    if (type >= QuickenMetrics::TypeCount) {
+        return 0;
+    }
+    memset(metrics, 0, sizeof(QuickenMetrics));
+    metrics->type = static_cast<QuickenMetrics::Type>(type);
+    quint64* words = metricsWords(metrics);
+
+    quint64 value;
+    quint64* previousWords;
+    int firstWord;
+    if (type == QuickenMetrics::Frame) {
+        GET_VARINT(value);
+        if (value > 0xffffffff) {
+            return 0;
+        }
+        FrameState* state = frameState(static_cast<quint32>(value));
+        metrics->frame.window = static_cast<quint32>(value);
+        GET_VARINT(value);
+        metrics->frame.number = state->number + 1 + static_cast<quint32>(unzigzag(value));
+        GET_VARINT(value);
+        metrics->timeStamp = state->timeStamp + state->timeStampDelta + unzigzag(value);
+        state->timeStampDelta = metrics->timeStamp - state->timeStamp;
+        state->timeStamp = metrics->timeStamp;
+        state->number = metrics->frame.number;
+        previousWords = state->words;
+        firstWord = 1;
+    } else {
+        GET_VARINT(value);
+        metrics->timeStamp = m_timeStamp + unzigzag(value);
+        previousWords = m_words[type];
+        firstWord = 0;
+    }
+    m_timeStamp = metrics->timeStamp;
+
+    quint64 mask;
+    GET_VARINT(mask);
+    if (mask >> (wordCount - firstWord)) {
+        return 0;
+    }
+    for (int i = firstWord; i < wordCount; ++i) {
+        if (mask & (1 << (i - firstWord))) {
+            GET_VARINT(value);
+            previousWords[i] += unzigzag(value);
+        }
+        words[i] = previousWords[i];
+    }
+
+    dequantize(metrics);
+    return size;
+}
@@ -0,0 +1,68 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#ifndef METRICSCODEC_P_H
+#define METRICSCODEC_P_H
+
+#include <QtCore/QHash>
+
+#include <Quicken/quickenmetrics.h>
+#include <Quicken/private/quickenglobal_p.h>
+
+// Compact encoding of metrics used by QuickenCompressedLogger. Metrics are
+// encoded in blocks, the state of the codec is reset at each block start so
+// that blocks can be decoded independently. Each metrics is encoded as a type
+// byte, followed for frame metrics by the window id and the frame number
+// (delta from the previous frame number of that window plus one) and then by
+// the time stamp, as the difference with a prediction. The 64-bit words of the
+// metrics content are then encoded as a varint mask of the words that changed
+// since the previous metrics of the same type (or of the same window for frame
+// metrics) followed by the zigzag varint deltas of these words. Frame metrics
+// time stamps are predicted from the previous frame interval of the window,
+// other time stamps from the previous metrics.
+//
+// An optional time resolution in nanoseconds allows to quantize the time
+// stamps and the frame timings (delta, sync, render, GPU and swap times) for
+// better compression ratios.
+class QUICKEN_PRIVATE_EXPORT QuickenMetricsCodec
+{
+public:
+    // Max size of an encoded metrics.
+    static const int maxEncodedSize = 1 + 5 + 10 + 10 + 3 + 14 * 10;
+
+    QuickenMetricsCodec(quint32 timeResolution = 1);
+
+    // Reset the state, must be called at each block start.
+    void reset();
+
+    // Encode metrics to buffer which must have at least maxEncodedSize bytes
+    // available. Returns the number of bytes written.
+    int encode(const QuickenMetrics& metrics, char* buffer);
+
+    // Decode metrics from buffer of size bytes. Returns the number of bytes
+    // read, 0 if the data is invalid.
+    int decode(const char* buffer, int size, QuickenMetrics* metrics);
+
+private:
+    static const int wordCount = 14;
+
+    struct FrameState {
+        quint64 timeStamp;
+        quint64 timeStampDelta;
+        quint32 number;
+        quint64 words[wordCount];
+    };
+
+    FrameState* frameState(quint32 window);
+    void quantize(QuickenMetrics* metrics);
+    void dequantize(QuickenMetrics* metrics);
+
+    QHash<quint32, FrameState> m_frameStates;
+    quint64 m_words[QuickenMetrics::TypeCount][wordCount];
+    quint64 m_timeStamp;
+    quint32 m_timeResolution;
+};
+
+#endif  // METRICSCODEC_P_H
@@ -6,12 +6,15 @@
 
 #include "quickenoverlay_p.h"
 
+#include <ctype.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/syscall.h>
 
 #include <QtCore/QSysInfo>
 #include <QtGui/QGuiApplication>
 
+#include "quickencounter_p.h"
 #include "quickenglobal_p.h"
 
 static const QPointF position = QPointF(5.0f, 5.0f);
@@ -40,25 +43,49 @@ static const struct {
     quint16 defaultWidth;
     QuickenMetrics::Type type;
 } metricInfo[] = {
-    { "cpuUsage",    sizeof("cpuUsage") - 1,    3, QuickenMetrics::Process },
-    { "threadCount", sizeof("threadCount") - 1, 3, QuickenMetrics::Process },
-    { "vszMemory",   sizeof("vszMemory") - 1,   8, QuickenMetrics::Process },
-    { "rssMemory",   sizeof("rssMemory") - 1,   8, QuickenMetrics::Process },
-    { "windowId",    sizeof("windowId") - 1,    2, QuickenMetrics::Window  },
-    { "windowSize",  sizeof("windowSize") - 1,  9, QuickenMetrics::Window  },
-    { "frameNumber", sizeof("frameNumber") - 1, 7, QuickenMetrics::Frame   },
-    { "deltaTime",   sizeof("deltaTime") - 1,   7, QuickenMetrics::Frame   },
-    { "syncTime",    sizeof("syncTime") - 1,    7, QuickenMetrics::Frame   },
-    { "renderTime",  sizeof("renderTime") - 1,  7, QuickenMetrics::Frame   },
-    { "gpuTime",     sizeof("gpuTime") - 1,     7, QuickenMetrics::Frame   },
-    { "totalTime",   sizeof("totalTime") - 1,   7, QuickenMetrics::Frame   }
+    { "cpuUsage",        sizeof("cpuUsage") - 1,        3, QuickenMetrics::Process },
+    { "threadCount",     sizeof("threadCount") - 1,     3, QuickenMetrics::Process },
+    { "vszMemory",       sizeof("vszMemory") - 1,       8, QuickenMetrics::Process },
+    { "rssMemory",       sizeof("rssMemory") - 1,       8, QuickenMetrics::Process },
+    { "windowId",        sizeof("windowId") - 1,        2, QuickenMetrics::Window  },
+    { "windowSize",      sizeof("windowSize") - 1,      9, QuickenMetrics::Window  },
+    { "frameNumber",     sizeof("frameNumber") - 1,     7, QuickenMetrics::Frame   },
+    { "deltaTime",       sizeof("deltaTime") - 1,       7, QuickenMetrics::Frame   },
+    { "syncTime",        sizeof("syncTime") - 1,        7, QuickenMetrics::Frame   },
+    { "renderTime",      sizeof("renderTime") - 1,      7, QuickenMetrics::Frame   },
+    { "gpuTime",         sizeof("gpuTime") - 1,         7, QuickenMetrics::Frame   },
+    { "totalTime",       sizeof("totalTime") - 1,       7, QuickenMetrics::Frame   },
+    { "cpuTime",         sizeof("cpuTime") - 1,         7, QuickenMetrics::Frame   },
+    { "nodeCount",       sizeof("nodeCount") - 1,       6, QuickenMetrics::Frame   },
+    { "opaqueBatches",   sizeof("opaqueBatches") - 1,   4, QuickenMetrics::Frame   },
+    { "alphaBatches",    sizeof("alphaBatches") - 1,    4, QuickenMetrics::Frame   },
+    { "drawCalls",       sizeof("drawCalls") - 1,       5, QuickenMetrics::Frame   },
+    { "materialChanges", sizeof("materialChanges") - 1, 4, QuickenMetrics::Frame   },
+    { "shaderChanges",   sizeof("shaderChanges") - 1,   4, QuickenMetrics::Frame   },
+    { "uploadSize",      sizeof("uploadSize") - 1,      6, QuickenMetrics::Frame   },
+    { "guiCpuUsage",     sizeof("guiCpuUsage") - 1,     3, QuickenMetrics::Thread  },
+    { "renderCpuUsage",  sizeof("renderCpuUsage") - 1,  3, QuickenMetrics::Thread  },
+    { "pssMemory",       sizeof("pssMemory") - 1,       8, QuickenMetrics::Memory  },
+    { "ussMemory",       sizeof("ussMemory") - 1,       8, QuickenMetrics::Memory  },
+    { "swapMemory",      sizeof("swapMemory") - 1,      8, QuickenMetrics::Memory  },
+    { "heapMemory",      sizeof("heapMemory") - 1,      8, QuickenMetrics::Memory  },
+    { "smoothness",      sizeof("smoothness") - 1,      6, QuickenMetrics::Pacing  },
+    { "droppedVsyncs",   sizeof("droppedVsyncs") - 1,   4, QuickenMetrics::Pacing  },
+    { "refreshRate",     sizeof("refreshRate") - 1,     3, QuickenMetrics::Pacing  }
 };
 enum {
     CpuUsage = 0, ThreadCount, VszMemory, RssMemory, WindowId, WindowSize, FrameNumber, DeltaTime,
-    SyncTime, RenderTime, GpuTime, TotalTime, MetricCount
+    SyncTime, RenderTime, GpuTime, TotalTime, CpuTime, NodeCount, OpaqueBatches, AlphaBatches,
+    DrawCalls, MaterialChanges, ShaderChanges, UploadSize, GuiCpuUsage, RenderCpuUsage, PssMemory,
+    UssMemory, SwapMemory, HeapMemory, Smoothness, DroppedVsyncs, RefreshRate, MetricCount
 };
 Q_STATIC_ASSERT(ARRAY_SIZE(metricInfo) == MetricCount);
 
+// "%counter:name" keywords, the name ends at the first whitespace or '%'.
+static const char* const counterKeyword = "counter:";
+const int counterKeywordSize = sizeof("counter:") - 1;
+const int defaultCounterWidth = 8;
+
 const int maxMetricsWidth = 32;
 const int maxKeywordStringSize = 128;
 const int bufferSize = 128;
@@ -79,15 +106,25 @@ QuickenOverlay::QuickenOverlay(const char* text, int windowId)
 #endif
     , m_text(QString::fromLatin1(text))
     , m_metricsSize{}
+    , m_counterCount(0)
     , m_frameSize(0, 0)
     , m_windowId(windowId)
-    , m_flags(DirtyText | DirtyProcessMetrics)
+    , m_renderThread(0)
+    , m_guiThreadCpuUsage(0)
+    , m_renderThreadCpuUsage(0)
+    , m_hasSceneGraphStatistics(true)
+    , m_flags(DirtyText | DirtyProcessMetrics | DirtyThreadMetrics | DirtyMemoryMetrics
+              | DirtyPacingMetrics)
 {
     DASSERT(text);
 
     m_buffer = alignedAlloc(bufferAlignment, bufferSize);
     memset(&m_processMetrics, 0, sizeof(m_processMetrics));
     m_processMetrics.type = QuickenMetrics::Process;
+    memset(&m_memoryMetrics, 0, sizeof(m_memoryMetrics));
+    m_memoryMetrics.type = QuickenMetrics::Memory;
+    memset(&m_pacingMetrics, 0, sizeof(m_pacingMetrics));
+    m_pacingMetrics.type = QuickenMetrics::Pacing;
 }
 
 QuickenOverlay::~QuickenOverlay()
@@ -139,6 +176,39 @@ void QuickenOverlay::setProcessMetrics(const QuickenMetrics& processMetrics)
     m_flags |= DirtyProcessMetrics;
 }
 
+void QuickenOverlay::setThreadMetrics(const QuickenMetrics* threadMetrics, int count)
+{
+    DASSERT(threadMetrics);
+
+    // The render thread is the GUI thread with the basic render loop.
+    for (int i = 0; i < count; ++i) {
+        DASSERT(threadMetrics[i].type == QuickenMetrics::Thread);
+        if (threadMetrics[i].thread.role == QuickenThreadMetrics::Gui) {
+            m_guiThreadCpuUsage = threadMetrics[i].thread.cpuUsage;
+        }
+        if (threadMetrics[i].thread.thread == m_renderThread) {
+            m_renderThreadCpuUsage = threadMetrics[i].thread.cpuUsage;
+        }
+    }
+    m_flags |= DirtyThreadMetrics;
+}
+
+void QuickenOverlay::setMemoryMetrics(const QuickenMetrics& memoryMetrics)
+{
+    DASSERT(memoryMetrics.type == QuickenMetrics::Memory);
+
+    memcpy(&m_memoryMetrics, &memoryMetrics, sizeof(m_memoryMetrics));
+    m_flags |= DirtyMemoryMetrics;
+}
+
+void QuickenOverlay::setPacingMetrics(const QuickenMetrics& pacingMetrics)
+{
+    DASSERT(pacingMetrics.type == QuickenMetrics::Pacing);
+
+    memcpy(&m_pacingMetrics, &pacingMetrics, sizeof(m_pacingMetrics));
+    m_flags |= DirtyPacingMetrics;
+}
+
 void QuickenOverlay::render(const QuickenMetrics& frameMetrics, const QSize& frameSize)
 {
     DASSERT(m_flags & Initialized);
@@ -159,7 +229,23 @@ void QuickenOverlay::render(const QuickenMetrics& frameMetrics, const QSize& fra
         updateProcessMetrics();
         m_flags &= ~DirtyProcessMetrics;
     }
+    if (m_flags & DirtyThreadMetrics) {
+        if (m_renderThread == 0) {
+            m_renderThread = syscall(SYS_gettid);
+        }
+        updateThreadMetrics();
+        m_flags &= ~DirtyThreadMetrics;
+    }
+    if (m_flags & DirtyMemoryMetrics) {
+        updateMemoryMetrics();
+        m_flags &= ~DirtyMemoryMetrics;
+    }
+    if (m_flags & DirtyPacingMetrics) {
+        updatePacingMetrics();
+        m_flags &= ~DirtyPacingMetrics;
+    }
     updateFrameMetrics(frameMetrics);
+    updateCounters();
     m_bitmapText.render();
 }
 
@@ -261,6 +347,35 @@ void QuickenOverlay::updateFrameMetrics(const QuickenMetrics& metrics)
             timeMetricToText(time, text, textWidth);
             break;
         }
+        case CpuTime:
+            // The CPU time is measured up to the swap, it's the one of the
+            // previous frame.
+            timeMetricToText(metrics.frame.cpuTime, text, textWidth);
+            break;
+        case NodeCount:
+            integerMetricToText(metrics.frame.nodeCount, text, textWidth);
+            break;
+        case OpaqueBatches:
+            integerMetricToText(metrics.frame.opaqueBatchCount, text, textWidth);
+            break;
+        case AlphaBatches:
+            integerMetricToText(metrics.frame.alphaBatchCount, text, textWidth);
+            break;
+        case DrawCalls:
+            integerMetricToText(metrics.frame.drawCallCount, text, textWidth);
+            break;
+        case MaterialChanges:
+            integerMetricToText(metrics.frame.materialChangeCount, text, textWidth);
+            break;
+        case ShaderChanges:
+            integerMetricToText(metrics.frame.shaderChangeCount, text, textWidth);
+            break;
+        case UploadSize:
+            // In kB.
+            integerMetricToText(
+                (static_cast<quint64>(metrics.frame.vertexUploadSize)
+                 + metrics.frame.indexUploadSize) >> 10, text, textWidth);
+            break;
         default:
             DNOT_REACHED();
             break;
@@ -343,6 +458,139 @@ void QuickenOverlay::updateProcessMetrics()
     }
 }
 
+void QuickenOverlay::updateThreadMetrics()
+{
+    DASSERT(m_flags & Initialized);
+    Q_STATIC_ASSERT(IS_POWER_OF_TWO(maxMetricsWidth));
+
+    char* text = static_cast<char*>(m_buffer);
+    for (int i = 0; i < m_metricsSize[QuickenMetrics::Thread]; i++) {
+        int textWidth = m_metrics[QuickenMetrics::Thread][i].width;
+        DASSERT(textWidth <= maxMetricsWidth);
+        memset(text, ' ', maxMetricsWidth);
+
+        switch (m_metrics[QuickenMetrics::Thread][i].index) {
+        case GuiCpuUsage:
+            integerMetricToText(m_guiThreadCpuUsage, text, textWidth);
+            break;
+        case RenderCpuUsage:
+            integerMetricToText(m_renderThreadCpuUsage, text, textWidth);
+            break;
+        default:
+            DNOT_REACHED();
+            break;
+        }
+
+        m_bitmapText.updateText(
+            text, m_metrics[QuickenMetrics::Thread][i].textIndex,
+            m_metrics[QuickenMetrics::Thread][i].width);
+    }
+}
+
+void QuickenOverlay::updateMemoryMetrics()
+{
+    DASSERT(m_flags & Initialized);
+    Q_STATIC_ASSERT(IS_POWER_OF_TWO(maxMetricsWidth));
+
+    const QuickenMemoryMetrics& memory = m_memoryMetrics.memory;
+    char* text = static_cast<char*>(m_buffer);
+    for (int i = 0; i < m_metricsSize[QuickenMetrics::Memory]; i++) {
+        int textWidth = m_metrics[QuickenMetrics::Memory][i].width;
+        DASSERT(textWidth <= maxMetricsWidth);
+        memset(text, ' ', maxMetricsWidth);
+
+        switch (m_metrics[QuickenMetrics::Memory][i].index) {
+        case PssMemory:
+            integerMetricToText(memory.pssMemory, text, textWidth);
+            break;
+        case UssMemory:
+            integerMetricToText(
+                memory.privateCleanMemory + memory.privateDirtyMemory, text, textWidth);
+            break;
+        case SwapMemory:
+            integerMetricToText(memory.swapMemory, text, textWidth);
+            break;
+        case HeapMemory:
+            integerMetricToText(memory.heapUsedMemory, text, textWidth);
+            break;
+        default:
+            DNOT_REACHED();
+            break;
+        }
+
+        m_bitmapText.updateText(
+            text, m_metrics[QuickenMetrics::Memory][i].textIndex,
+            m_metrics[QuickenMetrics::Memory][i].width);
+    }
+}
+
+void QuickenOverlay::updatePacingMetrics()
+{
+    DASSERT(m_flags & Initialized);
+    Q_STATIC_ASSERT(IS_POWER_OF_TWO(maxMetricsWidth));
+
+    const QuickenPacingMetrics& pacing = m_pacingMetrics.pacing;
+    char* text = static_cast<char*>(m_buffer);
+    for (int i = 0; i < m_metricsSize[QuickenMetrics::Pacing]; i++) {
+        int textWidth = m_metrics[QuickenMetrics::Pacing][i].width;
+        DASSERT(textWidth <= maxMetricsWidth);
+        memset(text, ' ', maxMetricsWidth);
+
+        switch (m_metrics[QuickenMetrics::Pacing][i].index) {
+        case Smoothness:
+            // Hundredths of a percent, written with 2 decimals like times.
+            timeMetricToText(static_cast<quint64>(pacing.smoothness) * 10000, text, textWidth);
+            break;
+        case DroppedVsyncs:
+            integerMetricToText(pacing.droppedVsyncCount, text, textWidth);
+            break;
+        case RefreshRate:
+            // Rounded to the nearest Hz.
+            integerMetricToText(
+                pacing.vsyncInterval > 0
+                    ? (Q_UINT64_C(1000000000) + pacing.vsyncInterval / 2) / pacing.vsyncInterval
+                    : 0, text, textWidth);
+            break;
+        default:
+            DNOT_REACHED();
+            break;
+        }
+
+        m_bitmapText.updateText(
+            text, m_metrics[QuickenMetrics::Pacing][i].textIndex,
+            m_metrics[QuickenMetrics::Pacing][i].width);
+    }
+}
+
+void QuickenOverlay::updateCounters()
+{
+    DASSERT(m_flags & Initialized);
+    Q_STATIC_ASSERT(IS_POWER_OF_TWO(maxMetricsWidth));
+
+    char* text = static_cast<char*>(m_buffer);
+    for (int i = 0; i < m_counterCount; i++) {
+        if (!m_counters[i].counter) {
+            m_counters[i].counter =
+                QuickenCounterRegistry::find(m_counters[i].name, m_counters[i].nameSize);
+            if (!m_counters[i].counter) {
+                continue;
+            }
+        }
+        int textWidth = m_counters[i].width;
+        DASSERT(textWidth <= maxMetricsWidth);
+        memset(text, ' ', maxMetricsWidth);
+
+        const qint64 value = m_counters[i].counter->value();
+        textWidth = integerMetricToText(
+            value >= 0 ? value : -static_cast<quint64>(value), text, textWidth);
+        if (value < 0 && textWidth > 0) {
+            text[textWidth - 1] = '-';
+        }
+
+        m_bitmapText.updateText(text, m_counters[i].textIndex, m_counters[i].width);
+    }
+}
+
 static int cpuModel(char* buffer, int bufferSize)
 {
     DASSERT(buffer);
@@ -503,6 +751,7 @@ void QuickenOverlay::parseText()
     const int textSize = textLatin1.size();
     char* keywordBuffer = static_cast<char*>(m_buffer);
     int characters = 0;
+    m_hasSceneGraphStatistics = false;
 
     for (int i = 0; i <= textSize; i++) {
         const char character = text[i];
@@ -542,27 +791,58 @@ void QuickenOverlay::parseText()
                     }
                     width = qBound(1, width, maxMetricsWidth);
                 }
-                for (int j = 0; j < MetricCount; j++) {
-                    const int type = metricInfo[j].type;
-                    DASSERT(type >= 0);
-                    DASSERT(type < QuickenMetrics::TypeCount);
-                    if (m_metricsSize[type] < maxMetricsPerType &&
-                        !strncmp(&text[i+1+widthOffset], metricInfo[j].name, metricInfo[j].size)) {
-                        if (width == -1) {
-                            width = metricInfo[j].defaultWidth;
-                        }
-                        if (width < maxParsedTextSize - characters) {
-                            m_metrics[type][m_metricsSize[type]].index = j;
-                            m_metrics[type][m_metricsSize[type]].textIndex = characters;
-                            m_metrics[type][m_metricsSize[type]].width = width;
-                            // Must be initialized since it might contain non
-                            // printable characters and break setText otherwise.
-                            memset(&m_parsedText[characters], '?', width);
-                            characters += width;
-                            i += widthOffset + metricInfo[j].size;
-                            m_metricsSize[type]++;
+                // Search for counters.
+                if (!strncmp(&text[i+1+widthOffset], counterKeyword, counterKeywordSize)) {
+                    const char* const name = &text[i+1+widthOffset+counterKeywordSize];
+                    int nameSize = 0;
+                    while (name[nameSize] != '\0' && name[nameSize] != '%'
+                           && !isspace(name[nameSize])) {
+                        nameSize++;
+                    }
+                    if (width == -1) {
+                        width = defaultCounterWidth;
+                    }
+                    if (m_counterCount < maxCounters && nameSize > 0
+                        && nameSize < maxCounterNameSize
+                        && width < maxParsedTextSize - characters) {
+                        m_counters[m_counterCount].counter = nullptr;
+                        m_counters[m_counterCount].textIndex = characters;
+                        m_counters[m_counterCount].width = width;
+                        m_counters[m_counterCount].nameSize = nameSize;
+                        memcpy(m_counters[m_counterCount].name, name, nameSize);
+                        m_counters[m_counterCount].name[nameSize] = '\0';
+                        memset(&m_parsedText[characters], '?', width);
+                        characters += width;
+                        i += widthOffset + counterKeywordSize + nameSize;
+                        m_counterCount++;
+                    }
+                } else {
+                    for (int j = 0; j < MetricCount; j++) {
+                        const int type = metricInfo[j].type;
+                        DASSERT(type >= 0);
+                        DASSERT(type < QuickenMetrics::TypeCount);
+                        if (m_metricsSize[type] < maxMetricsPerType &&
+                            !strncmp(&text[i+1+widthOffset], metricInfo[j].name,
+                                     metricInfo[j].size)) {
+                            if (width == -1) {
+                                width = metricInfo[j].defaultWidth;
+                            }
+                            if (width < maxParsedTextSize - characters) {
+                                m_metrics[type][m_metricsSize[type]].index = j;
+                                m_metrics[type][m_metricsSize[type]].textIndex = characters;
+                                m_metrics[type][m_metricsSize[type]].width = width;
+                                // Must be initialized since it might contain non
+                                // printable characters and break setText otherwise.
+                                memset(&m_parsedText[characters], '?', width);
+                                characters += width;
+                                i += widthOffset + metricInfo[j].size;
+                                m_metricsSize[type]++;
+                                if (j >= NodeCount && j <= UploadSize) {
+                                    m_hasSceneGraphStatistics = true;
+                                }
+                            }
+                            break;
                         }
-                        break;
                     }
                 }
             }
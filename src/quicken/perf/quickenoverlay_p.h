@@ -9,6 +9,7 @@
 
 #include <QtCore/QSize>
 
+#include <Quicken/quickencounter.h>
 #include <Quicken/quickenmetrics.h>
 #include <Quicken/private/quickenbitmaptext_p.h>
 #include <Quicken/private/quickenglobal_p.h>
@@ -34,24 +35,47 @@ public:
     // Sets the process metrics.
     void setProcessMetrics(const QuickenMetrics& processMetrics);
 
+    // Sets the thread metrics of all the threads of the process.
+    void setThreadMetrics(const QuickenMetrics* threadMetrics, int count);
+
+    // Sets the memory metrics.
+    void setMemoryMetrics(const QuickenMetrics& memoryMetrics);
+
+    // Sets the frame pacing metrics of the window.
+    void setPacingMetrics(const QuickenMetrics& pacingMetrics);
+
     // Renders the overlay. Must be called in a thread with the same OpenGL
     // context bound than at initialize().
     void render(const QuickenMetrics& frameMetrics, const QSize& frameSize);
 
+    // Whether the text shows scene graph statistics, which must then be set in
+    // the frame metrics passed to render(). True until the text is parsed at
+    // the first rendering. Must be called in the thread rendering.
+    bool hasSceneGraphStatistics() const { return m_hasSceneGraphStatistics; }
+
 private:
     void updateFrameMetrics(const QuickenMetrics& frameMetrics);
     void updateWindowMetrics(quint32 windowId, const QSize& frameSize);
     void updateProcessMetrics();
+    void updateThreadMetrics();
+    void updateMemoryMetrics();
+    void updatePacingMetrics();
+    void updateCounters();
     int keywordString(int index, char* buffer, int bufferSize);
     void parseText();
 
     enum {
         Initialized         = (1 << 0),
         DirtyText           = (1 << 1),
-        DirtyProcessMetrics = (1 << 2)
+        DirtyProcessMetrics = (1 << 2),
+        DirtyThreadMetrics  = (1 << 3),
+        DirtyMemoryMetrics  = (1 << 4),
+        DirtyPacingMetrics  = (1 << 5)
     };
 
     static const int maxMetricsPerType = 16;
+    static const int maxCounters = 16;
+    static const int maxCounterNameSize = 64;
 
     void* m_buffer;
     char* m_parsedText;
@@ -65,11 +89,28 @@ private:
         quint8 width;
     } m_metrics[QuickenMetrics::TypeCount][maxMetricsPerType];
     quint8 m_metricsSize[QuickenMetrics::TypeCount];
+    // Counters are resolved by name at rendering since they can be registered
+    // after the overlay creation.
+    struct {
+        QuickenCounter* counter;
+        quint16 textIndex;
+        quint8 width;
+        quint8 nameSize;
+        char name[maxCounterNameSize];
+    } m_counters[maxCounters];
+    quint8 m_counterCount;
     QuickenBitmapText m_bitmapText;
     QSize m_frameSize;
     quint32 m_windowId;
+    // Thread rendering the overlay, set at first rendering.
+    quint32 m_renderThread;
+    quint16 m_guiThreadCpuUsage;
+    quint16 m_renderThreadCpuUsage;
+    bool m_hasSceneGraphStatistics;
     quint8 m_flags;
     alignas(64) QuickenMetrics m_processMetrics;
+    alignas(64) QuickenMetrics m_memoryMetrics;
+    alignas(64) QuickenMetrics m_pacingMetrics;
 };
 
 #endif  // OVERLAY_P_H
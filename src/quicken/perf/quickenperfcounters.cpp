@@ -0,0 +1,133 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#include "quickenperfcounters_p.h"
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const quint64 hardwareConfigs[QuickenPerfCounters::counterCount] = {
+    PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_CACHE_MISSES
+};
+static const quint64 softwareConfigs[QuickenPerfCounters::counterCount] = {
+    PERF_COUNT_SW_TASK_CLOCK, PERF_COUNT_SW_CONTEXT_SWITCHES, PERF_COUNT_SW_PAGE_FAULTS
+};
+
+static int perfEventOpen(struct perf_event_attr* attr, quint32 thread, int groupFd)
+{
+    return syscall(SYS_perf_event_open, attr, static_cast<pid_t>(thread), -1, groupFd,
+                   PERF_FLAG_FD_CLOEXEC);
+}
+
+QuickenPerfCounters::QuickenPerfCounters()
+    : m_source(QuickenPerfCounterMetrics::Hardware)
+{
+    for (int i = 0; i < counterCount; ++i) {
+        m_fds[i] = -1;
+    }
+}
+
+QuickenPerfCounters::~QuickenPerfCounters()
+{
+    close();
+}
+
+bool QuickenPerfCounters::open(quint32 thread, quint8 source)
+{
+    DASSERT(!isOpen());
+    DASSERT(source < QuickenPerfCounterMetrics::SourceCount);
+
+    m_source = source;
+    const bool hardware = source == QuickenPerfCounterMetrics::Hardware;
+    const quint32 type = hardware ? PERF_TYPE_HARDWARE : PERF_TYPE_SOFTWARE;
+    const quint64* configs = hardware ? hardwareConfigs : softwareConfigs;
+    // Unprivileged processes can only count user space events with a
+    // perf_event_paranoid level of 2 (the default on most systems). The whole
+    // group is opened again so that all the counters cover the same events.
+    if (openGroup(thread, type, configs, false)
+        || ((errno == EACCES || errno == EPERM) && openGroup(thread, type, configs, true))) {
+        return true;
+    } else {
+        // Hardware counters missing is common, not worth a warning.
+        if (!hardware || (errno != ENOENT && errno != EOPNOTSUPP)) {
+            DWARN("PerfCounters: can't open %s perf events (%s)",
+                  hardware ? "hardware" : "software", strerror(errno));
+        }
+        return false;
+    }
+}
+
+bool QuickenPerfCounters::openGroup(
+    quint32 thread, quint32 type, const quint64* configs, bool excludeKernel)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.exclude_kernel = excludeKernel ? 1 : 0;
+    attr.exclude_hv = 1;
+
+    for (int i = 0; i < counterCount; ++i) {
+        attr.config = configs[i];
+        // The leader reads the values of the whole group at once, along with
+        // the times the group was enabled and actually counting.
+        attr.read_format = i == 0
+            ? PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING
+            : 0;
+        m_fds[i] = perfEventOpen(&attr, thread, i == 0 ? -1 : m_fds[0]);
+        if (m_fds[i] == -1) {
+            const int error = errno;
+            close();
+            errno = error;
+            return false;
+        }
+    }
+    return true;
+}
+
+void QuickenPerfCounters::close()
+{
+    // Members are closed before the leader.
+    for (int i = counterCount - 1; i >= 0; --i) {
+        if (m_fds[i] != -1) {
+            ::close(m_fds[i]);
+            m_fds[i] = -1;
+        }
+    }
+}
+
+bool QuickenPerfCounters::read(quint64 values[counterCount])
+{
+    DASSERT(isOpen());
+    DASSERT(values);
+
+    // PERF_FORMAT_GROUP layout, the number of counters, the enabled and running
+    // times and the values.
+    quint64 buffer[3 + counterCount];
+    if (::read(m_fds[0], buffer, sizeof(buffer)) != sizeof(buffer)
+        || buffer[0] != counterCount) {
+        return false;
+    }
+    const quint64 enabledTime = buffer[1];
+    const quint64 runningTime = buffer[2];
+    if (runningTime == enabledTime) {
+        memcpy(values, &buffer[3], counterCount * sizeof(quint64));
+    } else if (runningTime > 0) {
+        // The group is multiplexed with other events when the PMU runs out of
+        // counters (typically on shared machines), the values only cover the
+        // running time and are extrapolated to the enabled time.
+        const double scale = static_cast<double>(enabledTime) / runningTime;
+        for (int i = 0; i < counterCount; ++i) {
+            values[i] = static_cast<quint64>(buffer[3 + i] * scale);
+        }
+    } else {
+        // Enabled but not scheduled yet, no values to extrapolate from.
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,52 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#ifndef PERFCOUNTERS_P_H
+#define PERFCOUNTERS_P_H
+
+#include <Quicken/quickenmetrics.h>
+
+#include <Quicken/private/quickenglobal_p.h>
+
+// Group of perf_event_open() counters of a thread, the counters of a group are
+// scheduled together on the PMU so that their values are consistent. A group
+// has either hardware counters (instructions, CPU cycles and cache misses) or
+// software counters (task clock, context switches and page faults). See
+// QuickenPerfCounterMetrics.
+class QUICKEN_PRIVATE_EXPORT QuickenPerfCounters
+{
+public:
+    static const int counterCount = QuickenPerfCounterMetrics::counterCount;
+
+    QuickenPerfCounters();
+    ~QuickenPerfCounters();
+
+    // Opens the counters of the given source (QuickenPerfCounterMetrics::Source)
+    // for the given thread id, 0 for the calling thread. Returns false if they
+    // can't be opened, hardware counters aren't available in most virtual
+    // machines and perf events might be restricted by
+    // /proc/sys/kernel/perf_event_paranoid.
+    bool open(quint32 thread, quint8 source);
+    void close();
+    bool isOpen() const { return m_fds[0] != -1; }
+
+    // Source of the opened counters (QuickenPerfCounterMetrics::Source).
+    quint8 source() const { return m_source; }
+
+    // Reads the current values of the counters, accumulated since open() and
+    // scaled when the group is multiplexed. Returns false on error or if the
+    // group hasn't been scheduled yet.
+    bool read(quint64 values[counterCount]);
+
+private:
+    Q_DISABLE_COPY(QuickenPerfCounters)
+
+    bool openGroup(quint32 thread, quint32 type, const quint64* configs, bool excludeKernel);
+
+    int m_fds[counterCount];
+    quint8 m_source;
+};
+
+#endif  // PERFCOUNTERS_P_H
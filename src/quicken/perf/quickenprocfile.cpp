@@ -0,0 +1,53 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#include "quickenprocfile_p.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+QuickenProcFile::QuickenProcFile(const char* fileName, int bufferSize)
+    : m_buffer(static_cast<char*>(malloc(bufferSize)))
+    , m_bufferSize(bufferSize)
+    , m_fd(open(fileName, O_RDONLY | O_CLOEXEC))
+{
+    DASSERT(fileName);
+    DASSERT(bufferSize > 0);
+
+    m_buffer[0] = '\0';
+    // Files of exited tasks (like /proc/self/task/<tid>/stat) are expected to
+    // vanish.
+    if (m_fd == -1 && errno != ENOENT) {
+        DWARN("ProcFile: can't open '%s'", fileName);
+    }
+}
+
+QuickenProcFile::~QuickenProcFile()
+{
+    if (m_fd != -1) {
+        close(m_fd);
+    }
+    free(m_buffer);
+}
+
+int QuickenProcFile::read()
+{
+    if (m_fd == -1) {
+        return -1;
+    }
+
+    const int size = pread(m_fd, m_buffer, m_bufferSize - 1, 0);
+    if (size < 0) {
+        if (errno != ESRCH) {
+            DWARN("ProcFile: can't read file");
+        }
+        m_buffer[0] = '\0';
+        return -1;
+    }
+    m_buffer[size] = '\0';
+    return size;
+}
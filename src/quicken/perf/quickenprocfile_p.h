@@ -0,0 +1,149 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#ifndef PROCFILE_P_H
+#define PROCFILE_P_H
+
+#include <string.h>
+
+#include <Quicken/private/quickenglobal_p.h>
+
+// Procfs file kept open between samples. procfs regenerates the content of a
+// file when it's read at offset 0, so each sample is a single pread() instead
+// of an open(), a path lookup, a read() and a close().
+class QUICKEN_PRIVATE_EXPORT QuickenProcFile
+{
+public:
+    // The file is opened at construction, content bigger than bufferSize - 1
+    // is truncated.
+    QuickenProcFile(const char* fileName, int bufferSize);
+    ~QuickenProcFile();
+
+    bool isOpen() const { return m_fd != -1; }
+
+    // Read the current content, null-terminated. Returns its size, or -1 if
+    // the file isn't open or can't be read.
+    int read();
+
+    const char* data() const { return m_buffer; }
+
+private:
+    Q_DISABLE_COPY(QuickenProcFile)
+
+    char* m_buffer;
+    int m_bufferSize;
+    int m_fd;
+};
+
+// Scanner of procfs file content, either space separated fields (like
+// /proc/self/stat) or "key: value" lines (like /proc/self/io). Replaces
+// sscanf() and its format string parsing and locale handling.
+class QuickenProcScanner
+{
+public:
+    QuickenProcScanner(const char* data, int size) : m_p(data), m_end(data + size) {}
+
+    // Skip the given number of space separated fields.
+    bool skipFields(int count) {
+        for (int i = 0; i < count; ++i) {
+            skipSpaces();
+            if (m_p == m_end) {
+                return false;
+            }
+            while (m_p != m_end && *m_p != ' ' && *m_p != '\n') {
+                m_p++;
+            }
+        }
+        return true;
+    }
+
+    // Move past the last occurrence of the given character.
+    bool skipPastLast(char c) {
+        for (const char* p = m_end; p != m_p; --p) {
+            if (p[-1] == c) {
+                m_p = p;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Read the field surrounded by parentheses after optional spaces (like the
+    // name of /proc/self/stat). It can contain spaces and parentheses, so it
+    // ends at the last closing one. The returned field isn't null-terminated.
+    bool readParenthesized(const char** field, int* size) {
+        DASSERT(field);
+        DASSERT(size);
+        skipSpaces();
+        if (m_p == m_end || *m_p != '(') {
+            return false;
+        }
+        const char* const start = m_p + 1;
+        if (!skipPastLast(')') || m_p <= start) {
+            return false;
+        }
+        *field = start;
+        *size = static_cast<int>(m_p - start) - 1;
+        return true;
+    }
+
+    // Read a single character field after optional spaces.
+    bool readCharacter(char* value) {
+        DASSERT(value);
+        skipSpaces();
+        if (m_p == m_end) {
+            return false;
+        }
+        *value = *m_p++;
+        return true;
+    }
+
+    // Read an unsigned decimal integer after optional spaces.
+    bool readInteger(quint64* value) {
+        DASSERT(value);
+        skipSpaces();
+        if (m_p == m_end || *m_p < '0' || *m_p > '9') {
+            return false;
+        }
+        quint64 integer = 0;
+        do {
+            integer = integer * 10 + (*m_p++ - '0');
+        } while (m_p != m_end && *m_p >= '0' && *m_p <= '9');
+        *value = integer;
+        return true;
+    }
+
+    // Move to the line starting with the given key (including the separator,
+    // like "rchar:") and read its integer value. Keys must be searched in file
+    // order.
+    bool readKeyValue(const char* key, int keySize, quint64* value) {
+        DASSERT(key);
+        while (m_end - m_p >= keySize) {
+            if (!memcmp(m_p, key, keySize)) {
+                m_p += keySize;
+                return readInteger(value);
+            }
+            const char* lineEnd = static_cast<const char*>(memchr(m_p, '\n', m_end - m_p));
+            if (!lineEnd) {
+                break;
+            }
+            m_p = lineEnd + 1;
+        }
+        m_p = m_end;
+        return false;
+    }
+
+private:
+    void skipSpaces() {
+        while (m_p != m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\n')) {
+            m_p++;
+        }
+    }
+
+    const char* m_p;
+    const char* const m_end;
+};
+
+#endif  // PROCFILE_P_H
@@ -0,0 +1,226 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#include "quickenscenegraphstatistics_p.h"
+
+#include <string.h>
+
+#include <QtQuick/QSGGeometry>
+#include <QtQuick/QSGMaterial>
+
+// Max number of vertices of a mergeable geometry, same default and environment
+// variable than the batch renderer.
+static int batchVertexThreshold()
+{
+    static const int threshold = qEnvironmentVariableIsSet("QSG_RENDERER_BATCH_VERTEX_THRESHOLD")
+        ? qEnvironmentVariableIntValue("QSG_RENDERER_BATCH_VERTEX_THRESHOLD") : 1024;
+    return threshold;
+}
+
+static bool sameMaterial(QSGMaterial* material, QSGMaterial* otherMaterial)
+{
+    return material == otherMaterial
+        || (material->type() == otherMaterial->type() && material->compare(otherMaterial) == 0);
+}
+
+static quint16 clampedCount(quint32 count)
+{
+    return static_cast<quint16>(qMin(count, static_cast<quint32>(0xffff)));
+}
+
+QuickenSceneGraphStatistics::QuickenSceneGraphStatistics()
+    : m_firstAlphaType(nullptr)
+    , m_alphaType(nullptr)
+    , m_nodeCount(0)
+    , m_opaqueOverflowCount(0)
+    , m_alphaBatchCount(0)
+    , m_drawCallCount(0)
+    , m_shaderChangeCount(0)
+    , m_materialChangeCount(0)
+    , m_vertexUploadSize(0)
+    , m_indexUploadSize(0)
+{
+    memset(&m_alphaBatch, 0, sizeof(m_alphaBatch));
+}
+
+QuickenSceneGraphStatistics::~QuickenSceneGraphStatistics()
+{
+    setRootNode(nullptr);
+}
+
+void QuickenSceneGraphStatistics::update(QSGRootNode* root, QuickenFrameMetrics* frame)
+{
+    DASSERT(frame);
+
+    if (root != rootNode()) {
+        // Attaching notifies the whole tree as added, the changes are only
+        // counted from the next frame.
+        setRootNode(root);
+        m_materialChangeCount = 0;
+        m_vertexUploadSize = 0;
+        m_indexUploadSize = 0;
+    }
+
+    m_opaqueBatches.clear();
+    m_alphaBatch.material = nullptr;
+    m_firstAlphaType = nullptr;
+    m_alphaType = nullptr;
+    m_nodeCount = 0;
+    m_opaqueOverflowCount = 0;
+    m_alphaBatchCount = 0;
+    m_drawCallCount = 0;
+    m_shaderChangeCount = 0;
+    if (root) {
+        visit(root);
+        closeAlphaBatch();
+    }
+
+    // Opaque batches are rendered front-to-back before alpha batches, shader
+    // changes are counted as program switches between consecutive batches.
+    QSGMaterialType* type = nullptr;
+    for (int i = m_opaqueBatches.size() - 1; i >= 0; --i) {
+        const Batch& batch = m_opaqueBatches[i];
+        m_drawCallCount += batch.mergeable ? 1 : batch.nodeCount;
+        if (batch.material->type() != type) {
+            type = batch.material->type();
+            m_shaderChangeCount++;
+        }
+    }
+    if (m_firstAlphaType && m_firstAlphaType != type) {
+        m_shaderChangeCount++;
+    }
+    m_drawCallCount += m_opaqueOverflowCount;
+
+    frame->nodeCount = m_nodeCount;
+    frame->opaqueBatchCount = clampedCount(m_opaqueBatches.size() + m_opaqueOverflowCount);
+    frame->alphaBatchCount = clampedCount(m_alphaBatchCount);
+    frame->drawCallCount = m_drawCallCount;
+    frame->materialChangeCount = clampedCount(m_materialChangeCount);
+    frame->shaderChangeCount = clampedCount(m_shaderChangeCount);
+    frame->vertexUploadSize = qMin(m_vertexUploadSize, Q_UINT64_C(0xffffffff));
+    frame->indexUploadSize = qMin(m_indexUploadSize, Q_UINT64_C(0xffffffff));
+    m_materialChangeCount = 0;
+    m_vertexUploadSize = 0;
+    m_indexUploadSize = 0;
+}
+
+void QuickenSceneGraphStatistics::visit(QSGNode* node)
+{
+    DASSERT(node);
+
+    // Subtrees blocked by a 0 opacity aren't rendered.
+    if (node->isSubtreeBlocked()) {
+        return;
+    }
+    m_nodeCount++;
+
+    if (node->type() == QSGNode::GeometryNodeType) {
+        addGeometryNode(static_cast<QSGGeometryNode*>(node));
+    } else if (node->type() == QSGNode::RenderNodeType) {
+        // Render nodes break alpha batches and can bind any program.
+        closeAlphaBatch();
+        m_alphaBatchCount++;
+        m_drawCallCount++;
+        m_alphaType = nullptr;
+    }
+
+    for (QSGNode* child = node->firstChild(); child; child = child->nextSibling()) {
+        visit(child);
+    }
+}
+
+void QuickenSceneGraphStatistics::addGeometryNode(QSGGeometryNode* node)
+{
+    QSGMaterial* material = node->activeMaterial();
+    const QSGGeometry* geometry = node->geometry();
+    if (!material || !geometry || geometry->vertexCount() == 0) {
+        return;
+    }
+
+    Batch element;
+    element.material = material;
+    element.clipList = node->clipList();
+    element.drawingMode = geometry->drawingMode();
+    element.nodeCount = 1;
+    element.mergeable = !(material->flags() & QSGMaterial::RequiresFullMatrixExceptTranslate)
+        && geometry->vertexCount() <= batchVertexThreshold();
+
+    if (!(material->flags() & QSGMaterial::Blending) && node->inheritedOpacity() > 0.999) {
+        for (int i = 0; i < m_opaqueBatches.size(); ++i) {
+            Batch& batch = m_opaqueBatches[i];
+            if (batch.clipList == element.clipList && batch.drawingMode == element.drawingMode
+                && sameMaterial(batch.material, material)) {
+                batch.nodeCount++;
+                batch.mergeable &= element.mergeable;
+                return;
+            }
+        }
+        if (m_opaqueBatches.size() < maxOpaqueBatches) {
+            m_opaqueBatches.append(element);
+        } else {
+            m_opaqueOverflowCount++;
+        }
+    } else {
+        if (m_alphaBatch.material && m_alphaBatch.clipList == element.clipList
+            && m_alphaBatch.drawingMode == element.drawingMode
+            && sameMaterial(m_alphaBatch.material, material)) {
+            m_alphaBatch.nodeCount++;
+            m_alphaBatch.mergeable &= element.mergeable;
+            return;
+        }
+        closeAlphaBatch();
+        m_alphaBatch = element;
+        m_alphaBatchCount++;
+        if (m_alphaBatchCount == 1) {
+            m_firstAlphaType = material->type();
+        } else if (material->type() != m_alphaType) {
+            m_shaderChangeCount++;
+        }
+        m_alphaType = material->type();
+    }
+}
+
+void QuickenSceneGraphStatistics::closeAlphaBatch()
+{
+    if (m_alphaBatch.material) {
+        m_drawCallCount += m_alphaBatch.mergeable ? 1 : m_alphaBatch.nodeCount;
+        m_alphaBatch.material = nullptr;
+    }
+}
+
+// Adds the geometry sizes of a node (and of its subtree if requested) to the
+// upload sizes.
+void QuickenSceneGraphStatistics::addUploadSize(QSGNode* node, bool subtree)
+{
+    if (node->type() == QSGNode::GeometryNodeType || node->type() == QSGNode::ClipNodeType) {
+        const QSGGeometry* geometry = static_cast<QSGBasicGeometryNode*>(node)->geometry();
+        if (geometry) {
+            m_vertexUploadSize += geometry->vertexCount() * geometry->sizeOfVertex();
+            m_indexUploadSize += geometry->indexCount() * geometry->sizeOfIndex();
+        }
+    }
+    if (subtree) {
+        for (QSGNode* child = node->firstChild(); child; child = child->nextSibling()) {
+            addUploadSize(child, true);
+        }
+    }
+}
+
+void QuickenSceneGraphStatistics::nodeChanged(QSGNode* node, QSGNode::DirtyState state)
+{
+    DASSERT(node);
+
+    // Removed nodes might be deleted right after the notification, they must
+    // not be kept. A node changed several times in a frame is counted each
+    // time.
+    if (state & QSGNode::DirtyNodeAdded) {
+        addUploadSize(node, true);
+    } else if (state & QSGNode::DirtyGeometry) {
+        addUploadSize(node, false);
+    }
+    if (state & QSGNode::DirtyMaterial) {
+        m_materialChangeCount++;
+    }
+}
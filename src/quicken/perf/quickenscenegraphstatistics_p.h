@@ -0,0 +1,83 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#ifndef SCENEGRAPHSTATISTICS_P_H
+#define SCENEGRAPHSTATISTICS_P_H
+
+#include <QtCore/QVarLengthArray>
+#include <QtQuick/QSGAbstractRenderer>
+#include <QtQuick/QSGNode>
+
+#include <Quicken/quickenmetrics.h>
+
+#include <Quicken/private/quickenglobal_p.h>
+
+class QSGClipNode;
+class QSGMaterial;
+class QSGMaterialType;
+
+// Scene graph statistics of a window, gathered on the scene graph thread. The
+// batch renderer doesn't expose its batches, so they are estimated from the
+// node tree with the renderer's main merging rules: opaque geometry nodes
+// sharing a material (same type and compare() returning 0), a clip list and a
+// drawing mode are merged into the same batch wherever they are in the tree,
+// alpha ones only when consecutive in rendering order. Merged batches take a
+// single draw call, unmergeable ones (materials requiring the full matrix or
+// geometries above the batch vertex threshold) one per node.
+//
+// Changes are received like a renderer, by attaching to the window's root node
+// so that node changes are notified, which gives the materials changed and
+// the geometry sizes to upload.
+class QUICKEN_PRIVATE_EXPORT QuickenSceneGraphStatistics : public QSGAbstractRenderer
+{
+public:
+    QuickenSceneGraphStatistics();
+    ~QuickenSceneGraphStatistics();
+
+    // Walks the tree of the given root node, attaching to it first if needed,
+    // and sets the scene graph statistics of the frame metrics. Changes are
+    // the ones notified since the previous call.
+    void update(QSGRootNode* root, QuickenFrameMetrics* frame);
+
+    void renderScene(uint fboId) override { Q_UNUSED(fboId); }
+
+protected:
+    void nodeChanged(QSGNode* node, QSGNode::DirtyState state) override;
+
+private:
+    Q_DISABLE_COPY(QuickenSceneGraphStatistics)
+
+    static const int maxOpaqueBatches = 256;
+
+    struct Batch {
+        QSGMaterial* material;
+        const QSGClipNode* clipList;
+        quint32 drawingMode;
+        quint32 nodeCount;
+        bool mergeable;
+    };
+
+    void visit(QSGNode* node);
+    void addGeometryNode(QSGGeometryNode* node);
+    void closeAlphaBatch();
+    void addUploadSize(QSGNode* node, bool subtree);
+
+    QVarLengthArray<Batch, 64> m_opaqueBatches;
+    Batch m_alphaBatch;
+    // Material type of the first alpha batch and of the last one, a render
+    // node resets it to null.
+    QSGMaterialType* m_firstAlphaType;
+    QSGMaterialType* m_alphaType;
+    quint32 m_nodeCount;
+    quint32 m_opaqueOverflowCount;
+    quint32 m_alphaBatchCount;
+    quint32 m_drawCallCount;
+    quint32 m_shaderChangeCount;
+    quint32 m_materialChangeCount;
+    quint64 m_vertexUploadSize;
+    quint64 m_indexUploadSize;
+};
+
+#endif  // SCENEGRAPHSTATISTICS_P_H
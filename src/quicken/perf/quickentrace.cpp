@@ -0,0 +1,205 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#include "quickentrace_p.h"
+
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "quickenapplicationmonitor_p.h"
+#include "quickenmetrics.h"
+
+QAtomicInteger<quint32> QuickenTrace::generation(0);
+
+QMutex QuickenTracePrivate::mutex;
+LoggingThread* QuickenTracePrivate::currentLoggingThread = nullptr;
+quint32 QuickenTracePrivate::lastGeneration = 0;
+QMutex QuickenTracePrivate::buffersMutex;
+QVector<QuickenTraceBuffer*> QuickenTracePrivate::buffers;
+
+// Constructed at the first use on a thread, the destructor flushes remaining
+// scopes at thread exit.
+static thread_local QuickenTraceBuffer traceBuffer;
+
+// Ring buffer indices are masked.
+Q_STATIC_ASSERT((QuickenTraceBuffer::capacity & (QuickenTraceBuffer::capacity - 1)) == 0);
+
+void QuickenTrace::begin(const char* name)
+{
+    DASSERT(name);
+    traceBuffer.begin(name, generation.load());
+}
+
+void QuickenTrace::end()
+{
+    traceBuffer.end(generation.load());
+}
+
+void QuickenTrace::flush()
+{
+    traceBuffer.flush(true);
+}
+
+void QuickenTracePrivate::setLoggingThread(LoggingThread* loggingThread)
+{
+    QMutexLocker locker(&mutex);
+
+    if (loggingThread != currentLoggingThread) {
+        if (currentLoggingThread) {
+            currentLoggingThread->deref();
+        }
+        if (loggingThread) {
+            currentLoggingThread = loggingThread->ref();
+            // 0 means inactive.
+            if (++lastGeneration == 0) {
+                lastGeneration = 1;
+            }
+            QuickenTrace::generation.store(lastGeneration);
+        } else {
+            currentLoggingThread = nullptr;
+            QuickenTrace::generation.store(0);
+        }
+    }
+}
+
+LoggingThread* QuickenTracePrivate::loggingThread(quint32 generation)
+{
+    QMutexLocker locker(&mutex);
+
+    if (currentLoggingThread && generation == lastGeneration) {
+        return currentLoggingThread->ref();
+    } else {
+        return nullptr;
+    }
+}
+
+void QuickenTracePrivate::flushBuffers()
+{
+    QMutexLocker locker(&buffersMutex);
+
+    for (int i = 0; i < buffers.size(); ++i) {
+        buffers[i]->flush(false);
+    }
+}
+
+void QuickenTracePrivate::addBuffer(QuickenTraceBuffer* buffer)
+{
+    QMutexLocker locker(&buffersMutex);
+    buffers.append(buffer);
+}
+
+void QuickenTracePrivate::removeBuffer(QuickenTraceBuffer* buffer)
+{
+    QMutexLocker locker(&buffersMutex);
+    buffers.removeOne(buffer);
+}
+
+QuickenTraceBuffer::QuickenTraceBuffer()
+    : m_depth(0)
+    , m_generation(0)
+    // Constructed on the thread using it, it can then be flushed by others.
+    , m_thread(syscall(SYS_gettid))
+    , m_head(0)
+    , m_tail(0)
+{
+    QuickenTracePrivate::addBuffer(this);
+}
+
+QuickenTraceBuffer::~QuickenTraceBuffer()
+{
+    QuickenTracePrivate::removeBuffer(this);
+    flush(true);
+}
+
+void QuickenTraceBuffer::begin(const char* name, quint32 generation)
+{
+    if (generation != m_generation) {
+        // Scopes left open by a former activation are discarded, the buffered
+        // ones are discarded at flush.
+        m_generation = generation;
+        m_depth = 0;
+    }
+    if (m_depth < maxDepth) {
+        m_openNames[m_depth] = name;
+        m_openStartTimes[m_depth] = QuickenMetricsUtils::timeStamp();
+    }
+    m_depth++;
+}
+
+void QuickenTraceBuffer::end(quint32 generation)
+{
+    if (m_depth == 0) {
+        return;
+    }
+    m_depth--;
+    if (generation != m_generation || m_depth >= maxDepth) {
+        return;
+    }
+
+    // Flushes always release all the slots, the buffer can't be full here.
+    const quint32 head = m_head.load();
+    DASSERT(head - m_tail.loadAcquire() < static_cast<quint32>(capacity));
+    Scope* scope = &m_scopes[head & (capacity - 1)];
+    scope->name = m_openNames[m_depth];
+    scope->startTime = m_openStartTimes[m_depth];
+    scope->endTime = QuickenMetricsUtils::timeStamp();
+    scope->depth = m_depth;
+    scope->generation = m_generation;
+    m_head.storeRelease(head + 1);
+
+    // The oldest slot is only written by this thread, it can be read even if
+    // a flush releases it in the meantime.
+    const quint32 tail = m_tail.loadAcquire();
+    if (head + 1 - tail == static_cast<quint32>(capacity)
+        || (m_depth == 0 && tail != head + 1
+            && scope->endTime - m_scopes[tail & (capacity - 1)].endTime >= flushDelay)) {
+        flush(true);
+    }
+}
+
+void QuickenTraceBuffer::flush(bool block)
+{
+    QMutexLocker locker(&m_flushMutex);
+
+    const quint32 head = m_head.loadAcquire();
+    quint32 tail = m_tail.load();
+    if (tail == head) {
+        return;
+    }
+
+    LoggingThread* loggingThread = nullptr;
+    quint32 generation = 0;
+    QuickenMetrics metrics;
+    memset(&metrics, 0, sizeof(QuickenMetrics));
+    metrics.type = QuickenMetrics::Scope;
+    metrics.scope.thread = m_thread;
+    for (; tail != head; ++tail) {
+        const Scope& scope = m_scopes[tail & (capacity - 1)];
+        if (scope.generation != generation) {
+            if (loggingThread) {
+                loggingThread->deref();
+            }
+            generation = scope.generation;
+            loggingThread = QuickenTracePrivate::loggingThread(generation);
+        }
+        if (loggingThread) {
+            metrics.timeStamp = scope.endTime;
+            metrics.scope.depth = scope.depth;
+            metrics.scope.startTime = scope.startTime;
+            strncpy(metrics.scope.name, scope.name, QuickenScopeMetrics::maxNameSize - 1);
+            metrics.scope.name[QuickenScopeMetrics::maxNameSize - 1] = '\0';
+            if (block) {
+                loggingThread->push(&metrics);
+            } else {
+                loggingThread->tryPush(&metrics);
+            }
+        }
+    }
+    if (loggingThread) {
+        loggingThread->deref();
+    }
+    m_tail.storeRelease(head);
+}
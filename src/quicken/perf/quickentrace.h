@@ -0,0 +1,89 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QtCore/QAtomicInteger>
+
+#include <Quicken/quickenglobal.h>
+
+// Scoped tracing of application code regions on any thread. Scopes are time
+// stamped with QuickenMetricsUtils::timeStamp(), the time base of all the
+// metrics, so that they can be related to the frame phases measured by the
+// application monitor. Scopes are stored without locking in per-thread
+// buffers and flushed to the logging pipeline as QuickenMetrics::Scope metrics
+// once a buffer is full, once the outermost scope of a thread ends more than
+// 100 ms after the oldest buffered one, at thread exit or at flush() calls.
+// The application monitor also flushes the buffers of all the threads at each
+// process update and when stopped, dropping the scopes instead of blocking
+// when the logging queue is full. Tracing is active only when the application monitor logs with the ScopeMetrics
+// filter set, an inactive scope costs a relaxed atomic load. Defining
+// QUICKEN_NO_TRACE removes the macros entirely.
+//
+// Names aren't copied before flushing, they must be string literals or stay
+// valid until the thread's buffer is flushed. Names longer than
+// QuickenScopeMetrics::maxNameSize - 1 are truncated.
+class QUICKEN_EXPORT QuickenTrace
+{
+public:
+    // Whether scopes are currently recorded.
+    static inline bool isActive() { return generation.load() != 0; }
+
+    // Begin and end a scope on the calling thread. Scopes must be properly
+    // nested, at most 32 scopes can be open at once on a thread (deeper ones
+    // aren't recorded).
+    static void begin(const char* name);
+    static void end();
+
+    // Flush the scopes buffered by the calling thread.
+    static void flush();
+
+private:
+    // Non-zero while tracing is active, incremented at each activation so that
+    // threads can discard scopes left open by a former activation.
+    static QAtomicInteger<quint32> generation;
+
+    friend class QuickenTracePrivate;
+};
+
+// Traces the enclosing C++ scope. The scope is ended even if tracing got
+// deactivated in the meantime.
+class QuickenTraceScope
+{
+public:
+    explicit QuickenTraceScope(const char* name) : m_active(QuickenTrace::isActive()) {
+        if (m_active) {
+            QuickenTrace::begin(name);
+        }
+    }
+    ~QuickenTraceScope() {
+        if (m_active) {
+            QuickenTrace::end();
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(QuickenTraceScope)
+
+    const bool m_active;
+};
+
+#if !defined(QUICKEN_NO_TRACE)
+#define QUICKEN_TRACE_CONCAT_(a, b) a ## b
+#define QUICKEN_TRACE_CONCAT(a, b) QUICKEN_TRACE_CONCAT_(a, b)
+#define QUICKEN_TRACE_SCOPE(name) \
+    QuickenTraceScope QUICKEN_TRACE_CONCAT(quickenTraceScope, __LINE__)(name)
+#define QUICKEN_TRACE_BEGIN(name) \
+    do { if (QuickenTrace::isActive()) QuickenTrace::begin(name); } while (0)
+#define QUICKEN_TRACE_END() \
+    do { if (QuickenTrace::isActive()) QuickenTrace::end(); } while (0)
+#else
+#define QUICKEN_TRACE_SCOPE(name) do {} while (0)
+#define QUICKEN_TRACE_BEGIN(name) do {} while (0)
+#define QUICKEN_TRACE_END() do {} while (0)
+#endif
+
+#endif  // TRACE_H
@@ -0,0 +1,97 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#ifndef TRACE_P_H
+#define TRACE_P_H
+
+#include <Quicken/quickentrace.h>
+
+#include <QtCore/QAtomicInteger>
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+
+#include <Quicken/private/quickenglobal_p.h>
+
+class LoggingThread;
+struct QuickenTraceBuffer;
+
+class QUICKEN_PRIVATE_EXPORT QuickenTracePrivate
+{
+public:
+    // Set the logging thread scopes are flushed to and activate tracing, or
+    // deactivate it when null. Called by the application monitor.
+    static void setLoggingThread(LoggingThread* loggingThread);
+
+    // Get a reference to the current logging thread, null if tracing is
+    // inactive or has been reactivated since the given generation. The caller
+    // must deref() it.
+    static LoggingThread* loggingThread(quint32 generation);
+
+    // Flush the scopes buffered by all the threads. Called by the application
+    // monitor at each process update and before deactivating tracing, so that
+    // the scopes of threads tracing sporadically aren't kept or lost. Never
+    // blocks on a full logging queue, the scopes are dropped instead.
+    static void flushBuffers();
+
+    // Register or unregister the buffer of a thread.
+    static void addBuffer(QuickenTraceBuffer* buffer);
+    static void removeBuffer(QuickenTraceBuffer* buffer);
+
+private:
+    static QMutex mutex;
+    static LoggingThread* currentLoggingThread;
+    static quint32 lastGeneration;
+    // Locked before the buffers, which lock the mutex above when flushing.
+    static QMutex buffersMutex;
+    static QVector<QuickenTraceBuffer*> buffers;
+};
+
+// Scopes recorded by a thread, flushed when full, at an outermost scope end
+// after flushDelay, by the application monitor and at thread exit. The scopes
+// are stored in a single-producer single-consumer ring buffer, the recording
+// thread appends them without locking and publishes the head index, flushes
+// read up to it and release the slots by publishing the tail index. Flushes
+// can happen on any thread, they're serialized by a mutex the recording thread
+// only takes when it flushes itself.
+struct QuickenTraceBuffer
+{
+    static const int capacity = 256;
+    static const int maxDepth = 32;
+    // Time in nanoseconds after which an outermost scope end triggers a flush.
+    static const quint64 flushDelay = 100000000;
+
+    struct Scope {
+        const char* name;
+        quint64 startTime;
+        quint64 endTime;
+        quint32 depth;
+        // Scopes of a former activation are discarded at flush.
+        quint32 generation;
+    };
+
+    QuickenTraceBuffer();
+    ~QuickenTraceBuffer();
+
+    void begin(const char* name, quint32 generation);
+    void end(quint32 generation);
+    // Push the buffered scopes to the logging thread. When block is false, the
+    // scopes are dropped if the logging queue is full whatever the overflow
+    // policy.
+    void flush(bool block);
+
+    Scope m_scopes[capacity];
+    const char* m_openNames[maxDepth];
+    quint64 m_openStartTimes[maxDepth];
+    int m_depth;
+    quint32 m_generation;
+    quint32 m_thread;
+    QMutex m_flushMutex;
+    // Written by the recording thread and the flushing threads respectively,
+    // kept on their own cache lines.
+    alignas(64) QAtomicInteger<quint32> m_head;
+    alignas(64) QAtomicInteger<quint32> m_tail;
+};
+
+#endif  // TRACE_P_H
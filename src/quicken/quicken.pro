@@ -1,5 +1,5 @@
 TARGET = Quicken
-QT = core-private quick-private
+QT = core-private qml-private quick-private
 
 contains(QT_CONFIG, opengles2) {
     CONFIG += egl
@@ -0,0 +1,173 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#include <math.h>
+
+#include <algorithm>
+
+#include <QtCore/QVector>
+#include <QtTest/QtTest>
+
+#include <Quicken/private/quickenhistogram_p.h>
+
+// Pseudo-random values spread over several orders of magnitude, like frame
+// timings in nanoseconds with a long tail.
+static QVector<quint64> generateValues(int count, quint64 scale)
+{
+    QVector<quint64> values(count);
+    quint32 seed = 1;
+    for (int i = 0; i < count; ++i) {
+        seed = seed * 1103515245 + 12345;
+        const double random = (seed >> 8) / static_cast<double>(1 << 24);
+        values[i] = static_cast<quint64>(scale * exp(6.0 * random * random));
+    }
+    return values;
+}
+
+// Nearest-rank percentiles of sorted values.
+static quint64 exactPercentile(const QVector<quint64>& sortedValues, double percentile)
+{
+    const int rank = qMax(1, static_cast<int>(ceil(percentile / 100.0 * sortedValues.size())));
+    return sortedValues[rank - 1];
+}
+
+class tst_Histogram : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void empty();
+    void buckets();
+    void exactValues();
+    void accuracy_data();
+    void accuracy();
+    void add();
+    void clamping();
+};
+
+void tst_Histogram::empty()
+{
+    QuickenHistogram histogram;
+    const double percentiles[] = { 0.0, 50.0, 100.0 };
+    quint64 values[3] = { 1, 1, 1 };
+    histogram.percentiles(percentiles, values, 3);
+    QCOMPARE(values[0], Q_UINT64_C(0));
+    QCOMPARE(values[2], Q_UINT64_C(0));
+    QCOMPARE(histogram.count(), Q_UINT64_C(0));
+    QCOMPARE(histogram.min(), Q_UINT64_C(0));
+    QCOMPARE(histogram.mean(), Q_UINT64_C(0));
+}
+
+// Buckets are contiguous, in ascending order, and within 1/128 of the values
+// they hold.
+void tst_Histogram::buckets()
+{
+    quint64 lowestValue = 0;
+    for (int i = 0; i < QuickenHistogram::bucketCount; ++i) {
+        const quint64 highestValue = QuickenHistogram::highestEquivalentValue(i);
+        QVERIFY(highestValue >= lowestValue);
+        QCOMPARE(QuickenHistogram::index(lowestValue), i);
+        QCOMPARE(QuickenHistogram::index(highestValue), i);
+        QVERIFY(highestValue - lowestValue <= lowestValue / 128);
+        lowestValue = highestValue + 1;
+    }
+    QCOMPARE(lowestValue - 1, quint64(QuickenHistogram::maxValue));
+}
+
+// Values below 256 are stored exactly.
+void tst_Histogram::exactValues()
+{
+    QuickenHistogram histogram;
+    for (quint64 i = 1; i <= 200; ++i) {
+        histogram.record(i);
+    }
+    const double percentiles[] = { 0.0, 1.0, 50.0, 99.0, 100.0 };
+    quint64 values[5];
+    histogram.percentiles(percentiles, values, 5);
+    QCOMPARE(values[0], Q_UINT64_C(1));
+    QCOMPARE(values[1], Q_UINT64_C(2));
+    QCOMPARE(values[2], Q_UINT64_C(100));
+    QCOMPARE(values[3], Q_UINT64_C(198));
+    QCOMPARE(values[4], Q_UINT64_C(200));
+    QCOMPARE(histogram.mean(), Q_UINT64_C(100));
+}
+
+void tst_Histogram::accuracy_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<quint64>("scale");
+
+    QTest::newRow("small") << 10 << Q_UINT64_C(1000000);
+    QTest::newRow("frames") << 10000 << Q_UINT64_C(16000000);
+    QTest::newRow("large") << 200000 << Q_UINT64_C(1000);
+}
+
+// Percentiles are the highest value equivalent to the bucket of the exact
+// nearest-rank percentile, so they're never below and within 0.8% above.
+void tst_Histogram::accuracy()
+{
+    QFETCH(int, count);
+    QFETCH(quint64, scale);
+
+    QVector<quint64> values = generateValues(count, scale);
+    QuickenHistogram histogram;
+    quint64 sum = 0;
+    for (int i = 0; i < values.size(); ++i) {
+        histogram.record(values[i]);
+        sum += values[i];
+    }
+    std::sort(values.begin(), values.end());
+    QCOMPARE(histogram.count(), static_cast<quint64>(count));
+    QCOMPARE(histogram.min(), values.first());
+    QCOMPARE(histogram.max(), values.last());
+    QCOMPARE(histogram.mean(), sum / count);
+
+    const double percentiles[] = { 0.0, 1.0, 25.0, 50.0, 90.0, 95.0, 99.0, 99.9, 100.0 };
+    const int percentileCount = sizeof(percentiles) / sizeof(percentiles[0]);
+    quint64 results[percentileCount];
+    histogram.percentiles(percentiles, results, percentileCount);
+    for (int i = 0; i < percentileCount; ++i) {
+        const quint64 exact = exactPercentile(values, percentiles[i]);
+        QVERIFY2(results[i] >= exact && results[i] - exact <= exact / 128,
+                 qPrintable(QStringLiteral("p%1: %2 (exact %3)")
+                            .arg(percentiles[i]).arg(results[i]).arg(exact)));
+    }
+    QCOMPARE(results[percentileCount - 1], values.last());
+}
+
+// Adding histograms gives the histogram of all the values.
+void tst_Histogram::add()
+{
+    const QVector<quint64> values = generateValues(5000, 1000000);
+    QuickenHistogram histogram;
+    QuickenHistogram halves[2];
+    for (int i = 0; i < values.size(); ++i) {
+        histogram.record(values[i]);
+        halves[i & 1].record(values[i]);
+    }
+    halves[0].add(halves[1]);
+    QCOMPARE(halves[0].count(), histogram.count());
+    QCOMPARE(halves[0].min(), histogram.min());
+    QCOMPARE(halves[0].max(), histogram.max());
+    QCOMPARE(halves[0].mean(), histogram.mean());
+    for (int i = 0; i < QuickenHistogram::bucketCount; ++i) {
+        QCOMPARE(halves[0].count(i), histogram.count(i));
+    }
+}
+
+void tst_Histogram::clamping()
+{
+    QuickenHistogram histogram;
+    histogram.record(Q_UINT64_C(1) << 40);
+    QCOMPARE(histogram.max(), quint64(QuickenHistogram::maxValue));
+    const double percentile = 100.0;
+    quint64 value;
+    histogram.percentiles(&percentile, &value, 1);
+    QCOMPARE(value, quint64(QuickenHistogram::maxValue));
+}
+
+QTEST_APPLESS_MAIN(tst_Histogram)
+
+#include "tst_histogram.moc"
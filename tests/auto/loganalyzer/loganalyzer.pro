@@ -0,0 +1,9 @@
+TEMPLATE = app
+TARGET = tst_loganalyzer
+QT = core testlib
+
+CONFIG += testcase c++11
+SOURCES += tst_loganalyzer.cpp
+DEFINES += QUICKEN_LOG_ANALYZER=\\\"$${OUT_PWD}/../../../bin/quicken-log-analyzer\\\"
+INCLUDEPATH += $${OUT_PWD}/../../../include $${OUT_PWD}/../../../include/Quicken/$${MODULE_VERSION}
+LIBS += -L$${OUT_PWD}/../../../lib -lQuicken
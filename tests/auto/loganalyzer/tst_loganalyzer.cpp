@@ -0,0 +1,285 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#include <string.h>
+
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QProcess>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QVector>
+#include <QtTest/QtTest>
+
+#include <Quicken/quickenlogger.h>
+#include <Quicken/quickenmetrics.h>
+
+// Runs the analyzer with the given arguments. Returns its exit status, -1 if it
+// didn't run, and sets the JSON report written to stdout.
+static int runAnalyzer(const QStringList& arguments, QJsonObject* report)
+{
+    QProcess process;
+    process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    process.start(QStringLiteral(QUICKEN_LOG_ANALYZER), arguments);
+    if (!process.waitForFinished(120000) || process.exitStatus() != QProcess::NormalExit) {
+        return -1;
+    }
+    *report = QJsonDocument::fromJson(process.readAllStandardOutput()).object();
+    return process.exitCode();
+}
+
+// Writes metrics to a parsable text log.
+static bool writeTextLog(const QString& fileName, const QVector<QuickenMetrics>& metrics)
+{
+    QuickenFileLogger logger(fileName, true);
+    if (!logger.isOpen()) {
+        return false;
+    }
+    logger.setFlushPolicy(QuickenFileLogger::FlushOnShutdown);
+    logger.logBatch(metrics.constData(), metrics.size());
+    return true;
+}
+
+static QuickenMetrics frameMetrics(
+    quint64 timeStamp, quint32 window, quint32 number, quint64 deltaTime)
+{
+    QuickenMetrics metrics;
+    memset(&metrics, 0, sizeof(metrics));
+    metrics.type = QuickenMetrics::Frame;
+    metrics.timeStamp = timeStamp;
+    metrics.frame.window = window;
+    metrics.frame.number = number;
+    metrics.frame.deltaTime = deltaTime;
+    metrics.frame.syncTime = 1000000;
+    metrics.frame.renderTime = 2000000;
+    metrics.frame.swapTime = 3000000;
+    return metrics;
+}
+
+class tst_LogAnalyzer : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void chunkedParsing();
+    void invalidExtensionLine();
+    void compareRegression();
+    void compareIdentical();
+
+private:
+    QString writeDeltaLog(const QString& name, quint64 firstDeltaTime);
+
+    QTemporaryDir m_directory;
+};
+
+void tst_LogAnalyzer::initTestCase()
+{
+    QVERIFY(m_directory.isValid());
+    if (!QFile::exists(QStringLiteral(QUICKEN_LOG_ANALYZER))) {
+        QSKIP("quicken-log-analyzer isn't built.");
+    }
+}
+
+// A log big enough to be split in several chunks gives the same report with one
+// or several jobs, frame and process lines being merged with their extension
+// lines whatever the chunk boundaries.
+void tst_LogAnalyzer::chunkedParsing()
+{
+    const QString fileName = m_directory.path() + QStringLiteral("/chunked.log");
+    const int frameCount = 200000;
+    const int processInterval = 100;
+    QVector<QuickenMetrics> metrics;
+    metrics.reserve(frameCount + frameCount / processInterval);
+    quint64 minorPageFaults[2] = { 0, 0 };
+    quint64 majorPageFaults[2] = { 0, 0 };
+    quint64 timeStamp = 1000000000;
+    for (int i = 0; i < frameCount; ++i) {
+        const quint32 window = 1 + (i & 1);
+        const quint32 number = 1 + i / 2;
+        const quint64 random = i * Q_UINT64_C(1299709);
+        timeStamp += 8333333 + random % 100000;
+        QuickenMetrics frame = frameMetrics(
+            timeStamp, window, number, number > 1 ? 16666667 + random % 5000000 : 0);
+        frame.frame.cpuTime = 4000000 + random % 1000000;
+        frame.frame.minorPageFaults = i % 7;
+        frame.frame.majorPageFaults = i % 1000 == 0 ? 1 : 0;
+        frame.frame.voluntaryContextSwitches = i % 3;
+        frame.frame.nodeCount = 50 + i % 10;
+        minorPageFaults[window - 1] += frame.frame.minorPageFaults;
+        majorPageFaults[window - 1] += frame.frame.majorPageFaults;
+        metrics.append(frame);
+        if (i % processInterval == processInterval - 1) {
+            QuickenMetrics process;
+            memset(&process, 0, sizeof(process));
+            process.type = QuickenMetrics::Process;
+            process.timeStamp = timeStamp;
+            process.process.cpuUsage = i % 100;
+            process.process.vszMemory = 500000;
+            process.process.rssMemory = 100000 + i / 100;
+            process.process.threadCount = 12;
+            process.process.readBytes = 4096 * (i + 1);
+            process.process.writtenBytes = 1024 * (i + 1);
+            metrics.append(process);
+        }
+    }
+    QVERIFY(writeTextLog(fileName, metrics));
+    // Big enough for several chunks of at least 4 MB.
+    QVERIFY(QFileInfo(fileName).size() > 16 * 1024 * 1024);
+
+    QJsonObject reports[2];
+    QCOMPARE(runAnalyzer(QStringList() << QStringLiteral("--jobs") << QStringLiteral("1")
+                         << fileName, &reports[0]), 0);
+    QCOMPARE(runAnalyzer(QStringList() << QStringLiteral("--jobs") << QStringLiteral("8")
+                         << fileName, &reports[1]), 0);
+    for (int i = 0; i < 2; ++i) {
+        const QJsonObject& report = reports[i];
+        QCOMPARE(report.value(QStringLiteral("metricsCount")).toDouble(),
+                 static_cast<double>(metrics.size()));
+        QCOMPARE(report.value(QStringLiteral("invalidLineCount")).toDouble(), 0.0);
+        const QJsonObject process = report.value(QStringLiteral("process")).toObject();
+        QCOMPARE(process.value(QStringLiteral("readBytes")).toObject()
+                 .value(QStringLiteral("count")).toDouble(),
+                 static_cast<double>(frameCount / processInterval));
+        const QJsonArray windows = report.value(QStringLiteral("windows")).toArray();
+        QCOMPARE(windows.size(), 2);
+        for (int j = 0; j < 2; ++j) {
+            const QJsonObject window = windows.at(j).toObject();
+            QCOMPARE(window.value(QStringLiteral("id")).toDouble(), j + 1.0);
+            QCOMPARE(window.value(QStringLiteral("frameCount")).toDouble(), frameCount / 2.0);
+            const QJsonObject pageFaults = window.value(QStringLiteral("pageFaults")).toObject();
+            QCOMPARE(pageFaults.value(QStringLiteral("minor")).toDouble(),
+                     static_cast<double>(minorPageFaults[j]));
+            QCOMPARE(pageFaults.value(QStringLiteral("major")).toDouble(),
+                     static_cast<double>(majorPageFaults[j]));
+            const QJsonObject timings = window.value(QStringLiteral("timings")).toObject();
+            // The first frame has no delta time.
+            QCOMPARE(timings.value(QStringLiteral("delta")).toObject()
+                     .value(QStringLiteral("count")).toDouble(), frameCount / 2.0 - 1.0);
+            QCOMPARE(timings.value(QStringLiteral("cpu")).toObject()
+                     .value(QStringLiteral("count")).toDouble(), frameCount / 2.0);
+        }
+    }
+
+    // Histograms, counts and sums don't depend on the chunks.
+    const QJsonArray windows[2] = {
+        reports[0].value(QStringLiteral("windows")).toArray(),
+        reports[1].value(QStringLiteral("windows")).toArray()
+    };
+    for (int j = 0; j < 2; ++j) {
+        const QJsonObject window[2] = { windows[0].at(j).toObject(), windows[1].at(j).toObject() };
+        QCOMPARE(window[1].value(QStringLiteral("timings")),
+                 window[0].value(QStringLiteral("timings")));
+        QCOMPARE(window[1].value(QStringLiteral("contextSwitches")),
+                 window[0].value(QStringLiteral("contextSwitches")));
+        QCOMPARE(window[1].value(QStringLiteral("jankCount")),
+                 window[0].value(QStringLiteral("jankCount")));
+    }
+}
+
+// An extension line that doesn't match the line it follows is invalid, the
+// frame is still counted.
+void tst_LogAnalyzer::invalidExtensionLine()
+{
+    const QString fileName = m_directory.path() + QStringLiteral("/invalid.log");
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("F 1000000000 1 1 0 1000000 2000000 0 3000000\n"
+               "f 1000000000 1 1 4000000 2 0 0 0 10 1 0 1 0 0 0 0 0 0 0\n"
+               "F 1016666667 1 2 16666667 1000000 2000000 0 3000000\n"
+               "f 1016666667 1 3 4000000 5 0 0 0 10 1 0 1 0 0 0 0 0 0 0\n");
+    file.close();
+
+    QJsonObject report;
+    QCOMPARE(runAnalyzer(QStringList() << fileName, &report), 0);
+    QCOMPARE(report.value(QStringLiteral("metricsCount")).toDouble(), 2.0);
+    QCOMPARE(report.value(QStringLiteral("invalidLineCount")).toDouble(), 1.0);
+    const QJsonObject window =
+        report.value(QStringLiteral("windows")).toArray().at(0).toObject();
+    QCOMPARE(window.value(QStringLiteral("frameCount")).toDouble(), 2.0);
+    QCOMPARE(window.value(QStringLiteral("pageFaults")).toObject()
+             .value(QStringLiteral("minor")).toDouble(), 2.0);
+}
+
+// Writes a log of 6 frames, the first one has no delta time and the others
+// have delta times increasing by 1 ms from firstDeltaTime.
+QString tst_LogAnalyzer::writeDeltaLog(const QString& name, quint64 firstDeltaTime)
+{
+    const QString fileName = m_directory.path() + QLatin1Char('/') + name;
+    QVector<QuickenMetrics> metrics;
+    quint64 timeStamp = 1000000000;
+    metrics.append(frameMetrics(timeStamp, 1, 1, 0));
+    for (int i = 0; i < 5; ++i) {
+        const quint64 deltaTime = firstDeltaTime + i * Q_UINT64_C(1000000);
+        timeStamp += deltaTime;
+        metrics.append(frameMetrics(timeStamp, 1, i + 2, deltaTime));
+    }
+    return writeTextLog(fileName, metrics) ? fileName : QString();
+}
+
+// Delta times of 6 to 10 ms against 1 to 5 ms: all the 25 pairs are greater,
+// U = 25 and the normal approximation with continuity correction gives
+// z = 12 / sqrt(25 * 11 / 12) = 2.5067 and a two-sided p-value of 0.012186.
+// It's not significant at the default 0.01 level but the p99 confidence
+// intervals don't overlap, the tail regression fails the candidate.
+void tst_LogAnalyzer::compareRegression()
+{
+    const QString baseline = writeDeltaLog(QStringLiteral("baseline.log"), 1000000);
+    const QString candidate = writeDeltaLog(QStringLiteral("candidate.log"), 6000000);
+    QVERIFY(!baseline.isEmpty() && !candidate.isEmpty());
+
+    QJsonObject report;
+    QCOMPARE(runAnalyzer(QStringList() << QStringLiteral("--compare") << QStringLiteral("--field")
+                         << QStringLiteral("delta") << baseline << candidate, &report), 2);
+    QCOMPARE(report.value(QStringLiteral("verdict")).toString(), QStringLiteral("fail"));
+    // Zero delta times aren't recorded.
+    QCOMPARE(report.value(QStringLiteral("baseline")).toObject()
+             .value(QStringLiteral("timings")).toObject()
+             .value(QStringLiteral("count")).toDouble(), 5.0);
+    const QJsonArray candidates = report.value(QStringLiteral("candidates")).toArray();
+    QCOMPARE(candidates.size(), 1);
+    const QJsonObject comparison = candidates.at(0).toObject();
+    QCOMPARE(comparison.value(QStringLiteral("mannWhitneyU")).toDouble(), 25.0);
+    QVERIFY(qAbs(comparison.value(QStringLiteral("z")).toDouble() - 2.5067) < 1e-4);
+    QVERIFY(qAbs(comparison.value(QStringLiteral("pValue")).toDouble() - 0.012186) < 1e-6);
+    QCOMPARE(comparison.value(QStringLiteral("medianRegression")).toBool(), false);
+    QCOMPARE(comparison.value(QStringLiteral("tailRegression")).toBool(), true);
+    QCOMPARE(comparison.value(QStringLiteral("verdict")).toString(), QStringLiteral("fail"));
+
+    // Significant at the 0.05 level.
+    QCOMPARE(runAnalyzer(QStringList() << QStringLiteral("--compare") << QStringLiteral("--field")
+                         << QStringLiteral("delta") << QStringLiteral("--alpha")
+                         << QStringLiteral("0.05") << baseline << candidate, &report), 2);
+    QCOMPARE(report.value(QStringLiteral("candidates")).toArray().at(0).toObject()
+             .value(QStringLiteral("medianRegression")).toBool(), true);
+
+    // The baseline isn't slower than the candidate.
+    QCOMPARE(runAnalyzer(QStringList() << QStringLiteral("--compare") << QStringLiteral("--field")
+                         << QStringLiteral("delta") << candidate << baseline, &report), 0);
+    QCOMPARE(report.value(QStringLiteral("verdict")).toString(), QStringLiteral("pass"));
+}
+
+void tst_LogAnalyzer::compareIdentical()
+{
+    const QString baseline = writeDeltaLog(QStringLiteral("identical1.log"), 1000000);
+    const QString candidate = writeDeltaLog(QStringLiteral("identical2.log"), 1000000);
+    QVERIFY(!baseline.isEmpty() && !candidate.isEmpty());
+
+    QJsonObject report;
+    QCOMPARE(runAnalyzer(QStringList() << QStringLiteral("--compare") << QStringLiteral("--field")
+                         << QStringLiteral("delta") << baseline << candidate, &report), 0);
+    QCOMPARE(report.value(QStringLiteral("verdict")).toString(), QStringLiteral("pass"));
+    const QJsonObject comparison =
+        report.value(QStringLiteral("candidates")).toArray().at(0).toObject();
+    QCOMPARE(comparison.value(QStringLiteral("mannWhitneyU")).toDouble(), 12.5);
+    QCOMPARE(comparison.value(QStringLiteral("pValue")).toDouble(), 1.0);
+    QCOMPARE(comparison.value(QStringLiteral("medianChange")).toDouble(), 0.0);
+}
+
+QTEST_GUILESS_MAIN(tst_LogAnalyzer)
+
+#include "tst_loganalyzer.moc"
@@ -0,0 +1,8 @@
+TEMPLATE = app
+TARGET = tst_logreader
+QT = core testlib
+
+CONFIG += testcase c++11
+SOURCES += tst_logreader.cpp
+INCLUDEPATH += $${OUT_PWD}/../../../include $${OUT_PWD}/../../../include/Quicken/$${MODULE_VERSION}
+LIBS += -L$${OUT_PWD}/../../../lib -lQuicken
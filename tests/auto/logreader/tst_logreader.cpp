@@ -0,0 +1,254 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#include <string.h>
+
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QVector>
+#include <QtTest/QtTest>
+
+#include <Quicken/quickenlogger.h>
+#include <Quicken/quickenlogreader.h>
+#include <Quicken/quickenmetrics.h>
+#include <Quicken/private/quickenlogger_p.h>
+
+// Frame metrics numbered from 1 to count.
+static QVector<QuickenMetrics> generateMetrics(int count)
+{
+    QVector<QuickenMetrics> metrics(count);
+    for (int i = 0; i < count; ++i) {
+        QuickenMetrics* m = &metrics[i];
+        memset(m, 0, sizeof(QuickenMetrics));
+        m->type = QuickenMetrics::Frame;
+        const quint64 random = i * Q_UINT64_C(1299709);
+        m->timeStamp = 1000000000 + i * Q_UINT64_C(16666667) + random % 100000;
+        m->frame.window = 1;
+        m->frame.number = i + 1;
+        m->frame.deltaTime = 16666667 + random % 100000;
+        m->frame.renderTime = 4000000 + random % 1000000;
+        m->frame.swapTime = 10000000 + random % 3000000;
+    }
+    return metrics;
+}
+
+// Reads the log until its end, returns the number of metrics read or -1.
+static int readAll(QuickenLogReader* reader, QVector<QuickenMetrics>* metrics)
+{
+    int count = 0;
+    int readCount;
+    while ((readCount = reader->read(&(*metrics)[count], metrics->size() - count)) > 0) {
+        count += readCount;
+    }
+    return readCount == 0 ? count : -1;
+}
+
+static bool writeFile(const QString& fileName, const QByteArray& data, QIODevice::OpenMode mode)
+{
+    QFile file(fileName);
+    return file.open(mode) && file.write(data) == data.size();
+}
+
+class tst_LogReader : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void unknownFormat();
+    void binary();
+    void binaryPartialRecord();
+    void flightRecorder();
+    void flightRecorderPendingWrite();
+    void compressed();
+    void compressedTruncatedBlock();
+
+private:
+    QTemporaryDir m_directory;
+};
+
+void tst_LogReader::initTestCase()
+{
+    QVERIFY(m_directory.isValid());
+}
+
+void tst_LogReader::unknownFormat()
+{
+    const QString fileName = m_directory.path() + QStringLiteral("/unknown.log");
+    QVERIFY(writeFile(fileName, QByteArray(256, 'x'), QIODevice::WriteOnly));
+    QuickenLogReader reader(fileName);
+    QVERIFY(!reader.isOpen());
+    QCOMPARE(reader.format(), QuickenLogReader::Unknown);
+}
+
+void tst_LogReader::binary()
+{
+    const QString fileName = m_directory.path() + QStringLiteral("/binary.log");
+    const QVector<QuickenMetrics> metrics = generateMetrics(1000);
+    {
+        QuickenBinaryLogger logger(fileName);
+        QVERIFY(logger.isOpen());
+        for (int i = 0; i < metrics.size(); i += 10) {
+            logger.logBatch(&metrics[i], 10);
+        }
+    }
+
+    QuickenLogReader reader(fileName);
+    QVERIFY(reader.isOpen());
+    QCOMPARE(reader.format(), QuickenLogReader::Binary);
+    QCOMPARE(reader.version(), quint32(QuickenBinaryLogHeader::currentVersion));
+    QVector<QuickenMetrics> decoded(metrics.size() + 1);
+    QCOMPARE(readAll(&reader, &decoded), metrics.size());
+    QVERIFY(!memcmp(decoded.constData(), metrics.constData(),
+                    metrics.size() * sizeof(QuickenMetrics)));
+}
+
+// A metrics partially written at the end of a binary log isn't consumed, it's
+// read once the log is completed.
+void tst_LogReader::binaryPartialRecord()
+{
+    const QString fileName = m_directory.path() + QStringLiteral("/partial.log");
+    const QVector<QuickenMetrics> metrics = generateMetrics(10);
+    {
+        QuickenBinaryLogger logger(fileName);
+        QVERIFY(logger.isOpen());
+        logger.logBatch(metrics.constData(), metrics.size());
+    }
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray data = file.readAll();
+    file.close();
+    QCOMPARE(data.size(), static_cast<int>(
+        sizeof(QuickenBinaryLogHeader) + metrics.size() * sizeof(QuickenMetrics)));
+    const int partialSize = data.size() - static_cast<int>(sizeof(QuickenMetrics)) / 2;
+    QVERIFY(writeFile(fileName, data.left(partialSize), QIODevice::WriteOnly));
+
+    QuickenLogReader reader(fileName);
+    QVERIFY(reader.isOpen());
+    QVector<QuickenMetrics> decoded(metrics.size());
+    QCOMPARE(readAll(&reader, &decoded), metrics.size() - 1);
+    QVERIFY(!memcmp(decoded.constData(), metrics.constData(),
+                    (metrics.size() - 1) * sizeof(QuickenMetrics)));
+
+    QVERIFY(writeFile(fileName, data.mid(partialSize), QIODevice::Append));
+    QCOMPARE(reader.read(decoded.data(), decoded.size()), 1);
+    QVERIFY(!memcmp(decoded.constData(), &metrics.last(), sizeof(QuickenMetrics)));
+    QCOMPARE(reader.read(decoded.data(), decoded.size()), 0);
+}
+
+// A wrapped around ring buffer is read from its oldest metrics.
+void tst_LogReader::flightRecorder()
+{
+    const QString fileName = m_directory.path() + QStringLiteral("/recorder.log");
+    const QVector<QuickenMetrics> metrics = generateMetrics(301);
+    const int capacity = 128;
+    {
+        // The capacity is rounded up to the next power of two.
+        QuickenFlightRecorderLogger logger(fileName, 100);
+        QVERIFY(logger.isOpen());
+        for (int i = 0; i < metrics.size(); i += 7) {
+            logger.logBatch(&metrics[i], 7);
+        }
+    }
+
+    QuickenLogReader reader(fileName);
+    QVERIFY(reader.isOpen());
+    QCOMPARE(reader.format(), QuickenLogReader::FlightRecorder);
+    QVector<QuickenMetrics> decoded(metrics.size());
+    QCOMPARE(readAll(&reader, &decoded), capacity);
+    QVERIFY(!memcmp(decoded.constData(), &metrics[metrics.size() - capacity],
+                    capacity * sizeof(QuickenMetrics)));
+}
+
+// Slots reserved by a write that didn't complete (crash while logging) are
+// skipped, along with the metrics they overwrote.
+void tst_LogReader::flightRecorderPendingWrite()
+{
+    const QString fileName = m_directory.path() + QStringLiteral("/pending.log");
+    const QVector<QuickenMetrics> metrics = generateMetrics(200);
+    const int capacity = 128;
+    const int pendingCount = 5;
+    {
+        QuickenFlightRecorderLogger logger(fileName, capacity);
+        QVERIFY(logger.isOpen());
+        logger.logBatch(metrics.constData(), 100);
+        logger.logBatch(&metrics[100], 100);
+    }
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QuickenFlightRecorderHeader header;
+    QCOMPARE(file.read(reinterpret_cast<char*>(&header), sizeof(header)),
+             static_cast<qint64>(sizeof(header)));
+    QCOMPARE(header.capacity, static_cast<quint32>(capacity));
+    QCOMPARE(header.writeIndex.load(), static_cast<quint64>(metrics.size()));
+    header.reserveIndex.store(metrics.size() + pendingCount);
+    QVERIFY(file.seek(0));
+    QCOMPARE(file.write(reinterpret_cast<const char*>(&header), sizeof(header)),
+             static_cast<qint64>(sizeof(header)));
+    file.close();
+
+    QuickenLogReader reader(fileName);
+    QVERIFY(reader.isOpen());
+    QVector<QuickenMetrics> decoded(metrics.size());
+    const int validCount = capacity - pendingCount;
+    QCOMPARE(readAll(&reader, &decoded), validCount);
+    QVERIFY(!memcmp(decoded.constData(), &metrics[metrics.size() - validCount],
+                    validCount * sizeof(QuickenMetrics)));
+}
+
+void tst_LogReader::compressed()
+{
+    const QString fileName = m_directory.path() + QStringLiteral("/compressed.log");
+    const QVector<QuickenMetrics> metrics = generateMetrics(5000);
+    {
+        QuickenCompressedLogger logger(fileName);
+        QVERIFY(logger.isOpen());
+        logger.logBatch(metrics.constData(), metrics.size());
+    }
+
+    QuickenLogReader reader(fileName);
+    QVERIFY(reader.isOpen());
+    QCOMPARE(reader.format(), QuickenLogReader::Compressed);
+    QVector<QuickenMetrics> decoded(metrics.size() + 1);
+    QCOMPARE(readAll(&reader, &decoded), metrics.size());
+    QVERIFY(!memcmp(decoded.constData(), metrics.constData(),
+                    metrics.size() * sizeof(QuickenMetrics)));
+}
+
+// A truncated last block is skipped, the previous blocks are read.
+void tst_LogReader::compressedTruncatedBlock()
+{
+    const QString fileName = m_directory.path() + QStringLiteral("/truncated.log");
+    const QVector<QuickenMetrics> metrics = generateMetrics(20000);
+    {
+        QuickenCompressedLogger logger(fileName);
+        QVERIFY(logger.isOpen());
+        logger.logBatch(metrics.constData(), metrics.size());
+    }
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray data = file.readAll();
+    file.close();
+    const QByteArray marker(quickenCompressedBlockMarker, sizeof(quickenCompressedBlockMarker));
+    const int lastBlock = data.lastIndexOf(marker);
+    QVERIFY(lastBlock > static_cast<int>(sizeof(QuickenCompressedLogHeader)));
+    QuickenCompressedBlockHeader header;
+    memcpy(&header, &data.constData()[lastBlock], sizeof(header));
+    QVERIFY(header.count < static_cast<quint32>(metrics.size()));
+    const int truncatedSize = lastBlock + sizeof(header) + header.payloadSize / 2;
+    QVERIFY(writeFile(fileName, data.left(truncatedSize), QIODevice::WriteOnly));
+
+    QuickenLogReader reader(fileName);
+    QVERIFY(reader.isOpen());
+    QVector<QuickenMetrics> decoded(metrics.size());
+    const int validCount = metrics.size() - static_cast<int>(header.count);
+    QCOMPARE(readAll(&reader, &decoded), validCount);
+    QVERIFY(!memcmp(decoded.constData(), metrics.constData(),
+                    validCount * sizeof(QuickenMetrics)));
+}
+
+QTEST_APPLESS_MAIN(tst_LogReader)
+
+#include "tst_logreader.moc"
@@ -0,0 +1,240 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+#include <stddef.h>
+#include <string.h>
+
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QVector>
+#include <QtTest/QtTest>
+
+#include <Quicken/quickenlogger.h>
+#include <Quicken/quickenlogreader.h>
+#include <Quicken/quickenmetrics.h>
+#include <Quicken/private/quickenlogger_p.h>
+#include <Quicken/private/quickenmetricscodec_p.h>
+
+// Pseudo-random metrics of different types, frames of two interleaved windows
+// and process, generic, numeric and scope metrics in between.
+static QVector<QuickenMetrics> generateMetrics(int count)
+{
+    QVector<QuickenMetrics> metrics(count);
+    quint32 seed = 1;
+    quint64 timeStamp = 1000000000;
+    quint32 numbers[2] = { 0, 0 };
+    for (int i = 0; i < count; ++i) {
+        seed = seed * 1103515245 + 12345;
+        const quint32 random = seed >> 8;
+        timeStamp += 8000000 + random % 1000000;
+        QuickenMetrics* m = &metrics[i];
+        memset(m, 0, sizeof(QuickenMetrics));
+        m->timeStamp = timeStamp;
+        switch (i % 8) {
+        case 3:
+            m->type = QuickenMetrics::Process;
+            m->process.cpuUsage = random % 100;
+            m->process.threadCount = 8 + random % 4;
+            m->process.vszMemory = 500000 + random % 1000;
+            m->process.rssMemory = 100000 + random % 1000;
+            m->process.readBytes = i * 4096;
+            break;
+        case 5:
+            m->type = QuickenMetrics::Generic;
+            m->generic.id = 1 + random % 3;
+            m->generic.stringSize = qsnprintf(m->generic.string,
+                                              QuickenGenericMetrics::maxStringSize,
+                                              "generic %u", random) + 1;
+            break;
+        case 6:
+            m->type = QuickenMetrics::Numeric;
+            m->numeric.id = 1;
+            m->numeric.kind = QuickenNumericMetrics::Real;
+            m->numeric.valueCount = 2;
+            m->numeric.reals[0] = random / 3.0;
+            m->numeric.reals[1] = -1.5;
+            break;
+        case 7:
+            m->type = QuickenMetrics::Scope;
+            m->scope.thread = 1234;
+            m->scope.depth = random % 3;
+            m->scope.startTime = timeStamp - random % 100000;
+            strcpy(m->scope.name, "scope");
+            break;
+        default: {
+            const quint32 window = random & 1;
+            m->type = QuickenMetrics::Frame;
+            m->frame.window = window;
+            // Frame numbers can skip frames.
+            numbers[window] += 1 + (random % 5 == 0 ? 1 : 0);
+            m->frame.number = numbers[window];
+            m->frame.deltaTime = 16666667 + random % 100000;
+            m->frame.syncTime = 1000000 + random % 10000;
+            m->frame.renderTime = 4000000 + random % 100000;
+            m->frame.gpuTime = random % 3 ? 3000000 + random % 10000 : 0;
+            m->frame.swapTime = 10000000 + random % 1000000;
+            m->frame.cpuTime = 5000000 + random % 100000;
+            m->frame.minorPageFaults = random % 10;
+            m->frame.nodeCount = 100 + random % 3;
+            break;
+        }
+        }
+    }
+    return metrics;
+}
+
+class tst_MetricsCodec : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void roundTrip();
+    void quantizedRoundTrip();
+    void invalidData();
+    void checksum();
+    void blockResync();
+};
+
+// Encoded metrics must decode to the exact same bytes.
+void tst_MetricsCodec::roundTrip()
+{
+    const QVector<QuickenMetrics> metrics = generateMetrics(1000);
+    QByteArray buffer(metrics.size() * QuickenMetricsCodec::maxEncodedSize, '\0');
+    QuickenMetricsCodec encoder;
+    int size = 0;
+    for (int i = 0; i < metrics.size(); ++i) {
+        size += encoder.encode(metrics[i], &buffer.data()[size]);
+    }
+    QVERIFY(size < metrics.size() * static_cast<int>(sizeof(QuickenMetrics)) / 2);
+
+    QuickenMetricsCodec decoder;
+    int offset = 0;
+    for (int i = 0; i < metrics.size(); ++i) {
+        QuickenMetrics decoded;
+        const int decodedSize =
+            decoder.decode(&buffer.constData()[offset], size - offset, &decoded);
+        QVERIFY(decodedSize > 0);
+        offset += decodedSize;
+        QVERIFY2(!memcmp(&decoded, &metrics[i], sizeof(QuickenMetrics)),
+                 qPrintable(QStringLiteral("metrics %1").arg(i)));
+    }
+    QCOMPARE(offset, size);
+}
+
+// Time stamps and frame timings are rounded to the time resolution, the other
+// values are kept.
+void tst_MetricsCodec::quantizedRoundTrip()
+{
+    const quint32 resolution = 1000;
+    const QVector<QuickenMetrics> metrics = generateMetrics(100);
+    QuickenMetricsCodec encoder(resolution);
+    QuickenMetricsCodec decoder(resolution);
+    char buffer[QuickenMetricsCodec::maxEncodedSize];
+    for (int i = 0; i < metrics.size(); ++i) {
+        const int size = encoder.encode(metrics[i], buffer);
+        QuickenMetrics decoded;
+        QCOMPARE(decoder.decode(buffer, size, &decoded), size);
+        QCOMPARE(decoded.type, metrics[i].type);
+        QCOMPARE(decoded.timeStamp,
+                 (metrics[i].timeStamp + resolution / 2) / resolution * resolution);
+        if (decoded.type == QuickenMetrics::Frame) {
+            const QuickenFrameMetrics& frame = metrics[i].frame;
+            QCOMPARE(decoded.frame.window, frame.window);
+            QCOMPARE(decoded.frame.number, frame.number);
+            QCOMPARE(decoded.frame.deltaTime,
+                     (frame.deltaTime + resolution / 2) / resolution * resolution);
+            QCOMPARE(decoded.frame.swapTime,
+                     (frame.swapTime + resolution / 2) / resolution * resolution);
+            QCOMPARE(decoded.frame.cpuTime, frame.cpuTime);
+            QCOMPARE(decoded.frame.nodeCount, frame.nodeCount);
+        } else {
+            QVERIFY(!memcmp(&decoded.process, &metrics[i].process,
+                            sizeof(QuickenMetrics) - offsetof(QuickenMetrics, process)));
+        }
+    }
+}
+
+void tst_MetricsCodec::invalidData()
+{
+    QuickenMetricsCodec codec;
+    QuickenMetrics metrics;
+
+    // Empty buffer and unknown type.
+    QCOMPARE(codec.decode("", 0, &metrics), 0);
+    const char unknownType[] = { QuickenMetrics::TypeCount, 0, 0 };
+    QCOMPARE(codec.decode(unknownType, sizeof(unknownType), &metrics), 0);
+
+    // Truncated metrics.
+    const QVector<QuickenMetrics> source = generateMetrics(1);
+    char buffer[QuickenMetricsCodec::maxEncodedSize];
+    const int size = QuickenMetricsCodec().encode(source[0], buffer);
+    for (int i = 0; i < size; ++i) {
+        QuickenMetricsCodec decoder;
+        QCOMPARE(decoder.decode(buffer, i, &metrics), 0);
+    }
+}
+
+// FNV-1a reference values.
+void tst_MetricsCodec::checksum()
+{
+    QCOMPARE(quickenCompressedBlockChecksum("", 0), 0x811c9dc5u);
+    QCOMPARE(quickenCompressedBlockChecksum("a", 1), 0xe40c292cu);
+    QCOMPARE(quickenCompressedBlockChecksum("foobar", 6), 0xbf9cf968u);
+}
+
+// A corrupted block is skipped, the reader resynchronizes on the next one.
+void tst_MetricsCodec::blockResync()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    const QString fileName = directory.path() + QStringLiteral("/compressed.log");
+    const QVector<QuickenMetrics> metrics = generateMetrics(20000);
+    {
+        QuickenCompressedLogger logger(fileName);
+        QVERIFY(logger.isOpen());
+        logger.logBatch(metrics.constData(), metrics.size());
+    }
+
+    // Find the blocks and corrupt the payload of the second one.
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QByteArray data = file.readAll();
+    const QByteArray marker(quickenCompressedBlockMarker, sizeof(quickenCompressedBlockMarker));
+    QVector<int> blocks;
+    for (int i = data.indexOf(marker); i != -1; i = data.indexOf(marker, i + 1)) {
+        blocks.append(i);
+    }
+    QVERIFY(blocks.size() >= 3);
+    QuickenCompressedBlockHeader header;
+    memcpy(&header, &data.constData()[blocks[0]], sizeof(header));
+    const int firstBlockCount = header.count;
+    memcpy(&header, &data.constData()[blocks[1]], sizeof(header));
+    const int skippedCount = header.count;
+    data.data()[blocks[1] + sizeof(header) + header.payloadSize / 2] ^= 0x5a;
+    QVERIFY(file.seek(0));
+    QCOMPARE(file.write(data), static_cast<qint64>(data.size()));
+    file.close();
+
+    QuickenLogReader reader(fileName);
+    QVERIFY(reader.isOpen());
+    QCOMPARE(reader.format(), QuickenLogReader::Compressed);
+    QVector<QuickenMetrics> decoded(metrics.size());
+    int count = 0;
+    int readCount;
+    while ((readCount = reader.read(&decoded[count], decoded.size() - count)) > 0) {
+        count += readCount;
+    }
+    QCOMPARE(readCount, 0);
+    QCOMPARE(count, metrics.size() - skippedCount);
+    for (int i = 0; i < count; ++i) {
+        const int index = i < firstBlockCount ? i : i + skippedCount;
+        QVERIFY2(!memcmp(&decoded[i], &metrics[index], sizeof(QuickenMetrics)),
+                 qPrintable(QStringLiteral("metrics %1").arg(index)));
+    }
+}
+
+QTEST_APPLESS_MAIN(tst_MetricsCodec)
+
+#include "tst_metricscodec.moc"
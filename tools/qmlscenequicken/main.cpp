@@ -157,6 +157,8 @@ struct Options
         , coreProfile(false)
         , verbose(false)
         , metricsOverlay(false)
+        , metricsLoggingQueueSize(0)
+        , metricsMemoryInterval(0)
         , continuousUpdates(false)
         , applicationType(DefaultQmlApplicationType)
         , textRenderType(QQuickWindow::textRenderType())
@@ -183,6 +185,10 @@ struct Options
     bool metricsOverlay;
     QString metricsLogging;
     QString metricsLoggingFilter;
+    QString metricsLoggingFormat;
+    int metricsLoggingQueueSize;
+    QString metricsLoggingOverflow;
+    int metricsMemoryInterval;
     bool continuousUpdates;
     int quitAfterFrameCount;
     QVector<Qt::ApplicationAttribute> applicationAttributes;
@@ -394,8 +400,23 @@ static void usage()
     puts("  --metrics-logging <device> ........ Enable metrics logging. <device> is a file or 'stdout' (an empty");
     puts("    ................................. <device> means 'stdout').");
     puts("  --metrics-logging-filter <filter> . Filter logged metrics. <filter> is a list of metrics types (either");
-    puts("    ................................. 'window', 'frame', 'process' or 'generic') separated by commas");
-    puts("    ................................. (for example: 'window' or 'window,process').");
+    puts("    ................................. 'window', 'frame', 'process', 'generic', 'numeric', 'scope',");
+    puts("    ................................. 'thread', 'memory', 'pacing', 'perf', 'engine', 'timeline' or");
+    puts("    ................................. 'scenegraph') separated by commas (for example: 'window' or");
+    puts("    ................................. 'window,process'). 'perf' (perf_event_open() counters per frame");
+    puts("    ................................. phase), 'engine' (QML engine heap, garbage collections and");
+    puts("    ................................. bindings), 'timeline' (time stamps of the frame phases of the GUI");
+    puts("    ................................. and render threads) and 'scenegraph' (scene graph statistics in");
+    puts("    ................................. frame metrics) aren't logged by default.");
+    puts("  --metrics-logging-format <format> . Set the logging format. <format> is either 'text' (default),");
+    puts("    ................................. 'binary', 'trace' (Chrome trace event), 'statistics' (frame");
+    puts("    ................................. timing summaries every 10 s), 'compressed' or 'flight-recorder'");
+    puts("    ................................. (the last two require a file <device>).");
+    puts("  --metrics-logging-queue-size <size> Set the logging queue size to <size> metrics.");
+    puts("  --metrics-logging-overflow <policy> Set the logging queue overflow policy. <policy> is either");
+    puts("    ................................. 'block', 'drop-newest' or 'drop-oldest'.");
+    puts("  --metrics-memory-interval <ms> .... Set the memory metrics update interval to <ms> milliseconds");
+    puts("    ................................. (10000 by default, -1 disables memory metrics updates).");
     puts("  --continuous-updates .............. Continuously update the main window.");
     puts("  --quit-after-frame-count <count> .. Quit after <count> frames rendered on the main window.");
     puts(" ");
@@ -546,13 +567,71 @@ static void setQuickenPerfOptions(Options* options) {
                 filter |= QuickenApplicationMonitor::FrameMetrics;
             } else if (filterList[i] == QLatin1String("generic")) {
                 filter |= QuickenApplicationMonitor::GenericMetrics;
+            } else if (filterList[i] == QLatin1String("numeric")) {
+                filter |= QuickenApplicationMonitor::NumericMetrics;
+            } else if (filterList[i] == QLatin1String("scope")) {
+                filter |= QuickenApplicationMonitor::ScopeMetrics;
+            } else if (filterList[i] == QLatin1String("thread")) {
+                filter |= QuickenApplicationMonitor::ThreadMetrics;
+            } else if (filterList[i] == QLatin1String("memory")) {
+                filter |= QuickenApplicationMonitor::MemoryMetrics;
+            } else if (filterList[i] == QLatin1String("pacing")) {
+                filter |= QuickenApplicationMonitor::PacingMetrics;
+            } else if (filterList[i] == QLatin1String("perf")) {
+                filter |= QuickenApplicationMonitor::PerfCounterMetrics;
+            } else if (filterList[i] == QLatin1String("engine")) {
+                filter |= QuickenApplicationMonitor::EngineMetrics;
+            } else if (filterList[i] == QLatin1String("timeline")) {
+                filter |= QuickenApplicationMonitor::TimelineMetrics;
+            } else if (filterList[i] == QLatin1String("scenegraph")) {
+                filter |= QuickenApplicationMonitor::SceneGraphMetrics;
             }
         }
         applicationMonitor->setLoggingFilter(filter);
     }
+    if (options->metricsLoggingQueueSize > 0) {
+        applicationMonitor->setLoggingQueueSize(options->metricsLoggingQueueSize);
+    }
+    if (options->metricsMemoryInterval != 0) {
+        applicationMonitor->setUpdateInterval(
+            QuickenMetrics::Memory, qMax(options->metricsMemoryInterval, -1));
+    }
+    if (!options->metricsLoggingOverflow.isEmpty()) {
+        if (options->metricsLoggingOverflow == QLatin1String("block")) {
+            applicationMonitor->setLoggingOverflowPolicy(QuickenApplicationMonitor::Block);
+        } else if (options->metricsLoggingOverflow == QLatin1String("drop-newest")) {
+            applicationMonitor->setLoggingOverflowPolicy(QuickenApplicationMonitor::DropNewest);
+        } else if (options->metricsLoggingOverflow == QLatin1String("drop-oldest")) {
+            applicationMonitor->setLoggingOverflowPolicy(QuickenApplicationMonitor::DropOldest);
+        }
+    }
     if (!options->metricsLogging.isEmpty()) {
         QuickenLogger* logger;
-        if (options->metricsLogging == QLatin1String("stdout")) {
+        if (options->metricsLoggingFormat == QLatin1String("binary")) {
+            if (options->metricsLogging == QLatin1String("stdout")) {
+                logger = new QuickenBinaryLogger(QStringLiteral("/dev/stdout"));
+            } else {
+                logger = new QuickenBinaryLogger(options->metricsLogging);
+            }
+        } else if (options->metricsLoggingFormat == QLatin1String("trace")) {
+            if (options->metricsLogging == QLatin1String("stdout")) {
+                logger = new QuickenTraceLogger(QStringLiteral("/dev/stdout"));
+            } else {
+                logger = new QuickenTraceLogger(options->metricsLogging);
+            }
+        } else if (options->metricsLoggingFormat == QLatin1String("statistics")) {
+            if (options->metricsLogging == QLatin1String("stdout")) {
+                logger = new QuickenStatisticsLogger(stdout);
+            } else {
+                logger = new QuickenStatisticsLogger(options->metricsLogging);
+            }
+        } else if (options->metricsLoggingFormat == QLatin1String("compressed")
+                   && options->metricsLogging != QLatin1String("stdout")) {
+            logger = new QuickenCompressedLogger(options->metricsLogging);
+        } else if (options->metricsLoggingFormat == QLatin1String("flight-recorder")
+                   && options->metricsLogging != QLatin1String("stdout")) {
+            logger = new QuickenFlightRecorderLogger(options->metricsLogging);
+        } else if (options->metricsLogging == QLatin1String("stdout")) {
             logger = new QuickenFileLogger(stdout);
         } else {
             logger = new QuickenFileLogger(options->metricsLogging);
@@ -662,7 +741,15 @@ int main(int argc, char ** argv)
                     // Filter everything (as empty is not a valid metrics type).
                     options.metricsLoggingFilter = QString("empty");
                 }
-            } else if (lowerArgument == QLatin1String("--continuous-updates"))
+            } else if (lowerArgument == QLatin1String("--metrics-logging-format") && i + 1 < size)
+                options.metricsLoggingFormat = arguments.at(++i).toLower();
+            else if (lowerArgument == QLatin1String("--metrics-logging-queue-size") && i + 1 < size)
+                options.metricsLoggingQueueSize = atoi(argv[++i]);
+            else if (lowerArgument == QLatin1String("--metrics-logging-overflow") && i + 1 < size)
+                options.metricsLoggingOverflow = arguments.at(++i).toLower();
+            else if (lowerArgument == QLatin1String("--metrics-memory-interval") && i + 1 < size)
+                options.metricsMemoryInterval = atoi(argv[++i]);
+            else if (lowerArgument == QLatin1String("--continuous-updates"))
                 options.continuousUpdates = true;
             else if (lowerArgument == QLatin1String("--quit-after-frame-count"))
                 options.quitAfterFrameCount = atoi(argv[++i]);
@@ -0,0 +1,1907 @@
+// Copyright © 2018 Loïc Molinari <loicm@loicm.fr>
+//
+// This file is part of Quicken, licensed under the MIT license. See the license
+// file at project root for full information.
+
+// Offline analysis of metrics logs. Parsable text logs are memory mapped and
+// split in chunks parsed in parallel, binary logs are decoded with
+// QuickenLogReader. The per-window frame timings and process metrics are
+// accumulated per chunk in mergeable statistics (histograms, counters and
+// linear regression sums), merged and written as a JSON report. The frame
+// timing distributions of several logs can also be compared with significance
+// testing for use in continuous integration.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QRunnable>
+#include <QtCore/QSet>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+#include <QtCore/QtAlgorithms>
+#include <Quicken/QuickenLogReader>
+#include <Quicken/quickenmetrics.h>
+#include <Quicken/private/quickenhistogram_p.h>
+
+// Chunks smaller than that aren't worth a thread.
+const qint64 minChunkSize = 4 * 1024 * 1024;
+
+// Number of metrics read at once from binary logs.
+const int binaryBatchSize = 4096;
+
+// Names of the frame timing fields. Instructions is the number of instructions
+// retired by the render thread per frame, from hardware perf counters, input
+// the latency of the frames reflecting input events. Polish, GUI blocked and
+// animations are the phases of the GUI thread from the frame timelines.
+const char* const fieldNames[] = {
+    "delta", "sync", "render", "gpu", "swap", "total", "cpu", "instructions", "inputLatency",
+    "polish", "guiBlocked", "animations"
+};
+
+// Names of the perf counters per source and of the frame phases.
+const char* const perfCounterNames[][QuickenPerfCounterMetrics::counterCount] = {
+    { "instructions", "cycles", "cacheMisses" }, { "taskClock", "contextSwitches", "pageFaults" }
+};
+const char* const perfSourceNames[] = { "hardware", "software" };
+
+// Names of the scene graph statistics fields.
+const char* const sceneGraphFieldNames[] = {
+    "nodes", "opaqueBatches", "alphaBatches", "drawCalls", "materialChanges", "shaderChanges",
+    "uploadSize"
+};
+const char* const perfPhaseNames[] = { "sync", "render", "swap" };
+Q_STATIC_ASSERT(ARRAY_SIZE(perfCounterNames) == QuickenPerfCounterMetrics::SourceCount);
+Q_STATIC_ASSERT(ARRAY_SIZE(perfSourceNames) == QuickenPerfCounterMetrics::SourceCount);
+Q_STATIC_ASSERT(ARRAY_SIZE(perfPhaseNames) == QuickenPerfCounterMetrics::PhaseCount);
+
+// Mergeable min, max, mean, first and last values and linear regression of a
+// value over time (in seconds).
+struct Trend
+{
+    Trend()
+        : count(0), min(0.0), max(0.0), sum(0.0), sumT(0.0), sumTT(0.0), sumTY(0.0)
+        , firstTimeStamp(0), firstValue(0.0), lastTimeStamp(0), lastValue(0.0)
+    {
+    }
+
+    void add(quint64 timeStamp, double value);
+    void merge(const Trend& trend);
+    QJsonObject toJson() const;
+
+    quint64 count;
+    double min;
+    double max;
+    double sum;
+    double sumT;
+    double sumTT;
+    double sumTY;
+    quint64 firstTimeStamp;
+    double firstValue;
+    quint64 lastTimeStamp;
+    double lastValue;
+};
+
+struct WindowStatistics
+{
+    enum {
+        DeltaTime = 0, SyncTime, RenderTime, GpuTime, SwapTime, TotalTime, CpuTime,
+        Instructions, InputLatency, PolishTime, GuiBlockedTime, AnimationTime, FieldCount
+    };
+    enum {
+        Nodes = 0, OpaqueBatches, AlphaBatches, DrawCalls, MaterialChanges, ShaderChanges,
+        UploadSize, SceneGraphFieldCount
+    };
+    // Perf counters are logged for the render thread and the GUI thread.
+    enum { RenderPerfCounters = 0, GuiPerfCounters, PerfCountersCount };
+
+    WindowStatistics()
+        : frameCount(0), jankCount(0), missedVsyncCount(0), firstTimeStamp(0), lastTimeStamp(0)
+        , minorPageFaults(0), majorPageFaults(0), voluntarySwitches(0), involuntarySwitches(0)
+        , majorPageFaultJankCount(0), involuntarySwitchJankCount(0), engineFrameCount(0)
+        , gcCount(0), pacedFrameCount(0), pacedVsyncCount(0), droppedVsyncCount(0)
+        , pacingChangeCount(0)
+    {
+        memset(perfCounterFrameCount, 0, sizeof(perfCounterFrameCount));
+        memset(perfCounterTotals, 0, sizeof(perfCounterTotals));
+    }
+
+    void merge(const WindowStatistics& statistics);
+
+    QuickenHistogram histograms[FieldCount];
+    // Scene graph statistics per frame, the upload size is in bytes.
+    Trend sceneGraph[SceneGraphFieldCount];
+    quint64 frameCount;
+    quint64 jankCount;
+    quint64 missedVsyncCount;
+    quint64 firstTimeStamp;
+    quint64 lastTimeStamp;
+    // Page faults and context switches of the render thread, and number of
+    // janky frames with major page faults or involuntary context switches.
+    quint64 minorPageFaults;
+    quint64 majorPageFaults;
+    quint64 voluntarySwitches;
+    quint64 involuntarySwitches;
+    quint64 majorPageFaultJankCount;
+    quint64 involuntarySwitchJankCount;
+    // Number of frames with perf counters and totals per phase, per thread and
+    // source. Hardware and software counters are logged separately.
+    quint64 perfCounterFrameCount[PerfCountersCount][QuickenPerfCounterMetrics::SourceCount];
+    quint64 perfCounterTotals[PerfCountersCount][QuickenPerfCounterMetrics::SourceCount]
+                             [QuickenPerfCounterMetrics::PhaseCount]
+                             [QuickenPerfCounterMetrics::counterCount];
+    // QML engine metrics, JavaScript heap sizes are in kilobytes and garbage
+    // collector pauses are recorded for the frames with collections.
+    quint64 engineFrameCount;
+    quint64 gcCount;
+    QuickenHistogram gcTimeEstimate;
+    Trend bindings;
+    Trend jsHeapUsed;
+    Trend jsHeapAllocated;
+    // Frame pacing metrics totals, smoothness in percent and learned refresh
+    // rate in Hz.
+    quint64 pacedFrameCount;
+    quint64 pacedVsyncCount;
+    quint64 droppedVsyncCount;
+    quint64 pacingChangeCount;
+    Trend smoothness;
+    Trend refreshRate;
+    // Numbers of the janky frames and of the frames with collections, matched
+    // once all the chunks are merged.
+    QSet<quint32> jankyFrames;
+    QSet<quint32> gcFrames;
+};
+
+Q_STATIC_ASSERT(ARRAY_SIZE(fieldNames) == WindowStatistics::FieldCount);
+Q_STATIC_ASSERT(ARRAY_SIZE(sceneGraphFieldNames) == WindowStatistics::SceneGraphFieldCount);
+
+// Trends of the values of a numeric metrics. Declarations and values might be
+// parsed by different chunks, so names are resolved when merging.
+struct NumericStatistics
+{
+    void merge(const NumericStatistics& statistics);
+
+    QByteArray name;
+    QByteArray unit;
+    QVector<Trend> values;
+};
+
+// CPU usage trend and CPU times of a thread.
+struct ThreadStatistics
+{
+    ThreadStatistics() : role(0), userTime(0), systemTime(0) {}
+
+    void merge(const ThreadStatistics& statistics);
+
+    QByteArray name;
+    quint8 role;
+    Trend cpuUsage;
+    quint64 userTime;
+    quint64 systemTime;
+};
+
+struct Statistics
+{
+    Statistics()
+        : metricsCount(0), invalidLineCount(0), genericCount(0), windowEventCount(0)
+    {
+        memset(droppedCount, 0, sizeof(droppedCount));
+    }
+    ~Statistics() {
+        qDeleteAll(windows); qDeleteAll(numerics); qDeleteAll(scopes); qDeleteAll(threads);
+    }
+
+    void add(const QuickenMetrics& metrics, quint64 vsyncInterval);
+    void merge(const Statistics& statistics);
+    QJsonObject toJson(quint64 vsyncInterval) const;
+
+    QHash<quint32, WindowStatistics*> windows;
+    QHash<quint32, NumericStatistics*> numerics;
+    // Durations of the traced scopes, per name.
+    QHash<QByteArray, QuickenHistogram*> scopes;
+    QHash<quint32, ThreadStatistics*> threads;
+    Trend cpuUsage;
+    Trend rssMemory;
+    Trend vszMemory;
+    Trend threadCount;
+    Trend readBytes;
+    Trend writtenBytes;
+    Trend pssMemory;
+    Trend ussMemory;
+    Trend anonymousMemory;
+    Trend swapMemory;
+    Trend heapUsedMemory;
+    Trend heapFreeMemory;
+    quint64 metricsCount;
+    quint64 invalidLineCount;
+    quint64 genericCount;
+    quint64 windowEventCount;
+    quint64 droppedCount[QuickenMetrics::TypeCount];
+};
+
+struct Options
+{
+    Options()
+        : jobs(QThread::idealThreadCount())
+        , refreshRate(60.0)
+        , compare(false)
+        , field(WindowStatistics::TotalTime)
+        , window(0)
+        , alpha(0.01)
+        , maxRegression(5.0)
+        , maxTailRegression(10.0)
+    {
+    }
+
+    QStringList fileNames;
+    QString output;
+    int jobs;
+    double refreshRate;
+    bool compare;
+    int field;
+    quint32 window;
+    double alpha;
+    double maxRegression;
+    double maxTailRegression;
+};
+
+void Trend::add(quint64 timeStamp, double value)
+{
+    const double t = timeStamp / 1000000000.0;
+    if (count == 0) {
+        min = max = value;
+        firstTimeStamp = lastTimeStamp = timeStamp;
+        firstValue = lastValue = value;
+    } else {
+        min = qMin(min, value);
+        max = qMax(max, value);
+        if (timeStamp < firstTimeStamp) {
+            firstTimeStamp = timeStamp;
+            firstValue = value;
+        }
+        if (timeStamp >= lastTimeStamp) {
+            lastTimeStamp = timeStamp;
+            lastValue = value;
+        }
+    }
+    count++;
+    sum += value;
+    sumT += t;
+    sumTT += t * t;
+    sumTY += t * value;
+}
+
+void Trend::merge(const Trend& trend)
+{
+    if (trend.count == 0) {
+        return;
+    } else if (count == 0) {
+        *this = trend;
+        return;
+    }
+    min = qMin(min, trend.min);
+    max = qMax(max, trend.max);
+    if (trend.firstTimeStamp < firstTimeStamp) {
+        firstTimeStamp = trend.firstTimeStamp;
+        firstValue = trend.firstValue;
+    }
+    if (trend.lastTimeStamp >= lastTimeStamp) {
+        lastTimeStamp = trend.lastTimeStamp;
+        lastValue = trend.lastValue;
+    }
+    count += trend.count;
+    sum += trend.sum;
+    sumT += trend.sumT;
+    sumTT += trend.sumTT;
+    sumTY += trend.sumTY;
+}
+
+QJsonObject Trend::toJson() const
+{
+    QJsonObject object;
+    object.insert(QStringLiteral("count"), static_cast<double>(count));
+    if (count > 0) {
+        // Least squares slope, per minute.
+        const double n = static_cast<double>(count);
+        const double denominator = n * sumTT - sumT * sumT;
+        const double slope = denominator > 0.0 ? (n * sumTY - sumT * sum) / denominator : 0.0;
+        object.insert(QStringLiteral("min"), min);
+        object.insert(QStringLiteral("mean"), sum / n);
+        object.insert(QStringLiteral("max"), max);
+        object.insert(QStringLiteral("first"), firstValue);
+        object.insert(QStringLiteral("last"), lastValue);
+        object.insert(QStringLiteral("slopePerMinute"), slope * 60.0);
+    }
+    return object;
+}
+
+void WindowStatistics::merge(const WindowStatistics& statistics)
+{
+    for (int i = 0; i < FieldCount; ++i) {
+        histograms[i].add(statistics.histograms[i]);
+    }
+    for (int i = 0; i < SceneGraphFieldCount; ++i) {
+        sceneGraph[i].merge(statistics.sceneGraph[i]);
+    }
+    if (frameCount == 0) {
+        firstTimeStamp = statistics.firstTimeStamp;
+        lastTimeStamp = statistics.lastTimeStamp;
+    } else if (statistics.frameCount > 0) {
+        firstTimeStamp = qMin(firstTimeStamp, statistics.firstTimeStamp);
+        lastTimeStamp = qMax(lastTimeStamp, statistics.lastTimeStamp);
+    }
+    frameCount += statistics.frameCount;
+    jankCount += statistics.jankCount;
+    missedVsyncCount += statistics.missedVsyncCount;
+    minorPageFaults += statistics.minorPageFaults;
+    majorPageFaults += statistics.majorPageFaults;
+    voluntarySwitches += statistics.voluntarySwitches;
+    involuntarySwitches += statistics.involuntarySwitches;
+    majorPageFaultJankCount += statistics.majorPageFaultJankCount;
+    involuntarySwitchJankCount += statistics.involuntarySwitchJankCount;
+    for (int i = 0; i < PerfCountersCount; ++i) {
+        for (int j = 0; j < QuickenPerfCounterMetrics::SourceCount; ++j) {
+            perfCounterFrameCount[i][j] += statistics.perfCounterFrameCount[i][j];
+            for (int k = 0; k < QuickenPerfCounterMetrics::PhaseCount; ++k) {
+                for (int l = 0; l < QuickenPerfCounterMetrics::counterCount; ++l) {
+                    perfCounterTotals[i][j][k][l] += statistics.perfCounterTotals[i][j][k][l];
+                }
+            }
+        }
+    }
+    engineFrameCount += statistics.engineFrameCount;
+    gcCount += statistics.gcCount;
+    gcTimeEstimate.add(statistics.gcTimeEstimate);
+    bindings.merge(statistics.bindings);
+    jsHeapUsed.merge(statistics.jsHeapUsed);
+    jsHeapAllocated.merge(statistics.jsHeapAllocated);
+    pacedFrameCount += statistics.pacedFrameCount;
+    pacedVsyncCount += statistics.pacedVsyncCount;
+    droppedVsyncCount += statistics.droppedVsyncCount;
+    pacingChangeCount += statistics.pacingChangeCount;
+    smoothness.merge(statistics.smoothness);
+    refreshRate.merge(statistics.refreshRate);
+    jankyFrames.unite(statistics.jankyFrames);
+    gcFrames.unite(statistics.gcFrames);
+}
+
+void NumericStatistics::merge(const NumericStatistics& statistics)
+{
+    if (name.isEmpty()) {
+        name = statistics.name;
+        unit = statistics.unit;
+    }
+    if (values.size() < statistics.values.size()) {
+        values.resize(statistics.values.size());
+    }
+    for (int i = 0; i < statistics.values.size(); ++i) {
+        values[i].merge(statistics.values[i]);
+    }
+}
+
+void ThreadStatistics::merge(const ThreadStatistics& statistics)
+{
+    // Threads are renamed at times, the name with the most recent CPU usage is
+    // kept.
+    if (name.isEmpty() || statistics.cpuUsage.lastTimeStamp > cpuUsage.lastTimeStamp) {
+        name = statistics.name;
+        role = statistics.role;
+    }
+    cpuUsage.merge(statistics.cpuUsage);
+    userTime = qMax(userTime, statistics.userTime);
+    systemTime = qMax(systemTime, statistics.systemTime);
+}
+
+void Statistics::add(const QuickenMetrics& metrics, quint64 vsyncInterval)
+{
+    metricsCount++;
+
+    switch (metrics.type) {
+    case QuickenMetrics::Process:
+        cpuUsage.add(metrics.timeStamp, metrics.process.cpuUsage);
+        rssMemory.add(metrics.timeStamp, metrics.process.rssMemory);
+        vszMemory.add(metrics.timeStamp, metrics.process.vszMemory);
+        threadCount.add(metrics.timeStamp, metrics.process.threadCount);
+        // 0 if I/O accounting isn't available or with logs written by older
+        // versions.
+        if (metrics.process.readBytes > 0 || metrics.process.writtenBytes > 0) {
+            readBytes.add(metrics.timeStamp, metrics.process.readBytes);
+            writtenBytes.add(metrics.timeStamp, metrics.process.writtenBytes);
+        }
+        break;
+
+    case QuickenMetrics::Frame: {
+        WindowStatistics* statistics = windows.value(metrics.frame.window, nullptr);
+        if (!statistics) {
+            statistics = new WindowStatistics;
+            statistics->firstTimeStamp = metrics.timeStamp;
+            windows.insert(metrics.frame.window, statistics);
+        }
+        // Instructions are recorded from perf counter metrics.
+        const quint64 values[WindowStatistics::Instructions] = {
+            metrics.frame.deltaTime, metrics.frame.syncTime, metrics.frame.renderTime,
+            metrics.frame.gpuTime, metrics.frame.swapTime,
+            metrics.frame.syncTime + metrics.frame.renderTime + metrics.frame.swapTime,
+            metrics.frame.cpuTime
+        };
+        for (int i = 0; i < WindowStatistics::Instructions; ++i) {
+            // Delta time of the first frame, unavailable GPU times and CPU
+            // times of logs written by older versions are 0.
+            if (values[i] > 0
+                || (i != WindowStatistics::DeltaTime && i != WindowStatistics::GpuTime
+                    && i != WindowStatistics::CpuTime)) {
+                statistics->histograms[i].record(values[i]);
+            }
+        }
+        if (metrics.frame.inputEventCount > 0) {
+            statistics->histograms[WindowStatistics::InputLatency].record(
+                metrics.frame.inputLatency);
+        }
+        // A frame is janky if it's been presented one vsync interval (or more)
+        // after the expected one, the number of missed vsyncs is estimated from
+        // the rounded ratio of the frame delta time over the vsync interval.
+        if (metrics.frame.deltaTime > 0 && vsyncInterval > 0) {
+            const quint64 intervals =
+                (metrics.frame.deltaTime + vsyncInterval / 2) / vsyncInterval;
+            if (intervals > 1) {
+                statistics->jankCount++;
+                statistics->jankyFrames.insert(metrics.frame.number);
+                statistics->missedVsyncCount += intervals - 1;
+                if (metrics.frame.majorPageFaults > 0) {
+                    statistics->majorPageFaultJankCount++;
+                }
+                if (metrics.frame.involuntaryContextSwitches > 0) {
+                    statistics->involuntarySwitchJankCount++;
+                }
+            }
+        }
+        // Logs written by older versions have no scene graph statistics, the
+        // root node is always counted otherwise.
+        if (metrics.frame.nodeCount > 0) {
+            const quint64 sceneGraphValues[WindowStatistics::SceneGraphFieldCount] = {
+                metrics.frame.nodeCount, metrics.frame.opaqueBatchCount,
+                metrics.frame.alphaBatchCount, metrics.frame.drawCallCount,
+                metrics.frame.materialChangeCount, metrics.frame.shaderChangeCount,
+                static_cast<quint64>(metrics.frame.vertexUploadSize)
+                + metrics.frame.indexUploadSize
+            };
+            for (int i = 0; i < WindowStatistics::SceneGraphFieldCount; ++i) {
+                statistics->sceneGraph[i].add(metrics.timeStamp, sceneGraphValues[i]);
+            }
+        }
+        statistics->minorPageFaults += metrics.frame.minorPageFaults;
+        statistics->majorPageFaults += metrics.frame.majorPageFaults;
+        statistics->voluntarySwitches += metrics.frame.voluntaryContextSwitches;
+        statistics->involuntarySwitches += metrics.frame.involuntaryContextSwitches;
+        statistics->frameCount++;
+        statistics->firstTimeStamp = qMin(statistics->firstTimeStamp, metrics.timeStamp);
+        statistics->lastTimeStamp = qMax(statistics->lastTimeStamp, metrics.timeStamp);
+        break;
+    }
+
+    case QuickenMetrics::Window:
+        windowEventCount++;
+        break;
+
+    case QuickenMetrics::Generic:
+        genericCount++;
+        break;
+
+    case QuickenMetrics::Dropped:
+        for (int i = 0; i < QuickenMetrics::TypeCount; ++i) {
+            droppedCount[i] += metrics.dropped.count[i];
+        }
+        break;
+
+    case QuickenMetrics::Numeric: {
+        const QuickenNumericMetrics& numeric = metrics.numeric;
+        NumericStatistics* statistics = numerics.value(numeric.id, nullptr);
+        if (!statistics) {
+            statistics = new NumericStatistics;
+            numerics.insert(numeric.id, statistics);
+        }
+        if (numeric.kind == QuickenNumericMetrics::Declaration) {
+            statistics->name = QByteArray(
+                numeric.declaration.name,
+                strnlen(numeric.declaration.name, QuickenNumericDeclaration::maxNameSize));
+            statistics->unit = QByteArray(
+                numeric.declaration.unit,
+                strnlen(numeric.declaration.unit, QuickenNumericDeclaration::maxUnitSize));
+        } else {
+            const int count = qMin(static_cast<int>(numeric.valueCount),
+                                   static_cast<int>(QuickenNumericMetrics::maxValueCount));
+            if (statistics->values.size() < count) {
+                statistics->values.resize(count);
+            }
+            for (int i = 0; i < count; ++i) {
+                statistics->values[i].add(
+                    metrics.timeStamp, numeric.kind == QuickenNumericMetrics::Integer
+                    ? static_cast<double>(numeric.integers[i]) : numeric.reals[i]);
+            }
+        }
+        break;
+    }
+
+    case QuickenMetrics::Scope: {
+        const QByteArray name(
+            metrics.scope.name, strnlen(metrics.scope.name, QuickenScopeMetrics::maxNameSize));
+        QuickenHistogram* histogram = scopes.value(name, nullptr);
+        if (!histogram) {
+            histogram = new QuickenHistogram;
+            scopes.insert(name, histogram);
+        }
+        histogram->record(metrics.timeStamp - qMin(metrics.timeStamp, metrics.scope.startTime));
+        break;
+    }
+
+    case QuickenMetrics::Thread: {
+        ThreadStatistics* statistics = threads.value(metrics.thread.thread, nullptr);
+        if (!statistics) {
+            statistics = new ThreadStatistics;
+            threads.insert(metrics.thread.thread, statistics);
+        }
+        statistics->name = QByteArray(
+            metrics.thread.name, strnlen(metrics.thread.name, QuickenThreadMetrics::maxNameSize));
+        statistics->role = metrics.thread.role;
+        statistics->cpuUsage.add(metrics.timeStamp, metrics.thread.cpuUsage);
+        statistics->userTime = qMax(statistics->userTime, metrics.thread.userTime);
+        statistics->systemTime = qMax(statistics->systemTime, metrics.thread.systemTime);
+        break;
+    }
+
+    case QuickenMetrics::Memory: {
+        const QuickenMemoryMetrics& memory = metrics.memory;
+        pssMemory.add(metrics.timeStamp, memory.pssMemory);
+        ussMemory.add(metrics.timeStamp, memory.privateCleanMemory + memory.privateDirtyMemory);
+        anonymousMemory.add(metrics.timeStamp, memory.anonymousMemory);
+        swapMemory.add(metrics.timeStamp, memory.swapMemory);
+        heapUsedMemory.add(metrics.timeStamp, memory.heapUsedMemory);
+        heapFreeMemory.add(metrics.timeStamp, memory.heapFreeMemory);
+        break;
+    }
+
+    case QuickenMetrics::PerfCounters: {
+        const QuickenPerfCounterMetrics& perfCounters = metrics.perfCounters;
+        if (perfCounters.source >= QuickenPerfCounterMetrics::SourceCount) {
+            break;
+        }
+        WindowStatistics* statistics = windows.value(perfCounters.window, nullptr);
+        if (!statistics) {
+            statistics = new WindowStatistics;
+            statistics->firstTimeStamp = metrics.timeStamp;
+            windows.insert(perfCounters.window, statistics);
+        }
+        const int index = perfCounters.role == QuickenThreadMetrics::Gui
+            ? WindowStatistics::GuiPerfCounters : WindowStatistics::RenderPerfCounters;
+        const int source = perfCounters.source;
+        statistics->perfCounterFrameCount[index][source]++;
+        quint64 total = 0;
+        for (int i = 0; i < QuickenPerfCounterMetrics::PhaseCount; ++i) {
+            for (int j = 0; j < QuickenPerfCounterMetrics::counterCount; ++j) {
+                statistics->perfCounterTotals[index][source][i][j] += perfCounters.values[i][j];
+            }
+            total += perfCounters.values[i][0];
+        }
+        if (index == WindowStatistics::RenderPerfCounters
+            && perfCounters.source == QuickenPerfCounterMetrics::Hardware) {
+            statistics->histograms[WindowStatistics::Instructions].record(total);
+        }
+        break;
+    }
+
+    case QuickenMetrics::Engine: {
+        const QuickenEngineMetrics& engine = metrics.engine;
+        WindowStatistics* statistics = windows.value(engine.window, nullptr);
+        if (!statistics) {
+            statistics = new WindowStatistics;
+            statistics->firstTimeStamp = metrics.timeStamp;
+            windows.insert(engine.window, statistics);
+        }
+        statistics->engineFrameCount++;
+        if (engine.gcCount > 0) {
+            statistics->gcCount += engine.gcCount;
+            statistics->gcTimeEstimate.record(engine.gcTimeEstimate);
+            statistics->gcFrames.insert(engine.number);
+        }
+        statistics->bindings.add(metrics.timeStamp, engine.bindingCount);
+        statistics->jsHeapUsed.add(metrics.timeStamp, engine.heapUsed >> 10);
+        statistics->jsHeapAllocated.add(metrics.timeStamp, engine.heapAllocated >> 10);
+        break;
+    }
+
+    case QuickenMetrics::Pacing: {
+        const QuickenPacingMetrics& pacing = metrics.pacing;
+        WindowStatistics* statistics = windows.value(pacing.window, nullptr);
+        if (!statistics) {
+            statistics = new WindowStatistics;
+            statistics->firstTimeStamp = metrics.timeStamp;
+            windows.insert(pacing.window, statistics);
+        }
+        statistics->pacedFrameCount += pacing.frameCount;
+        statistics->pacedVsyncCount += pacing.vsyncCount;
+        statistics->droppedVsyncCount += pacing.droppedVsyncCount;
+        statistics->pacingChangeCount += pacing.pacingChangeCount;
+        statistics->smoothness.add(metrics.timeStamp, pacing.smoothness / 100.0);
+        if (pacing.vsyncInterval > 0) {
+            statistics->refreshRate.add(metrics.timeStamp, 1000000000.0 / pacing.vsyncInterval);
+        }
+        break;
+    }
+
+    case QuickenMetrics::Timeline: {
+        // The render thread phases are already timed by the frame metrics.
+        const QuickenTimelineMetrics& timeline = metrics.timeline;
+        if (timeline.role != QuickenThreadMetrics::Gui) {
+            break;
+        }
+        WindowStatistics* statistics = windows.value(timeline.window, nullptr);
+        if (!statistics) {
+            statistics = new WindowStatistics;
+            statistics->firstTimeStamp = metrics.timeStamp;
+            windows.insert(timeline.window, statistics);
+        }
+        const int phases[][3] = {
+            { WindowStatistics::PolishTime, QuickenTimelineMetrics::UpdateRequest,
+              QuickenTimelineMetrics::PolishEnd },
+            { WindowStatistics::GuiBlockedTime, QuickenTimelineMetrics::PolishEnd,
+              QuickenTimelineMetrics::Unblocked },
+            { WindowStatistics::AnimationTime, QuickenTimelineMetrics::Unblocked,
+              QuickenTimelineMetrics::GuiFrameEnd }
+        };
+        for (int i = 0; i < static_cast<int>(ARRAY_SIZE(phases)); ++i) {
+            const quint64 start = timeline.timeStamps[phases[i][1]];
+            const quint64 end = timeline.timeStamps[phases[i][2]];
+            if (start > 0 && end >= start) {
+                statistics->histograms[phases[i][0]].record(end - start);
+            }
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+void Statistics::merge(const Statistics& statistics)
+{
+    for (QHash<quint32, WindowStatistics*>::const_iterator it = statistics.windows.constBegin();
+         it != statistics.windows.constEnd(); ++it) {
+        WindowStatistics* windowStatistics = windows.value(it.key(), nullptr);
+        if (!windowStatistics) {
+            windowStatistics = new WindowStatistics;
+            windows.insert(it.key(), windowStatistics);
+        }
+        windowStatistics->merge(*it.value());
+    }
+    for (QHash<quint32, NumericStatistics*>::const_iterator it = statistics.numerics.constBegin();
+         it != statistics.numerics.constEnd(); ++it) {
+        NumericStatistics* numericStatistics = numerics.value(it.key(), nullptr);
+        if (!numericStatistics) {
+            numericStatistics = new NumericStatistics;
+            numerics.insert(it.key(), numericStatistics);
+        }
+        numericStatistics->merge(*it.value());
+    }
+    for (QHash<QByteArray, QuickenHistogram*>::const_iterator it = statistics.scopes.constBegin();
+         it != statistics.scopes.constEnd(); ++it) {
+        QuickenHistogram* histogram = scopes.value(it.key(), nullptr);
+        if (!histogram) {
+            histogram = new QuickenHistogram;
+            scopes.insert(it.key(), histogram);
+        }
+        histogram->add(*it.value());
+    }
+    for (QHash<quint32, ThreadStatistics*>::const_iterator it = statistics.threads.constBegin();
+         it != statistics.threads.constEnd(); ++it) {
+        ThreadStatistics* threadStatistics = threads.value(it.key(), nullptr);
+        if (!threadStatistics) {
+            threadStatistics = new ThreadStatistics;
+            threads.insert(it.key(), threadStatistics);
+        }
+        threadStatistics->merge(*it.value());
+    }
+    cpuUsage.merge(statistics.cpuUsage);
+    rssMemory.merge(statistics.rssMemory);
+    vszMemory.merge(statistics.vszMemory);
+    threadCount.merge(statistics.threadCount);
+    readBytes.merge(statistics.readBytes);
+    writtenBytes.merge(statistics.writtenBytes);
+    pssMemory.merge(statistics.pssMemory);
+    ussMemory.merge(statistics.ussMemory);
+    anonymousMemory.merge(statistics.anonymousMemory);
+    swapMemory.merge(statistics.swapMemory);
+    heapUsedMemory.merge(statistics.heapUsedMemory);
+    heapFreeMemory.merge(statistics.heapFreeMemory);
+    metricsCount += statistics.metricsCount;
+    invalidLineCount += statistics.invalidLineCount;
+    genericCount += statistics.genericCount;
+    windowEventCount += statistics.windowEventCount;
+    for (int i = 0; i < QuickenMetrics::TypeCount; ++i) {
+        droppedCount[i] += statistics.droppedCount[i];
+    }
+}
+
+// Get the distribution of a histogram of nanoseconds in milliseconds (or of
+// instructions in millions).
+static QJsonObject histogramToJson(const QuickenHistogram& histogram)
+{
+    const double percentiles[] = { 50.0, 90.0, 95.0, 99.0, 99.9 };
+    const char* const percentileNames[] = { "p50", "p90", "p95", "p99", "p99.9" };
+    Q_STATIC_ASSERT(ARRAY_SIZE(percentiles) == ARRAY_SIZE(percentileNames));
+    quint64 values[ARRAY_SIZE(percentiles)];
+    histogram.percentiles(percentiles, values, ARRAY_SIZE(percentiles));
+
+    QJsonObject object;
+    object.insert(QStringLiteral("count"), static_cast<double>(histogram.count()));
+    object.insert(QStringLiteral("min"), histogram.min() / 1000000.0);
+    object.insert(QStringLiteral("mean"), histogram.mean() / 1000000.0);
+    for (int i = 0; i < static_cast<int>(ARRAY_SIZE(percentiles)); ++i) {
+        object.insert(QLatin1String(percentileNames[i]), values[i] / 1000000.0);
+    }
+    object.insert(QStringLiteral("max"), histogram.max() / 1000000.0);
+    return object;
+}
+
+QJsonObject Statistics::toJson(quint64 vsyncInterval) const
+{
+    const char* const typeNames[] = {
+        "process", "window", "frame", "generic", "dropped", "numeric", "scope", "thread",
+        "memory", "perfCounters", "engine", "pacing", "timeline"
+    };
+    const char* const roleNames[] = { "other", "gui", "render", "pixmapReader", "qml", "logging" };
+    Q_STATIC_ASSERT(ARRAY_SIZE(roleNames) == QuickenThreadMetrics::RoleCount);
+    Q_STATIC_ASSERT(ARRAY_SIZE(typeNames) == QuickenMetrics::TypeCount);
+
+    QVector<quint32> ids;
+    ids.reserve(windows.size());
+    for (QHash<quint32, WindowStatistics*>::const_iterator it = windows.constBegin();
+         it != windows.constEnd(); ++it) {
+        ids.append(it.key());
+    }
+    std::sort(ids.begin(), ids.end());
+
+    QJsonArray windowArray;
+    for (int i = 0; i < ids.size(); ++i) {
+        const WindowStatistics* statistics = windows.value(ids[i]);
+        const double duration =
+            (statistics->lastTimeStamp - statistics->firstTimeStamp) / 1000000000.0;
+        QJsonObject window;
+        window.insert(QStringLiteral("id"), static_cast<double>(ids[i]));
+        window.insert(QStringLiteral("frameCount"), static_cast<double>(statistics->frameCount));
+        window.insert(QStringLiteral("duration"), duration);
+        window.insert(QStringLiteral("averageFps"), duration > 0.0
+                      ? (statistics->frameCount - 1) / duration : 0.0);
+        window.insert(QStringLiteral("jankCount"), static_cast<double>(statistics->jankCount));
+        window.insert(QStringLiteral("missedVsyncCount"),
+                      static_cast<double>(statistics->missedVsyncCount));
+        window.insert(QStringLiteral("majorPageFaultJankCount"),
+                      static_cast<double>(statistics->majorPageFaultJankCount));
+        window.insert(QStringLiteral("involuntarySwitchJankCount"),
+                      static_cast<double>(statistics->involuntarySwitchJankCount));
+        QJsonObject pageFaults;
+        pageFaults.insert(QStringLiteral("minor"),
+                          static_cast<double>(statistics->minorPageFaults));
+        pageFaults.insert(QStringLiteral("major"),
+                          static_cast<double>(statistics->majorPageFaults));
+        window.insert(QStringLiteral("pageFaults"), pageFaults);
+        QJsonObject contextSwitches;
+        contextSwitches.insert(QStringLiteral("voluntary"),
+                               static_cast<double>(statistics->voluntarySwitches));
+        contextSwitches.insert(QStringLiteral("involuntary"),
+                               static_cast<double>(statistics->involuntarySwitches));
+        window.insert(QStringLiteral("contextSwitches"), contextSwitches);
+        QJsonObject sceneGraph;
+        for (int j = 0; j < WindowStatistics::SceneGraphFieldCount; ++j) {
+            sceneGraph.insert(QLatin1String(sceneGraphFieldNames[j]),
+                              statistics->sceneGraph[j].toJson());
+        }
+        window.insert(QStringLiteral("sceneGraph"), sceneGraph);
+        // Mean counter values per frame and phase.
+        QJsonObject perfCounters;
+        for (int j = 0; j < WindowStatistics::PerfCountersCount; ++j) {
+            QJsonObject thread;
+            for (int source = 0; source < QuickenPerfCounterMetrics::SourceCount; ++source) {
+                const quint64 count = statistics->perfCounterFrameCount[j][source];
+                if (count == 0) {
+                    continue;
+                }
+                QJsonObject counters;
+                counters.insert(QStringLiteral("frameCount"), static_cast<double>(count));
+                for (int k = 0; k < QuickenPerfCounterMetrics::PhaseCount; ++k) {
+                    QJsonObject phase;
+                    for (int l = 0; l < QuickenPerfCounterMetrics::counterCount; ++l) {
+                        phase.insert(
+                            QLatin1String(perfCounterNames[source][l]),
+                            static_cast<double>(statistics->perfCounterTotals[j][source][k][l])
+                            / count);
+                    }
+                    counters.insert(QLatin1String(perfPhaseNames[k]), phase);
+                }
+                thread.insert(QLatin1String(perfSourceNames[source]), counters);
+            }
+            if (!thread.isEmpty()) {
+                perfCounters.insert(j == WindowStatistics::GuiPerfCounters
+                                    ? QStringLiteral("gui") : QStringLiteral("render"), thread);
+            }
+        }
+        window.insert(QStringLiteral("perfCounters"), perfCounters);
+        // Janky frames are matched to the frames with garbage collections by
+        // number, engine activity delays the frame it's reported with.
+        int gcJankCount = 0;
+        for (QSet<quint32>::const_iterator it = statistics->gcFrames.constBegin();
+             it != statistics->gcFrames.constEnd(); ++it) {
+            if (statistics->jankyFrames.contains(*it)) {
+                gcJankCount++;
+            }
+        }
+        QJsonObject engine;
+        engine.insert(QStringLiteral("frameCount"),
+                      static_cast<double>(statistics->engineFrameCount));
+        engine.insert(QStringLiteral("gcCount"), static_cast<double>(statistics->gcCount));
+        engine.insert(QStringLiteral("gcJankCount"), gcJankCount);
+        engine.insert(QStringLiteral("gcTimeEstimate"),
+                      histogramToJson(statistics->gcTimeEstimate));
+        engine.insert(QStringLiteral("bindings"), statistics->bindings.toJson());
+        engine.insert(QStringLiteral("heapUsed"), statistics->jsHeapUsed.toJson());
+        engine.insert(QStringLiteral("heapAllocated"), statistics->jsHeapAllocated.toJson());
+        window.insert(QStringLiteral("engine"), engine);
+        // Smoothness over the whole log, as computed by the window monitor for
+        // each update.
+        const quint64 pacedVsyncCount =
+            statistics->pacedVsyncCount + statistics->pacingChangeCount;
+        QJsonObject pacing;
+        pacing.insert(QStringLiteral("frameCount"),
+                      static_cast<double>(statistics->pacedFrameCount));
+        pacing.insert(QStringLiteral("vsyncCount"),
+                      static_cast<double>(statistics->pacedVsyncCount));
+        pacing.insert(QStringLiteral("droppedVsyncCount"),
+                      static_cast<double>(statistics->droppedVsyncCount));
+        pacing.insert(QStringLiteral("pacingChangeCount"),
+                      static_cast<double>(statistics->pacingChangeCount));
+        pacing.insert(QStringLiteral("smoothness"), pacedVsyncCount > 0
+                      ? qMin(100.0 * statistics->pacedFrameCount / pacedVsyncCount, 100.0)
+                      : 0.0);
+        pacing.insert(QStringLiteral("smoothnessTrend"), statistics->smoothness.toJson());
+        pacing.insert(QStringLiteral("refreshRate"), statistics->refreshRate.toJson());
+        window.insert(QStringLiteral("pacing"), pacing);
+        QJsonObject timings;
+        for (int j = 0; j < WindowStatistics::FieldCount; ++j) {
+            timings.insert(QLatin1String(fieldNames[j]),
+                           histogramToJson(statistics->histograms[j]));
+        }
+        window.insert(QStringLiteral("timings"), timings);
+        windowArray.append(window);
+    }
+
+    QJsonObject process;
+    process.insert(QStringLiteral("cpuUsage"), cpuUsage.toJson());
+    process.insert(QStringLiteral("rssMemory"), rssMemory.toJson());
+    process.insert(QStringLiteral("vszMemory"), vszMemory.toJson());
+    process.insert(QStringLiteral("threadCount"), threadCount.toJson());
+    process.insert(QStringLiteral("readBytes"), readBytes.toJson());
+    process.insert(QStringLiteral("writtenBytes"), writtenBytes.toJson());
+
+    QJsonObject memory;
+    memory.insert(QStringLiteral("pssMemory"), pssMemory.toJson());
+    memory.insert(QStringLiteral("ussMemory"), ussMemory.toJson());
+    memory.insert(QStringLiteral("anonymousMemory"), anonymousMemory.toJson());
+    memory.insert(QStringLiteral("swapMemory"), swapMemory.toJson());
+    memory.insert(QStringLiteral("heapUsedMemory"), heapUsedMemory.toJson());
+    memory.insert(QStringLiteral("heapFreeMemory"), heapFreeMemory.toJson());
+
+    QVector<quint32> numericIds;
+    numericIds.reserve(numerics.size());
+    for (QHash<quint32, NumericStatistics*>::const_iterator it = numerics.constBegin();
+         it != numerics.constEnd(); ++it) {
+        numericIds.append(it.key());
+    }
+    std::sort(numericIds.begin(), numericIds.end());
+
+    QJsonArray numericArray;
+    for (int i = 0; i < numericIds.size(); ++i) {
+        const NumericStatistics* statistics = numerics.value(numericIds[i]);
+        QJsonObject numeric;
+        numeric.insert(QStringLiteral("id"), static_cast<double>(numericIds[i]));
+        numeric.insert(QStringLiteral("name"), QString::fromLatin1(statistics->name));
+        numeric.insert(QStringLiteral("unit"), QString::fromLatin1(statistics->unit));
+        QJsonArray values;
+        for (int j = 0; j < statistics->values.size(); ++j) {
+            values.append(statistics->values[j].toJson());
+        }
+        numeric.insert(QStringLiteral("values"), values);
+        numericArray.append(numeric);
+    }
+
+    QJsonObject scopeObject;
+    for (QHash<QByteArray, QuickenHistogram*>::const_iterator it = scopes.constBegin();
+         it != scopes.constEnd(); ++it) {
+        scopeObject.insert(QString::fromLatin1(it.key()), histogramToJson(*it.value()));
+    }
+
+    QVector<quint32> threadIds;
+    threadIds.reserve(threads.size());
+    for (QHash<quint32, ThreadStatistics*>::const_iterator it = threads.constBegin();
+         it != threads.constEnd(); ++it) {
+        threadIds.append(it.key());
+    }
+    std::sort(threadIds.begin(), threadIds.end());
+
+    QJsonArray threadArray;
+    for (int i = 0; i < threadIds.size(); ++i) {
+        const ThreadStatistics* statistics = threads.value(threadIds[i]);
+        QJsonObject thread;
+        thread.insert(QStringLiteral("id"), static_cast<double>(threadIds[i]));
+        thread.insert(QStringLiteral("name"), QString::fromLatin1(statistics->name));
+        thread.insert(QStringLiteral("role"), QLatin1String(
+            statistics->role < QuickenThreadMetrics::RoleCount ? roleNames[statistics->role]
+                                                               : roleNames[0]));
+        thread.insert(QStringLiteral("cpuUsage"), statistics->cpuUsage.toJson());
+        thread.insert(QStringLiteral("userTime"), statistics->userTime / 1000000.0);
+        thread.insert(QStringLiteral("systemTime"), statistics->systemTime / 1000000.0);
+        threadArray.append(thread);
+    }
+
+    QJsonObject dropped;
+    for (int i = 0; i < QuickenMetrics::TypeCount; ++i) {
+        dropped.insert(QLatin1String(typeNames[i]), static_cast<double>(droppedCount[i]));
+    }
+
+    QJsonObject object;
+    object.insert(QStringLiteral("metricsCount"), static_cast<double>(metricsCount));
+    object.insert(QStringLiteral("invalidLineCount"), static_cast<double>(invalidLineCount));
+    object.insert(QStringLiteral("genericCount"), static_cast<double>(genericCount));
+    object.insert(QStringLiteral("windowEventCount"), static_cast<double>(windowEventCount));
+    object.insert(QStringLiteral("vsyncInterval"), vsyncInterval / 1000000.0);
+    object.insert(QStringLiteral("windows"), windowArray);
+    object.insert(QStringLiteral("process"), process);
+    object.insert(QStringLiteral("memory"), memory);
+    object.insert(QStringLiteral("numeric"), numericArray);
+    object.insert(QStringLiteral("scopes"), scopeObject);
+    object.insert(QStringLiteral("threads"), threadArray);
+    object.insert(QStringLiteral("dropped"), dropped);
+    return object;
+}
+
+// Parses a space separated unsigned integer, returns false if there's none.
+static inline bool parseInteger(const char*& p, const char* end, quint64* value)
+{
+    if (p == end || *p != ' ') {
+        return false;
+    }
+    p++;
+    if (p == end || *p < '0' || *p > '9') {
+        return false;
+    }
+    quint64 integer = 0;
+    do {
+        integer = integer * 10 + (*p++ - '0');
+    } while (p != end && *p >= '0' && *p <= '9');
+    *value = integer;
+    return true;
+}
+
+// Parses a space separated token, returns false if there's none.
+static inline bool parseToken(const char*& p, const char* end, const char** token, int* size)
+{
+    if (p == end || *p != ' ') {
+        return false;
+    }
+    p++;
+    *token = p;
+    while (p != end && *p != ' ') {
+        p++;
+    }
+    *size = p - *token;
+    return *size > 0;
+}
+
+// Parses a space separated signed integer or real, returns false if there's
+// none.
+static bool parseNumber(const char*& p, const char* end, bool real, qint64* integer, double* value)
+{
+    const char* token;
+    int size;
+    char string[64];
+    if (!parseToken(p, end, &token, &size) || size >= static_cast<int>(sizeof(string))) {
+        return false;
+    }
+    memcpy(string, token, size);
+    string[size] = '\0';
+    char* stringEnd;
+    if (real) {
+        *value = strtod(string, &stringEnd);
+    } else {
+        *integer = strtoll(string, &stringEnd, 10);
+    }
+    return stringEnd == &string[size];
+}
+
+// Parses the parsable line [begin, end), without the new line character, into
+// metrics. Returns false if the line isn't valid.
+static bool parseLine(const char* begin, const char* end, QuickenMetrics* metrics)
+{
+    if (end - begin < 2 || begin[1] != ' ') {
+        return false;
+    }
+    const char* p = begin + 1;
+    quint64 values[24];
+    Q_STATIC_ASSERT(ARRAY_SIZE(values) >= 2 + QuickenMetrics::TypeCount);
+
+    switch (begin[0]) {
+    case 'F':
+        for (int i = 0; i < 8; ++i) {
+            if (!parseInteger(p, end, &values[i])) {
+                return false;
+            }
+        }
+        metrics->type = QuickenMetrics::Frame;
+        metrics->timeStamp = values[0];
+        metrics->frame.window = values[1];
+        metrics->frame.number = values[2];
+        metrics->frame.deltaTime = values[3];
+        metrics->frame.syncTime = values[4];
+        metrics->frame.renderTime = values[5];
+        metrics->frame.gpuTime = values[6];
+        metrics->frame.swapTime = values[7];
+        // Lines without extension line (older versions) have no CPU time, page
+        // faults, context switches, scene graph statistics, input latency and
+        // dropped vsyncs.
+        metrics->frame.cpuTime = 0;
+        metrics->frame.minorPageFaults = 0;
+        metrics->frame.majorPageFaults = 0;
+        metrics->frame.voluntaryContextSwitches = 0;
+        metrics->frame.involuntaryContextSwitches = 0;
+        metrics->frame.nodeCount = 0;
+        metrics->frame.opaqueBatchCount = 0;
+        metrics->frame.alphaBatchCount = 0;
+        metrics->frame.drawCallCount = 0;
+        metrics->frame.materialChangeCount = 0;
+        metrics->frame.shaderChangeCount = 0;
+        metrics->frame.vertexUploadSize = 0;
+        metrics->frame.indexUploadSize = 0;
+        metrics->frame.inputLatency = 0;
+        metrics->frame.inputEventCount = 0;
+        metrics->frame.droppedVsyncCount = 0;
+        return p == end;
+
+    case 'P':
+        for (int i = 0; i < 5; ++i) {
+            if (!parseInteger(p, end, &values[i])) {
+                return false;
+            }
+        }
+        metrics->type = QuickenMetrics::Process;
+        metrics->timeStamp = values[0];
+        metrics->process.cpuUsage = values[1];
+        metrics->process.vszMemory = values[2];
+        metrics->process.rssMemory = values[3];
+        metrics->process.threadCount = values[4];
+        // Lines without extension line (older versions) have no I/O bytes, page
+        // faults and context switches.
+        metrics->process.readBytes = 0;
+        metrics->process.writtenBytes = 0;
+        metrics->process.minorPageFaults = 0;
+        metrics->process.majorPageFaults = 0;
+        metrics->process.voluntaryContextSwitches = 0;
+        metrics->process.involuntaryContextSwitches = 0;
+        return p == end;
+
+    case 'W':
+        for (int i = 0; i < 5; ++i) {
+            if (!parseInteger(p, end, &values[i])) {
+                return false;
+            }
+        }
+        metrics->type = QuickenMetrics::Window;
+        metrics->timeStamp = values[0];
+        metrics->window.id = values[1];
+        metrics->window.state = static_cast<QuickenWindowMetrics::State>(values[2]);
+        metrics->window.width = values[3];
+        metrics->window.height = values[4];
+        return p == end;
+
+    case 'G':
+        // The string isn't needed by the analysis.
+        if (!parseInteger(p, end, &values[0]) || !parseInteger(p, end, &values[1])) {
+            return false;
+        }
+        metrics->type = QuickenMetrics::Generic;
+        metrics->timeStamp = values[0];
+        metrics->generic.id = values[1];
+        return true;
+
+    case 'D': {
+        // Logs written by older versions might have less types.
+        int count = 0;
+        while (count < 2 + QuickenMetrics::TypeCount && parseInteger(p, end, &values[count])) {
+            count++;
+        }
+        if (count < 2 || p != end) {
+            return false;
+        }
+        metrics->type = QuickenMetrics::Dropped;
+        metrics->timeStamp = values[0];
+        metrics->dropped.window = values[1];
+        for (int i = 0; i < QuickenMetrics::TypeCount; ++i) {
+            metrics->dropped.count[i] = i + 2 < count ? values[i + 2] : 0;
+        }
+        return true;
+    }
+
+    case 'T': {
+        // Lines store the duration instead of the start time.
+        for (int i = 0; i < 4; ++i) {
+            if (!parseInteger(p, end, &values[i])) {
+                return false;
+            }
+        }
+        // The name is the rest of the line, it might contain spaces.
+        if (p == end || *p != ' ' || p + 1 == end) {
+            return false;
+        }
+        const char* token = p + 1;
+        const int size = end - token;
+        metrics->type = QuickenMetrics::Scope;
+        metrics->timeStamp = values[0];
+        metrics->scope.thread = values[1];
+        metrics->scope.depth = values[2];
+        metrics->scope.startTime = values[0] - qMin(values[0], values[3]);
+        memset(metrics->scope.name, 0, sizeof(metrics->scope.name));
+        memcpy(metrics->scope.name, token,
+               qMin(size, static_cast<int>(QuickenScopeMetrics::maxNameSize) - 1));
+        return true;
+    }
+
+    case 'H': {
+        // The state is a character and the name is the rest of the line, it
+        // might contain spaces.
+        const char* token;
+        int size;
+        if (!parseInteger(p, end, &values[0]) || !parseInteger(p, end, &values[1])
+            || !parseInteger(p, end, &values[2]) || !parseToken(p, end, &token, &size)
+            || size != 1) {
+            return false;
+        }
+        const char state = token[0];
+        for (int i = 3; i < 6; ++i) {
+            if (!parseInteger(p, end, &values[i])) {
+                return false;
+            }
+        }
+        if (p == end || *p != ' ' || p + 1 == end) {
+            return false;
+        }
+        token = p + 1;
+        size = end - token;
+        metrics->type = QuickenMetrics::Thread;
+        metrics->timeStamp = values[0];
+        metrics->thread.thread = values[1];
+        metrics->thread.role = values[2];
+        metrics->thread.state = state;
+        metrics->thread.cpuUsage = values[3];
+        metrics->thread.userTime = values[4];
+        metrics->thread.systemTime = values[5];
+        memset(metrics->thread.name, 0, sizeof(metrics->thread.name));
+        memcpy(metrics->thread.name, token,
+               qMin(size, static_cast<int>(QuickenThreadMetrics::maxNameSize) - 1));
+        return true;
+    }
+
+    case 'M': {
+        for (int i = 0; i < 10; ++i) {
+            if (!parseInteger(p, end, &values[i])) {
+                return false;
+            }
+        }
+        QuickenMemoryMetrics* memory = &metrics->memory;
+        metrics->type = QuickenMetrics::Memory;
+        metrics->timeStamp = values[0];
+        memory->pssMemory = values[1];
+        memory->privateCleanMemory = values[2];
+        memory->privateDirtyMemory = values[3];
+        memory->anonymousMemory = values[4];
+        memory->swapMemory = values[5];
+        memory->heapArenaMemory = values[6];
+        memory->heapUsedMemory = values[7];
+        memory->heapFreeMemory = values[8];
+        memory->heapMappedMemory = values[9];
+        return p == end;
+    }
+
+    case 'C': {
+        for (int i = 0; i < 14; ++i) {
+            if (!parseInteger(p, end, &values[i])) {
+                return false;
+            }
+        }
+        QuickenPerfCounterMetrics* perfCounters = &metrics->perfCounters;
+        metrics->type = QuickenMetrics::PerfCounters;
+        metrics->timeStamp = values[0];
+        perfCounters->window = values[1];
+        perfCounters->number = values[2];
+        perfCounters->role = values[3];
+        perfCounters->source = values[4];
+        for (int i = 0; i < QuickenPerfCounterMetrics::PhaseCount; ++i) {
+            for (int j = 0; j < QuickenPerfCounterMetrics::counterCount; ++j) {
+                perfCounters->values[i][j] =
+                    values[5 + i * QuickenPerfCounterMetrics::counterCount + j];
+            }
+        }
+        return p == end;
+    }
+
+    case 'E': {
+        for (int i = 0; i < 8; ++i) {
+            if (!parseInteger(p, end, &values[i])) {
+                return false;
+            }
+        }
+        QuickenEngineMetrics* engine = &metrics->engine;
+        metrics->type = QuickenMetrics::Engine;
+        metrics->timeStamp = values[0];
+        engine->window = values[1];
+        engine->number = values[2];
+        engine->heapUsed = values[3];
+        engine->heapAllocated = values[4];
+        engine->gcCount = values[5];
+        engine->gcTimeEstimate = values[6];
+        engine->bindingCount = values[7];
+        return p == end;
+    }
+
+    case 'V': {
+        for (int i = 0; i < 10; ++i) {
+            if (!parseInteger(p, end, &values[i])) {
+                return false;
+            }
+        }
+        QuickenPacingMetrics* pacing = &metrics->pacing;
+        metrics->type = QuickenMetrics::Pacing;
+        metrics->timeStamp = values[0];
+        pacing->window = values[1];
+        pacing->number = values[2];
+        pacing->vsyncInterval = values[3];
+        pacing->screenVsyncInterval = values[4];
+        pacing->frameCount = values[5];
+        pacing->vsyncCount = values[6];
+        pacing->droppedVsyncCount = values[7];
+        pacing->pacingChangeCount = values[8];
+        pacing->smoothness = values[9];
+        return p == end;
+    }
+
+    case 'L': {
+        for (int i = 0; i < 5 + QuickenTimelineMetrics::maxBoundaryCount; ++i) {
+            if (!parseInteger(p, end, &values[i])) {
+                return false;
+            }
+        }
+        QuickenTimelineMetrics* timeline = &metrics->timeline;
+        metrics->type = QuickenMetrics::Timeline;
+        metrics->timeStamp = values[0];
+        timeline->window = values[1];
+        timeline->number = values[2];
+        timeline->thread = values[3];
+        timeline->role = values[4];
+        for (int i = 0; i < QuickenTimelineMetrics::maxBoundaryCount; ++i) {
+            timeline->timeStamps[i] = values[5 + i];
+        }
+        return p == end;
+    }
+
+    case 'N': {
+        for (int i = 0; i < 3; ++i) {
+            if (!parseInteger(p, end, &values[i])) {
+                return false;
+            }
+        }
+        if (values[2] >= QuickenNumericMetrics::KindCount) {
+            return false;
+        }
+        QuickenNumericMetrics* numeric = &metrics->numeric;
+        metrics->type = QuickenMetrics::Numeric;
+        metrics->timeStamp = values[0];
+        numeric->id = values[1];
+        numeric->kind = values[2];
+        numeric->valueCount = 0;
+        if (numeric->kind == QuickenNumericMetrics::Declaration) {
+            // The unit is optional.
+            const char* token;
+            int size;
+            if (!parseToken(p, end, &token, &size)) {
+                return false;
+            }
+            memset(&numeric->declaration, 0, sizeof(numeric->declaration));
+            memcpy(numeric->declaration.name, token,
+                   qMin(size, static_cast<int>(QuickenNumericDeclaration::maxNameSize) - 1));
+            if (parseToken(p, end, &token, &size)) {
+                memcpy(numeric->declaration.unit, token,
+                       qMin(size, static_cast<int>(QuickenNumericDeclaration::maxUnitSize) - 1));
+            }
+        } else {
+            const bool real = numeric->kind == QuickenNumericMetrics::Real;
+            while (p != end && numeric->valueCount < QuickenNumericMetrics::maxValueCount) {
+                const int i = numeric->valueCount;
+                if (!parseNumber(p, end, real, &numeric->integers[i], &numeric->reals[i])) {
+                    return false;
+                }
+                numeric->valueCount++;
+            }
+        }
+        return p == end;
+    }
+
+    default:
+        return false;
+    }
+}
+
+// Frame and process lines keep their original fields, the values added since
+// are on an extension line right after them.
+static inline bool isExtensionLine(const char* begin, const char* end)
+{
+    return end - begin >= 2 && (begin[0] == 'f' || begin[0] == 'p') && begin[1] == ' ';
+}
+
+// Parses the extension line [begin, end), without the new line character, into
+// the metrics parsed from the previous line. Returns false if the line isn't
+// valid or doesn't extend these metrics.
+static bool parseExtensionLine(const char* begin, const char* end, QuickenMetrics* metrics)
+{
+    const char* p = begin + 1;
+    quint64 values[19];
+
+    switch (begin[0]) {
+    case 'f':
+        for (int i = 0; i < 19; ++i) {
+            if (!parseInteger(p, end, &values[i])) {
+                return false;
+            }
+        }
+        if (metrics->type != QuickenMetrics::Frame || values[0] != metrics->timeStamp
+            || values[1] != metrics->frame.window || values[2] != metrics->frame.number) {
+            return false;
+        }
+        metrics->frame.cpuTime = values[3];
+        metrics->frame.minorPageFaults = values[4];
+        metrics->frame.majorPageFaults = values[5];
+        metrics->frame.voluntaryContextSwitches = values[6];
+        metrics->frame.involuntaryContextSwitches = values[7];
+        metrics->frame.nodeCount = values[8];
+        metrics->frame.opaqueBatchCount = values[9];
+        metrics->frame.alphaBatchCount = values[10];
+        metrics->frame.drawCallCount = values[11];
+        metrics->frame.materialChangeCount = values[12];
+        metrics->frame.shaderChangeCount = values[13];
+        metrics->frame.vertexUploadSize = values[14];
+        metrics->frame.indexUploadSize = values[15];
+        metrics->frame.inputLatency = values[16];
+        metrics->frame.inputEventCount = values[17];
+        metrics->frame.droppedVsyncCount = values[18];
+        return p == end;
+
+    case 'p':
+        for (int i = 0; i < 7; ++i) {
+            if (!parseInteger(p, end, &values[i])) {
+                return false;
+            }
+        }
+        if (metrics->type != QuickenMetrics::Process || values[0] != metrics->timeStamp) {
+            return false;
+        }
+        metrics->process.readBytes = values[1];
+        metrics->process.writtenBytes = values[2];
+        metrics->process.minorPageFaults = values[3];
+        metrics->process.majorPageFaults = values[4];
+        metrics->process.voluntaryContextSwitches = values[5];
+        metrics->process.involuntaryContextSwitches = values[6];
+        return p == end;
+
+    default:
+        return false;
+    }
+}
+
+// Parses the lines of a chunk of a text log. The chunk starts right after a new
+// line character (or at the file start) and ends right after one (or at the
+// file end), extension lines are in the chunk of the line they extend.
+class ChunkParser : public QRunnable
+{
+public:
+    ChunkParser(const char* begin, const char* end, quint64 vsyncInterval)
+        : m_begin(begin), m_end(end), m_vsyncInterval(vsyncInterval)
+    {
+        setAutoDelete(false);
+    }
+
+    void run() Q_DECL_OVERRIDE;
+
+    const Statistics& statistics() const { return m_statistics; }
+
+private:
+    const char* m_begin;
+    const char* m_end;
+    quint64 m_vsyncInterval;
+    Statistics m_statistics;
+};
+
+void ChunkParser::run()
+{
+    QuickenMetrics metrics;
+    const char* line = m_begin;
+    while (line < m_end) {
+        const char* lineEnd = static_cast<const char*>(memchr(line, '\n', m_end - line));
+        if (!lineEnd) {
+            lineEnd = m_end;
+        }
+        if (lineEnd > line) {
+            if (parseLine(line, lineEnd, &metrics)) {
+                const char* next = lineEnd + 1;
+                if (next < m_end) {
+                    const char* nextEnd = static_cast<const char*>(
+                        memchr(next, '\n', m_end - next));
+                    if (!nextEnd) {
+                        nextEnd = m_end;
+                    }
+                    if (isExtensionLine(next, nextEnd)) {
+                        if (!parseExtensionLine(next, nextEnd, &metrics)) {
+                            m_statistics.invalidLineCount++;
+                        }
+                        lineEnd = nextEnd;
+                    }
+                }
+                m_statistics.add(metrics, m_vsyncInterval);
+            } else {
+                m_statistics.invalidLineCount++;
+            }
+        }
+        line = lineEnd + 1;
+    }
+}
+
+static bool analyzeTextLog(
+    const QString& fileName, QFile* file, const Options& options, quint64 vsyncInterval,
+    Statistics* statistics)
+{
+    const qint64 size = file->size();
+    if (size == 0) {
+        return true;
+    }
+    const char* data = reinterpret_cast<const char*>(file->map(0, size));
+    if (!data) {
+        fprintf(stderr, "Can't map file '%s' (%s).\n", qPrintable(fileName),
+                qPrintable(file->errorString()));
+        return false;
+    }
+
+    // Split the file in chunks starting at line boundaries.
+    const int chunkCount = static_cast<int>(
+        qBound(static_cast<qint64>(1), size / minChunkSize, static_cast<qint64>(options.jobs)));
+    QVector<ChunkParser*> parsers;
+    const char* chunkBegin = data;
+    for (int i = 0; i < chunkCount; ++i) {
+        const char* chunkEnd = data + size;
+        if (i < chunkCount - 1) {
+            const char* splitPoint = data + (size / chunkCount) * (i + 1);
+            const char* newLine = static_cast<const char*>(
+                memchr(splitPoint, '\n', (data + size) - splitPoint));
+            // Extension lines stay with the line they extend.
+            while (newLine && isExtensionLine(newLine + 1, data + size)) {
+                newLine = static_cast<const char*>(
+                    memchr(newLine + 1, '\n', (data + size) - (newLine + 1)));
+            }
+            if (newLine) {
+                chunkEnd = newLine + 1;
+            }
+        }
+        if (chunkEnd > chunkBegin) {
+            parsers.append(new ChunkParser(chunkBegin, chunkEnd, vsyncInterval));
+        }
+        chunkBegin = chunkEnd;
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(options.jobs);
+    for (int i = 0; i < parsers.size(); ++i) {
+        pool.start(parsers[i]);
+    }
+    pool.waitForDone();
+
+    for (int i = 0; i < parsers.size(); ++i) {
+        statistics->merge(parsers[i]->statistics());
+    }
+    qDeleteAll(parsers);
+    file->unmap(reinterpret_cast<uchar*>(const_cast<char*>(data)));
+    return true;
+}
+
+static bool analyzeBinaryLog(
+    const QString& fileName, quint64 vsyncInterval, Statistics* statistics)
+{
+    QuickenLogReader reader(fileName);
+    if (!reader.isOpen()) {
+        fprintf(stderr, "Can't read binary log '%s'.\n", qPrintable(fileName));
+        return false;
+    }
+
+    QVector<QuickenMetrics> metrics(binaryBatchSize);
+    int count;
+    while ((count = reader.read(metrics.data(), binaryBatchSize)) > 0) {
+        for (int i = 0; i < count; ++i) {
+            statistics->add(metrics[i], vsyncInterval);
+        }
+    }
+    if (count == -1) {
+        fprintf(stderr, "Can't read binary log '%s'.\n", qPrintable(fileName));
+        return false;
+    }
+    return true;
+}
+
+// Analyzes a log, either text or binary (starting with a "QUICKEN" magic).
+static bool analyzeLog(
+    const QString& fileName, const Options& options, quint64 vsyncInterval,
+    Statistics* statistics, bool* isBinary)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fprintf(stderr, "Can't open file '%s' (%s).\n", qPrintable(fileName),
+                qPrintable(file.errorString()));
+        return false;
+    }
+
+    char magic[7];
+    *isBinary = file.read(magic, sizeof(magic)) == sizeof(magic)
+        && !memcmp(magic, "QUICKEN", sizeof(magic));
+    if (*isBinary) {
+        file.close();
+        return analyzeBinaryLog(fileName, vsyncInterval, statistics);
+    } else {
+        return analyzeTextLog(fileName, &file, options, vsyncInterval, statistics);
+    }
+}
+
+// Get the value z such that P(Z > z) = probability for a standard normal
+// variable Z, by bisection.
+static double normalQuantile(double probability)
+{
+    double low = -40.0;
+    double high = 40.0;
+    for (int i = 0; i < 100; ++i) {
+        const double middle = 0.5 * (low + high);
+        if (0.5 * erfc(middle / M_SQRT2) > probability) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return 0.5 * (low + high);
+}
+
+// Distribution-free confidence interval of a percentile, given by the order
+// statistics at the ranks n * p -/+ z * sqrt(n * p * (1 - p)) (normal
+// approximation of the binomial distribution of the number of values below the
+// percentile).
+static void percentileInterval(
+    const QuickenHistogram& histogram, double percentile, double z, quint64* low, quint64* high)
+{
+    const double n = static_cast<double>(histogram.count());
+    const double p = percentile / 100.0;
+    const double halfWidth = z * sqrt(n * p * (1.0 - p));
+    const double percentiles[] = {
+        qBound(0.0, 100.0 * (n * p - halfWidth) / n, 100.0),
+        qBound(0.0, 100.0 * (n * p + halfWidth) / n, 100.0)
+    };
+    quint64 values[2];
+    histogram.percentiles(percentiles, values, 2);
+    *low = values[0];
+    *high = values[1];
+}
+
+struct Comparison
+{
+    double u;
+    double z;
+    double pValue;
+    double probabilityOfSuperiority;
+};
+
+// Mann-Whitney U test of the hypothesis that candidate values are neither
+// greater nor lower than baseline values. Values in the same histogram bucket
+// are considered tied. U counts the pairs in which the candidate value is
+// greater (ties count for half), its normal approximation (with tie and
+// continuity corrections) gives a two-sided p-value.
+static Comparison mannWhitney(const QuickenHistogram& baseline, const QuickenHistogram& candidate)
+{
+    const double n1 = static_cast<double>(baseline.count());
+    const double n2 = static_cast<double>(candidate.count());
+    const double n = n1 + n2;
+    double u = 0.0;
+    double tieSum = 0.0;
+    double baselineBelow = 0.0;
+    for (int i = 0; i < QuickenHistogram::bucketCount; ++i) {
+        const double baselineCount = baseline.count(i);
+        const double candidateCount = candidate.count(i);
+        u += candidateCount * (baselineBelow + 0.5 * baselineCount);
+        const double tied = baselineCount + candidateCount;
+        tieSum += tied * tied * tied - tied;
+        baselineBelow += baselineCount;
+    }
+
+    Comparison comparison;
+    const double mean = 0.5 * n1 * n2;
+    const double variance = n1 * n2 / 12.0 * ((n + 1.0) - tieSum / (n * (n - 1.0)));
+    comparison.u = u;
+    if (variance > 0.0) {
+        const double difference = u - mean;
+        const double corrected = qMax(0.0, fabs(difference) - 0.5);
+        comparison.z = (difference < 0.0 ? -corrected : corrected) / sqrt(variance);
+        comparison.pValue = erfc(fabs(comparison.z) / M_SQRT2);
+    } else {
+        comparison.z = 0.0;
+        comparison.pValue = 1.0;
+    }
+    comparison.probabilityOfSuperiority = u / (n1 * n2);
+    return comparison;
+}
+
+static double relativeChange(quint64 baseline, quint64 candidate)
+{
+    return baseline > 0
+        ? 100.0 * (static_cast<double>(candidate) - static_cast<double>(baseline)) / baseline
+        : 0.0;
+}
+
+// Gets the histogram of the compared field, merging the windows.
+static QuickenHistogram* comparedHistogram(const Statistics& statistics, const Options& options)
+{
+    QuickenHistogram* histogram = new QuickenHistogram;
+    for (QHash<quint32, WindowStatistics*>::const_iterator it = statistics.windows.constBegin();
+         it != statistics.windows.constEnd(); ++it) {
+        if (options.window == 0 || it.key() == options.window) {
+            histogram->add(it.value()->histograms[options.field]);
+        }
+    }
+    return histogram;
+}
+
+// Compares the first log (the baseline) with the others (the candidates). A
+// candidate fails if it's significantly slower than the baseline (Mann-Whitney
+// p-value lower than alpha) with a median increase bigger than maxRegression
+// percents, or if its p99 increase is bigger than maxTailRegression percents
+// with non-overlapping (1 - alpha) confidence intervals. Returns the number of
+// failing candidates, -1 in case of error.
+static int compareLogs(const Options& options, quint64 vsyncInterval, QJsonObject* report)
+{
+    const double z = normalQuantile(0.5 * options.alpha);
+    int failureCount = 0;
+    QuickenHistogram* baseline = nullptr;
+    QJsonArray candidates;
+    quint64 baselineMedian = 0;
+    quint64 baselineMean = 0;
+    quint64 baselineP99 = 0;
+    quint64 baselineP99High = 0;
+
+    for (int i = 0; i < options.fileNames.size(); ++i) {
+        const QString& fileName = options.fileNames.at(i);
+        Statistics statistics;
+        bool isBinary;
+        if (!analyzeLog(fileName, options, vsyncInterval, &statistics, &isBinary)) {
+            delete baseline;
+            return -1;
+        }
+        QuickenHistogram* histogram = comparedHistogram(statistics, options);
+        if (histogram->count() < 2) {
+            fprintf(stderr, "Not enough frames in log '%s'.\n", qPrintable(fileName));
+            delete histogram;
+            delete baseline;
+            return -1;
+        }
+
+        const double percentiles[] = { 50.0, 99.0 };
+        quint64 values[2];
+        histogram->percentiles(percentiles, values, 2);
+        quint64 p99Low, p99High;
+        percentileInterval(*histogram, 99.0, z, &p99Low, &p99High);
+        QJsonArray p99Interval;
+        p99Interval.append(p99Low / 1000000.0);
+        p99Interval.append(p99High / 1000000.0);
+
+        if (i == 0) {
+            baseline = histogram;
+            baselineMedian = values[0];
+            baselineMean = histogram->mean();
+            baselineP99 = values[1];
+            baselineP99High = p99High;
+            QJsonObject object;
+            object.insert(QStringLiteral("file"), fileName);
+            object.insert(QStringLiteral("timings"), histogramToJson(*histogram));
+            object.insert(QStringLiteral("p99Interval"), p99Interval);
+            report->insert(QStringLiteral("baseline"), object);
+            continue;
+        }
+
+        const Comparison comparison = mannWhitney(*baseline, *histogram);
+        const double medianChange = relativeChange(baselineMedian, values[0]);
+        const double meanChange = relativeChange(baselineMean, histogram->mean());
+        const double p99Change = relativeChange(baselineP99, values[1]);
+        const bool medianRegression = comparison.pValue < options.alpha
+            && comparison.probabilityOfSuperiority > 0.5 && medianChange > options.maxRegression;
+        const bool tailRegression = p99Low > baselineP99High
+            && p99Change > options.maxTailRegression;
+        const bool failed = medianRegression || tailRegression;
+        if (failed) {
+            failureCount++;
+        }
+        fprintf(stderr, "%s: %s (median %+.1f%%, mean %+.1f%%, p99 %+.1f%%, p-value %.3g)\n",
+                qPrintable(fileName), failed ? "FAIL" : "PASS", medianChange, meanChange,
+                p99Change, comparison.pValue);
+
+        QJsonObject object;
+        object.insert(QStringLiteral("file"), fileName);
+        object.insert(QStringLiteral("timings"), histogramToJson(*histogram));
+        object.insert(QStringLiteral("p99Interval"), p99Interval);
+        object.insert(QStringLiteral("medianChange"), medianChange);
+        object.insert(QStringLiteral("meanChange"), meanChange);
+        object.insert(QStringLiteral("p99Change"), p99Change);
+        object.insert(QStringLiteral("mannWhitneyU"), comparison.u);
+        object.insert(QStringLiteral("z"), comparison.z);
+        object.insert(QStringLiteral("pValue"), comparison.pValue);
+        object.insert(QStringLiteral("probabilityOfSuperiority"),
+                      comparison.probabilityOfSuperiority);
+        object.insert(QStringLiteral("medianRegression"), medianRegression);
+        object.insert(QStringLiteral("tailRegression"), tailRegression);
+        object.insert(QStringLiteral("verdict"),
+                      failed ? QStringLiteral("fail") : QStringLiteral("pass"));
+        candidates.append(object);
+        delete histogram;
+    }
+    delete baseline;
+
+    report->insert(QStringLiteral("field"), QLatin1String(fieldNames[options.field]));
+    report->insert(QStringLiteral("window"), static_cast<double>(options.window));
+    report->insert(QStringLiteral("alpha"), options.alpha);
+    report->insert(QStringLiteral("maxRegression"), options.maxRegression);
+    report->insert(QStringLiteral("maxTailRegression"), options.maxTailRegression);
+    report->insert(QStringLiteral("candidates"), candidates);
+    report->insert(QStringLiteral("verdict"),
+                   failureCount > 0 ? QStringLiteral("fail") : QStringLiteral("pass"));
+    return failureCount;
+}
+
+static void usage()
+{
+    puts("Usage: quicken-log-analyzer [options] <log>");
+    puts("       quicken-log-analyzer --compare [options] <baseline log> <candidate log>...");
+    puts(" ");
+    puts(" Analyze a metrics log (parsable text or binary) and write a JSON report. With");
+    puts(" --compare, compare the frame timings of candidate logs to a baseline log, write a");
+    puts(" JSON report and exit with status 2 if a candidate regressed.");
+    puts(" ");
+    puts(" Options:");
+    puts("  --output <file> ................. Write the report to <file> instead of stdout.");
+    puts("  --jobs <count> .................. Parse text logs with <count> threads (default is");
+    puts("    ............................... the number of cores).");
+    puts("  --refresh-rate <rate> ........... Set the display refresh rate in Hz used to detect");
+    puts("    ............................... janky frames and missed vsyncs (default is 60).");
+    puts("  --help .......................... Show this help.");
+    puts(" ");
+    puts(" Comparison options:");
+    puts("  --field <field> ................. Set the compared frame timing. <field> is either");
+    puts("    ............................... 'delta', 'sync', 'render', 'gpu', 'swap', 'total'");
+    puts("    ............................... (default), 'cpu', 'instructions' (render thread");
+    puts("    ............................... instructions per frame from perf counters, more");
+    puts("    ............................... stable than timings on noisy machines),");
+    puts("    ............................... 'inputLatency' (frames reflecting input events),");
+    puts("    ............................... 'polish', 'guiBlocked' or 'animations' (GUI thread");
+    puts("    ............................... phases from the frame timelines).");
+    puts("  --window <id> ................... Compare the frames of window <id> only (default is");
+    puts("    ............................... all windows).");
+    puts("  --alpha <level> ................. Set the significance level (default is 0.01).");
+    puts("  --max-regression <percent> ...... Set the max median increase of a significantly");
+    puts("    ............................... slower candidate (default is 5).");
+    puts("  --max-tail-regression <percent> . Set the max p99 increase of a candidate with a p99");
+    puts("    ............................... confidence interval above the baseline one (default");
+    puts("    ............................... is 10).");
+    puts(" ");
+    exit(1);
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication application(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("Quicken log analyzer"));
+    QCoreApplication::setOrganizationName(QStringLiteral("Quicken"));
+
+    Options options;
+    const QStringList arguments = QCoreApplication::arguments();
+    for (int i = 1, size = arguments.size(); i < size; ++i) {
+        const QString& argument = arguments.at(i);
+        if (!argument.startsWith(QLatin1Char('-'))) {
+            options.fileNames.append(argument);
+        } else if (argument == QLatin1String("--output") && i + 1 < size) {
+            options.output = arguments.at(++i);
+        } else if (argument == QLatin1String("--jobs") && i + 1 < size) {
+            options.jobs = qMax(1, arguments.at(++i).toInt());
+        } else if (argument == QLatin1String("--refresh-rate") && i + 1 < size) {
+            options.refreshRate = arguments.at(++i).toDouble();
+        } else if (argument == QLatin1String("--compare")) {
+            options.compare = true;
+        } else if (argument == QLatin1String("--field") && i + 1 < size) {
+            const QString field = arguments.at(++i);
+            options.field = -1;
+            for (int j = 0; j < WindowStatistics::FieldCount; ++j) {
+                if (field == QLatin1String(fieldNames[j])) {
+                    options.field = j;
+                }
+            }
+            if (options.field == -1) {
+                usage();
+            }
+        } else if (argument == QLatin1String("--window") && i + 1 < size) {
+            options.window = arguments.at(++i).toUInt();
+        } else if (argument == QLatin1String("--alpha") && i + 1 < size) {
+            options.alpha = qBound(0.0, arguments.at(++i).toDouble(), 1.0);
+        } else if (argument == QLatin1String("--max-regression") && i + 1 < size) {
+            options.maxRegression = arguments.at(++i).toDouble();
+        } else if (argument == QLatin1String("--max-tail-regression") && i + 1 < size) {
+            options.maxTailRegression = arguments.at(++i).toDouble();
+        } else {
+            usage();
+        }
+    }
+    if (options.fileNames.isEmpty() || (!options.compare && options.fileNames.size() > 1)
+        || (options.compare && options.fileNames.size() < 2)) {
+        usage();
+    }
+
+    const quint64 vsyncInterval = options.refreshRate > 0.0
+        ? static_cast<quint64>(1000000000.0 / options.refreshRate) : 0;
+    QJsonObject report;
+    int status = 0;
+    if (options.compare) {
+        const int failureCount = compareLogs(options, vsyncInterval, &report);
+        if (failureCount == -1) {
+            return 1;
+        }
+        status = failureCount > 0 ? 2 : 0;
+    } else {
+        const QString& fileName = options.fileNames.first();
+        Statistics statistics;
+        bool isBinary;
+        if (!analyzeLog(fileName, options, vsyncInterval, &statistics, &isBinary)) {
+            return 1;
+        }
+        report = statistics.toJson(vsyncInterval);
+        report.insert(QStringLiteral("file"), fileName);
+        report.insert(QStringLiteral("format"),
+                      isBinary ? QStringLiteral("binary") : QStringLiteral("text"));
+    }
+    const QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+
+    if (options.output.isEmpty()) {
+        fwrite(json.constData(), 1, json.size(), stdout);
+    } else {
+        QFile output(options.output);
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            || output.write(json) != json.size()) {
+            fprintf(stderr, "Can't write report to '%s' (%s).\n", qPrintable(options.output),
+                    qPrintable(output.errorString()));
+            return 1;
+        }
+    }
+
+    return status;
+}
@@ -0,0 +1,11 @@
+TEMPLATE = app
+TARGET = quicken-log-analyzer
+QT = core
+
+CONFIG += c++11
+SOURCES += main.cpp
+INCLUDEPATH += $${OUT_PWD}/../../include $${OUT_PWD}/../../include/Quicken/$${MODULE_VERSION}
+LIBS += -L$${OUT_PWD}/../../lib -lQuicken
+QMAKE_TARGET_DESCRIPTION = Quicken log analyzer
+
+load(qt_tool)
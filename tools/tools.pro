@@ -1,2 +1,2 @@
 TEMPLATE = subdirs
-SUBDIRS += qmlscenequicken
+SUBDIRS += qmlscenequicken quickenloganalyzer